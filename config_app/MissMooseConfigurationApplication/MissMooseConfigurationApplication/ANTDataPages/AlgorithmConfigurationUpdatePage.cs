@@ -0,0 +1,124 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.Threading.Tasks;
+
+namespace MissMooseConfigurationApplication
+{
+    public class AlgorithmConfigurationUpdatePage : DataPage
+    {
+        #region Public Enums
+
+        /* Sensor algorithm config fields, in the same order as the gateway's config struct. */
+        public enum ConfigField : byte
+        {
+            ActivityVariableMin,
+            ActivityVariableMax,
+            CommonSensorWeightFactor,
+            BaseSensorWeightFactorPir,
+            BaseSensorWeightFactorLidar,
+            RoadProximityFactor0,
+            RoadProximityFactor1,
+            RoadProximityFactor2,
+            CommonSensorTrickleFactor,
+            BaseSensorTrickleFactorPir,
+            BaseSensorTrickleFactorLidar,
+            RoadTrickleProximityFactor0,
+            RoadTrickleProximityFactor1,
+            RoadTrickleProximityFactor2,
+            ActivityVariableDecayFactor,
+            ActivityDecayPeriodMs,
+            PossibleDetectionThresholdRs,
+            PossibleDetectionThresholdNrs,
+            DetectionThresholdRs,
+            DetectionThresholdNrs,
+            MinimumConcernSignalDurationS,
+            MinimumAlarmSignalDurationS,
+
+            /* Tells the gateway to validate the fields sent so far and apply them on its next tick. */
+            Commit = 0xFF
+        }
+
+        #endregion
+
+        #region Private Members
+
+        private static readonly byte dataPageNumber = 0x12;
+
+        #endregion
+
+        #region Public Data Fields
+
+        public override byte DataPageNumber
+        {
+            get { return dataPageNumber; }
+        }
+
+        /* Which of the gateway's sensor grids the update is for. */
+        public byte GridId { get; set; }
+
+        public ConfigField Field { get; set; }
+
+        /* Value for the field, whole number fields are rounded. Unused by a commit. */
+        public float Value { get; set; }
+
+        #endregion
+
+        #region Public Methods
+
+        /* Encodes the current values of this page's data fields into the given txBuffer */
+        public override void Encode(byte[] txBuffer)
+        {
+            txBuffer[0] = DataPageNumber;
+            txBuffer[1] = GridId;
+            txBuffer[2] = (byte)Field;
+
+            byte[] value;
+            if (IsWholeNumberField(Field))
+            {
+                value = BitConverter.GetBytes((UInt16)Math.Round(Value));
+            }
+            else
+            {
+                value = BitConverter.GetBytes(Value);
+            }
+
+            for (int i = 3; i < 8; i++)
+            {
+                txBuffer[i] = 0xFF;
+            }
+            Array.Copy(value, 0, txBuffer, 3, value.Length);
+        }
+
+        /* Decodes the given rxBuffer into this page's data fields */
+        public override void Decode(byte[] rxBuffer)
+        {
+            GridId = rxBuffer[1];
+            Field = (ConfigField)rxBuffer[2];
+
+            if (IsWholeNumberField(Field))
+            {
+                Value = BitConverter.ToUInt16(rxBuffer, 3);
+            }
+            else
+            {
+                Value = BitConverter.ToSingle(rxBuffer, 3);
+            }
+        }
+
+        #endregion
+
+        #region Private Methods
+
+        /* Checks if the gateway stores a field as a whole number rather than a float */
+        private static bool IsWholeNumberField(ConfigField field)
+        {
+            return field == ConfigField.ActivityDecayPeriodMs
+                || field == ConfigField.MinimumConcernSignalDurationS
+                || field == ConfigField.MinimumAlarmSignalDurationS;
+        }
+
+        #endregion
+    }
+}
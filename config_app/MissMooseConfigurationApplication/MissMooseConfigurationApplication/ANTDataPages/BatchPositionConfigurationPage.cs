@@ -0,0 +1,138 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.Threading.Tasks;
+using MissMooseConfigurationApplication.UIComponents;
+
+namespace MissMooseConfigurationApplication
+{
+    /*
+     * Sends a grid's node positions to the gateway as one batch: an entry page per node,
+     * then a commit page with the number of nodes. The gateway applies the batch only if
+     * every entry arrived, and answers the commit with an outcome page on the same page number.
+     */
+    public class BatchPositionConfigurationPage : DataPage
+    {
+        #region Public Enums
+
+        /* Outcome of a commit, in the same order as the gateway's batch_result_t. */
+        public enum BatchResult : byte
+        {
+            Applied,
+            Incomplete,
+            TooManyNodes
+        }
+
+        #endregion
+
+        #region Private Members
+
+        private static readonly byte dataPageNumber = 0x29;
+        private static readonly byte commitFlag = 0x80;
+        private static readonly byte maxTransactionId = 0x07;
+
+        #endregion
+
+        #region Public Data Fields
+
+        public override byte DataPageNumber
+        {
+            get { return dataPageNumber; }
+        }
+
+        /* Commit pages close the batch, entry pages carry one node each. Outcome pages decode as commits. */
+        public bool IsCommit { get; set; }
+
+        /* Shared by every page of a batch, must differ from the previous batch's. */
+        public byte TransactionId { get; set; }
+
+        /* Which of the gateway's sensor grids the batch is for. */
+        public byte GridId { get; set; }
+
+        public UInt16 NodeId { get; set; }
+        public HardwareConfiguration NodeType { get; set; }
+        public Rotation NodeRotation { get; set; }
+
+        public sbyte xpos { get; set; }
+        public sbyte ypos { get; set; }
+        public sbyte xoffset { get; set; }
+        public sbyte yoffset { get; set; }
+
+        /* Nodes in the batch for a commit, nodes the gateway received for an outcome. */
+        public byte NodeCount { get; set; }
+
+        /* Only set on outcome pages from the gateway. */
+        public BatchResult Result { get; set; }
+
+        /* The header byte, which the gateway expects back as the message ID when the outcome is acknowledged. */
+        public byte Header
+        {
+            get
+            {
+                byte header = (byte)((TransactionId & maxTransactionId) << 4);
+
+                if (IsCommit)
+                {
+                    return (byte)(header | commitFlag);
+                }
+
+                return (byte)(header | (GridId & 0x0F));
+            }
+        }
+
+        #endregion
+
+        #region Public Methods
+
+        /* Gets the transaction ID to use for the batch after the one with the given ID */
+        public static byte GetNextTransactionId(byte transactionId)
+        {
+            return (byte)((transactionId + 1) & maxTransactionId);
+        }
+
+        /* Encodes the current values of this page's data fields into the given txBuffer */
+        public override void Encode(byte[] txBuffer)
+        {
+            txBuffer[0] = DataPageNumber;
+            txBuffer[1] = Header;
+
+            if (IsCommit)
+            {
+                txBuffer[2] = NodeCount;
+
+                for (int i = 3; i < 8; i++)
+                {
+                    txBuffer[i] = BitManipulation.ReservedOnes;
+                }
+
+                return;
+            }
+
+            txBuffer[2] = BitManipulation.GetByte0(NodeId);
+            txBuffer[3] = BitManipulation.GetByte1(NodeId);
+
+            /* Rotation shares the node type byte, above the two node type bits. */
+            txBuffer[4] = (byte)(((NodeRotation.ToEnum() & 0x07) << 2) | ((byte)NodeType & 0x03));
+
+            byte xpos_encoded = (byte)((xpos - 1) & 0x0F);
+            byte ypos_encoded = (byte)((1 - ypos) & 0x0F);
+            ypos_encoded <<= 4;
+
+            txBuffer[5] = (byte)(xpos_encoded | ypos_encoded);
+            txBuffer[6] = (byte)xoffset;
+            txBuffer[7] = (byte)yoffset;
+        }
+
+        /* Decodes the given rxBuffer into this page's data fields. Only outcome pages are received. */
+        public override void Decode(byte[] rxBuffer)
+        {
+            IsCommit = (rxBuffer[1] & commitFlag) != 0;
+            TransactionId = (byte)((rxBuffer[1] >> 4) & maxTransactionId);
+            NodeCount = rxBuffer[2];
+            Result = (BatchResult)rxBuffer[3];
+        }
+
+        #endregion
+    }
+}
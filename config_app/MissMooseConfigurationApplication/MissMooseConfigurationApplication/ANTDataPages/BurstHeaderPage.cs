@@ -0,0 +1,65 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.Threading.Tasks;
+
+namespace MissMooseConfigurationApplication
+{
+    /*
+     * First packet of each burst the gateway sends, says where the rest of the burst's data goes.
+     */
+    public class BurstHeaderPage : DataPage
+    {
+        #region Private Members
+
+        private static readonly byte dataPageNumber = 0x2C;
+
+        #endregion
+
+        #region Public Data Fields
+
+        public override byte DataPageNumber
+        {
+            get { return dataPageNumber; }
+        }
+
+        public BurstDataType DataType { get; set; }
+
+        public byte Argument { get; set; }
+
+        public byte TransferId { get; set; }
+
+        /* Where the burst's data starts in the block. */
+        public UInt16 Offset { get; set; }
+
+        public UInt16 TotalSize { get; set; }
+
+        #endregion
+
+        #region Public Methods
+
+        /* Encodes the current values of this page's data fields into the given txBuffer */
+        public override void Encode(byte[] txBuffer)
+        {
+            txBuffer[0] = DataPageNumber;
+            txBuffer[1] = (byte)DataType;
+            txBuffer[2] = Argument;
+            txBuffer[3] = TransferId;
+            Array.Copy(BitConverter.GetBytes(Offset), 0, txBuffer, 4, 2);
+            Array.Copy(BitConverter.GetBytes(TotalSize), 0, txBuffer, 6, 2);
+        }
+
+        /* Decodes the given rxBuffer into this page's data fields */
+        public override void Decode(byte[] rxBuffer)
+        {
+            DataType = (BurstDataType)rxBuffer[1];
+            Argument = rxBuffer[2];
+            TransferId = rxBuffer[3];
+            Offset = BitConverter.ToUInt16(rxBuffer, 4);
+            TotalSize = BitConverter.ToUInt16(rxBuffer, 6);
+        }
+
+        #endregion
+    }
+}
@@ -0,0 +1,82 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.Threading.Tasks;
+
+namespace MissMooseConfigurationApplication
+{
+    #region Public Types
+
+    /* Blocks the gateway can send as burst transfers, in the same order as the gateway's data type enum. */
+    public enum BurstDataType : byte
+    {
+        /* The argument is the grid id. */
+        WildlifeStatistics,
+    }
+
+    #endregion
+
+    /*
+     * Asks the gateway for a block of data, see BurstReceiver. The same page starts,
+     * acknowledges and resumes a transfer.
+     */
+    public class BurstRequestPage : DataPage
+    {
+        #region Public Constants
+
+        /* Transfer id that asks for a new transfer. */
+        public const byte NewTransferId = 0;
+
+        #endregion
+
+        #region Private Members
+
+        private static readonly byte dataPageNumber = 0x2B;
+
+        #endregion
+
+        #region Public Data Fields
+
+        public override byte DataPageNumber
+        {
+            get { return dataPageNumber; }
+        }
+
+        public BurstDataType DataType { get; set; }
+
+        public byte Argument { get; set; }
+
+        public byte TransferId { get; set; } = NewTransferId;
+
+        /* The first byte of the block that hasn't been received, ignored for a new transfer. */
+        public UInt16 Offset { get; set; }
+
+        #endregion
+
+        #region Public Methods
+
+        /* Encodes the current values of this page's data fields into the given txBuffer */
+        public override void Encode(byte[] txBuffer)
+        {
+            txBuffer[0] = DataPageNumber;
+            txBuffer[1] = (byte)DataType;
+            txBuffer[2] = Argument;
+            txBuffer[3] = TransferId;
+            Array.Copy(BitConverter.GetBytes(Offset), 0, txBuffer, 4, 2);
+            txBuffer[6] = 0xFF;
+            txBuffer[7] = 0xFF;
+        }
+
+        /* Decodes the given rxBuffer into this page's data fields */
+        public override void Decode(byte[] rxBuffer)
+        {
+            DataType = (BurstDataType)rxBuffer[1];
+            Argument = rxBuffer[2];
+            TransferId = rxBuffer[3];
+            Offset = BitConverter.ToUInt16(rxBuffer, 4);
+        }
+
+        #endregion
+    }
+}
@@ -0,0 +1,82 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.Threading.Tasks;
+
+namespace MissMooseConfigurationApplication
+{
+    /*
+     * One chunk of the gateway's monitoring snapshot, see MonitoringSnapshot for the slot layout.
+     * Snapshot pages aren't acknowledged.
+     */
+    public class MonitoringSnapshotPage : DataPage
+    {
+        #region Public Constants
+
+        public const int SlotsPerPage = 20;
+
+        #endregion
+
+        #region Private Members
+
+        private static readonly byte dataPageNumber = 0x2A;
+        private static readonly byte keyframeFlag = 0x80;
+        private static readonly int slotsIndex = 3;
+
+        #endregion
+
+        #region Public Data Fields
+
+        public override byte DataPageNumber
+        {
+            get { return dataPageNumber; }
+        }
+
+        /* One more than the last snapshot page the gateway sent. */
+        public byte SequenceNumber { get; set; }
+
+        /* Set if nothing in the chunk changed, the chunk is being sent again for receivers that missed it. */
+        public bool IsKeyframe { get; set; }
+
+        /* The chunk's first slot is Chunk * SlotsPerPage. */
+        public byte Chunk { get; set; }
+
+        /* The 2 bit state of each slot in the chunk. */
+        public byte[] SlotStates { get; } = new byte[SlotsPerPage];
+
+        #endregion
+
+        #region Public Methods
+
+        /* Encodes the current values of this page's data fields into the given txBuffer */
+        public override void Encode(byte[] txBuffer)
+        {
+            txBuffer[0] = DataPageNumber;
+            txBuffer[1] = SequenceNumber;
+            txBuffer[2] = (byte)((IsKeyframe ? keyframeFlag : 0) | (Chunk & 0x7F));
+
+            for (int i = 0; i < SlotsPerPage; i++)
+            {
+                int shift = (i % 4) * 2;
+                txBuffer[slotsIndex + i / 4] &= (byte)~(0x03 << shift);
+                txBuffer[slotsIndex + i / 4] |= (byte)((SlotStates[i] & 0x03) << shift);
+            }
+        }
+
+        /* Decodes the given rxBuffer into this page's data fields */
+        public override void Decode(byte[] rxBuffer)
+        {
+            SequenceNumber = rxBuffer[1];
+            IsKeyframe = (rxBuffer[2] & keyframeFlag) != 0;
+            Chunk = (byte)(rxBuffer[2] & 0x7F);
+
+            for (int i = 0; i < SlotsPerPage; i++)
+            {
+                SlotStates[i] = (byte)((rxBuffer[slotsIndex + i / 4] >> ((i % 4) * 2)) & 0x03);
+            }
+        }
+
+        #endregion
+    }
+}
@@ -43,6 +43,9 @@ namespace MissMooseConfigurationApplication
             set { nodeRotation = value; OnPropertyChanged("NodeRotation"); }
         }
 
+        /* Which of the gateway's sensor grids the node is part of. */
+        public byte GridId { get; set; }
+
         public sbyte xpos { get; set; }
         public sbyte ypos { get; set; }
         public sbyte xoffset { get; set; }
@@ -60,7 +63,8 @@ namespace MissMooseConfigurationApplication
             txBuffer[1] = BitManipulation.GetByte0(NodeId);
             txBuffer[2] = BitManipulation.GetByte1(NodeId);
 
-            txBuffer[3] = (byte)NodeType;
+            /* Grid ID shares the node type byte, in the upper nibble. */
+            txBuffer[3] = (byte)(((GridId << 4) & 0xF0) | ((byte)NodeType & 0x03));
 
             txBuffer[4] = (byte)NodeRotation.ToEnum();
 
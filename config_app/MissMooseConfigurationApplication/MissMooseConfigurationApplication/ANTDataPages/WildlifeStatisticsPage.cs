@@ -0,0 +1,88 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.Threading.Tasks;
+
+namespace MissMooseConfigurationApplication
+{
+    public class WildlifeStatisticsPage : DataPage
+    {
+        #region Public Enums
+
+        /* Statistics the gateway keeps, in the same order as the gateway's statistic enum. */
+        public enum Statistic : byte
+        {
+            /* Index is an AV index, bucket is the hour of the day. */
+            RegionHourly,
+            /* Index is a sensor type, bucket is a histogram bucket of log2 seconds. */
+            Duration,
+            /* Index is a node id, bucket is the sensor rotation and days ago. */
+            SensorDaily
+        }
+
+        #endregion
+
+        #region Private Members
+
+        private static readonly byte dataPageNumber = 0x28;
+
+        #endregion
+
+        #region Public Data Fields
+
+        public override byte DataPageNumber
+        {
+            get { return dataPageNumber; }
+        }
+
+        /* Repeated by the gateway's answer, acknowledge the answer with it. */
+        public byte MessageId { get; set; }
+
+        public Statistic StatisticType { get; set; }
+
+        /* Which of the gateway's sensor grids the statistic is for. */
+        public byte GridId { get; set; }
+
+        public UInt16 Index { get; set; }
+
+        public byte Bucket { get; set; }
+
+        /* Filled in by the gateway's answer, unused by a request. */
+        public UInt16 Count { get; set; }
+
+        #endregion
+
+        #region Public Methods
+
+        /* Sets Bucket for a SensorDaily statistic */
+        public void SetSensorDailyBucket(byte sensorRotation, byte daysAgo)
+        {
+            Bucket = (byte)((sensorRotation << 4) | (daysAgo & 0x0F));
+        }
+
+        /* Encodes the current values of this page's data fields into the given txBuffer */
+        public override void Encode(byte[] txBuffer)
+        {
+            txBuffer[0] = DataPageNumber;
+            txBuffer[1] = MessageId;
+            txBuffer[2] = (byte)(((byte)StatisticType << 4) | (GridId & 0x0F));
+            Array.Copy(BitConverter.GetBytes(Index), 0, txBuffer, 3, 2);
+            txBuffer[5] = Bucket;
+            Array.Copy(BitConverter.GetBytes(Count), 0, txBuffer, 6, 2);
+        }
+
+        /* Decodes the given rxBuffer into this page's data fields */
+        public override void Decode(byte[] rxBuffer)
+        {
+            MessageId = rxBuffer[1];
+            StatisticType = (Statistic)(rxBuffer[2] >> 4);
+            GridId = (byte)(rxBuffer[2] & 0x0F);
+            Index = BitConverter.ToUInt16(rxBuffer, 3);
+            Bucket = rxBuffer[5];
+            Count = BitConverter.ToUInt16(rxBuffer, 6);
+        }
+
+        #endregion
+    }
+}
@@ -16,6 +16,9 @@ namespace MissMooseConfigurationApplication
         #region Public Members
 		
         public static AntControl Instance = new AntControl();
+
+        /* Puts together blocks the gateway sends as burst transfers. */
+        public BurstReceiver BurstReceiver { get; } = new BurstReceiver();
 		
         #endregion
 		
@@ -39,6 +42,8 @@ namespace MissMooseConfigurationApplication
             pageParser.AddDataPage(new RegionActivityVariablePage());
             pageParser.AddDataPage(new HyperactivityErrorStatusPage());
             pageParser.AddDataPage(new InactiveSensorErrorStatusPage());
+            pageParser.AddDataPage(new MonitoringSnapshotPage());
+            pageParser.AddDataPage(new BatchPositionConfigurationPage());
         }
 
         public void AddConfigUI(ConfigurationPage ConfigUI)
@@ -75,6 +80,14 @@ namespace MissMooseConfigurationApplication
 
                     byte[] rxBuffer = response.getDataPayload();
 
+                    // Burst packets aren't data pages, only the first packet of each burst has a page number
+                    if (response.responseID == (byte)ANT_ReferenceLibrary.ANTMessageID.BURST_DATA_0x50)
+                    {
+                        BurstReceiver.HandlePacket(response.messageContents[0],
+                            rxBuffer, new PageSender(channelManager.GetChannel(channelId.deviceNumber), channelId));
+                        return;
+                    }
+
                     dynamic dataPage = pageParser.Parse(rxBuffer);
 
                     if (dataPage != null)
@@ -0,0 +1,195 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.Threading.Tasks;
+
+namespace MissMooseConfigurationApplication
+{
+    /*
+     * Puts a block of data back together from the gateway's burst transfer.
+     *
+     * Each burst starts with a BurstHeaderPage, followed by packets of data. After every
+     * burst the gateway is told the first byte that is still missing, which lets it move
+     * its window on, or go back and send what was lost. A transfer that stalled can be
+     * picked up again with Resume, as long as the gateway still has it.
+     */
+    public class BurstReceiver
+    {
+        #region Public Types
+
+        public delegate void TransferCompleteHandler(BurstDataType dataType, byte argument, byte[] data);
+
+        #endregion
+
+        #region Public Events
+
+        public event TransferCompleteHandler TransferComplete;
+
+        #endregion
+
+        #region Private Members
+
+        // Burst packets carry a sequence number in the upper bits of the channel byte
+        private static readonly byte sequenceMask = 0x60;
+        private static readonly byte lastPacketFlag = 0x80;
+        private static readonly int packetSize = 8;
+
+        private readonly object receiveLock = new object();
+
+        private BurstDataType dataType;
+        private byte argument;
+        private byte transferId = BurstRequestPage.NewTransferId;
+        private byte[] data = null;
+
+        // Every byte before this one has been received
+        private UInt16 received = 0;
+
+        // Whether the current burst is for this transfer, and where its next data packet goes,
+        // null if its data is being dropped
+        private bool isBurstForTransfer = false;
+        private int? packetPosition = null;
+
+        #endregion
+
+        #region Public Methods
+
+        /*
+         * Asks the gateway for a block, replacing any transfer in progress.
+         */
+        public void Request(BurstDataType dataType, byte argument, PageSender responder)
+        {
+            lock (receiveLock)
+            {
+                this.dataType = dataType;
+                this.argument = argument;
+                transferId = BurstRequestPage.NewTransferId;
+                data = null;
+                received = 0;
+                isBurstForTransfer = false;
+                packetPosition = null;
+
+                SendRequest(responder);
+            }
+        }
+
+        /*
+         * Asks the gateway to carry on with the current transfer from the first missing byte.
+         */
+        public void Resume(PageSender responder)
+        {
+            lock (receiveLock)
+            {
+                SendRequest(responder);
+            }
+        }
+
+        /*
+         * Processes one packet of a burst. sequence is the burst sequence byte of the packet.
+         */
+        public void HandlePacket(byte sequence, byte[] packet, PageSender responder)
+        {
+            byte[] completedData = null;
+
+            lock (receiveLock)
+            {
+                if ((sequence & sequenceMask) == 0)
+                {
+                    HandleHeader(packet);
+                }
+                else if (packetPosition.HasValue && data != null)
+                {
+                    int length = Math.Min(packetSize, data.Length - packetPosition.Value);
+
+                    if (length > 0)
+                    {
+                        Array.Copy(packet, 0, data, packetPosition.Value, length);
+                        packetPosition += length;
+
+                        if (packetPosition.Value > received)
+                        {
+                            received = (UInt16)packetPosition.Value;
+                        }
+                    }
+                }
+
+                if ((sequence & lastPacketFlag) == 0 || !isBurstForTransfer)
+                {
+                    return;
+                }
+
+                isBurstForTransfer = false;
+                packetPosition = null;
+
+                // Acknowledge every burst, the gateway waits once its window is full
+                SendRequest(responder);
+
+                if (received == data.Length)
+                {
+                    completedData = data;
+                }
+            }
+
+            if (completedData != null)
+            {
+                TransferComplete?.Invoke(dataType, argument, completedData);
+            }
+        }
+
+        #endregion
+
+        #region Private Methods
+
+        private void HandleHeader(byte[] packet)
+        {
+            isBurstForTransfer = false;
+            packetPosition = null;
+
+            BurstHeaderPage header = new BurstHeaderPage();
+
+            if (packet[0] != header.DataPageNumber)
+            {
+                return;
+            }
+
+            header.Decode(packet);
+
+            if (header.DataType != dataType || header.Argument != argument)
+            {
+                // Someone else's transfer
+                return;
+            }
+
+            if (header.TransferId != transferId || data == null || data.Length != header.TotalSize)
+            {
+                // The gateway started the transfer over
+                transferId = header.TransferId;
+                data = new byte[header.TotalSize];
+                received = 0;
+            }
+
+            isBurstForTransfer = true;
+
+            // Data after a gap is dropped, the acknowledgement asks for the gap again
+            if (header.Offset <= received)
+            {
+                packetPosition = header.Offset;
+            }
+        }
+
+        private void SendRequest(PageSender responder)
+        {
+            BurstRequestPage requestPage = new BurstRequestPage
+            {
+                DataType = dataType,
+                Argument = argument,
+                TransferId = transferId,
+                Offset = received
+            };
+
+            responder.SendBroadcast(requestPage);
+        }
+
+        #endregion
+    }
+}
@@ -0,0 +1,157 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.Threading.Tasks;
+using MissMooseConfigurationApplication.UIComponents;
+
+namespace MissMooseConfigurationApplication
+{
+    /*
+     * Rebuilds the state of every sensor and AV on the gateway from its snapshot pages.
+     *
+     * Sensors come first, SensorsPerNode slots per node grid position, row by row starting from the
+     * row furthest from the road. Slot 0 of a node is its road facing sensor. A sensor slot holds a
+     * PIR's detection (0 or 1) or a lidar's LidarRegion. AVs follow, row by row, each holding a
+     * RegionStatus.
+     *
+     * Every page carries the whole state of its chunk. A missed page shows up as a gap in the
+     * sequence numbers, after which every chunk is treated as unknown until it is sent again.
+     */
+    public class MonitoringSnapshot
+    {
+        #region Public Constants
+
+        public const int GridSize = 3;
+        public const int SensorsPerNode = 2;
+        public const int SensorSlotCount = GridSize * GridSize * SensorsPerNode;
+        public const int AvSlotCount = (GridSize - 1) * (GridSize - 1);
+
+        #endregion
+
+        #region Private Members
+
+        private static readonly int chunkCount =
+            (SensorSlotCount + AvSlotCount + MonitoringSnapshotPage.SlotsPerPage - 1) / MonitoringSnapshotPage.SlotsPerPage;
+
+        private byte[] slotStates = new byte[chunkCount * MonitoringSnapshotPage.SlotsPerPage];
+        private bool[] chunksKnown = new bool[chunkCount];
+        private byte? lastSequenceNumber = null;
+
+        #endregion
+
+        #region Public Methods
+
+        /*
+         * Applies a snapshot page, returning the slots whose state changed. Every slot of a chunk
+         * is returned the first time it arrives, or after pages were missed.
+         */
+        public List<int> Apply(MonitoringSnapshotPage page)
+        {
+            List<int> changedSlots = new List<int>();
+
+            // The gateway repeats each page for a few channel periods
+            if (page.SequenceNumber == lastSequenceNumber)
+            {
+                return changedSlots;
+            }
+
+            if (lastSequenceNumber.HasValue && page.SequenceNumber != (byte)(lastSequenceNumber.Value + 1))
+            {
+                // Missed a page, anything may have changed since
+                Array.Clear(chunksKnown, 0, chunksKnown.Length);
+            }
+
+            lastSequenceNumber = page.SequenceNumber;
+
+            if (page.Chunk >= chunkCount)
+            {
+                // The gateway has a larger grid than the monitoring application
+                return changedSlots;
+            }
+
+            for (int i = 0; i < MonitoringSnapshotPage.SlotsPerPage; i++)
+            {
+                int slot = page.Chunk * MonitoringSnapshotPage.SlotsPerPage + i;
+
+                if (!chunksKnown[page.Chunk] || slotStates[slot] != page.SlotStates[i])
+                {
+                    slotStates[slot] = page.SlotStates[i];
+
+                    if (slot < SensorSlotCount + AvSlotCount)
+                    {
+                        changedSlots.Add(slot);
+                    }
+                }
+            }
+
+            chunksKnown[page.Chunk] = true;
+
+            return changedSlots;
+        }
+
+        /* Whether every chunk has arrived since the last missed page. */
+        public bool IsComplete()
+        {
+            return chunksKnown.All(x => x);
+        }
+
+        public byte GetSlotState(int slot)
+        {
+            return slotStates[slot];
+        }
+
+        /* Finds the node grid position and sensor a sensor slot is for, returns false if the slot is an AV. */
+        public static bool GetSensorSlot(int slot, out sbyte xpos, out sbyte ypos, out int sensorIndex)
+        {
+            xpos = 0;
+            ypos = 0;
+            sensorIndex = 0;
+
+            if (slot >= SensorSlotCount)
+            {
+                return false;
+            }
+
+            int nodeSlot = slot / SensorsPerNode;
+            sensorIndex = slot % SensorsPerNode;
+
+            // The gateway counts rows up towards the road, the grid counts down
+            xpos = (sbyte)(nodeSlot % GridSize);
+            ypos = (sbyte)(GridSize - 1 - nodeSlot / GridSize);
+
+            return true;
+        }
+
+        /* Finds the AV an AV slot is for, returns false if the slot is a sensor. */
+        public static bool GetAvSlot(int slot, out byte xCoordinate, out byte yCoordinate)
+        {
+            xCoordinate = 0;
+            yCoordinate = 0;
+
+            if (slot < SensorSlotCount || slot >= SensorSlotCount + AvSlotCount)
+            {
+                return false;
+            }
+
+            int avSlot = slot - SensorSlotCount;
+            xCoordinate = (byte)(avSlot % (GridSize - 1));
+            yCoordinate = (byte)(avSlot / (GridSize - 1));
+
+            return true;
+        }
+
+        /* Gets the rotation of a node's sensor, relative to the node. */
+        public static Rotation GetSensorRotation(HardwareConfiguration configuration, int sensorIndex)
+        {
+            if (sensorIndex == 0)
+            {
+                return new Rotation(Rotation.R0);
+            }
+
+            return new Rotation(configuration == HardwareConfiguration.Pir2 ? Rotation.R270 : Rotation.R90);
+        }
+
+        #endregion
+    }
+}
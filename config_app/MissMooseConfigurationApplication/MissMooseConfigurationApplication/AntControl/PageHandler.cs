@@ -34,6 +34,21 @@ namespace MissMooseConfigurationApplication
         // The most recently received error data message ID
         private byte? errorMessageId = null;
 
+        // The sensor and AV states rebuilt from the gateway's snapshot pages
+        private MonitoringSnapshot monitoringSnapshot = new MonitoringSnapshot();
+
+        // Node configuration data sent in the position batch the gateway hasn't answered yet, null if there isn't one
+        private List<NodeConfigurationData> batchInFlight = null;
+
+        // Transaction ID of the most recent position batch
+        private byte batchTransactionId = 0;
+
+        // When the batch in flight was committed, used to give up on it if the gateway never answers
+        private DateTime batchCommitTime;
+
+        // How long to wait for the outcome of a batch before sending it again
+        private static readonly TimeSpan batchOutcomeTimeout = TimeSpan.FromSeconds(10);
+
         #endregion
 
         #region Public Methods
@@ -297,6 +312,46 @@ namespace MissMooseConfigurationApplication
             Console.Out.WriteLine("Sent Ack for Region AV Msg: " + ackPage.MessageId);
         }
 
+        /*
+         * Processes a received Monitoring Snapshot data page. Snapshot pages aren't acknowledged,
+         * they only update the UI, the events are logged from the acknowledged pages.
+         */
+        public void HandlePage(MonitoringSnapshotPage dataPage, ushort deviceNum, PageSender responder)
+        {
+            foreach (int slot in monitoringSnapshot.Apply(dataPage))
+            {
+                byte state = monitoringSnapshot.GetSlotState(slot);
+
+                if (MonitoringSnapshot.GetSensorSlot(slot, out sbyte xpos, out sbyte ypos, out int sensorIndex))
+                {
+                    SensorNode node = ConfigUI.nodes.Where(x => x.xpos == xpos && x.ypos == ypos).FirstOrDefault();
+
+                    if (node != null)
+                    {
+                        Rotation totalRotation = new Rotation(node.Rotation.Val);
+                        totalRotation.Add(MonitoringSnapshot.GetSensorRotation(node.configuration, sensorIndex));
+
+                        if (GetLineDirection(totalRotation, out LineDirection direction))
+                        {
+                            StatusColour colour = state > 0 ? StatusColour.Red : StatusColour.Blue;
+
+                            Application.Current.Dispatcher.BeginInvoke((ThreadStart)delegate
+                            {
+                                MonitoringUI.MarkSensorDetection(node, direction, colour);
+                            });
+                        }
+                    }
+                }
+                else if (MonitoringSnapshot.GetAvSlot(slot, out byte xCoordinate, out byte yCoordinate))
+                {
+                    Application.Current.Dispatcher.BeginInvoke((ThreadStart)delegate
+                    {
+                        MonitoringUI.SetRegionActivityVariable(xCoordinate, yCoordinate, (RegionStatus)state);
+                    });
+                }
+            }
+        }
+
         public void HandlePage(HyperactivityErrorStatusPage dataPage, ushort deviceNum, PageSender responder)
         {
             // Only handle the data page if its message ID is different
@@ -405,6 +460,50 @@ namespace MissMooseConfigurationApplication
             Console.Out.WriteLine("Sent Ack for Inactive Sensor Error Msg: " + ackPage.MessageId);
         }
 
+        /*
+         * Processes the gateway's outcome for a position batch
+         */
+        public void HandlePage(BatchPositionConfigurationPage dataPage, ushort deviceNum, PageSender responder)
+        {
+            // Only the batch in flight is of interest, outcomes for older batches are just acknowledged
+            if (batchInFlight != null && dataPage.TransactionId == batchTransactionId)
+            {
+                switch (dataPage.Result)
+                {
+                    case BatchPositionConfigurationPage.BatchResult.Applied:
+                        Console.Out.WriteLine("Sent positions for " + batchInFlight.Count + " nodes");
+                        break;
+                    case BatchPositionConfigurationPage.BatchResult.Incomplete:
+                        // Nothing was applied, send the whole batch again with a new transaction ID
+                        Console.Out.WriteLine("Position batch incomplete, gateway received "
+                            + dataPage.NodeCount + " of " + batchInFlight.Count + " nodes");
+                        foreach (NodeConfigurationData data in batchInFlight)
+                        {
+                            data.isSent = false;
+                        }
+                        break;
+                    case BatchPositionConfigurationPage.BatchResult.TooManyNodes:
+                        // Sending it again won't help, leave the nodes until they change or the gateway is reconfigured
+                        Console.Out.WriteLine("Position batch of " + batchInFlight.Count + " nodes doesn't fit on the gateway");
+                        break;
+                    default:
+                        // Do nothing (shouldn't get here)
+                        break;
+                }
+
+                batchInFlight = null;
+            }
+
+            // Send an acknowledgement page so the gateway stops broadcasting the outcome
+            MonitoringDataAckPage ackPage = new MonitoringDataAckPage
+            {
+                MessageId = dataPage.Header,
+                AckedId = dataPage.DataPageNumber
+            };
+
+            responder.SendBroadcast(ackPage);
+        }
+
         #endregion
 
         #region Private Methods
@@ -427,6 +526,9 @@ namespace MissMooseConfigurationApplication
                     {
                         data.isSent = false;
                     }
+
+                    // A batch in flight was lost along with the rest
+                    batchInFlight = null;
                 }
 
                 // The gateway node has a hardcoded node ID, so we only need to send it a network ID.
@@ -507,38 +609,71 @@ namespace MissMooseConfigurationApplication
             // For now, poll the configuration page's sensor node list for updates every time we send data to the gateway
             UpdateNodes();
 
-            KeyValuePair<ushort, NodeConfigurationData> dataToSend = nodeConfigList.Where(x => !x.Value.isSent).FirstOrDefault();
-            if (!dataToSend.Equals(default(KeyValuePair<ushort, NodeConfigurationData>)))
+            // Wait for the outcome of the batch in flight before sending another,
+            // unless the gateway has gone quiet, e.g. because it ignored the commit as a repeat
+            if (batchInFlight != null)
             {
-                PositionConfigurationCommandPage positionPage = new PositionConfigurationCommandPage
+                if (DateTime.Now - batchCommitTime < batchOutcomeTimeout)
                 {
-                    NodeId = dataToSend.Key,
-                    NodeType = dataToSend.Value.nodeType,
-                    NodeRotation = dataToSend.Value.nodeRotation,
-                    xpos = dataToSend.Value.xpos,
-                    ypos = dataToSend.Value.ypos,
-                    xoffset = dataToSend.Value.xoffset,
-                    yoffset = dataToSend.Value.yoffset
-                };
+                    return;
+                }
 
-                if (positionPage.xpos == -1 || positionPage.ypos == -1)
+                foreach (NodeConfigurationData data in batchInFlight)
                 {
-                    return;
+                    data.isSent = false;
                 }
+                batchInFlight = null;
+            }
+
+            // Nodes that haven't been placed on the grid yet can't be sent
+            List<KeyValuePair<ushort, NodeConfigurationData>> dataToSend = nodeConfigList
+                .Where(x => !x.Value.isSent && x.Value.xpos != -1 && x.Value.ypos != -1)
+                .Take(byte.MaxValue)
+                .ToList();
 
-                dataToSend.Value.isSent = true;
+            if (dataToSend.Count == 0)
+            {
+                return;
+            }
 
-                // Send the node data as an acknowledged message, retrying up to 5 times
-                if (!responder.SendAcknowledged(positionPage, true, 5))
+            batchTransactionId = BatchPositionConfigurationPage.GetNextTransactionId(batchTransactionId);
+
+            // Entries aren't retried, the gateway reports any it missed in the outcome and the batch is sent again.
+            // Sending them acknowledged waits for each to go out, so they don't overwrite each other.
+            foreach (KeyValuePair<ushort, NodeConfigurationData> data in dataToSend)
+            {
+                BatchPositionConfigurationPage entryPage = new BatchPositionConfigurationPage
                 {
+                    TransactionId = batchTransactionId,
+                    NodeId = data.Key,
+                    NodeType = data.Value.nodeType,
+                    NodeRotation = data.Value.nodeRotation,
+                    xpos = data.Value.xpos,
+                    ypos = data.Value.ypos,
+                    xoffset = data.Value.xoffset,
+                    yoffset = data.Value.yoffset
+                };
 
-                    // If the message failed, mark the node data as unsent
-                    // so that we try to send it again
-                    dataToSend.Value.isSent = false;
-                }
-                else
+                responder.SendAcknowledged(entryPage, false);
+            }
+
+            BatchPositionConfigurationPage commitPage = new BatchPositionConfigurationPage
+            {
+                IsCommit = true,
+                TransactionId = batchTransactionId,
+                NodeCount = (byte)dataToSend.Count
+            };
+
+            // Send the commit as an acknowledged message, retrying up to 5 times.
+            // The gateway ignores repeats of a commit it has applied, so a retry after a lost ack is harmless.
+            if (responder.SendAcknowledged(commitPage, true, 5))
+            {
+                batchInFlight = dataToSend.Select(x => x.Value).ToList();
+                batchCommitTime = DateTime.Now;
+
+                foreach (NodeConfigurationData data in batchInFlight)
                 {
-                    Console.Out.WriteLine("Sent position for: " + positionPage.NodeId);
+                    data.isSent = true;
                 }
             }
         }
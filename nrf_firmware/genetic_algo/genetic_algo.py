@@ -60,7 +60,15 @@ class Genetic_Algo:
 
         print(self.ga.best_individual()[0])
         print("\r\n")
-        print(self.individual_to_config_struct(self.ga.best_individual()[1], time.time()))
+        name = time.time()
+        print(self.individual_to_config_struct(self.ga.best_individual()[1], name))
+
+        # Write the best individual as a header that can be folded into a static config build.
+        # It replaces the one in src/sensor_algorithm, where IS_STATIC_ALGORITHM_CONFIG builds include it from.
+        root_dir = os.path.dirname(os.path.realpath(__file__))
+        header_path = os.path.join(root_dir, '..', 'src', 'sensor_algorithm', 'mm_sensor_algorithm_static_config.h')
+        with open(header_path, 'w') as header:
+            header.write(self.individual_to_config_header(self.ga.best_individual()[1], name))
 
     # define and set function to create a candidate solution representation
     def create_individual(self, data):
@@ -137,6 +145,26 @@ class Genetic_Algo:
         struct += "};\r\n"
         return struct
 
+    def individual_to_config_header(self, individual, name):
+        '''
+        Generates mm_sensor_algorithm_static_config.h, which MM_STATIC_ALGORITHM_CONFIG
+        builds fold into the sensor algorithm as compile time constants.
+        '''
+        header  = "/**\n"
+        header += "file: mm_sensor_algorithm_static_config.h\n"
+        header += "brief: Sensor algorithm config for MM_STATIC_ALGORITHM_CONFIG builds\n"
+        header += "notes: Generated by genetic_algo.py from individual " + str(int(name)) + ", don't edit by hand.\n"
+        header += "       Only include through mm_sensor_algorithm_config.h.\n"
+        header += "*/\n"
+        header += "#ifndef MM_SENSOR_ALGORITHM_STATIC_CONFIG_H\n"
+        header += "#define MM_SENSOR_ALGORITHM_STATIC_CONFIG_H\n\n"
+        header += "static mm_sensor_algorithm_config_t const sensor_algorithm_static_config =\n{\n"
+        for item in individual:
+            header += "    " + "{:10.10f}".format((item['value'])) + ", /* " + item['name'] + " */\n"
+        header += "};\n\n"
+        header += "#endif /* MM_SENSOR_ALGORITHM_STATIC_CONFIG_H */\n"
+        return header
+
 class Custom_Fitness:
     ''' Class for holding our fitness function. I think it needs to be pickle-able
     so that the fitness function can be used by the multiprocessing libraries.
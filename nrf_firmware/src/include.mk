@@ -1,5 +1,9 @@
 #control constants
 IS_BLAZE_GATEWAY = 1
+# Fold the sensor algorithm config in src/sensor_algorithm/mm_sensor_algorithm_static_config.h
+# into the gateway as compile time constants. Leave off for tuning builds.
+# genetic_algo/genetic_algo.py overwrites that header with the best individual of each run.
+IS_STATIC_ALGORITHM_CONFIG = 0
 
 ifeq ($(IS_BLAZE_GATEWAY),1)
   CFLAGS += -DMM_BLAZE_GATEWAY
@@ -7,6 +11,10 @@ else
   CFLAGS += -DMM_BLAZE_NODE
 endif
 
+ifeq ($(IS_STATIC_ALGORITHM_CONFIG),1)
+  CFLAGS += -DMM_STATIC_ALGORITHM_CONFIG
+endif
+
 # Source files common to all targets
 SRC_FILES += \
   $(SDK_ROOT)/components/libraries/log/src/nrf_log_backend_serial.c \
@@ -24,6 +32,8 @@ SRC_FILES += \
   $(SDK_ROOT)/components/libraries/strerror/nrf_strerror.c \
   $(SDK_ROOT)/components/libraries/scheduler/app_scheduler.c \
   $(SDK_ROOT)/components/libraries/low_power_pwm/low_power_pwm.c \
+  $(SDK_ROOT)/components/libraries/fstorage/fstorage.c \
+  $(SDK_ROOT)/components/libraries/crc16/crc16.c \
   $(SDK_ROOT)/components/drivers_nrf/clock/nrf_drv_clock.c \
   $(SDK_ROOT)/components/drivers_nrf/common/nrf_drv_common.c \
   $(SDK_ROOT)/components/drivers_nrf/gpiote/nrf_drv_gpiote.c \
@@ -43,6 +53,7 @@ SRC_FILES += \
   $(PROJ_DIR)/src/protocols/mm_node_config.c \
   $(PROJ_DIR)/src/protocols/mm_switch_config.c \
   $(PROJ_DIR)/src/protocols/mm_led_control.c \
+  $(PROJ_DIR)/src/protocols/mm_channel_period_control.c \
   $(PROJ_DIR)/src/sensors/pir/pir_st_00081.c \
   $(PROJ_DIR)/src/sensors/lidar/lidar.c \
   $(PROJ_DIR)/src/sensors/mm_hardware_test.c \
@@ -50,6 +61,7 @@ SRC_FILES += \
   $(PROJ_DIR)/src/sensor_management/mm_sensor_transmission.c \
   $(PROJ_DIR)/src/peripherals/mm_rgb_led.c \
   $(PROJ_DIR)/src/peripherals/mm_power_bank_timer.c \
+  $(PROJ_DIR)/src/peripherals/mm_flash_storage.c \
   $(SDK_ROOT)/external/segger_rtt/RTT_Syscalls_GCC.c \
   $(SDK_ROOT)/external/segger_rtt/SEGGER_RTT.c \
   $(SDK_ROOT)/external/segger_rtt/SEGGER_RTT_printf.c \
@@ -63,18 +75,29 @@ SRC_FILES += \
   $(PROJ_DIR)/src/sensor_algorithm/mm_sensor_algorithm.c \
   $(PROJ_DIR)/src/sensor_algorithm/mm_activity_variables.c \
   $(PROJ_DIR)/src/sensor_algorithm/mm_sensor_error_check.c \
+  $(PROJ_DIR)/src/sensor_algorithm/mm_sensor_registry.c \
   $(PROJ_DIR)/src/sensor_algorithm/mm_activity_variable_drain.c \
   $(PROJ_DIR)/src/sensor_algorithm/mm_led_strip_states.c \
   $(PROJ_DIR)/src/sensor_algorithm/mm_sensor_algorithm_config.c \
+  $(PROJ_DIR)/src/sensor_algorithm/mm_trajectory_tracker.c \
+  $(PROJ_DIR)/src/sensor_algorithm/mm_wildlife_statistics.c \
+  $(PROJ_DIR)/src/sensor_algorithm/mm_sensor_algorithm_snapshot.c \
+  $(PROJ_DIR)/src/sensor_algorithm/mm_network_mode.c \
   $(PROJ_DIR)/src/sensor_algorithm/activity_variable_growth/mm_activity_variable_growth.c \
   $(PROJ_DIR)/src/sensor_algorithm/activity_variable_growth/mm_activity_variable_growth_lidar.c \
   $(PROJ_DIR)/src/sensor_algorithm/activity_variable_growth/mm_activity_variable_growth_pir.c \
   $(PROJ_DIR)/src/sensor_algorithm/activity_variable_growth/mm_activity_variable_growth_sensor_records.c \
+  $(PROJ_DIR)/src/protocols/mm_acked_broadcast.c \
   $(PROJ_DIR)/src/protocols/mm_monitoring_dispatch.c \
+  $(PROJ_DIR)/src/protocols/mm_monitoring_snapshot.c \
+  $(PROJ_DIR)/src/protocols/mm_burst_transfer.c \
   $(PROJ_DIR)/src/protocols/mm_position_config.c \
+  $(PROJ_DIR)/src/protocols/mm_position_table.c \
+  $(PROJ_DIR)/src/protocols/mm_algorithm_config_update.c \
   $(PROJ_DIR)/src/protocols/mm_av_transmission.c \
   $(PROJ_DIR)/src/protocols/mm_led_transmission.c \
-  $(PROJ_DIR)/src/protocols/mm_sensor_error_transmission.c 
+  $(PROJ_DIR)/src/protocols/mm_sensor_error_transmission.c \
+  $(PROJ_DIR)/src/protocols/mm_wildlife_statistics_transmission.c 
 endif
 
 # Include folders common to all targets
@@ -106,6 +129,9 @@ INC_FOLDERS += \
   $(SDK_ROOT)/components/drivers_nrf/timer \
   $(SDK_ROOT)/components/drivers_nrf/twi_master \
   $(SDK_ROOT)/components/libraries/low_power_pwm \
+  $(SDK_ROOT)/components/libraries/fstorage \
+  $(SDK_ROOT)/components/libraries/crc16 \
+  $(SDK_ROOT)/components/libraries/experimental_section_vars \
   $(PROJ_DIR)/src/sensors/pir \
   $(PROJ_DIR)/src/sensors/lidar \
   $(PROJ_DIR)/src/sensors \
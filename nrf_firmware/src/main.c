@@ -32,10 +32,14 @@ notes:
 #include "mm_switch_config.h"
 #include "mm_rgb_led_pub.h"
 #include "mm_ant_page_manager.h"
+#include "mm_acked_broadcast.h"
 #include "mm_monitoring_dispatch.h"
+#include "mm_monitoring_snapshot.h"
+#include "mm_burst_transfer.h"
 #include "mm_hardware_test_pub.h"
 #include "mm_position_config.h"
 #include "mm_sensor_manager.h"
+#include "mm_flash_storage_pub.h"
 
 /**********************************************************
                         CONSTANTS
@@ -96,9 +100,21 @@ int main(void)
     }
 
     mm_softdevice_init();
+    mm_flash_storage_init();
     mm_ant_init();
     mm_ant_page_manager_init();
 
+    #ifdef MM_BLAZE_GATEWAY
+
+    /* Before node config, which starts the sensor algorithm right away if the gateway was configured before a reset. */
+    mm_acked_broadcast_init();
+    mm_monitoring_snapshot_init();
+    mm_burst_transfer_init();
+    mm_monitoring_dispatch_init();
+    mm_position_config_init();
+
+    #endif
+
     #ifdef NODE_ID_FROM_CONFIG_APP
     // If getting node ID from the configuration app,
     // start the node config procedure
@@ -107,13 +123,6 @@ int main(void)
     APP_ERROR_CHECK(true); /* Used to initialize blaze here, that is no longer a supported mode. */
     #endif
 
-    #ifdef MM_BLAZE_GATEWAY
-
-    mm_monitoring_dispatch_init();
-    mm_position_config_init();
-
-    #endif
-
     // mm_hardware_test_init();
 
     while(true)
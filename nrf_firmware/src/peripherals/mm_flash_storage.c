@@ -0,0 +1,456 @@
+/**
+file: mm_flash_storage.c
+brief: Keeps small records in flash across resets.
+notes: Each area is a log of records appended one after another, each
+       record starting with a header holding a sequence number, its size
+       and a CRC of its data. Records never span a page. When the next
+       record doesn't fit in the current page the log moves on to the next
+       page of the area, erasing it first, which drops the oldest records.
+
+       At init every page is scanned, the valid record with the highest
+       sequence number is the area's record and the log continues after it.
+       A write cut short by a reset fails its CRC and is skipped, so the
+       record before it is read instead.
+
+       Flash operations are asynchronous, only one write is in progress
+       at a time across every area. fstorage reports back from interrupt
+       context, so results are kicked to main before the log is updated.
+       Writes that must not be dropped can be queued, each area can have
+       one queued write that starts once flash is free.
+*/
+
+
+/**********************************************************
+                        INCLUDES
+**********************************************************/
+
+#include <string.h>
+
+#include "app_error.h"
+#include "app_scheduler.h"
+#include "fstorage.h"
+#include "crc16.h"
+#include "softdevice_handler.h"
+#include "mm_flash_storage_pub.h"
+
+/**********************************************************
+                        CONSTANTS
+**********************************************************/
+
+#define FLASH_PAGE_SIZE_WORDS           ( 1024 )    ///< nRF52 flash pages are 4 kB.
+#define FLASH_ERASED_WORD               ( 0xFFFFFFFF )
+
+#define ALGORITHM_SNAPSHOT_PAGE_COUNT   ( 4 )
+#define NODE_POSITIONS_PAGE_COUNT       ( 2 )       ///< Only written when the config app changes something.
+#define NODE_IDENTITY_PAGE_COUNT        ( 2 )
+
+#define RECORD_HEADER_WORDS             ( sizeof(record_header_t) / sizeof(uint32_t) )
+#define MAX_RECORD_WORDS                ( RECORD_HEADER_WORDS + FLASH_STORAGE_MAX_RECORD_SIZE / sizeof(uint32_t) )
+
+/**********************************************************
+                          MACROS
+**********************************************************/
+
+/* Number of words needed to hold size bytes. */
+#define SIZE_TO_WORDS(size)             ( ( (size) + sizeof(uint32_t) - 1 ) / sizeof(uint32_t) )
+
+/**********************************************************
+                           TYPES
+**********************************************************/
+
+typedef struct
+{
+    uint32_t sequence;      /* Increases with every write, FLASH_ERASED_WORD marks the end of a page's records. */
+    uint16_t size;          /* Record data size in bytes, the data is padded to a whole word. */
+    uint16_t crc;           /* CRC16 of the record data. */
+} record_header_t;
+
+typedef struct
+{
+    fs_evt_id_t id;
+    fs_ret_t    result;
+} flash_operation_result_t;
+
+typedef struct
+{
+    fs_config_t const * config;
+    uint32_t const *    record;         /* Header of the newest valid record, NULL if the area is empty. */
+    uint32_t            next_sequence;
+    uint8_t             write_page;     /* Page the next record is appended to, if it fits. */
+    uint16_t            write_offset;   /* Word offset into write_page for the next record. */
+    void const *        queued_data;    /* Record to write once flash is free, NULL if none is queued. */
+    uint16_t            queued_size;
+} flash_area_t;
+
+/**********************************************************
+                       DECLARATIONS
+**********************************************************/
+
+/**
+ * Finds an area's newest record and where to append the next one.
+ */
+static void scan_area(flash_area_t * area);
+
+/**
+ * Checks whether the record starting at header is complete.
+ */
+static bool is_record_valid(uint32_t const * header);
+
+/**
+ * Gets the address of a word in one of an area's pages.
+ */
+static uint32_t const * get_page_address(flash_area_t const * area, uint8_t page, uint16_t offset);
+
+/**
+ * Starts storing the pending record.
+ */
+static void store_pending_record(void);
+
+/**
+ * Starts the first queued write, if any.
+ */
+static void start_queued_write(void);
+
+/**
+ * Called by fstorage once an erase or store has finished.
+ */
+static void fs_evt_handler(fs_evt_t const * const evt, fs_ret_t result);
+
+/**
+ * Continues or finishes the pending write once an erase or store has finished, from main context.
+ */
+static void on_flash_operation_complete(void * evt_data, uint16_t evt_size);
+
+/**********************************************************
+                       VARIABLES
+**********************************************************/
+
+#ifdef MM_BLAZE_GATEWAY
+FS_REGISTER_CFG(fs_config_t algorithm_snapshot_fs_config) =
+{
+    .callback  = fs_evt_handler,
+    .num_pages = ALGORITHM_SNAPSHOT_PAGE_COUNT,
+    .priority  = 0xFE,
+};
+
+FS_REGISTER_CFG(fs_config_t node_positions_fs_config) =
+{
+    .callback  = fs_evt_handler,
+    .num_pages = NODE_POSITIONS_PAGE_COUNT,
+    .priority  = 0xFD,
+};
+#endif
+
+FS_REGISTER_CFG(fs_config_t node_identity_fs_config) =
+{
+    .callback  = fs_evt_handler,
+    .num_pages = NODE_IDENTITY_PAGE_COUNT,
+    .priority  = 0xFC,
+};
+
+/* Areas without a config aren't kept on this build. */
+static flash_area_t areas[FLASH_AREA_COUNT] =
+{
+#ifdef MM_BLAZE_GATEWAY
+    [FLASH_AREA_ALGORITHM_SNAPSHOT] = { .config = &algorithm_snapshot_fs_config },
+    [FLASH_AREA_NODE_POSITIONS]     = { .config = &node_positions_fs_config },
+#endif
+    [FLASH_AREA_NODE_IDENTITY]      = { .config = &node_identity_fs_config },
+};
+
+static uint32_t         pending_record[MAX_RECORD_WORDS];   /* Header and data of the write in progress. */
+static uint16_t         pending_record_words;
+static flash_area_t *   pending_area = NULL;                /* Area being written to, NULL if no write is in progress. */
+
+/**********************************************************
+                       DEFINITIONS
+**********************************************************/
+
+/**
+ * @brief Finds the newest record in each area. Requires the softdevice to be enabled.
+ */
+void mm_flash_storage_init(void)
+{
+    uint32_t err_code;
+
+    err_code = softdevice_sys_evt_handler_set(fs_sys_event_handler);
+    APP_ERROR_CHECK(err_code);
+
+    /* Assigns each area its pages. */
+    err_code = fs_init();
+    APP_ERROR_CHECK(err_code);
+
+    for (uint8_t i = 0; i < FLASH_AREA_COUNT; i++)
+    {
+        if (areas[i].config != NULL)
+        {
+            scan_area(&areas[i]);
+        }
+    }
+}
+
+/**
+ * @brief Copies an area's newest record into data.
+ */
+bool mm_flash_storage_read(mm_flash_area_t area, void * data, uint16_t size)
+{
+    record_header_t const * header = (record_header_t const *)areas[area].record;
+
+    if (header == NULL || header->size != size)
+    {
+        return false;
+    }
+
+    memcpy(data, &areas[area].record[RECORD_HEADER_WORDS], size);
+    return true;
+}
+
+/**
+ * @brief Starts replacing an area's record.
+ */
+bool mm_flash_storage_write(mm_flash_area_t area, void const * data, uint16_t size)
+{
+    if (pending_area != NULL || size > FLASH_STORAGE_MAX_RECORD_SIZE || areas[area].config == NULL)
+    {
+        return false;
+    }
+
+    pending_area = &areas[area];
+    pending_record_words = RECORD_HEADER_WORDS + SIZE_TO_WORDS(size);
+
+    /* Pad with erased words so the padding doesn't need to be programmed. */
+    memset(&pending_record[0], 0xFF, pending_record_words * sizeof(uint32_t));
+    memcpy(&pending_record[RECORD_HEADER_WORDS], data, size);
+
+    record_header_t * header = (record_header_t *)&pending_record[0];
+    header->sequence = pending_area->next_sequence;
+    header->size = size;
+    header->crc = crc16_compute((uint8_t const *)data, size, NULL);
+
+    if (pending_area->write_offset + pending_record_words <= FLASH_PAGE_SIZE_WORDS)
+    {
+        store_pending_record();
+    }
+    else
+    {
+        /* Move on to the next page, it must be erased first. */
+        pending_area->write_page = ( pending_area->write_page + 1 ) % pending_area->config->num_pages;
+        pending_area->write_offset = 0;
+
+        uint32_t err_code;
+        err_code = fs_erase(pending_area->config, get_page_address(pending_area, pending_area->write_page, 0), 1, NULL);
+        APP_ERROR_CHECK(err_code);
+    }
+
+    return true;
+}
+
+/**
+ * @brief Replaces an area's record as soon as flash is free.
+ */
+bool mm_flash_storage_queue_write(mm_flash_area_t area, void const * data, uint16_t size)
+{
+    if (size > FLASH_STORAGE_MAX_RECORD_SIZE || areas[area].config == NULL)
+    {
+        return false;
+    }
+
+    areas[area].queued_data = data;
+    areas[area].queued_size = size;
+
+    if (pending_area == NULL)
+    {
+        start_queued_write();
+    }
+
+    return true;
+}
+
+/**
+ * @brief Checks whether a write is in progress or queued.
+ */
+bool mm_flash_storage_is_busy(void)
+{
+    if (pending_area != NULL)
+    {
+        return true;
+    }
+
+    for (uint8_t i = 0; i < FLASH_AREA_COUNT; i++)
+    {
+        if (areas[i].queued_data != NULL)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Finds an area's newest record and where to append the next one.
+ */
+static void scan_area(flash_area_t * area)
+{
+    /* The log must have somewhere to move on to without erasing the newest record. */
+    APP_ERROR_CHECK(area->config->num_pages < 2);
+
+    area->record = NULL;
+    area->next_sequence = 0;
+
+    /* If nothing is found, the first write erases and starts at the first page. */
+    area->write_page = area->config->num_pages - 1;
+    area->write_offset = FLASH_PAGE_SIZE_WORDS;
+
+    for (uint8_t page = 0; page < area->config->num_pages; page++)
+    {
+        uint16_t offset = 0;
+
+        /* Walk the page's records up to the first erased header. */
+        while (offset + RECORD_HEADER_WORDS <= FLASH_PAGE_SIZE_WORDS)
+        {
+            uint32_t const * address = get_page_address(area, page, offset);
+            record_header_t const * header = (record_header_t const *)address;
+
+            if (header->sequence == FLASH_ERASED_WORD)
+            {
+                break;
+            }
+
+            uint16_t record_words = RECORD_HEADER_WORDS + SIZE_TO_WORDS(header->size);
+            if (header->size > FLASH_STORAGE_MAX_RECORD_SIZE || offset + record_words > FLASH_PAGE_SIZE_WORDS)
+            {
+                /* Not a record header, nothing more can be trusted in this page. */
+                offset = FLASH_PAGE_SIZE_WORDS;
+                break;
+            }
+
+            if (is_record_valid(address) && ( area->record == NULL || header->sequence >= area->next_sequence ))
+            {
+                area->record = address;
+                area->next_sequence = header->sequence + 1;
+                area->write_page = page;
+            }
+
+            offset += record_words;
+        }
+
+        if (area->record != NULL && area->write_page == page)
+        {
+            area->write_offset = offset;
+        }
+    }
+}
+
+/**
+ * Checks whether the record starting at header is complete.
+ */
+static bool is_record_valid(uint32_t const * header)
+{
+    record_header_t const * p_header = (record_header_t const *)header;
+
+    return ( p_header->crc == crc16_compute((uint8_t const *)&header[RECORD_HEADER_WORDS], p_header->size, NULL) );
+}
+
+/**
+ * Gets the address of a word in one of an area's pages.
+ */
+static uint32_t const * get_page_address(flash_area_t const * area, uint8_t page, uint16_t offset)
+{
+    return area->config->p_start_addr + ( page * FLASH_PAGE_SIZE_WORDS ) + offset;
+}
+
+/**
+ * Starts storing the pending record.
+ */
+static void store_pending_record(void)
+{
+    uint32_t err_code;
+    err_code = fs_store
+        (
+        pending_area->config,
+        get_page_address(pending_area, pending_area->write_page, pending_area->write_offset),
+        &pending_record[0],
+        pending_record_words,
+        NULL
+        );
+    APP_ERROR_CHECK(err_code);
+}
+
+/**
+ * Starts the first queued write, if any.
+ */
+static void start_queued_write(void)
+{
+    for (uint8_t i = 0; i < FLASH_AREA_COUNT; i++)
+    {
+        void const * data = areas[i].queued_data;
+
+        if (data != NULL)
+        {
+            /* Cleared first, so the data can be queued again while it's being written. */
+            areas[i].queued_data = NULL;
+
+            (void)mm_flash_storage_write((mm_flash_area_t)i, data, areas[i].queued_size);
+            return;
+        }
+    }
+}
+
+/**
+ * Called by fstorage once an erase or store has finished.
+ */
+static void fs_evt_handler(fs_evt_t const * const evt, fs_ret_t result)
+{
+    flash_operation_result_t operation_result =
+    {
+        .id     = evt->id,
+        .result = result,
+    };
+
+    /* Kick the result to main, fstorage can't take the next operation until this returns. */
+    uint32_t err_code = app_sched_event_put(&operation_result, sizeof(operation_result), on_flash_operation_complete);
+    APP_ERROR_CHECK(err_code);
+}
+
+/**
+ * Continues or finishes the pending write once an erase or store has finished, from main context.
+ */
+static void on_flash_operation_complete(void * evt_data, uint16_t evt_size)
+{
+    flash_operation_result_t const * operation_result = (flash_operation_result_t const *)evt_data;
+
+    if (pending_area == NULL)
+    {
+        return;
+    }
+
+    if (operation_result->id == FS_EVT_ERASE && operation_result->result == FS_SUCCESS)
+    {
+        /* The page is ready, write the record into it. */
+        store_pending_record();
+        return;
+    }
+
+    if (operation_result->id == FS_EVT_STORE)
+    {
+        if (operation_result->result == FS_SUCCESS)
+        {
+            pending_area->record = get_page_address(pending_area, pending_area->write_page, pending_area->write_offset);
+            pending_area->next_sequence++;
+        }
+
+        /* Even a failed store may have programmed some of its words, don't reuse them. */
+        pending_area->write_offset += pending_record_words;
+    }
+    else
+    {
+        /* The page may be partly erased, make the next write try erasing it again. */
+        pending_area->write_page = ( pending_area->write_page + pending_area->config->num_pages - 1 ) % pending_area->config->num_pages;
+        pending_area->write_offset = FLASH_PAGE_SIZE_WORDS;
+    }
+
+    pending_area = NULL;
+
+    start_queued_write();
+}
@@ -0,0 +1,85 @@
+/**
+file: mm_flash_storage_pub.h
+brief: Interface for keeping small records in flash across resets.
+notes: Each area holds one record, the most recently written one. Writes
+       are appended to a log spread across the area's pages, so each page
+       is only erased once the writes have gone all the way around the area.
+*/
+#ifndef MM_FLASH_STORAGE_PUB_H
+#define MM_FLASH_STORAGE_PUB_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**********************************************************
+                        INCLUDES
+**********************************************************/
+
+#include <stdint.h>
+#include "stdbool.h"
+
+/**********************************************************
+                        CONSTANTS
+**********************************************************/
+
+#define FLASH_STORAGE_MAX_RECORD_SIZE   ( 2048 )    ///< in bytes. Largest record any area can hold, half a flash page.
+
+/**********************************************************
+                           TYPES
+**********************************************************/
+
+typedef enum
+{
+    FLASH_AREA_ALGORITHM_SNAPSHOT,  ///< Sensor algorithm state, see mm_sensor_algorithm_snapshot.h. Gateway only.
+    FLASH_AREA_NODE_POSITIONS,      ///< Position pages from the config app, see mm_position_config.c. Gateway only.
+    FLASH_AREA_NODE_IDENTITY,       ///< Node and network ID assigned by the config app, see mm_node_config.c.
+
+    FLASH_AREA_COUNT
+} mm_flash_area_t;
+
+/**********************************************************
+                        DECLARATIONS
+**********************************************************/
+
+/**
+ * @brief Finds the newest record in each area. Requires the softdevice to be enabled.
+ */
+void mm_flash_storage_init(void);
+
+/**
+ * @brief Copies an area's newest record into data.
+ *
+ * @return false if the area is empty, or its record isn't size bytes long.
+ */
+bool mm_flash_storage_read(mm_flash_area_t area, void * data, uint16_t size);
+
+/**
+ * @brief Starts replacing an area's record. The data is copied, so it can be reused
+ *        right away. Reads return the old record until the write has finished.
+ *
+ * @return false if another write is still in progress or the record is too large,
+ *         in which case nothing is written.
+ */
+bool mm_flash_storage_write(mm_flash_area_t area, void const * data, uint16_t size);
+
+/**
+ * @brief Replaces an area's record as soon as flash is free. The data isn't copied,
+ *        it must stay valid until the write starts. Changes made to it before then
+ *        are written too, so queueing again before the write starts costs nothing.
+ *
+ * @return false if the record is too large or the area isn't kept on this build.
+ */
+bool mm_flash_storage_queue_write(mm_flash_area_t area, void const * data, uint16_t size);
+
+/**
+ * @brief Checks whether a write is in progress or queued.
+ */
+bool mm_flash_storage_is_busy(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MM_FLASH_STORAGE_PUB_H */
@@ -0,0 +1,376 @@
+/**
+file: mm_acked_broadcast.c
+brief: Broadcasts pages to the monitoring application until it acknowledges them.
+notes:
+    Messages come from one pool. Each stream keeps its messages in a list,
+    oldest first, and broadcasts the first max_in_flight of them. The
+    pool is smaller than every stream's limit added up, raw sensor data
+    gives way to the other streams when they need the room.
+
+    A stream that broadcasts several messages at once must use a single
+    page number, since the page manager removes pages by page number.
+*/
+
+/**********************************************************
+                        INCLUDES
+**********************************************************/
+
+#include <string.h>
+
+#include "app_error.h"
+#include "app_scheduler.h"
+
+#include "mm_ant_page_manager.h"
+#include "mm_acked_broadcast.h"
+#include "mm_sensor_algorithm_config.h"
+#include "mm_activity_variables.h"
+
+/**********************************************************
+                        CONSTANTS
+**********************************************************/
+
+/* Messages shared by every stream. Can be overridden by the build. */
+#ifndef ACKED_BROADCAST_POOL_SIZE
+#define ACKED_BROADCAST_POOL_SIZE       ( MAX_SENSOR_COUNT + ACTIVITY_VARIABLES_NUM + MAX_GRID_SIZE_X )
+#endif
+
+#define MAX_NUM_LED_NODES               ( MAX_GRID_SIZE_X )
+
+#define PAGE_NUM_INDEX                  ( 0 )
+#define MESSAGE_ID_INDEX                ( 1 )
+#define ACKED_PAGE_NUM_INDEX            ( 2 )
+
+/* Marks the end of a list. */
+#define ACKED_BROADCAST_NO_MESSAGE      ( 0xFF )
+
+#if ACKED_BROADCAST_POOL_SIZE >= ACKED_BROADCAST_NO_MESSAGE
+#error "ACKED_BROADCAST_POOL_SIZE must fit in a message index."
+#endif
+
+/**********************************************************
+                          TYPES
+**********************************************************/
+
+typedef struct
+{
+    uint32_t            key;
+    mm_ant_payload_t    payload;
+    uint8_t             next;           /* Next message in the stream, or on the free list. */
+} message_t;
+
+typedef struct
+{
+    uint8_t             max_queued;     /* Messages the stream can hold. */
+    uint8_t             max_in_flight;  /* Messages broadcast at once, the oldest ones. */
+    uint8_t             copies;
+    mm_ant_page_priority_t priority;
+} stream_config_t;
+
+typedef struct
+{
+    uint8_t             head;           /* Oldest message. */
+    uint8_t             tail;
+    uint8_t             count;
+    uint8_t             page_num;       /* Page number on the page manager, 0 if nothing is broadcast. */
+} stream_t;
+
+/**********************************************************
+                       DECLARATIONS
+**********************************************************/
+
+/**
+ * Interrupt callback for ant events, kicks to on_message_acknowledge
+ */
+static void process_ant_evt(ant_evt_t * evt);
+
+/**
+ * Handles a broadcast acknowledgement. If it acknowledges a message being broadcast,
+ * the message is dropped and the stream moves on to its next message.
+ */
+static void on_message_acknowledge(void* evt_data, uint16_t evt_size);
+
+/**
+ * Find a stream's message with the provided key, ACKED_BROADCAST_NO_MESSAGE if there isn't one.
+ */
+static uint8_t find_message(mm_acked_broadcast_stream_t stream, uint32_t key);
+
+/**
+ * Check whether a message is one of the messages its stream is broadcasting.
+ */
+static bool is_in_flight(mm_acked_broadcast_stream_t stream, uint8_t index);
+
+/**
+ * Drop the oldest message of the least important stream that is no more important than stream.
+ *
+ * Returns false if there was no message to drop.
+ */
+static bool make_room(mm_acked_broadcast_stream_t stream);
+
+/**
+ * Remove a message from its stream and return it to the pool. prev is the
+ * message before it in the stream, ACKED_BROADCAST_NO_MESSAGE if it is the oldest.
+ */
+static void remove_message(mm_acked_broadcast_stream_t stream, uint8_t index, uint8_t prev);
+
+/**
+ * Replace the pages a stream has on the page manager with its current messages.
+ */
+static void refresh_broadcast(mm_acked_broadcast_stream_t stream);
+
+/**********************************************************
+                       VARIABLES
+**********************************************************/
+
+static stream_config_t const stream_configs[ACKED_BROADCAST_STREAM_COUNT] =
+{
+    /* ACKED_BROADCAST_STREAM_LED_OUTPUT */
+    { MAX_NUM_LED_NODES,        MAX_NUM_LED_NODES,      1, ANT_PAGE_PRIORITY_HIGH   },
+    /* ACKED_BROADCAST_STREAM_SENSOR_ERROR */
+    { MAX_SENSOR_COUNT,         1,                      1, ANT_PAGE_PRIORITY_NORMAL },
+    /* ACKED_BROADCAST_STREAM_ACTIVITY */
+    { ACTIVITY_VARIABLES_NUM,   ACTIVITY_VARIABLES_NUM, 1, ANT_PAGE_PRIORITY_NORMAL },
+    /* ACKED_BROADCAST_STREAM_MONITORING */
+    { MAX_SENSOR_COUNT,         1,                      2, ANT_PAGE_PRIORITY_LOW    }
+};
+
+static message_t messages[ACKED_BROADCAST_POOL_SIZE];
+static stream_t streams[ACKED_BROADCAST_STREAM_COUNT];
+static uint8_t free_message = ACKED_BROADCAST_NO_MESSAGE;
+static uint8_t message_id = 0;
+
+/**********************************************************
+                       DEFINITIONS
+**********************************************************/
+
+void mm_acked_broadcast_init(void)
+{
+    memset(&messages[0], 0, sizeof(messages));
+
+    /* Every message starts on the free list. */
+    for (uint8_t i = 0; i < ACKED_BROADCAST_POOL_SIZE; i++)
+    {
+        messages[i].next = ( i + 1 < ACKED_BROADCAST_POOL_SIZE ) ? ( i + 1 ) : ACKED_BROADCAST_NO_MESSAGE;
+    }
+    free_message = 0;
+
+    for (uint8_t i = 0; i < ACKED_BROADCAST_STREAM_COUNT; i++)
+    {
+        streams[i].head = ACKED_BROADCAST_NO_MESSAGE;
+        streams[i].tail = ACKED_BROADCAST_NO_MESSAGE;
+        streams[i].count = 0;
+        streams[i].page_num = 0;
+    }
+
+    /* Register to receive ANT events, used to receive acks on broadcasts. */
+    mm_ant_evt_handler_set(process_ant_evt);
+}
+
+void mm_acked_broadcast_send(mm_acked_broadcast_stream_t stream, uint32_t key, mm_ant_payload_t const * payload)
+{
+    APP_ERROR_CHECK(stream >= ACKED_BROADCAST_STREAM_COUNT);
+
+    stream_t * p_stream = &streams[stream];
+    uint8_t index = find_message(stream, key);
+
+    if (index == ACKED_BROADCAST_NO_MESSAGE)
+    {
+        if (p_stream->count >= stream_configs[stream].max_queued)
+        {
+            /* Full streams drop their own oldest message. */
+            remove_message(stream, p_stream->head, ACKED_BROADCAST_NO_MESSAGE);
+        }
+        else if (free_message == ACKED_BROADCAST_NO_MESSAGE && !make_room(stream))
+        {
+            /* Everything queued is more important. */
+            return;
+        }
+
+        index = free_message;
+        free_message = messages[index].next;
+
+        messages[index].key = key;
+        messages[index].next = ACKED_BROADCAST_NO_MESSAGE;
+
+        if (p_stream->tail == ACKED_BROADCAST_NO_MESSAGE)
+        {
+            p_stream->head = index;
+        }
+        else
+        {
+            messages[p_stream->tail].next = index;
+        }
+        p_stream->tail = index;
+        p_stream->count++;
+    }
+
+    /* A new message id means acks for the message this replaces are ignored. */
+    memcpy(&messages[index].payload, payload, sizeof(mm_ant_payload_t));
+    messages[index].payload.data[MESSAGE_ID_INDEX] = message_id;
+    message_id++;
+
+    if (is_in_flight(stream, index))
+    {
+        refresh_broadcast(stream);
+    }
+}
+
+static void process_ant_evt(ant_evt_t * evt)
+{
+    ANT_MESSAGE * p_message = (ANT_MESSAGE *)evt->msg.evt_buffer;
+
+    switch (evt->event)
+    {
+        /* If this is a "received message" event, take a closer look */
+        case EVENT_RX:
+            if( (p_message->ANT_MESSAGE_ucMesgID == MESG_BROADCAST_DATA_ID) ||
+                (p_message->ANT_MESSAGE_ucMesgID == MESG_ACKNOWLEDGED_DATA_ID) )
+            {
+                if (p_message->ANT_MESSAGE_aucPayload[PAGE_NUM_INDEX] == MESSAGE_ACKNOWLEDGEMENT_PAGE_NUM)
+                {
+                    /* This might acknowledge a current broadcast, kick it to main to check. */
+                    uint32_t err_code;
+                    err_code = app_sched_event_put(evt, sizeof(ant_evt_t), on_message_acknowledge);
+                    APP_ERROR_CHECK(err_code);
+                }
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+static void on_message_acknowledge(void* evt_data, uint16_t evt_size)
+{
+    ant_evt_t const * evt = (ant_evt_t const *)evt_data;
+    ANT_MESSAGE * p_message = (ANT_MESSAGE *)evt->msg.evt_buffer;
+    uint8_t const * payload = &p_message->ANT_MESSAGE_aucPayload[0];
+
+    for (uint8_t stream = 0; stream < ACKED_BROADCAST_STREAM_COUNT; stream++)
+    {
+        /* Only messages being broadcast can be acknowledged. */
+        if (streams[stream].page_num != payload[ACKED_PAGE_NUM_INDEX])
+        {
+            continue;
+        }
+
+        uint8_t prev = ACKED_BROADCAST_NO_MESSAGE;
+        uint8_t index = streams[stream].head;
+
+        for (uint8_t i = 0; i < stream_configs[stream].max_in_flight && index != ACKED_BROADCAST_NO_MESSAGE; i++)
+        {
+            if (messages[index].payload.data[MESSAGE_ID_INDEX] == payload[MESSAGE_ID_INDEX])
+            {
+                remove_message((mm_acked_broadcast_stream_t)stream, index, prev);
+                return;
+            }
+
+            prev = index;
+            index = messages[index].next;
+        }
+    }
+
+    /* Likely received an extra ack, or an ack for a replaced message. */
+}
+
+static uint8_t find_message(mm_acked_broadcast_stream_t stream, uint32_t key)
+{
+    for (uint8_t index = streams[stream].head; index != ACKED_BROADCAST_NO_MESSAGE; index = messages[index].next)
+    {
+        if (messages[index].key == key)
+        {
+            return index;
+        }
+    }
+
+    return ACKED_BROADCAST_NO_MESSAGE;
+}
+
+static bool is_in_flight(mm_acked_broadcast_stream_t stream, uint8_t index)
+{
+    uint8_t in_flight = streams[stream].head;
+
+    for (uint8_t i = 0; i < stream_configs[stream].max_in_flight && in_flight != ACKED_BROADCAST_NO_MESSAGE; i++)
+    {
+        if (in_flight == index)
+        {
+            return true;
+        }
+
+        in_flight = messages[in_flight].next;
+    }
+
+    return false;
+}
+
+static bool make_room(mm_acked_broadcast_stream_t stream)
+{
+    for (int8_t i = ACKED_BROADCAST_STREAM_COUNT - 1; i >= (int8_t)stream; i--)
+    {
+        if (streams[i].count > 0)
+        {
+            remove_message((mm_acked_broadcast_stream_t)i, streams[i].head, ACKED_BROADCAST_NO_MESSAGE);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void remove_message(mm_acked_broadcast_stream_t stream, uint8_t index, uint8_t prev)
+{
+    stream_t * p_stream = &streams[stream];
+
+    /* Check before unlinking, the message after it may start broadcasting. */
+    bool was_in_flight = is_in_flight(stream, index);
+
+    if (prev == ACKED_BROADCAST_NO_MESSAGE)
+    {
+        p_stream->head = messages[index].next;
+    }
+    else
+    {
+        messages[prev].next = messages[index].next;
+    }
+
+    if (p_stream->tail == index)
+    {
+        p_stream->tail = prev;
+    }
+
+    p_stream->count--;
+
+    messages[index].next = free_message;
+    free_message = index;
+
+    if (was_in_flight)
+    {
+        refresh_broadcast(stream);
+    }
+}
+
+static void refresh_broadcast(mm_acked_broadcast_stream_t stream)
+{
+    stream_t * p_stream = &streams[stream];
+    stream_config_t const * p_config = &stream_configs[stream];
+
+    if (p_stream->page_num != 0)
+    {
+        mm_ant_page_manager_remove_all_pages(p_stream->page_num);
+        p_stream->page_num = 0;
+    }
+
+    uint8_t index = p_stream->head;
+    for (uint8_t i = 0; i < p_config->max_in_flight && index != ACKED_BROADCAST_NO_MESSAGE; i++)
+    {
+        mm_ant_payload_t const * payload = &messages[index].payload;
+
+        /* See the notes at the top, every message being broadcast must share a page number. */
+        APP_ERROR_CHECK(p_stream->page_num != 0 && p_stream->page_num != payload->data[PAGE_NUM_INDEX]);
+        p_stream->page_num = payload->data[PAGE_NUM_INDEX];
+
+        mm_ant_page_manager_add_page(p_stream->page_num, payload, p_config->copies, p_config->priority);
+
+        index = messages[index].next;
+    }
+}
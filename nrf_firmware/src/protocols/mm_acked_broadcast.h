@@ -0,0 +1,71 @@
+/**
+file: mm_acked_broadcast.h
+brief: Broadcasts pages to the monitoring application until it acknowledges them.
+notes:
+    Every stream of acknowledged pages shares one pool of messages and one
+    acknowledgement handler. A stream keeps at most one message per key,
+    sending a message with a key that is already queued replaces the queued
+    one, so only the latest state of each sensor, AV or LED is broadcast.
+
+    Byte 0 of each payload is its page number and byte 1 its message id,
+    the message id is filled in here. The monitoring application acks a page
+    by echoing both on the acknowledgement page.
+*/
+#ifndef MM_ACKED_BROADCAST_H
+#define MM_ACKED_BROADCAST_H
+
+/**********************************************************
+                        INCLUDES
+**********************************************************/
+
+#include <stdint.h>
+
+#include "mm_ant_control.h"
+
+/**********************************************************
+                        CONSTANTS
+**********************************************************/
+
+#define MESSAGE_ACKNOWLEDGEMENT_PAGE_NUM    ( 0x20 )
+
+/**********************************************************
+                          TYPES
+**********************************************************/
+
+/**
+    Streams of acknowledged pages, most important first. When every message
+    is in use, the oldest message of the least important stream is dropped
+    to make room, see mm_acked_broadcast_send.
+*/
+typedef enum
+{
+    ACKED_BROADCAST_STREAM_LED_OUTPUT,      ///< LED output status, see mm_led_transmission.c.
+    ACKED_BROADCAST_STREAM_SENSOR_ERROR,    ///< Sensor errors, see mm_sensor_error_transmission.c.
+    ACKED_BROADCAST_STREAM_ACTIVITY,        ///< Activity variables, see mm_av_transmission.c.
+    ACKED_BROADCAST_STREAM_MONITORING,      ///< Raw sensor data, see mm_monitoring_dispatch.c.
+
+    ACKED_BROADCAST_STREAM_COUNT
+} mm_acked_broadcast_stream_t;
+
+/**********************************************************
+                       DECLARATIONS
+**********************************************************/
+
+/**
+    Start listening for acknowledgements. Call before any stream sends a page.
+*/
+void mm_acked_broadcast_init(void);
+
+/**
+    Broadcast a page on a stream until it is acknowledged. The payload is
+    copied and given the next message id.
+
+    If the stream already has a message with the same key, the message is
+    replaced in place, and an ack for the replaced message id is ignored.
+    If the stream or the pool is full, the oldest message of the least
+    important stream, no more important than this one, is dropped. If there
+    is no such message, the page is dropped instead.
+*/
+void mm_acked_broadcast_send(mm_acked_broadcast_stream_t stream, uint32_t key, mm_ant_payload_t const * payload);
+
+#endif /* MM_ACKED_BROADCAST_H */
@@ -0,0 +1,197 @@
+/**
+file: mm_algorithm_config_update.c
+brief: Receives sensor algorithm config updates from the monitoring application over ANT
+notes:
+    A page only has room for one field, so an update is a series of field
+    pages followed by a commit page. Fields are written into the grid's shadow
+    config, which the algorithm never reads. The commit validates the shadow and
+    the algorithm swaps it in at the start of the next second, so a partially
+    written or invalid config is never used and activity variables carry over.
+
+    Payload layout:
+        0:   page number
+        1:   grid id
+        2:   field (algorithm_config_field_t)
+        3-6: value, little endian
+        7:   unused
+*/
+
+/**********************************************************
+                        INCLUDES
+**********************************************************/
+
+#include <stddef.h>
+#include <string.h>
+
+#include "app_error.h"
+#include "app_scheduler.h"
+
+#include "mm_ant_control.h"
+#include "mm_algorithm_config_update.h"
+#include "mm_sensor_algorithm.h"
+#include "mm_sensor_algorithm_config.h"
+
+/**********************************************************
+                        CONSTANTS
+**********************************************************/
+
+#define PAGE_NUMBER_INDEX                    ( 0 )
+#define GRID_ID_INDEX                        ( 1 )
+#define FIELD_INDEX                          ( 2 )
+#define VALUE_INDEX                          ( 3 )
+
+/**********************************************************
+                         MACROS
+**********************************************************/
+
+/* Layout of a mm_sensor_algorithm_config_t member. */
+#define FIELD(member, type)     { offsetof(mm_sensor_algorithm_config_t, member), type }
+
+/**********************************************************
+                          TYPES
+**********************************************************/
+
+typedef enum
+{
+    FIELD_TYPE_FLOAT,
+    FIELD_TYPE_UINT16
+} field_type_t;
+
+/* Where a field lives in mm_sensor_algorithm_config_t and how its value is sent. */
+typedef struct
+{
+    uint8_t         offset;
+    field_type_t    type;
+} field_layout_t;
+
+/**********************************************************
+                       DECLARATIONS
+**********************************************************/
+
+/* Processes an ANT event */
+static void process_ant_evt(ant_evt_t * evt);
+
+/* Decodes an ANT algorithm config update page payload */
+static void decode_config_update_page(void* p_evt, uint16_t size);
+
+/* Writes a field value from a page payload into a config */
+static void write_field(mm_sensor_algorithm_config_t * config, uint8_t field, uint8_t const * value);
+
+/**********************************************************
+                       VARIABLES
+**********************************************************/
+
+static field_layout_t const field_layouts[ALGORITHM_CONFIG_FIELD_COUNT] =
+{
+    FIELD(activity_variable_min,                FIELD_TYPE_FLOAT),
+    FIELD(activity_variable_max,                FIELD_TYPE_FLOAT),
+    FIELD(common_sensor_weight_factor,          FIELD_TYPE_FLOAT),
+    FIELD(base_sensor_weight_factor_pir,        FIELD_TYPE_FLOAT),
+    FIELD(base_sensor_weight_factor_lidar,      FIELD_TYPE_FLOAT),
+    FIELD(road_proximity_factor_0,              FIELD_TYPE_FLOAT),
+    FIELD(road_proximity_factor_1,              FIELD_TYPE_FLOAT),
+    FIELD(road_proximity_factor_2,              FIELD_TYPE_FLOAT),
+    FIELD(common_sensor_trickle_factor,         FIELD_TYPE_FLOAT),
+    FIELD(base_sensor_trickle_factor_pir,       FIELD_TYPE_FLOAT),
+    FIELD(base_sensor_trickle_factor_lidar,     FIELD_TYPE_FLOAT),
+    FIELD(road_trickle_proximity_factor_0,      FIELD_TYPE_FLOAT),
+    FIELD(road_trickle_proximity_factor_1,      FIELD_TYPE_FLOAT),
+    FIELD(road_trickle_proximity_factor_2,      FIELD_TYPE_FLOAT),
+    FIELD(activity_variable_decay_factor,       FIELD_TYPE_FLOAT),
+    FIELD(activity_decay_period_ms,             FIELD_TYPE_UINT16),
+    FIELD(possible_detection_threshold_rs,      FIELD_TYPE_FLOAT),
+    FIELD(possible_detection_threshold_nrs,     FIELD_TYPE_FLOAT),
+    FIELD(detection_threshold_rs,               FIELD_TYPE_FLOAT),
+    FIELD(detection_threshold_nrs,              FIELD_TYPE_FLOAT),
+    FIELD(minimum_concern_signal_duration_s,    FIELD_TYPE_UINT16),
+    FIELD(minimum_alarm_signal_duration_s,      FIELD_TYPE_UINT16),
+};
+
+/**********************************************************
+                       DEFINITIONS
+**********************************************************/
+
+/* Start listening for algorithm config update pages */
+void mm_algorithm_config_update_init(void)
+{
+    // Register to receive ANT events
+    mm_ant_evt_handler_set(&process_ant_evt);
+}
+
+/* Processes an ANT event */
+static void process_ant_evt(ant_evt_t * evt)
+{
+    ANT_MESSAGE * p_message = (ANT_MESSAGE *)evt->msg.evt_buffer;
+
+    switch (evt->event)
+    {
+        // If this is a "received message" event, take a closer look
+        case EVENT_RX:
+
+            if (p_message->ANT_MESSAGE_ucMesgID == MESG_BROADCAST_DATA_ID
+                || p_message->ANT_MESSAGE_ucMesgID == MESG_ACKNOWLEDGED_DATA_ID)
+            {
+                if (p_message->ANT_MESSAGE_aucPayload[PAGE_NUMBER_INDEX] == ALGORITHM_CONFIG_UPDATE_PAGE_NUM)
+                {
+                    app_sched_event_put(evt, sizeof(ant_evt_t), decode_config_update_page);
+                }
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+/* Decodes an ANT algorithm config update page payload */
+static void decode_config_update_page(void* p_evt, uint16_t size)
+{
+    ant_evt_t * evt = (ant_evt_t*)p_evt;
+    ANT_MESSAGE * p_message = (ANT_MESSAGE *)evt->msg.evt_buffer;
+    uint8_t const * update_page = &(p_message->ANT_MESSAGE_aucPayload[0]);
+
+    uint8_t grid_id = update_page[GRID_ID_INDEX];
+    uint8_t field = update_page[FIELD_INDEX];
+
+    if ( grid_id >= MAX_SENSOR_GRIDS )
+    {
+        // Not a grid this gateway runs.
+        return;
+    }
+
+    if ( field == ALGORITHM_CONFIG_FIELD_COMMIT )
+    {
+        // Only wake the algorithm if there is something valid to apply.
+        if ( mm_sensor_algorithm_config_stage( grid_id ) )
+        {
+            mm_sensor_algorithm_on_config_staged();
+        }
+    }
+    else if ( field < ALGORITHM_CONFIG_FIELD_COUNT )
+    {
+        write_field( mm_sensor_algorithm_config_shadow( grid_id ), field, &update_page[VALUE_INDEX] );
+    }
+}
+
+/* Writes a field value from a page payload into a config */
+static void write_field(mm_sensor_algorithm_config_t * config, uint8_t field, uint8_t const * value)
+{
+    field_layout_t const * layout = &field_layouts[field];
+    uint8_t * destination = (uint8_t *)config + layout->offset;
+
+    // Both the payload and the gateway are little endian.
+    switch ( layout->type )
+    {
+        case FIELD_TYPE_FLOAT:
+            memcpy(destination, value, sizeof(float));
+            break;
+
+        case FIELD_TYPE_UINT16:
+            memcpy(destination, value, sizeof(uint16_t));
+            break;
+
+        default:
+            APP_ERROR_CHECK(true);
+            break;
+    }
+}
@@ -0,0 +1,69 @@
+/**
+file: mm_algorithm_config_update.h
+brief: Receives sensor algorithm config updates from the monitoring application over ANT
+notes:
+*/
+#ifndef MM_ALGORITHM_CONFIG_UPDATE_H
+#define MM_ALGORITHM_CONFIG_UPDATE_H
+
+/**********************************************************
+                        INCLUDES
+**********************************************************/
+
+#include <stdint.h>
+
+/**********************************************************
+                        CONSTANTS
+**********************************************************/
+
+#define ALGORITHM_CONFIG_UPDATE_PAGE_NUM    ( 0x12 )
+
+/**********************************************************
+                          ENUMS
+**********************************************************/
+
+/**
+    Config fields a page can update, in mm_sensor_algorithm_config_t order.
+    Float fields are sent as 4 little endian bytes, uint16_t fields as 2.
+*/
+typedef enum
+{
+    ALGORITHM_CONFIG_FIELD_ACTIVITY_VARIABLE_MIN,
+    ALGORITHM_CONFIG_FIELD_ACTIVITY_VARIABLE_MAX,
+    ALGORITHM_CONFIG_FIELD_COMMON_SENSOR_WEIGHT_FACTOR,
+    ALGORITHM_CONFIG_FIELD_BASE_SENSOR_WEIGHT_FACTOR_PIR,
+    ALGORITHM_CONFIG_FIELD_BASE_SENSOR_WEIGHT_FACTOR_LIDAR,
+    ALGORITHM_CONFIG_FIELD_ROAD_PROXIMITY_FACTOR_0,
+    ALGORITHM_CONFIG_FIELD_ROAD_PROXIMITY_FACTOR_1,
+    ALGORITHM_CONFIG_FIELD_ROAD_PROXIMITY_FACTOR_2,
+    ALGORITHM_CONFIG_FIELD_COMMON_SENSOR_TRICKLE_FACTOR,
+    ALGORITHM_CONFIG_FIELD_BASE_SENSOR_TRICKLE_FACTOR_PIR,
+    ALGORITHM_CONFIG_FIELD_BASE_SENSOR_TRICKLE_FACTOR_LIDAR,
+    ALGORITHM_CONFIG_FIELD_ROAD_TRICKLE_PROXIMITY_FACTOR_0,
+    ALGORITHM_CONFIG_FIELD_ROAD_TRICKLE_PROXIMITY_FACTOR_1,
+    ALGORITHM_CONFIG_FIELD_ROAD_TRICKLE_PROXIMITY_FACTOR_2,
+    ALGORITHM_CONFIG_FIELD_ACTIVITY_VARIABLE_DECAY_FACTOR,
+    ALGORITHM_CONFIG_FIELD_ACTIVITY_DECAY_PERIOD_MS,
+    ALGORITHM_CONFIG_FIELD_POSSIBLE_DETECTION_THRESHOLD_RS,
+    ALGORITHM_CONFIG_FIELD_POSSIBLE_DETECTION_THRESHOLD_NRS,
+    ALGORITHM_CONFIG_FIELD_DETECTION_THRESHOLD_RS,
+    ALGORITHM_CONFIG_FIELD_DETECTION_THRESHOLD_NRS,
+    ALGORITHM_CONFIG_FIELD_MINIMUM_CONCERN_SIGNAL_DURATION_S,
+    ALGORITHM_CONFIG_FIELD_MINIMUM_ALARM_SIGNAL_DURATION_S,
+
+    ALGORITHM_CONFIG_FIELD_COUNT,
+
+    /* Validates the fields written so far and stages them to be applied at the next tick. */
+    ALGORITHM_CONFIG_FIELD_COMMIT = 0xFF
+} algorithm_config_field_t;
+
+/**********************************************************
+                       DECLARATIONS
+**********************************************************/
+
+/**
+    Start listening for algorithm config update pages. The sensor algorithm must already be initialized.
+*/
+void mm_algorithm_config_update_init(void);
+
+#endif /* MM_ALGORITHM_CONFIG_UPDATE_H */
@@ -31,7 +31,7 @@ notes:
 void mm_av_transmission_init(void);
 
 /**
- * Broadcast all activity variable state over ANT.
+ * Broadcast all of MONITORED_SENSOR_GRID's activity variable state over ANT.
  */
 void mm_av_transmission_send_all_avs(void);
 
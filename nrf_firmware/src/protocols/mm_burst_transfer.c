@@ -0,0 +1,408 @@
+/**
+file: mm_burst_transfer.c
+brief: Sends large blocks of data to the monitoring application as ANT bursts.
+notes:
+    One transfer is kept at a time. send_offset is the next byte to send and
+    acked_offset the first byte the monitoring application is missing, the
+    transfer moves on as long as they are less than BURST_WINDOW_SIZE apart.
+
+    Between bursts the transfer rests for a channel period, so the page
+    manager's broadcasts still go out while a block is being sent.
+*/
+
+/**********************************************************
+                        INCLUDES
+**********************************************************/
+
+#include <string.h>
+
+#include "app_error.h"
+#include "app_timer.h"
+#include "app_scheduler.h"
+
+#include "mm_ant_control.h"
+#include "mm_ant_static_config.h"
+#include "mm_burst_transfer.h"
+
+/**********************************************************
+                        CONSTANTS
+**********************************************************/
+
+/* Data packets after each burst's header packet. */
+#define BURST_DATA_PACKETS          ( 32 )
+#define BURST_DATA_SIZE             ( BURST_DATA_PACKETS * MM_ANT_BURST_PACKET_SIZE )
+
+/* Bytes sent past the last byte acknowledged. */
+#define BURST_WINDOW_SIZE           ( 4 * BURST_DATA_SIZE )
+
+/* One channel period between bursts, for the broadcasts. */
+#define BURST_REST_INTERVAL         ( ( MM_CHAN_PERIOD * 1000 ) / 32768 )
+#define BURST_ACK_TIMEOUT_INTERVAL  ( 2000 )
+#define BURST_MAX_RETRIES           ( 3 )
+
+#define PAGE_NUM_INDEX              ( 0 )
+#define DATA_TYPE_INDEX             ( 1 )
+#define ARGUMENT_INDEX              ( 2 )
+#define TRANSFER_ID_INDEX           ( 3 )
+#define OFFSET_INDEX                ( 4 )
+#define SIZE_INDEX                  ( 6 )
+
+#define NEW_TRANSFER_ID             ( 0 )
+
+APP_TIMER_DEF(m_timer_id);
+
+/**********************************************************
+                          TYPES
+**********************************************************/
+
+typedef enum
+{
+    TRANSFER_IDLE,      /* No transfer, or the transfer is done or paused. */
+    TRANSFER_READY,     /* Between steps, see send_next. */
+    TRANSFER_SENDING,   /* A burst is in progress. */
+    TRANSFER_RESTING,   /* Waiting for the next burst. */
+    TRANSFER_WAITING    /* Waiting for an acknowledgement. */
+} transfer_state_t;
+
+typedef struct
+{
+    mm_burst_size_handler_t size_handler;
+    mm_burst_read_handler_t read_handler;
+} burst_source_t;
+
+/**********************************************************
+                       DECLARATIONS
+**********************************************************/
+
+/**
+ * Interrupt callback for ant events, kicks requests and the end of bursts to main.
+ */
+static void process_ant_evt(ant_evt_t * evt);
+
+/**
+ * Starts, acknowledges or resumes a transfer.
+ */
+static void on_burst_request(void* evt_data, uint16_t evt_size);
+
+/**
+ * Moves the transfer on after a burst, whether or not it made it.
+ */
+static void on_burst_end(void* evt_data, uint16_t evt_size);
+
+/**
+ * Interrupt callback for the transfer timer, kicks to on_timer_expired.
+ */
+static void timer_event(void * p_context);
+
+/**
+ * Ends a rest, or sends the window again if it wasn't acknowledged.
+ */
+static void on_timer_expired(void* evt_data, uint16_t evt_size);
+
+/**
+ * Starts the next burst if the window has room, otherwise waits for an acknowledgement.
+ */
+static void send_next(void);
+
+/**
+ * Starts a burst from send_offset, returns false if it couldn't be started.
+ */
+static bool send_burst(void);
+
+/**
+ * Counts a failed attempt, pausing the transfer if there have been too many.
+ * Returns false if the transfer was paused.
+ */
+static bool retry(void);
+
+/**
+ * Switch to a state that runs the timer for a number of milliseconds.
+ */
+static void start_timer(transfer_state_t timer_state, uint32_t interval);
+
+/**********************************************************
+                       VARIABLES
+**********************************************************/
+
+static burst_source_t sources[BURST_DATA_TYPE_COUNT];
+
+static transfer_state_t state = TRANSFER_IDLE;
+static uint8_t transfer_id = NEW_TRANSFER_ID;
+static uint8_t data_type;
+static uint8_t argument;
+static uint16_t total_size;
+static uint16_t send_offset;
+static uint16_t acked_offset;
+static uint8_t retries;
+
+/* The transfer the burst in progress is for, where it starts, and how much data it has. */
+static uint8_t burst_transfer_id;
+static uint16_t burst_offset;
+static uint16_t burst_size;
+
+/* Held by the softdevice while a burst is in progress. */
+static uint8_t burst_buffer[( 1 + BURST_DATA_PACKETS ) * MM_ANT_BURST_PACKET_SIZE];
+
+/**********************************************************
+                       DEFINITIONS
+**********************************************************/
+
+void mm_burst_transfer_init(void)
+{
+    memset(&sources[0], 0, sizeof(sources));
+    state = TRANSFER_IDLE;
+    transfer_id = NEW_TRANSFER_ID;
+
+    uint32_t err_code;
+    err_code = app_timer_create(&m_timer_id, APP_TIMER_MODE_SINGLE_SHOT, timer_event);
+    APP_ERROR_CHECK(err_code);
+
+    /* Register to receive ANT events, used to receive requests and the end of bursts. */
+    mm_ant_evt_handler_set(process_ant_evt);
+}
+
+void mm_burst_transfer_set_source(mm_burst_data_type_t data_type, mm_burst_size_handler_t size_handler, mm_burst_read_handler_t read_handler)
+{
+    APP_ERROR_CHECK(data_type >= BURST_DATA_TYPE_COUNT);
+
+    sources[data_type].size_handler = size_handler;
+    sources[data_type].read_handler = read_handler;
+}
+
+static void process_ant_evt(ant_evt_t * evt)
+{
+    ANT_MESSAGE * p_message = (ANT_MESSAGE *)evt->msg.evt_buffer;
+    uint32_t err_code;
+
+    switch (evt->event)
+    {
+        /* If this is a "received message" event, take a closer look */
+        case EVENT_RX:
+            if( (p_message->ANT_MESSAGE_ucMesgID == MESG_BROADCAST_DATA_ID) ||
+                (p_message->ANT_MESSAGE_ucMesgID == MESG_ACKNOWLEDGED_DATA_ID) )
+            {
+                if (p_message->ANT_MESSAGE_aucPayload[PAGE_NUM_INDEX] == BURST_REQUEST_PAGE_NUM)
+                {
+                    err_code = app_sched_event_put(evt, sizeof(ant_evt_t), on_burst_request);
+                    APP_ERROR_CHECK(err_code);
+                }
+            }
+            break;
+
+        case EVENT_TRANSFER_TX_COMPLETED:
+        case EVENT_TRANSFER_TX_FAILED:
+            if (evt->channel == MM_CHANNEL_NUMBER)
+            {
+                err_code = app_sched_event_put(evt, sizeof(ant_evt_t), on_burst_end);
+                APP_ERROR_CHECK(err_code);
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+static void on_burst_request(void* evt_data, uint16_t evt_size)
+{
+    ant_evt_t const * evt = (ant_evt_t const *)evt_data;
+    ANT_MESSAGE * p_message = (ANT_MESSAGE *)evt->msg.evt_buffer;
+    uint8_t const * request = &p_message->ANT_MESSAGE_aucPayload[0];
+
+    if (request[DATA_TYPE_INDEX] >= BURST_DATA_TYPE_COUNT || sources[request[DATA_TYPE_INDEX]].size_handler == NULL)
+    {
+        return;
+    }
+
+    uint16_t offset;
+    memcpy(&offset, &request[OFFSET_INDEX], sizeof(uint16_t));
+
+    bool is_current_transfer = transfer_id != NEW_TRANSFER_ID &&
+                               request[TRANSFER_ID_INDEX] == transfer_id &&
+                               request[DATA_TYPE_INDEX] == data_type &&
+                               request[ARGUMENT_INDEX] == argument;
+
+    if (!is_current_transfer)
+    {
+        uint16_t size = sources[request[DATA_TYPE_INDEX]].size_handler(request[ARGUMENT_INDEX]);
+        if (size == 0)
+        {
+            return;
+        }
+
+        /* Replaces any other transfer, a burst in progress carries on with its old header. */
+        transfer_id = ( transfer_id % UINT8_MAX ) + 1;
+        data_type = request[DATA_TYPE_INDEX];
+        argument = request[ARGUMENT_INDEX];
+        total_size = size;
+        acked_offset = 0;
+        send_offset = 0;
+        offset = 0;
+    }
+
+    if (offset > total_size)
+    {
+        offset = total_size;
+    }
+
+    if (offset < acked_offset || offset > send_offset)
+    {
+        /* The monitoring application lost data, or resumed with data it kept. Carry on from what it has. */
+        send_offset = offset;
+    }
+    acked_offset = offset;
+    retries = 0;
+
+    switch (state)
+    {
+        case TRANSFER_IDLE:
+        case TRANSFER_WAITING:
+            (void)app_timer_stop(m_timer_id);
+            state = TRANSFER_READY;
+            send_next();
+            break;
+
+        default:
+            /* Picked up at the end of the burst or rest. */
+            break;
+    }
+}
+
+static void on_burst_end(void* evt_data, uint16_t evt_size)
+{
+    ant_evt_t const * evt = (ant_evt_t const *)evt_data;
+
+    if (state != TRANSFER_SENDING)
+    {
+        return;
+    }
+
+    if (evt->event == EVENT_TRANSFER_TX_COMPLETED)
+    {
+        /* Unless a request moved the transfer elsewhere during the burst. */
+        if (burst_transfer_id == transfer_id && send_offset == burst_offset)
+        {
+            send_offset = burst_offset + burst_size;
+        }
+    }
+    else if (!retry())
+    {
+        return;
+    }
+
+    start_timer(TRANSFER_RESTING, BURST_REST_INTERVAL);
+}
+
+static void timer_event(void * p_context)
+{
+    uint32_t err_code;
+    err_code = app_sched_event_put(NULL, 0, on_timer_expired);
+    APP_ERROR_CHECK(err_code);
+}
+
+static void on_timer_expired(void* evt_data, uint16_t evt_size)
+{
+    switch (state)
+    {
+        case TRANSFER_RESTING:
+            state = TRANSFER_READY;
+            send_next();
+            break;
+
+        case TRANSFER_WAITING:
+            if (retry())
+            {
+                /* Nothing acknowledged, send the window again. */
+                send_offset = acked_offset;
+                state = TRANSFER_READY;
+                send_next();
+            }
+            break;
+
+        default:
+            /* Stopped after the timer fired. */
+            break;
+    }
+}
+
+static void send_next(void)
+{
+    if (send_offset < total_size &&
+        send_offset - acked_offset < BURST_WINDOW_SIZE &&
+        send_burst())
+    {
+        state = TRANSFER_SENDING;
+        return;
+    }
+
+    if (acked_offset >= total_size)
+    {
+        /* Done, or the block went away. */
+        state = TRANSFER_IDLE;
+        return;
+    }
+
+    /* Window is full, everything has been sent, or the channel is busy. */
+    start_timer(TRANSFER_WAITING, BURST_ACK_TIMEOUT_INTERVAL);
+}
+
+static bool send_burst(void)
+{
+    uint16_t size = total_size - send_offset;
+    if (size > BURST_DATA_SIZE)
+    {
+        size = BURST_DATA_SIZE;
+    }
+
+    memset(&burst_buffer[0], 0, sizeof(burst_buffer));
+
+    burst_buffer[PAGE_NUM_INDEX] = BURST_HEADER_PAGE_NUM;
+    burst_buffer[DATA_TYPE_INDEX] = data_type;
+    burst_buffer[ARGUMENT_INDEX] = argument;
+    burst_buffer[TRANSFER_ID_INDEX] = transfer_id;
+    memcpy(&burst_buffer[OFFSET_INDEX], &send_offset, sizeof(uint16_t));
+    memcpy(&burst_buffer[SIZE_INDEX], &total_size, sizeof(uint16_t));
+
+    if (!sources[data_type].read_handler(argument, send_offset, &burst_buffer[MM_ANT_BURST_PACKET_SIZE], size))
+    {
+        /* The block went away, the monitoring application will have to ask again. */
+        transfer_id = NEW_TRANSFER_ID;
+        total_size = 0;
+        acked_offset = 0;
+        return false;
+    }
+
+    uint16_t data_packets = ( size + MM_ANT_BURST_PACKET_SIZE - 1 ) / MM_ANT_BURST_PACKET_SIZE;
+    if (!mm_ant_burst_send(&burst_buffer[0], ( 1 + data_packets ) * MM_ANT_BURST_PACKET_SIZE))
+    {
+        return false;
+    }
+
+    burst_transfer_id = transfer_id;
+    burst_offset = send_offset;
+    burst_size = size;
+    return true;
+}
+
+static bool retry(void)
+{
+    retries++;
+
+    if (retries > BURST_MAX_RETRIES)
+    {
+        /* Nobody is listening. Kept so the monitoring application can resume it. */
+        state = TRANSFER_IDLE;
+        return false;
+    }
+
+    return true;
+}
+
+static void start_timer(transfer_state_t timer_state, uint32_t interval)
+{
+    uint32_t err_code;
+    err_code = app_timer_start(m_timer_id, APP_TIMER_TICKS(interval), NULL);
+    APP_ERROR_CHECK(err_code);
+
+    state = timer_state;
+}
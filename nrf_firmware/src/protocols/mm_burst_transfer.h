@@ -0,0 +1,89 @@
+/**
+file: mm_burst_transfer.h
+brief: Sends large blocks of data to the monitoring application as ANT bursts.
+notes:
+    The monitoring application asks for a block by data type and argument.
+    The block is sent in bursts of up to BURST_DATA_PACKETS packets, each
+    burst starts with a header packet saying where its data goes. At most
+    BURST_WINDOW_SIZE bytes are sent past the last byte acknowledged, the
+    monitoring application acknowledges by asking for the first byte it
+    doesn't have. Without an acknowledgement the window is sent again,
+    after BURST_MAX_RETRIES the transfer is paused until it is asked for again.
+
+    Request page, monitoring application to gateway:
+        byte 0: BURST_REQUEST_PAGE_NUM
+        byte 1: data type (mm_burst_data_type_t)
+        byte 2: argument, see mm_burst_data_type_t
+        byte 3: transfer id, 0 to start a new transfer
+        byte 4-5: first byte wanted, little endian, ignored for a new transfer
+
+    Burst header packet, gateway to monitoring application:
+        byte 0: BURST_HEADER_PAGE_NUM
+        byte 1: data type
+        byte 2: argument
+        byte 3: transfer id, asking for a transfer the gateway no longer has starts a new one
+        byte 4-5: offset of the burst's data in the block, little endian
+        byte 6-7: size of the block, little endian
+
+    The data follows in the burst's remaining packets, the last one padded with 0s.
+    The broadcast pages keep going between bursts, every other channel period.
+*/
+#ifndef MM_BURST_TRANSFER_H
+#define MM_BURST_TRANSFER_H
+
+/**********************************************************
+                        INCLUDES
+**********************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**********************************************************
+                        CONSTANTS
+**********************************************************/
+
+#define BURST_REQUEST_PAGE_NUM      ( 0x2B )
+#define BURST_HEADER_PAGE_NUM       ( 0x2C )
+
+/**********************************************************
+                          TYPES
+**********************************************************/
+
+/**
+    Blocks the monitoring application can ask for.
+*/
+typedef enum
+{
+    BURST_DATA_WILDLIFE_STATISTICS,     ///< A grid's wildlife statistics, the argument is the grid id. See mm_wildlife_statistics_export.
+
+    BURST_DATA_TYPE_COUNT
+} mm_burst_data_type_t;
+
+/**
+    Get the size of the block for an argument, 0 if there is no such block.
+*/
+typedef uint16_t (*mm_burst_size_handler_t)(uint8_t argument);
+
+/**
+    Read size bytes of the block for an argument, starting offset bytes in.
+
+    return false if the block can no longer be read, which ends the transfer.
+*/
+typedef bool (*mm_burst_read_handler_t)(uint8_t argument, uint16_t offset, uint8_t * data, uint16_t size);
+
+/**********************************************************
+                       DECLARATIONS
+**********************************************************/
+
+/**
+    Start answering burst requests.
+*/
+void mm_burst_transfer_init(void);
+
+/**
+    Set where the blocks of a data type come from, requests for a data type without a source are ignored.
+    The block is read as it is sent, so a block that changes during a transfer arrives with a mix of old and new data.
+*/
+void mm_burst_transfer_set_source(mm_burst_data_type_t data_type, mm_burst_size_handler_t size_handler, mm_burst_read_handler_t read_handler);
+
+#endif /* MM_BURST_TRANSFER_H */
@@ -0,0 +1,251 @@
+/**
+file: mm_channel_period_control.c
+brief: Switches every node between the low-power and low-latency BLAZE channel periods together.
+notes:
+    The two periods are a power of two apart, so a node left on the other
+    period still lines up with every fourth message rather than losing the
+    network. It catches up on the next announcement.
+*/
+
+/**********************************************************
+                        INCLUDES
+**********************************************************/
+
+#include <string.h>
+
+#include "app_error.h"
+#include "app_scheduler.h"
+#include "app_timer.h"
+
+#include "mm_channel_period_control.h"
+#include "mm_blaze_control.h"
+#include "mm_blaze_static_config.h"
+
+/**********************************************************
+                        CONSTANTS
+**********************************************************/
+
+#define BLAZE_CHANNEL_PERIOD_PAGE_NUM       ( 0x07 )
+
+#define PAGE_NUM_INDEX                      ( 0 )
+#define MODE_INDEX                          ( 1 )
+#define DELAY_INDEX                         ( 2 )
+
+#define CHANNEL_PERIOD_DELAY_UNIT_MS        ( 100 )
+#define CHANNEL_PERIOD_SWITCH_DELAY_MS      ( 2000 )    /* Long enough for the mode message to reach every node. */
+#define CHANNEL_PERIOD_ANNOUNCE_PERIOD_MS   ( 60000 )
+
+#if CHANNEL_PERIOD_SWITCH_DELAY_MS / CHANNEL_PERIOD_DELAY_UNIT_MS > UINT8_MAX
+#error "CHANNEL_PERIOD_SWITCH_DELAY_MS doesn't fit in the mode message."
+#endif
+
+/**********************************************************
+                       DECLARATIONS
+**********************************************************/
+
+/**
+ * Change this node's channel period to the pending mode.
+ */
+static void apply_pending_mode(void);
+
+/**
+ * Switch to the pending mode after delay_ms, straight away for 0.
+ */
+static void schedule_switch(uint32_t delay_ms);
+
+/**
+ * Interrupt handler for the switch timer, kicks to on_switch_timeout.
+ */
+static void switch_timer_event(void * p_context);
+
+static void on_switch_timeout(void* p_data, uint16_t size);
+
+#ifdef MM_BLAZE_GATEWAY
+    /**
+     * Send a mode message to every node.
+     */
+    static void send_mode_message(mm_channel_period_mode_t mode, uint32_t delay_ms);
+
+    /**
+     * Interrupt handler for the announcement timer, kicks to on_announce_timeout.
+     */
+    static void announce_timer_event(void * p_context);
+
+    static void on_announce_timeout(void* p_data, uint16_t size);
+#else
+    /**
+     * Interrupt handler for blaze rx events, passes mode messages to main.
+     */
+    static void blaze_rx_handler(ant_blaze_message_t msg);
+
+    static void on_mode_message(void* p_data, uint16_t size);
+#endif
+
+/**********************************************************
+                       VARIABLES
+**********************************************************/
+
+APP_TIMER_DEF(m_switch_timer_id);
+#ifdef MM_BLAZE_GATEWAY
+    APP_TIMER_DEF(m_announce_timer_id);
+#endif
+
+static uint16_t const channel_periods[CHANNEL_PERIOD_MODE_COUNT] =
+{
+    MM_CHANNEL_PERIOD_LOW_POWER,
+    MM_CHANNEL_PERIOD_LOW_LATENCY
+};
+
+static mm_channel_period_mode_t current_mode;   /* Mode the radio is running at. */
+static mm_channel_period_mode_t pending_mode;   /* Mode the network is switching to, current_mode if it isn't switching. */
+
+/**********************************************************
+                       DEFINITIONS
+**********************************************************/
+
+void mm_channel_period_control_init(void)
+{
+    /* Blaze starts at MM_CHANNEL_PERIOD. */
+    current_mode = CHANNEL_PERIOD_MODE_LOW_LATENCY;
+    pending_mode = CHANNEL_PERIOD_MODE_LOW_LATENCY;
+
+    uint32_t err_code;
+    err_code = app_timer_create(&m_switch_timer_id, APP_TIMER_MODE_SINGLE_SHOT, switch_timer_event);
+    APP_ERROR_CHECK(err_code);
+
+#ifdef MM_BLAZE_GATEWAY
+    err_code = app_timer_create(&m_announce_timer_id, APP_TIMER_MODE_REPEATED, announce_timer_event);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = app_timer_start(m_announce_timer_id, APP_TIMER_TICKS(CHANNEL_PERIOD_ANNOUNCE_PERIOD_MS), NULL);
+    APP_ERROR_CHECK(err_code);
+#else
+    mm_blaze_register_message_listener(blaze_rx_handler);
+#endif
+}
+
+static void apply_pending_mode(void)
+{
+    if (pending_mode != current_mode)
+    {
+        mm_blaze_set_channel_period(channel_periods[pending_mode]);
+        current_mode = pending_mode;
+    }
+}
+
+static void schedule_switch(uint32_t delay_ms)
+{
+    (void)app_timer_stop(m_switch_timer_id);
+
+    if (delay_ms == 0)
+    {
+        apply_pending_mode();
+        return;
+    }
+
+    uint32_t err_code;
+    err_code = app_timer_start(m_switch_timer_id, APP_TIMER_TICKS(delay_ms), NULL);
+    APP_ERROR_CHECK(err_code);
+}
+
+static void switch_timer_event(void * p_context)
+{
+    uint32_t err_code;
+    err_code = app_sched_event_put(NULL, 0, on_switch_timeout);
+    APP_ERROR_CHECK(err_code);
+}
+
+static void on_switch_timeout(void* p_data, uint16_t size)
+{
+    apply_pending_mode();
+}
+
+#ifdef MM_BLAZE_GATEWAY
+
+void mm_channel_period_control_set_mode(mm_channel_period_mode_t mode)
+{
+    APP_ERROR_CHECK(mode >= CHANNEL_PERIOD_MODE_COUNT);
+
+    if (mode == pending_mode)
+    {
+        return;
+    }
+
+    pending_mode = mode;
+
+    send_mode_message(mode, CHANNEL_PERIOD_SWITCH_DELAY_MS);
+    schedule_switch(CHANNEL_PERIOD_SWITCH_DELAY_MS);
+}
+
+static void send_mode_message(mm_channel_period_mode_t mode, uint32_t delay_ms)
+{
+    ant_blaze_message_t blaze_message;
+    memset(&blaze_message, 0, sizeof(blaze_message));
+
+    blaze_message.address = MM_DEFAULT_GROUP_ID;
+    blaze_message.index = 0;
+    blaze_message.length = 5;
+
+    uint8_t payload[5];
+    memset(&payload[0], 0xFF, sizeof(payload));
+
+    payload[PAGE_NUM_INDEX] = BLAZE_CHANNEL_PERIOD_PAGE_NUM;
+    payload[MODE_INDEX] = mode;
+    payload[DELAY_INDEX] = delay_ms / CHANNEL_PERIOD_DELAY_UNIT_MS;
+
+    blaze_message.p_data = &payload[0];
+
+    mm_blaze_send_message(&blaze_message);
+}
+
+static void announce_timer_event(void * p_context)
+{
+    uint32_t err_code;
+    err_code = app_sched_event_put(NULL, 0, on_announce_timeout);
+    APP_ERROR_CHECK(err_code);
+}
+
+static void on_announce_timeout(void* p_data, uint16_t size)
+{
+    /* A switch under way has already been sent, announcing the old mode would undo it. */
+    if (pending_mode == current_mode)
+    {
+        send_mode_message(current_mode, 0);
+    }
+}
+
+#else
+
+static void blaze_rx_handler(ant_blaze_message_t msg)
+{
+    /* Filter message for types we care about. */
+    if (msg.p_data[PAGE_NUM_INDEX] != BLAZE_CHANNEL_PERIOD_PAGE_NUM)
+    {
+        return;
+    }
+
+    /* Pack message to serializable format. */
+    mm_blaze_message_serialized_t evt;
+    mm_blaze_pack_message(&msg, &evt);
+
+    /* Kick event to main */
+    uint32_t err_code;
+    err_code = app_sched_event_put(&evt, sizeof(evt), on_mode_message);
+    APP_ERROR_CHECK(err_code);
+}
+
+static void on_mode_message(void* p_data, uint16_t size)
+{
+    mm_blaze_message_serialized_t const * msg = (mm_blaze_message_serialized_t const *)p_data;
+
+    /* From newer firmware, ignore it. */
+    if (msg->data[MODE_INDEX] >= CHANNEL_PERIOD_MODE_COUNT)
+    {
+        return;
+    }
+
+    pending_mode = (mm_channel_period_mode_t)msg->data[MODE_INDEX];
+    schedule_switch(msg->data[DELAY_INDEX] * CHANNEL_PERIOD_DELAY_UNIT_MS);
+}
+
+#endif
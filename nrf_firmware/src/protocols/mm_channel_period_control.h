@@ -0,0 +1,53 @@
+/**
+file: mm_channel_period_control.h
+brief: Switches every node between the low-power and low-latency BLAZE channel periods together.
+notes:
+    The gateway picks the mode and sends it to MM_DEFAULT_GROUP_ID. Every
+    node, and the gateway, switches CHANNEL_PERIOD_SWITCH_DELAY_MS after
+    the message is sent, so the network changes period in step. The gateway
+    repeats the current mode every CHANNEL_PERIOD_ANNOUNCE_PERIOD_MS for
+    nodes that missed it or restarted.
+
+    Nodes start at MM_CHANNEL_PERIOD, the low-latency period.
+
+    Mode message, gateway to every node:
+        byte 0: BLAZE_CHANNEL_PERIOD_PAGE_NUM
+        byte 1: mm_channel_period_mode_t
+        byte 2: delay before switching, in CHANNEL_PERIOD_DELAY_UNIT_MS
+*/
+#ifndef MM_CHANNEL_PERIOD_CONTROL_H
+#define MM_CHANNEL_PERIOD_CONTROL_H
+
+/**********************************************************
+                        INCLUDES
+**********************************************************/
+
+#include <stdint.h>
+
+/**********************************************************
+                          TYPES
+**********************************************************/
+
+typedef enum
+{
+    CHANNEL_PERIOD_MODE_LOW_POWER,      ///< MM_CHANNEL_PERIOD_LOW_POWER
+    CHANNEL_PERIOD_MODE_LOW_LATENCY,    ///< MM_CHANNEL_PERIOD_LOW_LATENCY
+
+    CHANNEL_PERIOD_MODE_COUNT
+} mm_channel_period_mode_t;
+
+/**********************************************************
+                       DECLARATIONS
+**********************************************************/
+
+/**
+    Start at the low-latency period. Nodes listen for mode messages, the gateway starts announcing its mode.
+*/
+void mm_channel_period_control_init(void);
+
+/**
+    Gateway only, switch the whole network to a mode. Does nothing if the network is already switching to it.
+*/
+void mm_channel_period_control_set_mode(mm_channel_period_mode_t mode);
+
+#endif /* MM_CHANNEL_PERIOD_CONTROL_H */
@@ -2,6 +2,23 @@
 file: mm_led_control.c
 brief: Methods for controlling LEDs over blaze
 notes:
+    Group message, sent to MM_DEFAULT_GROUP_ID:
+        byte 0: BLAZE_LED_GROUP_TRANSMISSION_PAGE_NUM
+        byte 1: number of nodes
+        then LED_GROUP_ENTRY_SIZE bytes per node:
+            byte 0-1: node id, little endian
+            byte 2: led function << 4 | led colour
+            byte 3: sequence number of the state
+
+    Ack, node to gateway:
+        byte 0: BLAZE_LED_ACK_PAGE_NUM
+        byte 1: sequence number of the state the node is showing
+
+    The gateway only sends a node's state when it changes. The state is
+    sent again, backing off from LED_RETRANSMIT_MIN_MS to LED_RETRANSMIT_MAX_MS,
+    until the node acks it or LED_MAX_SENDS is reached. Every
+    LED_KEEP_ALIVE_PERIOD_MS every state is sent again the same way, in case
+    a node restarted or was out of reach for all of its sends.
 */
 
 /**********************************************************
@@ -28,6 +45,12 @@ notes:
 #include "mm_rgb_led_pub.h"
 //For MM_GATEWAY_ID
 #include "mm_blaze_static_config.h"
+#ifdef MM_BLAZE_GATEWAY
+    //For retransmit and keep-alive timers
+    #include "app_timer.h"
+    //For the number of LED nodes
+    #include "mm_sensor_algorithm_config.h"
+#endif
 
 /**********************************************************
                         CONSTANTS
@@ -39,7 +62,23 @@ notes:
 #define LED_FUNCTION_INDEX                      (1)
 #define LED_COLOUR_INDEX                        (2)
 
+#define LED_GROUP_COUNT_INDEX                   (1)
+#define LED_GROUP_HEADER_SIZE                   (2)
+#define LED_GROUP_ENTRY_SIZE                    (4)
+#define LED_GROUP_MAX_ENTRIES                   ((ANT_BLAZE_MAX_MESSAGE_LENGTH - LED_GROUP_HEADER_SIZE) / LED_GROUP_ENTRY_SIZE)
+
+#define LED_ACK_SEQUENCE_INDEX                  (1)
+
 #define BLAZE_LED_STATUS_TRANSMISSION_PAGE_NUM  (0x03)
+#define BLAZE_LED_GROUP_TRANSMISSION_PAGE_NUM   (0x05)
+#define BLAZE_LED_ACK_PAGE_NUM                  (0x06)
+
+#define LED_RETRANSMIT_MIN_MS                   (500)   //Wait before the first retransmit, doubled for each one after
+#define LED_RETRANSMIT_MAX_MS                   (4000)
+#define LED_MAX_SENDS                           (6)     //Sends of a state before waiting for the keep-alive
+#define LED_KEEP_ALIVE_PERIOD_MS                (60000)
+
+#define MAX_LED_NODES                           (MAX_GRID_SIZE_X * MAX_SENSOR_GRIDS)
 
 //Used to test sending LED control messages from the gateway to the node by pressing buttons
 #ifdef MM_BLAZE_GATEWAY
@@ -50,9 +89,17 @@ notes:
     #define TEST_LED_MESSAGES                       (false) //Always false if not a gateway
 #endif
 /**********************************************************
-                          ENUMS
+                          TYPES
 **********************************************************/
-
+#ifdef MM_BLAZE_GATEWAY
+typedef struct
+{
+    led_node_output_t   output;
+    uint8_t             sequence;       //Sequence number of the output, the node acks it
+    uint8_t             sends_left;     //0 once acked, or after LED_MAX_SENDS without an ack
+    bool                in_use;
+} led_node_state_t;
+#endif
 
 /**********************************************************
                        DECLARATIONS
@@ -69,6 +116,48 @@ notes:
      * Main handler for updates to led output.
      */
     static void on_led_control_evt(void* p_data, uint16_t size);
+
+    /**
+     * Acks an LED state from the gateway.
+     */
+    static void send_led_ack(uint8_t sequence);
+#else
+    /**
+     * Interrupt handler for blaze rx events, passes LED acks to main.
+     */
+    static void gateway_blaze_rx_handler(ant_blaze_message_t msg);
+
+    /**
+     * Main handler for LED acks.
+     */
+    static void on_led_ack_evt(void* p_data, uint16_t size);
+
+    /**
+     * Gets the state record for a node, or a record to reuse for it. NULL if none are free.
+     */
+    static led_node_state_t * get_led_node_state(uint16_t node_id);
+
+    /**
+     * Sends every state not acked yet, and waits retransmit_delay_ms to send them again.
+     */
+    static void send_unacked_states(void);
+
+    /**
+     * Sends one group message with up to LED_GROUP_MAX_ENTRIES node states.
+     */
+    static void send_led_group_message(led_node_state_t const * const * states, uint8_t count);
+
+    /**
+     * Interrupt handlers for the retransmit and keep-alive timers, kick to main.
+     */
+    static void retransmit_timer_event(void * p_context);
+    static void keep_alive_timer_event(void * p_context);
+
+    /**
+     * Main handlers for the retransmit and keep-alive timers.
+     */
+    static void on_retransmit_timeout(void* p_data, uint16_t size);
+    static void on_keep_alive_timeout(void* p_data, uint16_t size);
 #endif /* MM_BLAZE_GATEWAY */
 
     /**
@@ -100,6 +189,15 @@ notes:
 **********************************************************/
 static hardware_config_t configuration;
 
+#ifdef MM_BLAZE_GATEWAY
+    APP_TIMER_DEF(m_retransmit_timer_id);
+    APP_TIMER_DEF(m_keep_alive_timer_id);
+
+    static led_node_state_t led_node_states[MAX_LED_NODES];
+    static uint8_t next_sequence = 0;
+    static uint32_t retransmit_delay_ms = LED_RETRANSMIT_MIN_MS;
+#endif
+
 #if TEST_LED_MESSAGES
     static led_colours_t test_led_msgs_current_colour = LED_COLOURS_YELLOW;
     static bool test_led_msgs_currently_transmitting = false;
@@ -121,6 +219,20 @@ void mm_led_control_init(void)
         mm_blaze_register_message_listener(blaze_rx_handler);
     }
 
+#else
+    memset( &led_node_states[0], 0, sizeof( led_node_states ) );
+
+    mm_blaze_register_message_listener(gateway_blaze_rx_handler);
+
+    uint32_t err_code;
+    err_code = app_timer_create(&m_retransmit_timer_id, APP_TIMER_MODE_SINGLE_SHOT, retransmit_timer_event);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = app_timer_create(&m_keep_alive_timer_id, APP_TIMER_MODE_REPEATED, keep_alive_timer_event);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = app_timer_start(m_keep_alive_timer_id, APP_TIMER_TICKS(LED_KEEP_ALIVE_PERIOD_MS), NULL);
+    APP_ERROR_CHECK(err_code);
 #endif // #ifndef MM_BLAZE_GATEWAY
 
 
@@ -165,6 +277,230 @@ void mm_led_control_update_node_leds
 
     mm_blaze_send_message( &blaze_message );
 }
+
+void mm_led_control_update_all_node_leds(led_node_output_t const * outputs, uint8_t count)
+{
+    bool changed = false;
+
+    for(uint8_t i = 0; i < count; ++i)
+    {
+        //The gateway's own LEDs are updated directly.
+        if(outputs[i].node_id == MM_GATEWAY_ID)
+        {
+            update_led_settings(outputs[i].led_function, outputs[i].led_colour);
+            continue;
+        }
+
+        led_node_state_t * state = get_led_node_state(outputs[i].node_id);
+        if(state == NULL)
+        {
+            //Every record is waiting on an ack, this state goes out with the next update.
+            continue;
+        }
+
+        //Only a new state needs sending, the node already acked (or is being sent) this one.
+        if(state->in_use &&
+           state->output.led_function == outputs[i].led_function &&
+           state->output.led_colour == outputs[i].led_colour)
+        {
+            continue;
+        }
+
+        state->output = outputs[i];
+        state->sequence = next_sequence;
+        state->sends_left = LED_MAX_SENDS;
+        state->in_use = true;
+        next_sequence++;
+        changed = true;
+    }
+
+    //Unchanged states are left to the retransmits already under way.
+    if(changed)
+    {
+        retransmit_delay_ms = LED_RETRANSMIT_MIN_MS;
+        send_unacked_states();
+    }
+}
+
+static void gateway_blaze_rx_handler(ant_blaze_message_t msg)
+{
+    /* Filter message for types we care about. */
+    if(msg.p_data[PAGE_NUM_INDEX] != BLAZE_LED_ACK_PAGE_NUM)
+    {
+        return;
+    }
+
+    /* Pack message to serializable format. */
+    mm_blaze_message_serialized_t evt;
+    mm_blaze_pack_message(&msg, &evt);
+
+    /* Kick event to main */
+    uint32_t err_code;
+    err_code = app_sched_event_put(&evt, sizeof(evt), on_led_ack_evt);
+    APP_ERROR_CHECK(err_code);
+}
+
+static void on_led_ack_evt(void* p_data, uint16_t size)
+{
+    mm_blaze_message_serialized_t const * msg = (mm_blaze_message_serialized_t const *)p_data;
+
+    for(uint8_t i = 0; i < MAX_LED_NODES; ++i)
+    {
+        led_node_state_t * state = &led_node_states[i];
+
+        //Acks for older states are ignored, the newer one is still on its way.
+        if(state->in_use &&
+           state->output.node_id == msg->message.address &&
+           state->sequence == msg->data[LED_ACK_SEQUENCE_INDEX])
+        {
+            state->sends_left = 0;
+            return;
+        }
+    }
+}
+
+static led_node_state_t * get_led_node_state(uint16_t node_id)
+{
+    led_node_state_t * unused = NULL;
+    led_node_state_t * finished = NULL;
+
+    for(uint8_t i = 0; i < MAX_LED_NODES; ++i)
+    {
+        led_node_state_t * state = &led_node_states[i];
+
+        if(!state->in_use)
+        {
+            unused = ( unused == NULL ) ? state : unused;
+        }
+        else if(state->output.node_id == node_id)
+        {
+            return state;
+        }
+        else if(state->sends_left == 0)
+        {
+            finished = ( finished == NULL ) ? state : finished;
+        }
+    }
+
+    //Prefer an unused record, then one with nothing left to send.
+    led_node_state_t * reused = ( unused != NULL ) ? unused : finished;
+    if(reused != NULL)
+    {
+        reused->in_use = false;
+    }
+
+    return reused;
+}
+
+static void send_unacked_states(void)
+{
+    led_node_state_t const * unacked[LED_GROUP_MAX_ENTRIES];
+    uint8_t unacked_count = 0;
+    bool sent = false;
+
+    (void)app_timer_stop(m_retransmit_timer_id);
+
+    for(uint8_t i = 0; i < MAX_LED_NODES; ++i)
+    {
+        led_node_state_t * state = &led_node_states[i];
+
+        if(!state->in_use || state->sends_left == 0)
+        {
+            continue;
+        }
+
+        if(unacked_count == LED_GROUP_MAX_ENTRIES)
+        {
+            send_led_group_message(&unacked[0], unacked_count);
+            unacked_count = 0;
+        }
+
+        unacked[unacked_count] = state;
+        unacked_count++;
+        state->sends_left--;
+        sent = true;
+    }
+
+    if(unacked_count > 0)
+    {
+        send_led_group_message(&unacked[0], unacked_count);
+    }
+
+    if(sent)
+    {
+        uint32_t err_code;
+        err_code = app_timer_start(m_retransmit_timer_id, APP_TIMER_TICKS(retransmit_delay_ms), NULL);
+        APP_ERROR_CHECK(err_code);
+    }
+}
+
+static void send_led_group_message(led_node_state_t const * const * states, uint8_t count)
+{
+    ant_blaze_message_t blaze_message;
+    memset( &blaze_message, 0, sizeof( blaze_message ) );
+
+    blaze_message.address = MM_DEFAULT_GROUP_ID;
+    blaze_message.index = 0; //Always 0, used internally by blaze code
+    blaze_message.length = LED_GROUP_HEADER_SIZE + count * LED_GROUP_ENTRY_SIZE;
+
+    uint8_t payload [LED_GROUP_HEADER_SIZE + LED_GROUP_MAX_ENTRIES * LED_GROUP_ENTRY_SIZE];
+    memset( &payload[0], 0, sizeof( payload ) );
+
+    payload[PAGE_NUM_INDEX] = BLAZE_LED_GROUP_TRANSMISSION_PAGE_NUM;
+    payload[LED_GROUP_COUNT_INDEX] = count;
+
+    for(uint8_t i = 0; i < count; ++i)
+    {
+        uint8_t * entry = &payload[LED_GROUP_HEADER_SIZE + i * LED_GROUP_ENTRY_SIZE];
+        memcpy( &entry[0], &states[i]->output.node_id, sizeof( uint16_t ) );
+        entry[2] = ( states[i]->output.led_function << 4 ) | states[i]->output.led_colour;
+        entry[3] = states[i]->sequence;
+    }
+
+    blaze_message.p_data = &payload[0];
+
+    mm_blaze_send_message( &blaze_message );
+}
+
+static void retransmit_timer_event(void * p_context)
+{
+    uint32_t err_code;
+    err_code = app_sched_event_put(NULL, 0, on_retransmit_timeout);
+    APP_ERROR_CHECK(err_code);
+}
+
+static void keep_alive_timer_event(void * p_context)
+{
+    uint32_t err_code;
+    err_code = app_sched_event_put(NULL, 0, on_keep_alive_timeout);
+    APP_ERROR_CHECK(err_code);
+}
+
+static void on_retransmit_timeout(void* p_data, uint16_t size)
+{
+    retransmit_delay_ms *= 2;
+    if(retransmit_delay_ms > LED_RETRANSMIT_MAX_MS)
+    {
+        retransmit_delay_ms = LED_RETRANSMIT_MAX_MS;
+    }
+
+    send_unacked_states();
+}
+
+static void on_keep_alive_timeout(void* p_data, uint16_t size)
+{
+    //Send every state again, until each node acks it.
+    for(uint8_t i = 0; i < MAX_LED_NODES; ++i)
+    {
+        if(led_node_states[i].in_use)
+        {
+            led_node_states[i].sends_left = LED_MAX_SENDS;
+        }
+    }
+
+    retransmit_delay_ms = LED_RETRANSMIT_MIN_MS;
+    send_unacked_states();
+}
 #endif
 
 #ifndef MM_BLAZE_GATEWAY
@@ -174,6 +510,7 @@ static void blaze_rx_handler(ant_blaze_message_t msg)
     switch(msg.p_data[PAGE_NUM_INDEX])
     {
         case BLAZE_LED_STATUS_TRANSMISSION_PAGE_NUM:
+        case BLAZE_LED_GROUP_TRANSMISSION_PAGE_NUM:
             break;
         default:
             return;
@@ -195,11 +532,54 @@ static void on_led_control_evt(void* p_data, uint16_t size)
     uint8_t const * payload = &msg->data[0];
 
     /* Message is pre-filtered, so it's always a control message */
-    APP_ERROR_CHECK(payload[PAGE_NUM_INDEX] != BLAZE_LED_STATUS_TRANSMISSION_PAGE_NUM);
+    if(payload[PAGE_NUM_INDEX] == BLAZE_LED_STATUS_TRANSMISSION_PAGE_NUM)
+    {
+        led_function_t led_function = payload[LED_FUNCTION_INDEX];
+        led_colours_t  led_colour   = payload[LED_COLOUR_INDEX];
+        update_led_settings(led_function, led_colour);
+        return;
+    }
+
+    APP_ERROR_CHECK(payload[PAGE_NUM_INDEX] != BLAZE_LED_GROUP_TRANSMISSION_PAGE_NUM);
+
+    /* Find this node's entry, if the group message has one. */
+    uint16_t this_node_id = mm_blaze_get_node_id();
 
-    led_function_t led_function = payload[LED_FUNCTION_INDEX];
-    led_colours_t  led_colour   = payload[LED_COLOUR_INDEX];
-    update_led_settings(led_function, led_colour);
+    for(uint8_t i = 0; i < payload[LED_GROUP_COUNT_INDEX] && i < LED_GROUP_MAX_ENTRIES; ++i)
+    {
+        uint8_t const * entry = &payload[LED_GROUP_HEADER_SIZE + i * LED_GROUP_ENTRY_SIZE];
+
+        uint16_t node_id;
+        memcpy( &node_id, &entry[0], sizeof( uint16_t ) );
+
+        if(node_id == this_node_id)
+        {
+            //Ack even a state already showing, the last ack may have been lost.
+            update_led_settings((led_function_t)( entry[2] >> 4 ), (led_colours_t)( entry[2] & 0x0F ));
+            send_led_ack(entry[3]);
+            return;
+        }
+    }
+}
+
+static void send_led_ack(uint8_t sequence)
+{
+    ant_blaze_message_t blaze_message;
+    memset( &blaze_message, 0, sizeof( blaze_message ) );
+
+    blaze_message.address = MM_GATEWAY_ID;
+    blaze_message.index = 0; //Always 0, used internally by blaze code
+    blaze_message.length = 5; //Payload length
+
+    uint8_t payload [5];
+    memset( &payload[0], 0xFF, sizeof( payload ) );
+
+    payload[PAGE_NUM_INDEX] = BLAZE_LED_ACK_PAGE_NUM;
+    payload[LED_ACK_SEQUENCE_INDEX] = sequence;
+
+    blaze_message.p_data = &payload[0];
+
+    mm_blaze_send_message( &blaze_message );
 }
 #endif
 
@@ -35,6 +35,18 @@ typedef enum
 
 } led_function_t;
 
+/**********************************************************
+                          TYPES
+**********************************************************/
+
+//LED state for one node, for updating several nodes at once
+typedef struct
+{
+    uint16_t        node_id;
+    led_function_t  led_function;
+    led_colours_t   led_colour;
+} led_node_output_t;
+
 /**********************************************************
                        DECLARATIONS
 **********************************************************/
@@ -54,4 +66,12 @@ void mm_led_control_update_node_leds
     led_colours_t led_colour
     );
 
+/**
+ * Set led states for several nodes.
+ *
+ * Sent as one message to every node, each node picks out its own state.
+ * Only changed states are sent, and they are resent until the node acks them.
+ */
+void mm_led_control_update_all_node_leds(led_node_output_t const * outputs, uint8_t count);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,187 @@
+/**
+file: mm_monitoring_snapshot.c
+brief: Broadcasts the state of every sensor and AV in the monitored grid, packed into snapshot pages.
+notes:
+    The snapshot page stays on the page manager, which calls fill_snapshot_page
+    whenever it comes up for broadcast, so every turn the page gets carries the
+    latest state of a chunk.
+*/
+
+/**********************************************************
+                        INCLUDES
+**********************************************************/
+
+#include <string.h>
+
+#include "app_error.h"
+
+#include "mm_ant_control.h"
+#include "mm_ant_page_manager.h"
+#include "mm_monitoring_snapshot.h"
+#include "mm_position_config.h"
+#include "mm_sensor_algorithm_config.h"
+
+/**********************************************************
+                        CONSTANTS
+**********************************************************/
+
+#define SENSOR_SLOT_COUNT           ( MAX_NUMBER_NODES * MAX_SENSORS_PER_NODE )
+#define AV_SLOT_COUNT               ( ACTIVITY_VARIABLES_NUM )
+#define SLOT_COUNT                  ( SENSOR_SLOT_COUNT + AV_SLOT_COUNT )
+#define CHUNK_COUNT                 ( ( SLOT_COUNT + SNAPSHOT_SLOTS_PER_PAGE - 1 ) / SNAPSHOT_SLOTS_PER_PAGE )
+
+#define SLOT_BITS                   ( 2 )
+#define SLOTS_PER_BYTE              ( 8 / SLOT_BITS )
+#define SLOT_MASK                   ( ( 1 << SLOT_BITS ) - 1 )
+
+#define PAGE_NUM_INDEX              ( 0 )
+#define SEQUENCE_NUMBER_INDEX       ( 1 )
+#define CHUNK_INDEX                 ( 2 )
+#define SLOTS_INDEX                 ( 3 )
+
+#define KEYFRAME_FLAG               ( 0x80 )
+#define KEYFRAME_PERIOD             ( 4 )       /* Every this many pages is a keyframe, even while chunks keep changing. */
+
+/* Dirty chunks are kept in a 32 bit mask. */
+#if CHUNK_COUNT > 32
+#error "Too many snapshot chunks, use a larger dirty chunk mask."
+#endif
+
+/* Each slot chunk is padded to a whole number of bytes. */
+#if SNAPSHOT_SLOTS_PER_PAGE % SLOTS_PER_BYTE != 0
+#error "SNAPSHOT_SLOTS_PER_PAGE must fill whole bytes."
+#endif
+
+/**********************************************************
+                       DECLARATIONS
+**********************************************************/
+
+/**
+ * Set a slot, marking its chunk to be sent if it changed.
+ */
+static void set_slot(uint16_t slot, uint8_t state);
+
+/**
+ * Fill in the snapshot page with the next chunk to send, called by the page manager.
+ */
+static void fill_snapshot_page(mm_ant_payload_t * payload);
+
+/**********************************************************
+                       VARIABLES
+**********************************************************/
+
+/* Every chunk's slots, packed as they are sent. */
+static uint8_t slot_states[CHUNK_COUNT * SNAPSHOT_SLOTS_PER_PAGE / SLOTS_PER_BYTE];
+
+static uint32_t dirty_chunks;
+static uint8_t last_dirty_chunk;
+static uint8_t next_keyframe_chunk;
+static uint8_t pages_since_keyframe;
+static uint8_t sequence_number;
+
+/**********************************************************
+                       DEFINITIONS
+**********************************************************/
+
+void mm_monitoring_snapshot_init(void)
+{
+    memset(&slot_states[0], 0, sizeof(slot_states));
+    dirty_chunks = 0;
+    last_dirty_chunk = 0;
+    next_keyframe_chunk = 0;
+    pages_since_keyframe = 0;
+    sequence_number = 0;
+
+    mm_ant_payload_t payload;
+    fill_snapshot_page(&payload);
+
+    /* Low priority, like the monitoring pages it summarizes. It is refilled every time it is sent. */
+    mm_ant_page_manager_set_fill_handler(SNAPSHOT_PAGE_NUM, fill_snapshot_page);
+    mm_ant_page_manager_add_page(SNAPSHOT_PAGE_NUM, &payload, 1, ANT_PAGE_PRIORITY_LOW);
+}
+
+void mm_monitoring_snapshot_set_sensor(uint16_t node_id, sensor_rotation_t sensor_rotation, uint8_t state)
+{
+    mm_node_position_t const * position = get_position_for_node(node_id);
+    if (position == NULL || position->grid_id != MONITORED_SENSOR_GRID)
+    {
+        return;
+    }
+
+    sensor_rotation_t sensor_rotations[MAX_SENSORS_PER_NODE];
+    uint8_t sensor_count = get_sensor_rotations(position->node_type, MAX_SENSORS_PER_NODE, &sensor_rotations[0]);
+
+    uint16_t node_slot = ( position->grid_position_y - GRID_POSITION_MIN_Y ) * MAX_GRID_SIZE_X
+                       + ( position->grid_position_x - GRID_POSITION_MIN_X );
+
+    for (uint8_t i = 0; i < sensor_count; i++)
+    {
+        if (sensor_rotations[i] == sensor_rotation)
+        {
+            set_slot(node_slot * MAX_SENSORS_PER_NODE + i, state);
+            return;
+        }
+    }
+}
+
+void mm_monitoring_snapshot_set_av(uint8_t av_position_x, uint8_t av_position_y, activity_variable_state_t state)
+{
+    set_slot(SENSOR_SLOT_COUNT + MAX_AV_SIZE_X * av_position_y + av_position_x, state);
+}
+
+static void set_slot(uint16_t slot, uint8_t state)
+{
+    APP_ERROR_CHECK(slot >= SLOT_COUNT);
+
+    uint8_t * byte = &slot_states[slot / SLOTS_PER_BYTE];
+    uint8_t shift = ( slot % SLOTS_PER_BYTE ) * SLOT_BITS;
+    uint8_t updated = ( *byte & ~( SLOT_MASK << shift ) ) | ( ( state & SLOT_MASK ) << shift );
+
+    if (updated != *byte)
+    {
+        *byte = updated;
+        dirty_chunks |= ( 1UL << ( slot / SNAPSHOT_SLOTS_PER_PAGE ) );
+    }
+}
+
+static void fill_snapshot_page(mm_ant_payload_t * payload)
+{
+    uint8_t chunk;
+    uint8_t chunk_flags = 0;
+
+    /* Keyframes are interleaved even while chunks are changing, so a receiver
+       that missed pages during a busy spell still catches up. */
+    if (dirty_chunks != 0 && pages_since_keyframe < KEYFRAME_PERIOD - 1)
+    {
+        /* Take turns between changed chunks, so a busy chunk can't hold the others back. */
+        chunk = last_dirty_chunk;
+        do
+        {
+            chunk = ( chunk + 1 ) % CHUNK_COUNT;
+        } while (( dirty_chunks & ( 1UL << chunk ) ) == 0);
+
+        last_dirty_chunk = chunk;
+        pages_since_keyframe++;
+    }
+    else
+    {
+        chunk = next_keyframe_chunk;
+        next_keyframe_chunk = ( next_keyframe_chunk + 1 ) % CHUNK_COUNT;
+        chunk_flags = KEYFRAME_FLAG;
+        pages_since_keyframe = 0;
+    }
+
+    dirty_chunks &= ~( 1UL << chunk );
+
+    payload->data[PAGE_NUM_INDEX] = SNAPSHOT_PAGE_NUM;
+    payload->data[SEQUENCE_NUMBER_INDEX] = sequence_number;
+    payload->data[CHUNK_INDEX] = chunk_flags | chunk;
+    memcpy
+        (
+        &payload->data[SLOTS_INDEX],
+        &slot_states[chunk * SNAPSHOT_SLOTS_PER_PAGE / SLOTS_PER_BYTE],
+        SNAPSHOT_SLOTS_PER_PAGE / SLOTS_PER_BYTE
+        );
+
+    sequence_number++;
+}
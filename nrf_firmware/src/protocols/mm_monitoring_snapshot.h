@@ -0,0 +1,66 @@
+/**
+file: mm_monitoring_snapshot.h
+brief: Broadcasts the state of every sensor and AV in the monitored grid, packed into snapshot pages.
+notes:
+    Each page carries the state of SNAPSHOT_SLOTS_PER_PAGE slots, 2 bits
+    each. Sensors come first, MAX_SENSORS_PER_NODE slots per node grid
+    position, row by row from (GRID_POSITION_MIN_X, GRID_POSITION_MIN_Y).
+    A node's sensors are in the order get_sensor_rotations lists them.
+    AVs follow, in the same order as the AV arrays.
+
+    Sensor slots hold a PIR's detection (0 or 1) or a lidar's lidar_region_t.
+    AV slots hold the AV's activity_variable_state_t.
+
+    Page format:
+        byte 0: SNAPSHOT_PAGE_NUM
+        byte 1: sequence number, one more than the last page sent
+        byte 2: bit 7 set for a keyframe, bits 0-6 the chunk, whose first slot is chunk * SNAPSHOT_SLOTS_PER_PAGE
+        byte 3-7: slot states, slot i of the chunk in bits 2*(i%4) to 2*(i%4)+1 of byte 3+i/4
+
+    Chunks that changed are sent first. A chunk is only sent once for any
+    number of changes to it, so a burst of activity costs a few pages rather
+    than a page per sensor. Chunks are also sent again in turn as keyframes,
+    every page when nothing has changed and every fourth page otherwise, so
+    a receiver that missed pages (it sees a gap in the sequence numbers)
+    only has to wait for the keyframes to catch up.
+    The pages aren't acknowledged.
+*/
+#ifndef MM_MONITORING_SNAPSHOT_H
+#define MM_MONITORING_SNAPSHOT_H
+
+/**********************************************************
+                        INCLUDES
+**********************************************************/
+
+#include <stdint.h>
+
+#include "mm_sensor_transmission.h"
+#include "mm_activity_variables.h"
+
+/**********************************************************
+                        CONSTANTS
+**********************************************************/
+
+#define SNAPSHOT_PAGE_NUM           ( 0x2A )
+#define SNAPSHOT_SLOTS_PER_PAGE     ( 20 )
+
+/**********************************************************
+                       DECLARATIONS
+**********************************************************/
+
+/**
+    Start broadcasting snapshot pages, every slot starts at 0.
+*/
+void mm_monitoring_snapshot_init(void);
+
+/**
+    Set a sensor's slot. Sensors outside the monitored grid are ignored.
+*/
+void mm_monitoring_snapshot_set_sensor(uint16_t node_id, sensor_rotation_t sensor_rotation, uint8_t state);
+
+/**
+    Set an AV's slot.
+*/
+void mm_monitoring_snapshot_set_av(uint8_t av_position_x, uint8_t av_position_y, activity_variable_state_t state);
+
+#endif /* MM_MONITORING_SNAPSHOT_H */
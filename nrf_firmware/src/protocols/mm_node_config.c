@@ -2,6 +2,10 @@
 file: mm_node_config.c
 brief: Handles the node configuration procedure over ANT
 notes:
+    The node and network ID from the config app are kept in flash, so after
+    a power loss the node joins BLAZE right away instead of waiting to be
+    configured again. Configuring a node with different IDs stores them and
+    resets it, BLAZE can't change IDs while it's running.
 */
 
 /**********************************************************
@@ -20,10 +24,14 @@ notes:
 #include "mm_sensor_transmission.h"
 #include "mm_sensor_algorithm.h"
 #include "mm_led_control.h"
+#include "mm_channel_period_control.h"
 #include "mm_av_transmission.h"
 #include "mm_led_transmission.h"
 #include "mm_sensor_error_transmission.h"
+#include "mm_algorithm_config_update.h"
+#include "mm_wildlife_statistics_transmission.h"
 #include "mm_sensor_algorithm_config.h"
+#include "mm_flash_storage_pub.h"
 
 #include "bsp.h"
 #include "nrf_drv_gpiote.h"
@@ -31,6 +39,7 @@ notes:
 
 #include "app_timer.h"
 #include "app_scheduler.h"
+#include "nrf_nvic.h"
 
 
 /**********************************************************
@@ -52,10 +61,25 @@ notes:
 #define TIMEOUT_PERIOD_MS        ( TIMEOUT_PERIOD_S * 1000 )
 #define TIMER_TICKS APP_TIMER_TICKS(TIMEOUT_PERIOD_MS)
 
+/* How often to check whether new IDs have been written before resetting. */
+#define RESET_POLL_PERIOD_MS     ( 100 )
+#define RESET_POLL_TICKS APP_TIMER_TICKS(RESET_POLL_PERIOD_MS)
+
 /**********************************************************
                         ENUMS
 **********************************************************/
 
+/**********************************************************
+                          TYPES
+**********************************************************/
+
+/* IDs assigned by the config app, as kept in flash. */
+typedef struct
+{
+    uint16_t node_id;
+    uint16_t network_id;
+} node_identity_t;
+
 /**********************************************************
                        DECLARATIONS
 **********************************************************/
@@ -74,6 +98,11 @@ static void timer_handler(void * p_context);
 /* Processes timer timeout */
 static void on_timer_event(void* evt_data, uint16_t evt_size);
 
+/* Reset timer handler */
+static void reset_timer_handler(void * p_context);
+/* Resets the node once its new IDs are in flash. */
+static void on_reset_timer_event(void* evt_data, uint16_t evt_size);
+
 /* Encodes node status data page. */
 static void encode_node_status_page(mm_ant_payload_t * status_page);
 
@@ -93,11 +122,16 @@ static void resume_ant_broadcast(void);
 static uint16_t node_id;
 static uint16_t network_id;
 
+/* Kept static, flash reads it whenever the queued write starts. */
+static node_identity_t stored_identity;
+
 APP_TIMER_DEF(m_timer_id);
+APP_TIMER_DEF(m_reset_timer_id);
 
-#ifdef MM_BLAZE_GATEWAY
+#if defined(MM_BLAZE_GATEWAY) && !defined(MM_STATIC_ALGORITHM_CONFIG)
 /**
-    Default sensor algorithm configuration constants.
+    Default sensor algorithm configuration constants. Static config
+    builds use mm_sensor_algorithm_static_config.h instead.
 */
 static mm_sensor_algorithm_config_t const sensor_algorithm_config_1551911794 =
 {
@@ -140,7 +174,7 @@ void mm_node_config_init(void)
 
     mm_ant_payload_t payload;
     encode_node_status_page(&payload);
-    mm_ant_page_manager_add_page(NODE_STATUS_PAGE, &payload, 1);
+    mm_ant_page_manager_add_page(NODE_STATUS_PAGE, &payload, 1, ANT_PAGE_PRIORITY_LOW);
 
     //configure control button
     uint32_t err_code;
@@ -156,6 +190,22 @@ void mm_node_config_init(void)
     //configure button timeout timer
     err_code = app_timer_create(&m_timer_id, APP_TIMER_MODE_SINGLE_SHOT, timer_handler);
     APP_ERROR_CHECK(err_code);
+
+    err_code = app_timer_create(&m_reset_timer_id, APP_TIMER_MODE_REPEATED, reset_timer_handler);
+    APP_ERROR_CHECK(err_code);
+
+    // Rejoin the network right away if the node was configured before a power loss.
+    if (mm_flash_storage_read(FLASH_AREA_NODE_IDENTITY, &stored_identity, sizeof(stored_identity)) &&
+        (stored_identity.node_id != 0 || stored_identity.network_id != 0))
+    {
+        node_id = stored_identity.node_id;
+        network_id = stored_identity.network_id;
+
+        external_init();
+
+        encode_node_status_page(&payload);
+        mm_ant_page_manager_replace_all_pages(NODE_STATUS_PAGE, &payload);
+    }
 }
 
 
@@ -164,13 +214,21 @@ static void on_config_command_page(void* evt_data, uint16_t evt_size)
     ant_evt_t const * evt = (ant_evt_t const *)evt_data;
     ANT_MESSAGE * p_message = (ANT_MESSAGE *)evt->msg.evt_buffer;
 
+    node_identity_t assigned_identity;
+    memcpy(&assigned_identity.node_id, &p_message->ANT_MESSAGE_aucPayload[1], sizeof(assigned_identity.node_id));
+    memcpy(&assigned_identity.network_id, &p_message->ANT_MESSAGE_aucPayload[3], sizeof(assigned_identity.network_id));
+
     // Only accept node configuration if this node
     // does not already have a node_id and network_id
     if (node_id == 0 && network_id == 0)
     {
         // Set the node ID and network ID
-        memcpy(&node_id, &p_message->ANT_MESSAGE_aucPayload[1], sizeof(node_id));
-        memcpy(&network_id, &p_message->ANT_MESSAGE_aucPayload[3], sizeof(network_id));
+        node_id = assigned_identity.node_id;
+        network_id = assigned_identity.network_id;
+
+        // Keep them for after a power loss.
+        stored_identity = assigned_identity;
+        (void)mm_flash_storage_queue_write(FLASH_AREA_NODE_IDENTITY, &stored_identity, sizeof(stored_identity));
 
         // Start init now that node ID and network ID are known
         external_init();
@@ -185,6 +243,18 @@ static void on_config_command_page(void* evt_data, uint16_t evt_size)
         pause_ant_broadcast();
     #endif
     }
+    else if (assigned_identity.node_id != node_id || assigned_identity.network_id != network_id)
+    {
+        // The node is being moved to new IDs. Store them and
+        // restart with them once they're written.
+        stored_identity = assigned_identity;
+        if (mm_flash_storage_queue_write(FLASH_AREA_NODE_IDENTITY, &stored_identity, sizeof(stored_identity)))
+        {
+            uint32_t err_code;
+            err_code = app_timer_start(m_reset_timer_id, RESET_POLL_TICKS, NULL);
+            APP_ERROR_CHECK(err_code);
+        }
+    }
 }
 
 static void encode_node_status_page(mm_ant_payload_t * payload)
@@ -243,6 +313,15 @@ static void on_timer_event(void* evt_data, uint16_t evt_size)
     }
 }
 
+static void on_reset_timer_event(void* evt_data, uint16_t evt_size)
+{
+    // The new IDs are picked up on boot.
+    if (!mm_flash_storage_is_busy())
+    {
+        (void)sd_nvic_SystemReset();
+    }
+}
+
 static void external_init(void)
 {
     /* Init blaze. */
@@ -253,15 +332,27 @@ static void external_init(void)
     mm_sensor_transmission_init();
     /* Init LED control transmission over blaze. Placed before algorithm init so it can use LED control. */
     mm_led_control_init();
+    /* Init channel period switching over blaze. Placed before algorithm init so the algorithm can switch it. */
+    mm_channel_period_control_init();
 #ifdef MM_BLAZE_GATEWAY
     /* Init LED output transmission over ant. */
     mm_led_transmission_init();
     /* Init sensor error transmission over ant. */
     mm_sensor_error_transmission_init();
     /* Init sensor data processing now that data can be transmitted. */
+#ifdef MM_STATIC_ALGORITHM_CONFIG
+    mm_sensor_algorithm_init(&sensor_algorithm_static_config);
+#else
     mm_sensor_algorithm_init(&sensor_algorithm_config_1551911794);
+#endif
     /* Init AV output transmission over ANT now that the sensor algorithm is up and running. */
     mm_av_transmission_init();
+    /* Answer wildlife statistics requests over ANT, the statistics are kept by the sensor algorithm. */
+    mm_wildlife_statistics_transmission_init();
+#ifndef MM_STATIC_ALGORITHM_CONFIG
+    /* Listen for algorithm config updates over ANT now that there is a config to update. */
+    mm_algorithm_config_update_init();
+#endif
 #endif
 }
 
@@ -321,6 +412,15 @@ static void timer_handler(void * p_context)
     APP_ERROR_CHECK(err_code);
 }
 
+static void reset_timer_handler(void * p_context)
+{
+    uint32_t err_code;
+
+    /* Kick timer event to main. */
+    err_code = app_sched_event_put(NULL, 0, on_reset_timer_event);
+    APP_ERROR_CHECK(err_code);
+}
+
 /* Pauses the ANT broadcast and turns off LED 2 */
 static void pause_ant_broadcast(void)
 {
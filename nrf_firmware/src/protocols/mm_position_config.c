@@ -2,6 +2,16 @@
 file: mm_position_config.c
 brief:
 notes:
+    Nodes are kept in mm_position_table, which indexes them for lookups.
+
+    The position pages themselves are kept in flash, so a gateway that loses
+    power comes back with its positions without waiting for the config app.
+    Only pages that change a node are written, the app repeats its pages.
+
+    A whole grid can also be sent as a batch, which mm_position_table
+    stages and applies once every node has arrived. The outcome of each
+    commit is broadcast on the batch page until the config app acknowledges
+    it.
 */
 
 /**********************************************************
@@ -14,43 +24,31 @@ notes:
 #include "app_scheduler.h"
 
 #include "mm_ant_control.h"
+#include "mm_ant_page_manager.h"
 #include "mm_position_config.h"
+#include "mm_position_table.h"
+#include "mm_sensor_algorithm_config.h"
 #include "mm_switch_config.h"
+#include "mm_flash_storage_pub.h"
 
 /**********************************************************
                         CONSTANTS
 **********************************************************/
 
-#define MAX_NUMBER_NODES                     ( 9 )
-
 #define PAGE_NUMBER_INDEX                    ( 0 )
 
-// Index of the byte containing the node type in
-// the position page. (May contain other info in the
-// future!)
-#define POSITION_PAGE_NODE_TYPE_INDEX        ( 3 )
-
-// Index of the byte containing the node rotation in
-// the position page. (May contain other info in the
-// future!)
-#define POSITION_PAGE_NODE_ROTATION_INDEX    ( 4 )
-#define POSITION_PAGE_GRID_POSITION_INDEX    ( 5 )
-#define POSITION_PAGE_GRID_OFFSET_X_INDEX    ( 6 )
-#define POSITION_PAGE_GRID_OFFSET_Y_INDEX    ( 7 )
-
-#define NODE_TYPE_MASK                       ( 0x03 )
-#define NODE_ROTATION_MASK                   ( 0x07 )
-
-#define GRID_POSITION_X_MASK                 ( 0x0F )
-#define GRID_POSITION_Y_MASK                 ( 0xF0 )
-
-// Number of bits that describe the grid position
-#define GRID_POSITION_SIZE                   ( 4 )
+#define MESSAGE_ACKNOWLEDGEMENT_PAGE_NUM     ( 0x20 )
+#define ACKED_MESSAGE_ID_INDEX               ( 1 )
+#define ACKED_PAGE_NUM_INDEX                 ( 2 )
 
 /**********************************************************
                         ENUMS
 **********************************************************/
 
+/**********************************************************
+                          TYPES
+**********************************************************/
+
 /**********************************************************
                        DECLARATIONS
 **********************************************************/
@@ -61,18 +59,27 @@ static void process_ant_evt(ant_evt_t * evt);
 /* Decodes an ANT position page message payload */
 static void decode_position_page(void* p_evt, uint16_t size);
 
-/* Sign extends a number in 2's complement form */
-static int8_t sign_extend( uint8_t uint, uint8_t size_bits );
+/* Applies the position pages kept in flash, if any */
+static void restore_position_pages( void );
+
+/* Decodes an ANT batch position page, staging entries and applying commits */
+static void decode_batch_page(void* p_evt, uint16_t size);
+
+/* Broadcasts the outcome of a commit until the config app acknowledges it */
+static void broadcast_batch_result( uint8_t header, uint8_t node_count, batch_result_t result );
+
+/* Stops broadcasting the batch outcome once it has been acknowledged */
+static void on_message_acknowledge(void* p_evt, uint16_t size);
 
 /**********************************************************
                        VARIABLES
 **********************************************************/
 
-static mm_node_position_t node_positions[MAX_NUMBER_NODES];
-
-static uint16_t current_number_of_nodes = 0;
 static bool have_positions_changed = false;
 
+static mm_ant_payload_t batch_result_payload;
+static bool is_batch_result_being_broadcast = false;
+
 /**********************************************************
                        DEFINITIONS
 **********************************************************/
@@ -80,7 +87,12 @@ static bool have_positions_changed = false;
 /* Initialize position configuration */
 void mm_position_config_init( void )
 {
-    memset(&node_positions[0], 0, sizeof( node_positions ) );
+    mm_position_table_init();
+
+    is_batch_result_being_broadcast = false;
+
+    // Carry on with the positions from before a power loss
+    restore_position_pages();
 
     // Register to receive ANT events
     mm_ant_evt_handler_set(&process_ant_evt);
@@ -99,9 +111,23 @@ static void process_ant_evt(ant_evt_t * evt)
             if (p_message->ANT_MESSAGE_ucMesgID == MESG_BROADCAST_DATA_ID
                 || p_message->ANT_MESSAGE_ucMesgID == MESG_ACKNOWLEDGED_DATA_ID)
             {
-                if (p_message->ANT_MESSAGE_aucPayload[0] == POSITION_CONFIG_PAGE_NUM)
+                switch (p_message->ANT_MESSAGE_aucPayload[PAGE_NUMBER_INDEX])
                 {
-                    app_sched_event_put(evt, sizeof(ant_evt_t), decode_position_page);
+                    case POSITION_CONFIG_PAGE_NUM:
+                        app_sched_event_put(evt, sizeof(ant_evt_t), decode_position_page);
+                        break;
+
+                    case POSITION_BATCH_PAGE_NUM:
+                        app_sched_event_put(evt, sizeof(ant_evt_t), decode_batch_page);
+                        break;
+
+                    case MESSAGE_ACKNOWLEDGEMENT_PAGE_NUM:
+                        /* This might acknowledge a batch outcome, kick it to main to check. */
+                        app_sched_event_put(evt, sizeof(ant_evt_t), on_message_acknowledge);
+                        break;
+
+                    default:
+                        break;
                 }
             }
             break;
@@ -119,132 +145,98 @@ static void decode_position_page(void* p_evt, uint16_t size)
     uint8_t const * position_page = &(p_message->ANT_MESSAGE_aucPayload[0]);
 
     have_positions_changed = true;
-    mm_node_position_t * node_position = NULL;
 
-    uint16_t node_id;
+    if ( mm_position_table_apply_page( position_page ) )
+    {
+        // Pages that arrive while a write is queued are picked up by it.
+        (void)mm_flash_storage_queue_write( FLASH_AREA_NODE_POSITIONS, mm_position_table_get_pages(), sizeof( position_pages_record_t ) );
+    }
+}
 
-    // These three bytes are "temp" variables which
-    // allow us to apply a bitmask to decode
-    // specific data from the payload.
-    uint8_t node_type_byte;
-    uint8_t node_rotation_byte;
-    uint8_t grid_position_byte;
+/* Decodes an ANT batch position page, staging entries and applying commits */
+static void decode_batch_page(void* p_evt, uint16_t size)
+{
+    ant_evt_t * evt = (ant_evt_t*)p_evt;
+    ANT_MESSAGE * p_message = (ANT_MESSAGE *)evt->msg.evt_buffer;
+    uint8_t const * batch_page = &(p_message->ANT_MESSAGE_aucPayload[0]);
 
-    memcpy(&node_id, &position_page[1], sizeof(node_id));
+    mm_position_batch_outcome_t outcome;
 
-    // Iterate through the list of maintained node positions
-    // and determine if the node from the message payload
-    // already exists in the list...
-    for ( uint16_t i = 0; i < MAX_NUMBER_NODES; i++)
+    if ( !mm_position_table_on_batch_page( batch_page, &outcome ) )
     {
-        if ( node_positions[i].node_id == node_id && node_positions[i].is_valid )
-        {
-            // If so, we're going to replace it's previous entry with
-            // the new one.
-            node_position = &node_positions[i];
-            break;
-        }
+        // An entry, or a repeat of a commit that has already been applied.
+        return;
     }
 
-    // Otherwise, if we couldn't find the node from the payload
-    // in the list, we need to add it...
-    if ( node_position == NULL )
+    // The whole batch is picked up by the next position update.
+    if ( outcome.has_changed )
     {
-        // ...by iterating through the existing list...
-        for ( uint16_t i = 0; i < MAX_NUMBER_NODES; i++ )
-        {
-            // ..and finding the first empty (non-valid) entry.
-            if ( !node_positions[i].is_valid )
-            {
-                node_position = &node_positions[i];
-                node_position->node_id = node_id;
-                node_position->is_valid = true;
+        have_positions_changed = true;
+        (void)mm_flash_storage_queue_write( FLASH_AREA_NODE_POSITIONS, mm_position_table_get_pages(), sizeof( position_pages_record_t ) );
+    }
 
-                current_number_of_nodes++;
-                break;
-            }
-        }
+    broadcast_batch_result( batch_page[BATCH_HEADER_INDEX], outcome.received_count, outcome.result );
+}
+
+/* Broadcasts the outcome of a commit until the config app acknowledges it */
+static void broadcast_batch_result( uint8_t header, uint8_t node_count, batch_result_t result )
+{
+    if ( is_batch_result_being_broadcast )
+    {
+        mm_ant_page_manager_remove_all_pages( POSITION_BATCH_PAGE_NUM );
     }
 
-    // If we couldn't add a new node position (because the existing
-    // list was full), APP_ERROR
-    APP_ERROR_CHECK( node_position == NULL );
-
-    // Read node type and rotation bytes...
-    memcpy
-        (
-        &node_type_byte,
-        &position_page[POSITION_PAGE_NODE_TYPE_INDEX],
-        sizeof(node_type_byte)
-        );
-    memcpy
-        (
-        &node_rotation_byte,
-        &position_page[POSITION_PAGE_NODE_ROTATION_INDEX],
-        sizeof(node_rotation_byte)
-        );
-
-    // Extract relevant bits using bitmasks...
-    node_position->node_type = node_type_byte & NODE_TYPE_MASK;
-    node_position->node_rotation = node_rotation_byte & NODE_ROTATION_MASK;
-
-    // Read grid position byte...
-    memcpy
-        (
-        &grid_position_byte,
-        &position_page[POSITION_PAGE_GRID_POSITION_INDEX],
-        sizeof(grid_position_byte)
-        );
-
-    // Separate into the x and y grid position nibbles using bitmasks...
-    node_position->grid_position_x = sign_extend( ( grid_position_byte & GRID_POSITION_X_MASK ), GRID_POSITION_SIZE );
-    node_position->grid_position_y = sign_extend( ( grid_position_byte & GRID_POSITION_Y_MASK ) >> 4,  GRID_POSITION_SIZE );
-
-    // Read grid offset bytes. Grid offset fills an entire byte, so no need
-    // for bitmask.
-    memcpy
-        (
-        &node_position->grid_offset_x,
-        &position_page[POSITION_PAGE_GRID_OFFSET_X_INDEX],
-        sizeof(node_position->grid_offset_x)
-        );
-    memcpy
-        (
-        &node_position->grid_offset_y,
-        &position_page[POSITION_PAGE_GRID_OFFSET_Y_INDEX],
-        sizeof(node_position->grid_offset_y)
-        );
+    memset( &batch_result_payload.data[0], 0xFF, sizeof( batch_result_payload.data ) );
+    batch_result_payload.data[PAGE_NUMBER_INDEX] = POSITION_BATCH_PAGE_NUM;
+    batch_result_payload.data[BATCH_HEADER_INDEX] = header;
+    batch_result_payload.data[BATCH_NODE_COUNT_INDEX] = node_count;
+    batch_result_payload.data[BATCH_RESULT_INDEX] = result;
+
+    mm_ant_page_manager_add_page( POSITION_BATCH_PAGE_NUM, &batch_result_payload, 1, ANT_PAGE_PRIORITY_NORMAL );
+    is_batch_result_being_broadcast = true;
 }
 
-/* Sign extends a number in 2's complement form */
-static int8_t sign_extend( uint8_t uint, uint8_t size_bits )
+/* Stops broadcasting the batch outcome once it has been acknowledged */
+static void on_message_acknowledge(void* p_evt, uint16_t size)
 {
-    int8_t result;
-    memcpy(&result, &uint, sizeof(result));
+    ant_evt_t * evt = (ant_evt_t*)p_evt;
+    ANT_MESSAGE * p_message = (ANT_MESSAGE *)evt->msg.evt_buffer;
+    uint8_t const * payload = &(p_message->ANT_MESSAGE_aucPayload[0]);
+
+    if ( !is_batch_result_being_broadcast ||
+         payload[ACKED_PAGE_NUM_INDEX] != POSITION_BATCH_PAGE_NUM ||
+         payload[ACKED_MESSAGE_ID_INDEX] != batch_result_payload.data[BATCH_HEADER_INDEX] )
+    {
+        return;
+    }
 
-    // Create a bitmask to extract the most significant
-    // bit (MSB) from "uint"...
-    uint8_t bitmask = 1 << ( size_bits - 1 );
+    mm_ant_page_manager_remove_all_pages( POSITION_BATCH_PAGE_NUM );
+    is_batch_result_being_broadcast = false;
+}
 
-    // Apply the bitmask to get the MSB
-    uint8_t msb = uint & bitmask;
+/* Applies the position pages kept in flash, if any */
+static void restore_position_pages( void )
+{
+    position_pages_record_t record;
 
-    // While MSB is not 0...
-    while ( msb )
+    if ( !mm_flash_storage_read( FLASH_AREA_NODE_POSITIONS, &record, sizeof( record ) ) ||
+         record.node_count > MAX_GATEWAY_NODES )
     {
-        // ..shifting the MSB left and OR-ing
-        // sign extends "uint"
-        msb <<= 1;
-        result |= msb;
+        return;
     }
 
-    return result;
+    for ( uint16_t i = 0; i < record.node_count; i++ )
+    {
+        (void)mm_position_table_apply_page( &record.pages[i][0] );
+    }
+
+    have_positions_changed = true;
 }
 
 /* Gets the entire array of node positions for the system */
 mm_node_position_t const * get_node_positions( void )
 {
-    return node_positions;
+    return mm_position_table_get_positions();
 }
 
 /* Gets a specific node position by node id. Returns NULL if
@@ -252,49 +244,21 @@ mm_node_position_t const * get_node_positions( void )
  */
 mm_node_position_t const * get_position_for_node( uint16_t node_id )
 {
-    for ( uint16_t i = 0; i < MAX_NUMBER_NODES; i ++ )
-    {
-        if ( node_positions[i].node_id == node_id && node_positions[i].is_valid )
-        {
-            return &node_positions[i];
-        }
-    }
-
-    return NULL;
+    return mm_position_table_find_node( node_id );
 }
 
-/* Gets a specific node position by it's x and y grid position. Returns
- * NULL is the node doesn't exist in the list yet.
+/* Gets a specific node position by it's x and y grid position within a
+ * grid. Returns NULL is the node doesn't exist in the list yet.
  */
-mm_node_position_t const * get_node_for_position(int8_t x, int8_t y)
+mm_node_position_t const * get_node_for_position( uint8_t grid_id, int8_t x, int8_t y )
 {
-    for ( uint16_t i = 0; i < MAX_NUMBER_NODES; ++i )
-    {
-        if( !node_positions[i].is_valid )
-        {
-            continue;
-        }
-
-        if(node_positions[i].grid_position_x != x)
-        {
-            continue;
-        }
-
-        if(node_positions[i].grid_position_y != y)
-        {
-            continue;
-        }
-
-        return &node_positions[i];
-    }
-
-    return NULL;
+    return mm_position_table_find_cell( grid_id, x, y );
 }
 
 /* Gets the current number of nodes whose positions have been configured. */
 uint16_t get_number_of_nodes( void )
 {
-    return current_number_of_nodes;
+    return mm_position_table_get_node_count();
 }
 
 /* Determines if the node positions have changed since the last read.
@@ -21,10 +21,14 @@ notes:
 **********************************************************/
 
 #define POSITION_CONFIG_PAGE_NUM        ( 0x11 )
+#define POSITION_BATCH_PAGE_NUM         ( 0x29 )
 
 #define NODE_SEPERATION_CM              ( 800 )
 #define NODE_OFFSET_SCALE_CM            ( 5 )
 
+/* Grid that nodes belong to when the position page doesn't say otherwise. */
+#define DEFAULT_GRID_ID                 ( 0 )
+
 /**********************************************************
                        DECLARATIONS
 **********************************************************/
@@ -50,6 +54,9 @@ typedef struct mm_node_position_struct {
     uint8_t             node_type;
     mm_node_rotation_t  node_rotation;
 
+    /* Which of the gateway's sensor grids the node is part of. */
+    uint8_t grid_id;
+
     int8_t grid_position_x;
     int8_t grid_position_y;
 
@@ -74,10 +81,10 @@ mm_node_position_t const * get_node_positions( void );
  */
 mm_node_position_t const * get_position_for_node( uint16_t node_id );
 
-/* Gets a specific node position by node location. Returns NULL if
- * the node doesn't exist in the list yet.
+/* Gets a specific node position by node location within a grid.
+ * Returns NULL if the node doesn't exist in the list yet.
  */
-mm_node_position_t const * get_node_for_position(int8_t x, int8_t y);
+mm_node_position_t const * get_node_for_position(uint8_t grid_id, int8_t x, int8_t y);
 
 /* Gets the current number of nodes whose positions have been configured. */
 uint16_t get_number_of_nodes( void );
@@ -0,0 +1,516 @@
+/**
+file: mm_position_table.c
+brief: The gateway's table of node positions, indexed by node id and by grid cell
+notes:
+*/
+
+/**********************************************************
+                        INCLUDES
+**********************************************************/
+
+#include <string.h>
+
+#include "app_error.h"
+
+#include "mm_position_table.h"
+
+/**********************************************************
+                        CONSTANTS
+**********************************************************/
+
+// Index of the byte containing the node type in
+// the position page. (May contain other info in the
+// future!)
+#define POSITION_PAGE_NODE_TYPE_INDEX        ( 3 )
+
+// Index of the byte containing the node rotation in
+// the position page. (May contain other info in the
+// future!)
+#define POSITION_PAGE_NODE_ROTATION_INDEX    ( 4 )
+#define POSITION_PAGE_GRID_POSITION_INDEX    ( 5 )
+#define POSITION_PAGE_GRID_OFFSET_X_INDEX    ( 6 )
+#define POSITION_PAGE_GRID_OFFSET_Y_INDEX    ( 7 )
+
+#define NODE_TYPE_MASK                       ( 0x03 )
+#define NODE_GRID_ID_MASK                    ( 0xF0 )
+#define NODE_GRID_ID_SHIFT                   ( 4 )
+#define NODE_ROTATION_MASK                   ( 0x07 )
+
+#define GRID_POSITION_X_MASK                 ( 0x0F )
+#define GRID_POSITION_Y_MASK                 ( 0xF0 )
+
+// Number of bits that describe the grid position
+#define GRID_POSITION_SIZE                   ( 4 )
+
+// The grid index covers every position a page can describe,
+// -GRID_INDEX_OFFSET to GRID_INDEX_OFFSET - 1 in each direction.
+#define GRID_INDEX_SIZE                      ( 1 << GRID_POSITION_SIZE )
+#define GRID_INDEX_OFFSET                    ( GRID_INDEX_SIZE / 2 )
+
+#define NODE_INDEX_INVALID                   ( UINT16_MAX )
+
+#define BATCH_NODE_ID_INDEX                  ( 2 )
+#define BATCH_NODE_TYPE_INDEX                ( 4 )
+#define BATCH_GRID_POSITION_INDEX            ( 5 )
+#define BATCH_GRID_OFFSET_X_INDEX            ( 6 )
+#define BATCH_GRID_OFFSET_Y_INDEX            ( 7 )
+
+#define BATCH_COMMIT_FLAG                    ( 0x80 )
+#define BATCH_TRANSACTION_MASK               ( 0x70 )
+#define BATCH_TRANSACTION_SHIFT              ( 4 )
+#define BATCH_GRID_ID_MASK                   ( 0x0F )
+#define BATCH_NODE_TYPE_MASK                 ( 0x03 )
+#define BATCH_NODE_ROTATION_SHIFT            ( 2 )
+
+#define BATCH_TRANSACTION_NONE               ( 0xFF )
+
+/**********************************************************
+                       DECLARATIONS
+**********************************************************/
+
+/* Stages a batch entry, converted to a position page */
+static void stage_batch_entry( uint8_t const * batch_page );
+
+/* Applies the staged batch if every node arrived */
+static void commit_batch( uint8_t const * batch_page, mm_position_batch_outcome_t * outcome );
+
+/* Sign extends a number in 2's complement form */
+static int8_t sign_extend( uint8_t uint, uint8_t size_bits );
+
+/* Rebuilds the node id and grid position indexes from node_positions */
+static void rebuild_indexes( void );
+
+/* Finds the id hash slot for a node id. The slot holds NODE_INDEX_INVALID
+ * if the node isn't in the index.
+ */
+static uint16_t find_node_id_slot( uint16_t node_id );
+
+/* Finds the node_positions index for a node id, NODE_INDEX_INVALID if
+ * the node doesn't exist in the list yet.
+ */
+static uint16_t find_node_index( uint16_t node_id );
+
+/**********************************************************
+                       VARIABLES
+**********************************************************/
+
+static mm_node_position_t node_positions[MAX_GATEWAY_NODES];
+
+static uint16_t current_number_of_nodes = 0;
+
+// Indexes into node_positions, NODE_INDEX_INVALID where empty.
+// Each grid has its own cell index since grids reuse the same positions.
+static uint16_t node_id_hash[POSITION_TABLE_ID_HASH_SIZE];
+static uint16_t grid_index[MAX_SENSOR_GRIDS][GRID_INDEX_SIZE][GRID_INDEX_SIZE];
+
+// The page each entry in node_positions was decoded from.
+static position_pages_record_t position_pages;
+
+// Position pages of the batch being received, one per node.
+static uint8_t  staged_pages[MAX_GATEWAY_NODES][POSITION_PAGE_SIZE];
+static uint16_t staged_count = 0;
+static bool     is_staging_overflowed = false;
+static uint8_t  staged_transaction = BATCH_TRANSACTION_NONE;
+
+// The config app repeats its commit until it sees the outcome, repeats aren't applied again.
+static uint8_t  committed_transaction = BATCH_TRANSACTION_NONE;
+
+/**********************************************************
+                       DEFINITIONS
+**********************************************************/
+
+/* Empties the table and drops any batch being received. */
+void mm_position_table_init( void )
+{
+    memset(&node_positions[0], 0, sizeof( node_positions ) );
+    memset(&position_pages, 0, sizeof( position_pages ) );
+    current_number_of_nodes = 0;
+    rebuild_indexes();
+
+    staged_count = 0;
+    is_staging_overflowed = false;
+    staged_transaction = BATCH_TRANSACTION_NONE;
+    committed_transaction = BATCH_TRANSACTION_NONE;
+}
+
+/* Applies a position page to the table. Returns true if the page changed the node's entry. */
+bool mm_position_table_apply_page( uint8_t const * position_page )
+{
+    mm_node_position_t * node_position = NULL;
+
+    uint16_t node_id;
+
+    // These three bytes are "temp" variables which
+    // allow us to apply a bitmask to decode
+    // specific data from the payload.
+    uint8_t node_type_byte;
+    uint8_t node_rotation_byte;
+    uint8_t grid_position_byte;
+
+    memcpy(&node_id, &position_page[1], sizeof(node_id));
+
+    // Determine if the node from the message payload
+    // already exists in the list...
+    uint16_t node_index = find_node_index( node_id );
+
+    if ( node_index != NODE_INDEX_INVALID )
+    {
+        // Nothing to do if the app is repeating itself.
+        if ( memcmp( &position_pages.pages[node_index][0], position_page, POSITION_PAGE_SIZE ) == 0 )
+        {
+            return false;
+        }
+
+        // If so, we're going to replace it's previous entry with
+        // the new one.
+        node_position = &node_positions[node_index];
+    }
+
+    // Otherwise, if we couldn't find the node from the payload
+    // in the list, we need to add it...
+    if ( node_position == NULL )
+    {
+        // ...by iterating through the existing list...
+        for ( uint16_t i = 0; i < MAX_GATEWAY_NODES; i++ )
+        {
+            // ..and finding the first empty (non-valid) entry.
+            if ( !node_positions[i].is_valid )
+            {
+                node_position = &node_positions[i];
+                node_position->node_id = node_id;
+                node_position->is_valid = true;
+
+                node_index = i;
+                current_number_of_nodes++;
+                position_pages.node_count = current_number_of_nodes;
+                break;
+            }
+        }
+    }
+
+    // If we couldn't add a new node position (because the existing
+    // list was full), APP_ERROR
+    APP_ERROR_CHECK( node_position == NULL );
+
+    // Read node type and rotation bytes...
+    memcpy
+        (
+        &node_type_byte,
+        &position_page[POSITION_PAGE_NODE_TYPE_INDEX],
+        sizeof(node_type_byte)
+        );
+    memcpy
+        (
+        &node_rotation_byte,
+        &position_page[POSITION_PAGE_NODE_ROTATION_INDEX],
+        sizeof(node_rotation_byte)
+        );
+
+    // Extract relevant bits using bitmasks...
+    node_position->node_type = node_type_byte & NODE_TYPE_MASK;
+    node_position->grid_id = ( node_type_byte & NODE_GRID_ID_MASK ) >> NODE_GRID_ID_SHIFT;
+    node_position->node_rotation = (mm_node_rotation_t)( node_rotation_byte & NODE_ROTATION_MASK );
+
+    // Read grid position byte...
+    memcpy
+        (
+        &grid_position_byte,
+        &position_page[POSITION_PAGE_GRID_POSITION_INDEX],
+        sizeof(grid_position_byte)
+        );
+
+    // Separate into the x and y grid position nibbles using bitmasks...
+    node_position->grid_position_x = sign_extend( ( grid_position_byte & GRID_POSITION_X_MASK ), GRID_POSITION_SIZE );
+    node_position->grid_position_y = sign_extend( ( grid_position_byte & GRID_POSITION_Y_MASK ) >> 4,  GRID_POSITION_SIZE );
+
+    // Read grid offset bytes. Grid offset fills an entire byte, so no need
+    // for bitmask.
+    memcpy
+        (
+        &node_position->grid_offset_x,
+        &position_page[POSITION_PAGE_GRID_OFFSET_X_INDEX],
+        sizeof(node_position->grid_offset_x)
+        );
+    memcpy
+        (
+        &node_position->grid_offset_y,
+        &position_page[POSITION_PAGE_GRID_OFFSET_Y_INDEX],
+        sizeof(node_position->grid_offset_y)
+        );
+
+    // The node may be new or have moved, bring the indexes up to date.
+    rebuild_indexes();
+
+    memcpy( &position_pages.pages[node_index][0], position_page, POSITION_PAGE_SIZE );
+    return true;
+}
+
+/* Stages a batch entry page, or commits the staged batch for a commit page. */
+bool mm_position_table_on_batch_page( uint8_t const * batch_page, mm_position_batch_outcome_t * outcome )
+{
+    uint8_t transaction = ( batch_page[BATCH_HEADER_INDEX] & BATCH_TRANSACTION_MASK ) >> BATCH_TRANSACTION_SHIFT;
+
+    if ( batch_page[BATCH_HEADER_INDEX] & BATCH_COMMIT_FLAG )
+    {
+        if ( transaction == committed_transaction )
+        {
+            // Already applied, the app hasn't seen the outcome yet.
+            return false;
+        }
+
+        commit_batch( batch_page, outcome );
+        return true;
+    }
+
+    if ( transaction == committed_transaction )
+    {
+        // A repeat of an entry from the batch that was just applied.
+        return false;
+    }
+
+    if ( transaction != staged_transaction )
+    {
+        // A new batch, drop whatever was left of the previous one.
+        staged_transaction = transaction;
+        staged_count = 0;
+        is_staging_overflowed = false;
+    }
+
+    stage_batch_entry( batch_page );
+    return false;
+}
+
+/* Gets the pages the table was built from, in table order. */
+position_pages_record_t const * mm_position_table_get_pages( void )
+{
+    return &position_pages;
+}
+
+/* Gets the entire table, MAX_GATEWAY_NODES entries. */
+mm_node_position_t const * mm_position_table_get_positions( void )
+{
+    return node_positions;
+}
+
+/* Gets a node's entry by node id, NULL if the node isn't in the table. */
+mm_node_position_t const * mm_position_table_find_node( uint16_t node_id )
+{
+    uint16_t node_index = find_node_index( node_id );
+
+    if ( node_index == NODE_INDEX_INVALID )
+    {
+        return NULL;
+    }
+
+    return &node_positions[node_index];
+}
+
+/* Gets the node at a position within a grid, NULL if there isn't one. */
+mm_node_position_t const * mm_position_table_find_cell( uint8_t grid_id, int8_t x, int8_t y )
+{
+    if ( grid_id >= MAX_SENSOR_GRIDS ||
+         x < -GRID_INDEX_OFFSET || x >= GRID_INDEX_OFFSET ||
+         y < -GRID_INDEX_OFFSET || y >= GRID_INDEX_OFFSET )
+    {
+        // No page can place a node here.
+        return NULL;
+    }
+
+    uint16_t node_index = grid_index[grid_id][x + GRID_INDEX_OFFSET][y + GRID_INDEX_OFFSET];
+
+    if ( node_index == NODE_INDEX_INVALID )
+    {
+        return NULL;
+    }
+
+    return &node_positions[node_index];
+}
+
+/* Gets the number of nodes in the table. */
+uint16_t mm_position_table_get_node_count( void )
+{
+    return current_number_of_nodes;
+}
+
+/* Stages a batch entry, converted to a position page */
+static void stage_batch_entry( uint8_t const * batch_page )
+{
+    uint8_t page[POSITION_PAGE_SIZE];
+
+    page[0] = POSITION_CONFIG_PAGE_NUM;
+    memcpy( &page[1], &batch_page[BATCH_NODE_ID_INDEX], sizeof(uint16_t) );
+    page[POSITION_PAGE_NODE_TYPE_INDEX] = ( batch_page[BATCH_NODE_TYPE_INDEX] & BATCH_NODE_TYPE_MASK ) |
+                                          ( ( batch_page[BATCH_HEADER_INDEX] & BATCH_GRID_ID_MASK ) << NODE_GRID_ID_SHIFT );
+    page[POSITION_PAGE_NODE_ROTATION_INDEX] = ( batch_page[BATCH_NODE_TYPE_INDEX] >> BATCH_NODE_ROTATION_SHIFT ) & NODE_ROTATION_MASK;
+    page[POSITION_PAGE_GRID_POSITION_INDEX] = batch_page[BATCH_GRID_POSITION_INDEX];
+    page[POSITION_PAGE_GRID_OFFSET_X_INDEX] = batch_page[BATCH_GRID_OFFSET_X_INDEX];
+    page[POSITION_PAGE_GRID_OFFSET_Y_INDEX] = batch_page[BATCH_GRID_OFFSET_Y_INDEX];
+
+    // Entries are broadcast, so the same node may arrive more than once.
+    for ( uint16_t i = 0; i < staged_count; i++ )
+    {
+        if ( memcmp( &staged_pages[i][1], &page[1], sizeof(uint16_t) ) == 0 )
+        {
+            memcpy( &staged_pages[i][0], page, POSITION_PAGE_SIZE );
+            return;
+        }
+    }
+
+    if ( staged_count >= MAX_GATEWAY_NODES )
+    {
+        is_staging_overflowed = true;
+        return;
+    }
+
+    memcpy( &staged_pages[staged_count][0], page, POSITION_PAGE_SIZE );
+    staged_count++;
+}
+
+/* Applies the staged batch if every node arrived */
+static void commit_batch( uint8_t const * batch_page, mm_position_batch_outcome_t * outcome )
+{
+    uint8_t transaction = ( batch_page[BATCH_HEADER_INDEX] & BATCH_TRANSACTION_MASK ) >> BATCH_TRANSACTION_SHIFT;
+    uint16_t received_count = ( transaction == staged_transaction ) ? staged_count : 0;
+
+    outcome->result = BATCH_RESULT_APPLIED;
+    outcome->received_count = (uint8_t)received_count;
+    outcome->has_changed = false;
+
+    // Count the nodes that would need a new entry in the table.
+    uint16_t new_node_count = 0;
+    for ( uint16_t i = 0; i < received_count; i++ )
+    {
+        uint16_t node_id;
+        memcpy( &node_id, &staged_pages[i][1], sizeof(node_id) );
+
+        if ( find_node_index( node_id ) == NODE_INDEX_INVALID )
+        {
+            new_node_count++;
+        }
+    }
+
+    if ( received_count != batch_page[BATCH_NODE_COUNT_INDEX] )
+    {
+        outcome->result = BATCH_RESULT_INCOMPLETE;
+    }
+    else if ( is_staging_overflowed || current_number_of_nodes + new_node_count > MAX_GATEWAY_NODES )
+    {
+        outcome->result = BATCH_RESULT_TOO_MANY_NODES;
+    }
+    else
+    {
+        for ( uint16_t i = 0; i < received_count; i++ )
+        {
+            outcome->has_changed |= mm_position_table_apply_page( &staged_pages[i][0] );
+        }
+
+        committed_transaction = transaction;
+    }
+
+    // A failed batch has to be sent again from the start.
+    staged_count = 0;
+    is_staging_overflowed = false;
+    staged_transaction = BATCH_TRANSACTION_NONE;
+}
+
+/* Rebuilds the node id and grid position indexes from node_positions */
+static void rebuild_indexes( void )
+{
+    for ( uint16_t i = 0; i < POSITION_TABLE_ID_HASH_SIZE; i++ )
+    {
+        node_id_hash[i] = NODE_INDEX_INVALID;
+    }
+
+    for ( uint8_t g = 0; g < MAX_SENSOR_GRIDS; g++ )
+    {
+        for ( uint16_t x = 0; x < GRID_INDEX_SIZE; x++ )
+        {
+            for ( uint16_t y = 0; y < GRID_INDEX_SIZE; y++ )
+            {
+                grid_index[g][x][y] = NODE_INDEX_INVALID;
+            }
+        }
+    }
+
+    for ( uint16_t i = 0; i < MAX_GATEWAY_NODES; i++ )
+    {
+        mm_node_position_t const * position = &node_positions[i];
+
+        if ( !position->is_valid )
+        {
+            continue;
+        }
+
+        uint16_t slot = find_node_id_slot( position->node_id );
+        node_id_hash[slot] = i;
+
+        if ( position->grid_id >= MAX_SENSOR_GRIDS )
+        {
+            // Not part of any grid this gateway runs.
+            continue;
+        }
+
+        // Decoded positions always fit the index. If two nodes claim
+        // the same cell, the first one in the list wins.
+        uint16_t * cell = &grid_index[position->grid_id][position->grid_position_x + GRID_INDEX_OFFSET][position->grid_position_y + GRID_INDEX_OFFSET];
+
+        if ( *cell == NODE_INDEX_INVALID )
+        {
+            *cell = i;
+        }
+    }
+}
+
+/* Finds the id hash slot for a node id. The slot holds NODE_INDEX_INVALID
+ * if the node isn't in the index.
+ */
+static uint16_t find_node_id_slot( uint16_t node_id )
+{
+    uint16_t slot = node_id % POSITION_TABLE_ID_HASH_SIZE;
+
+    // Linear probe, the table is never full so this always ends.
+    while ( node_id_hash[slot] != NODE_INDEX_INVALID )
+    {
+        if ( node_positions[node_id_hash[slot]].node_id == node_id )
+        {
+            break;
+        }
+
+        slot = ( slot + 1 ) % POSITION_TABLE_ID_HASH_SIZE;
+    }
+
+    return slot;
+}
+
+/* Finds the node_positions index for a node id, NODE_INDEX_INVALID if
+ * the node doesn't exist in the list yet.
+ */
+static uint16_t find_node_index( uint16_t node_id )
+{
+    return node_id_hash[find_node_id_slot( node_id )];
+}
+
+/* Sign extends a number in 2's complement form */
+static int8_t sign_extend( uint8_t uint, uint8_t size_bits )
+{
+    int8_t result;
+    memcpy(&result, &uint, sizeof(result));
+
+    // Create a bitmask to extract the most significant
+    // bit (MSB) from "uint"...
+    uint8_t bitmask = 1 << ( size_bits - 1 );
+
+    // Apply the bitmask to get the MSB
+    uint8_t msb = uint & bitmask;
+
+    // While MSB is not 0...
+    while ( msb )
+    {
+        // ..shifting the MSB left and OR-ing
+        // sign extends "uint"
+        msb <<= 1;
+        result |= msb;
+    }
+
+    return result;
+}
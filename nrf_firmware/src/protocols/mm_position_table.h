@@ -0,0 +1,135 @@
+/**
+file: mm_position_table.h
+brief: The gateway's table of node positions, indexed by node id and by grid cell
+notes:
+    Lookups by node id and by grid position go through indexes into the
+    table, so they don't depend on the number of nodes. The indexes are
+    rebuilt whenever a position page is applied. That happens in main
+    context, same as every lookup, so readers never see a partial rebuild.
+
+    Doesn't touch ANT or flash, mm_position_config receives the pages that
+    fill it and keeps them in flash.
+
+    A whole grid can also be sent as a batch: one entry page per node, all
+    with the same transaction id, then a commit page saying how many nodes
+    the batch has. Entry pages don't need to be acknowledged, the commit
+    applies the batch only if every node arrived, so positions change once
+    per batch instead of once per node. Each batch must use a different
+    transaction id from the one before it, repeats of the last committed
+    batch are ignored.
+
+    Position page layout:
+        0:   page number
+        1-2: node id, little endian
+        3:   grid id << 4 | node type
+        4:   node rotation
+        5:   grid position, y << 4 | x
+        6:   grid offset x
+        7:   grid offset y
+
+    Batch payload layout:
+        0:   page number
+        1:   commit flag << 7 | transaction id << 4 | grid id (entries only)
+        entry pages:
+        2-3: node id, little endian
+        4:   node rotation << 2 | node type
+        5:   grid position, y << 4 | x
+        6:   grid offset x
+        7:   grid offset y
+        commit pages:
+        2:   number of nodes in the batch
+        outcome pages, from the gateway:
+        1:   as in the commit page
+        2:   number of nodes received
+        3:   batch_result_t
+*/
+
+#ifndef MM_POSITION_TABLE_H
+#define MM_POSITION_TABLE_H
+
+/**********************************************************
+                        INCLUDES
+**********************************************************/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "mm_position_config.h"
+#include "mm_sensor_algorithm_config.h"
+
+/**********************************************************
+                        CONSTANTS
+**********************************************************/
+
+// An ANT standard data payload.
+#define POSITION_PAGE_SIZE                  ( 8 )
+
+// Keep the id hash at most half full so probe sequences stay short.
+#define POSITION_TABLE_ID_HASH_SIZE         ( 2 * MAX_GATEWAY_NODES + 1 )
+
+#define BATCH_HEADER_INDEX                  ( 1 )
+#define BATCH_NODE_COUNT_INDEX              ( 2 )
+#define BATCH_RESULT_INDEX                  ( 3 )
+
+/**********************************************************
+                          TYPES
+**********************************************************/
+
+/* Outcome of a batch commit, as reported to the config app. */
+typedef enum
+{
+    BATCH_RESULT_APPLIED,
+    BATCH_RESULT_INCOMPLETE,    /* Not every node in the batch arrived, nothing was applied. */
+    BATCH_RESULT_TOO_MANY_NODES /* The batch doesn't fit in the position table, nothing was applied. */
+} batch_result_t;
+
+typedef struct
+{
+    batch_result_t result;
+    uint8_t        received_count;  /* Nodes of the batch that arrived. */
+    bool           has_changed;     /* The batch changed the table. */
+} mm_position_batch_outcome_t;
+
+/* The position pages of every configured node, in table order. */
+typedef struct
+{
+    uint16_t node_count;
+    uint8_t  pages[MAX_GATEWAY_NODES][POSITION_PAGE_SIZE];
+} position_pages_record_t;
+
+/**********************************************************
+                       DECLARATIONS
+**********************************************************/
+
+/* Empties the table and drops any batch being received. */
+void mm_position_table_init( void );
+
+/* Applies a position page to the table. Returns true if the page changed the node's entry.
+ * The table must have room for the node if it is new.
+ */
+bool mm_position_table_apply_page( uint8_t const * position_page );
+
+/* Stages a batch entry page, or commits the staged batch for a commit page.
+ * Returns true with the outcome for a commit, false for entries and for
+ * repeats of the last committed batch.
+ */
+bool mm_position_table_on_batch_page( uint8_t const * batch_page, mm_position_batch_outcome_t * outcome );
+
+/* Gets the pages the table was built from, in table order. */
+position_pages_record_t const * mm_position_table_get_pages( void );
+
+/* Gets the entire table, MAX_GATEWAY_NODES entries. */
+mm_node_position_t const * mm_position_table_get_positions( void );
+
+/* Gets a node's entry by node id, NULL if the node isn't in the table. */
+mm_node_position_t const * mm_position_table_find_node( uint16_t node_id );
+
+/* Gets the node at a position within a grid, NULL if there isn't one. If
+ * several nodes claim the cell, the first one in the table wins.
+ */
+mm_node_position_t const * mm_position_table_find_cell( uint8_t grid_id, int8_t x, int8_t y );
+
+/* Gets the number of nodes in the table. */
+uint16_t mm_position_table_get_node_count( void );
+
+#endif /* MM_POSITION_TABLE_H */
@@ -0,0 +1,216 @@
+/**
+file: mm_wildlife_statistics_transmission.c
+brief: Answers wildlife statistics requests from the monitoring application over ANT
+notes:
+    The statistics are far too big to stream, so the monitoring application
+    asks for one counter at a time. The answer is broadcast on the same page
+    until the monitoring application acknowledges it, a new request replaces
+    an answer that hasn't been acknowledged yet. Requests for counters that
+    don't exist are ignored.
+
+    Payload layout, for both requests and answers:
+        0:   page number
+        1:   message id, answers repeat the request's
+        2:   statistic (wildlife_statistic_t) << 4 | grid id
+        3-4: index, little endian
+                 region hourly:  AV index
+                 duration:       sensor type
+                 sensor daily:   node id
+        5:   bucket
+                 region hourly:  hour of the day
+                 duration:       histogram bucket
+                 sensor daily:   sensor rotation << 4 | days ago
+        6-7: count, little endian, unused in requests
+
+    The whole of a grid's statistics can also be downloaded as a burst
+    transfer, see mm_burst_transfer.h.
+*/
+
+/**********************************************************
+                        INCLUDES
+**********************************************************/
+
+#include <string.h>
+
+#include "app_error.h"
+#include "app_scheduler.h"
+
+#include "mm_ant_control.h"
+#include "mm_ant_page_manager.h"
+#include "mm_wildlife_statistics_transmission.h"
+#include "mm_wildlife_statistics.h"
+#include "mm_burst_transfer.h"
+
+/**********************************************************
+                        CONSTANTS
+**********************************************************/
+
+#define MESSAGE_ACKNOWLEDGEMENT_PAGE_NUM    ( 0x20 )
+#define CONCURRENT_PAGE_COUNT               ( 1 )
+
+#define PAGE_NUM_INDEX                      ( 0 )
+#define MESSAGE_ID_INDEX                    ( 1 )
+#define STATISTIC_INDEX                     ( 2 )
+#define COUNTER_INDEX                       ( 3 )
+#define BUCKET_INDEX                        ( 5 )
+#define COUNT_INDEX                         ( 6 )
+
+#define ACKED_PAGE_NUM_INDEX                ( 2 )
+
+/**********************************************************
+                       DECLARATIONS
+**********************************************************/
+
+/* Processes an ANT event */
+static void process_ant_evt(ant_evt_t * evt);
+
+/* Looks up the requested counter and starts broadcasting it */
+static void on_statistics_request(void* evt_data, uint16_t evt_size);
+
+/* Stops broadcasting the answer once it has been acknowledged */
+static void on_message_acknowledge(void* evt_data, uint16_t evt_size);
+
+/* Looks up the counter a request asks for, returns false if it doesn't exist */
+static bool get_requested_count(uint8_t const * request, uint16_t* count);
+
+/* Gets the size of a grid's statistics for a burst transfer, 0 if the grid doesn't exist */
+static uint16_t get_burst_size(uint8_t grid_id);
+
+/**********************************************************
+                       VARIABLES
+**********************************************************/
+
+static mm_ant_payload_t answer_payload;
+static bool is_answer_being_broadcast = false;
+
+/**********************************************************
+                       DEFINITIONS
+**********************************************************/
+
+/* Start answering wildlife statistics requests */
+void mm_wildlife_statistics_transmission_init(void)
+{
+    is_answer_being_broadcast = false;
+
+    // Register to receive ANT events
+    mm_ant_evt_handler_set(&process_ant_evt);
+
+    // Whole grids are sent as burst transfers
+    mm_burst_transfer_set_source(BURST_DATA_WILDLIFE_STATISTICS, get_burst_size, mm_wildlife_statistics_export);
+}
+
+/* Processes an ANT event */
+static void process_ant_evt(ant_evt_t * evt)
+{
+    ANT_MESSAGE * p_message = (ANT_MESSAGE *)evt->msg.evt_buffer;
+    uint32_t err_code;
+
+    switch (evt->event)
+    {
+        // If this is a "received message" event, take a closer look
+        case EVENT_RX:
+            if( (p_message->ANT_MESSAGE_ucMesgID == MESG_BROADCAST_DATA_ID) ||
+                (p_message->ANT_MESSAGE_ucMesgID == MESG_ACKNOWLEDGED_DATA_ID) )
+            {
+                switch (p_message->ANT_MESSAGE_aucPayload[PAGE_NUM_INDEX])
+                {
+                    case WILDLIFE_STATISTICS_PAGE_NUM:
+                        err_code = app_sched_event_put(evt, sizeof(ant_evt_t), on_statistics_request);
+                        APP_ERROR_CHECK(err_code);
+                        break;
+
+                    case MESSAGE_ACKNOWLEDGEMENT_PAGE_NUM:
+                        /* This might acknowledge the current answer, kick it to main to check. */
+                        err_code = app_sched_event_put(evt, sizeof(ant_evt_t), on_message_acknowledge);
+                        APP_ERROR_CHECK(err_code);
+                        break;
+
+                    default:
+                        break;
+                }
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+/* Looks up the requested counter and starts broadcasting it */
+static void on_statistics_request(void* evt_data, uint16_t evt_size)
+{
+    ant_evt_t const * evt = (ant_evt_t const *)evt_data;
+    ANT_MESSAGE * p_message = (ANT_MESSAGE *)evt->msg.evt_buffer;
+    uint8_t const * request = &p_message->ANT_MESSAGE_aucPayload[0];
+
+    uint16_t count;
+    if (!get_requested_count(request, &count))
+    {
+        return;
+    }
+
+    if (is_answer_being_broadcast)
+    {
+        mm_ant_page_manager_remove_all_pages(WILDLIFE_STATISTICS_PAGE_NUM);
+    }
+
+    /* Answer with the request, filling in the count. */
+    memcpy(&answer_payload.data[0], request, COUNT_INDEX);
+    memcpy(&answer_payload.data[COUNT_INDEX], &count, sizeof(uint16_t));
+
+    mm_ant_page_manager_add_page(WILDLIFE_STATISTICS_PAGE_NUM, &answer_payload, CONCURRENT_PAGE_COUNT, ANT_PAGE_PRIORITY_NORMAL);
+    is_answer_being_broadcast = true;
+}
+
+/* Stops broadcasting the answer once it has been acknowledged */
+static void on_message_acknowledge(void* evt_data, uint16_t evt_size)
+{
+    ant_evt_t const * evt = (ant_evt_t const *)evt_data;
+    ANT_MESSAGE * p_message = (ANT_MESSAGE *)evt->msg.evt_buffer;
+    uint8_t const * payload = &p_message->ANT_MESSAGE_aucPayload[0];
+
+    if (!is_answer_being_broadcast ||
+        payload[ACKED_PAGE_NUM_INDEX] != WILDLIFE_STATISTICS_PAGE_NUM ||
+        payload[MESSAGE_ID_INDEX] != answer_payload.data[MESSAGE_ID_INDEX])
+    {
+        return;
+    }
+
+    mm_ant_page_manager_remove_all_pages(WILDLIFE_STATISTICS_PAGE_NUM);
+    is_answer_being_broadcast = false;
+}
+
+/* Looks up the counter a request asks for, returns false if it doesn't exist */
+static bool get_requested_count(uint8_t const * request, uint16_t* count)
+{
+    wildlife_statistic_t statistic = (wildlife_statistic_t)( request[STATISTIC_INDEX] >> 4 );
+    uint8_t grid_id = request[STATISTIC_INDEX] & 0x0F;
+    uint8_t bucket = request[BUCKET_INDEX];
+    uint16_t index;
+
+    memcpy(&index, &request[COUNTER_INDEX], sizeof(uint16_t));
+
+    if (statistic == WILDLIFE_STATISTIC_SENSOR_DAILY)
+    {
+        sensor_rotation_t sensor_rotation = (sensor_rotation_t)( bucket >> 4 );
+        if (sensor_rotation >= SENSOR_ROTATION_COUNT)
+        {
+            return false;
+        }
+
+        return mm_wildlife_statistics_get_sensor_daily(grid_id, index, sensor_rotation, bucket & 0x0F, count);
+    }
+
+    return mm_wildlife_statistics_get(grid_id, statistic, index, bucket, count);
+}
+
+/* Gets the size of a grid's statistics for a burst transfer, 0 if the grid doesn't exist */
+static uint16_t get_burst_size(uint8_t grid_id)
+{
+    if (grid_id >= MAX_SENSOR_GRIDS)
+    {
+        return 0;
+    }
+
+    return mm_wildlife_statistics_get_export_size();
+}
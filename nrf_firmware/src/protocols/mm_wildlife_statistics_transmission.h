@@ -0,0 +1,24 @@
+/**
+file: mm_wildlife_statistics_transmission.h
+brief: Answers wildlife statistics requests from the monitoring application over ANT
+notes:
+*/
+#ifndef MM_WILDLIFE_STATISTICS_TRANSMISSION_H
+#define MM_WILDLIFE_STATISTICS_TRANSMISSION_H
+
+/**********************************************************
+                        CONSTANTS
+**********************************************************/
+
+#define WILDLIFE_STATISTICS_PAGE_NUM    ( 0x28 )
+
+/**********************************************************
+                       DECLARATIONS
+**********************************************************/
+
+/**
+    Start answering wildlife statistics requests. The sensor algorithm must already be initialized.
+*/
+void mm_wildlife_statistics_transmission_init(void);
+
+#endif /* MM_WILDLIFE_STATISTICS_TRANSMISSION_H */
@@ -23,13 +23,13 @@ notes:
 #include "mm_activity_variable_growth_sensor_records_prv.h"
 
 #include "mm_av_transmission.h"
+#include "mm_trajectory_tracker.h"
+#include "mm_wildlife_statistics.h"
 
 /**********************************************************
                         CONSTANTS
 **********************************************************/
 
-#define MAX_ADJACENT_ACTIVITY_VARIABLES ( 2 )   /* The max number of regions a sensor can affect per detection. */
-
 /**********************************************************
                         MACROS
 **********************************************************/
@@ -38,32 +38,26 @@ notes:
                           TYPES
 **********************************************************/
 
-typedef struct
-{
-    mm_activity_variable_t* avs[MAX_ADJACENT_ACTIVITY_VARIABLES];
-    uint8_t                 av_count;
-} activity_variable_set_t;
-
 /**********************************************************
                        DECLARATIONS
 **********************************************************/
 
 /**
- * Apply growth given avs and constants.
+ * Collapse a set of sensor constants into the single factor they apply.
  */ 
-static void grow_activity_variables(activity_variable_set_t* av_set, activity_variable_sensor_constants_t const * constants);
+static float get_combined_factor(activity_variable_sensor_constants_t const * constants);
 
 /**
  * Calculate which activity variable regions are adjacent to a made detection.
  * 
  * [out] the set of activity variables that are adjacent.
  */
-static void find_adjacent_activity_variables(int8_t xpos, int8_t ypos, total_rotation_t sensor_rotation, activity_variable_set_t* av_set);
+static void find_adjacent_activity_variables(uint8_t grid_id, int8_t xpos, int8_t ypos, total_rotation_t sensor_rotation, activity_variable_set_t* av_set);
 
 /**
  * Check a set of AV coordinates for validity, then add to av_set if valid.
  */
-static void check_add_av(uint8_t x, uint8_t y, activity_variable_set_t* av_set);
+static void check_add_av(uint8_t grid_id, uint8_t x, uint8_t y, activity_variable_set_t* av_set);
 
 /**********************************************************
                        DEFINITIONS
@@ -72,24 +66,24 @@ static void check_add_av(uint8_t x, uint8_t y, activity_variable_set_t* av_set);
 /**
  * Initialize growth logic.
  */
-void mm_activity_variable_growth_init(void)
+void mm_activity_variable_growth_init(uint8_t grid_id)
 {
-    init_sensor_records();
+    init_sensor_records(grid_id);
 }
 
 /**
  * On sensor detection.
  */
-void mm_activity_variable_growth_on_sensor_detection(sensor_evt_t const * evt)
+void mm_activity_variable_growth_on_sensor_detection(uint8_t grid_id, sensor_evt_t const * evt, mm_sensor_handle_t handle)
 {
     /* Pass event to specific sensor processing. */
     switch(evt->sensor_type)
     {
     case SENSOR_TYPE_PIR:
-        translate_pir_detection(evt);
+        translate_pir_detection(grid_id, evt, handle);
         break;
     case SENSOR_TYPE_LIDAR:
-        translate_lidar_detection(evt);
+        translate_lidar_detection(grid_id, evt, handle);
         break;
     default:
         APP_ERROR_CHECK(true);
@@ -100,21 +94,62 @@ void mm_activity_variable_growth_on_sensor_detection(sensor_evt_t const * evt)
 /**
  * Called once per second.
  */
-void mm_activity_variable_growth_on_second_elapsed(void)
+void mm_activity_variable_growth_on_second_elapsed(uint8_t grid_id)
 {
     /* Pass event to specific sensor processing. */
-    translate_on_second_evt_pir();
-    translate_on_second_evt_lidar();
+    translate_on_second_evt_pir(grid_id);
+    translate_on_second_evt_lidar(grid_id);
 }
 
-void process_abstract_detection(abstract_sensor_detection_t* detection)
+/**
+ * Check if any sensor is still detecting, and so will trickle growth on the next second.
+ */
+bool mm_activity_variable_growth_is_trickling(uint8_t grid_id)
 {
+    return any_sensor_record_detecting(grid_id);
+}
+
+/**
+    Called before clearing node position changed flag.
+*/
+void mm_activity_variable_growth_on_node_positions_update(uint8_t grid_id)
+{
+    /* Plans depend on where nodes are, so rebuild them on next use. */
+    invalidate_sensor_plans(grid_id);
+}
+
+/**
+    Called after a new algorithm config has been applied to a grid.
+*/
+void mm_activity_variable_growth_on_config_update(uint8_t grid_id)
+{
+    /* Plans bake in the growth and trickle factors, so rebuild them on next use. */
+    invalidate_sensor_plans(grid_id);
+}
+
+/**
+ * Work out which AVs a detection from (xpos, ypos) facing rotation applies to, and
+ * collapse the growth and trickle constants into single factors.
+ */
+void compile_detection_plan
+    (
+    uint8_t grid_id,
+    int8_t xpos,
+    int8_t ypos,
+    total_rotation_t rotation,
+    activity_variable_sensor_constants_t const * growth_constants,
+    activity_variable_sensor_constants_t const * trickle_constants,
+    detection_plan_t* plan
+    )
+{
+    memset(plan, 0, sizeof(detection_plan_t));
+
     /* Which AV's does the detection apply to? */
-    activity_variable_set_t av_set;
-    find_adjacent_activity_variables(detection->xpos, detection->ypos, detection->rotation, &av_set);
+    find_adjacent_activity_variables(grid_id, xpos, ypos, rotation, &plan->av_set);
 
-    /* Apply growth */
-    grow_activity_variables(&av_set, &detection->constants);
+    plan->growth_factor = get_combined_factor(growth_constants);
+    plan->trickle_factor = get_combined_factor(trickle_constants);
+    plan->is_valid = true;
 }
 
 void get_grid_direction(total_rotation_t rotation, int8_t* dx, int8_t* dy)
@@ -149,41 +184,85 @@ void get_grid_direction(total_rotation_t rotation, int8_t* dx, int8_t* dy)
 }
 
 /**
- * Apply growth constants to a set of activity variables.
+ * Grow the AVs in a plan by factor, either the plan's growth or trickle factor.
  */
-static void grow_activity_variables(activity_variable_set_t* av_set, activity_variable_sensor_constants_t const * constants)
+void apply_detection_plan(uint8_t grid_id, detection_plan_t const * plan, float factor)
 {
-    for(uint16_t i = 0; i < av_set->av_count; ++i)
-    {
-        /* Calculate the factor */
-        float factor = 1.0f;
+    /* Plans outside the network should have been filtered out already. */
+    APP_ERROR_CHECK(!plan->is_valid);
 
-        factor *= constants->common_sensor_weight_factor;
-        factor *= constants->base_sensor_weight_factor;
-        factor *= constants->road_proximity_factor;
+    activity_variable_set_t const * av_set = &plan->av_set;
 
+    for(uint16_t i = 0; i < av_set->av_count; ++i)
+    {
         /* Apply the factor */
         *(av_set->avs[i]) *= factor;
 
         /* Check if max exceeded */
-        if(*(av_set->avs[i]) > mm_sensor_algorithm_config()->activity_variable_max)
+        if(*(av_set->avs[i]) > mm_sensor_algorithm_config(grid_id)->activity_variable_max)
         {
-            *(av_set->avs[i]) = mm_sensor_algorithm_config()->activity_variable_max;
+            *(av_set->avs[i]) = mm_sensor_algorithm_config(grid_id)->activity_variable_max;
         }
+
+        /* Make sure the AV gets drained and evaluated from now on. */
+        mm_av_set_active(grid_id, av_set->avs[i]);
+    }
+}
+
+/**
+ * Report a new detection covering the AVs in a plan to the trajectory tracker
+ * and the wildlife statistics.
+ */
+void report_detection_plan(uint8_t grid_id, detection_plan_t const * plan)
+{
+    activity_variable_set_t const * av_set = &plan->av_set;
+
+    if(av_set->av_count == 0)
+    {
+        return;
+    }
+
+    float x = 0.0f;
+    float y = 0.0f;
+
+    for(uint16_t i = 0; i < av_set->av_count; ++i)
+    {
+        /* Recover the AV's coordinates from its place in the grid. */
+        uint16_t index = av_set->avs[i] - mm_av_access(grid_id, 0, 0);
+        x += (float)(index % MAX_AV_SIZE_X) + 0.5f;
+        y += (float)(index / MAX_AV_SIZE_X) + 0.5f;
+
+        mm_wildlife_statistics_on_region_detection(grid_id, index);
     }
+
+    mm_trajectory_tracker_on_detection(grid_id, x / av_set->av_count, y / av_set->av_count);
+}
+
+/**
+ * Collapse a set of sensor constants into the single factor they apply.
+ */
+static float get_combined_factor(activity_variable_sensor_constants_t const * constants)
+{
+    float factor = 1.0f;
+
+    factor *= constants->common_sensor_weight_factor;
+    factor *= constants->base_sensor_weight_factor;
+    factor *= constants->road_proximity_factor;
+
+    return factor;
 }
 
 /**
  * Compute which AV regions are adjacent to a sensor detection.
  */
-static void find_adjacent_activity_variables(int8_t xpos, int8_t ypos, total_rotation_t rotation, activity_variable_set_t* av_set)
+static void find_adjacent_activity_variables(uint8_t grid_id, int8_t xpos, int8_t ypos, total_rotation_t rotation, activity_variable_set_t* av_set)
 {
     memset(av_set, 0, sizeof(activity_variable_set_t));
 
-    /* Convert node position (-1 to MAX_GRID_SIZE - 1) into
-       'av' coordinates (0 to MAX_GRID_SIZE)) */
-    uint8_t x_array = xpos + 1;
-    uint8_t y_array = ypos + 1;
+    /* Convert node position (GRID_POSITION_MIN to GRID_POSITION_MAX) into
+       'av' coordinates (0 to MAX_GRID_SIZE - 1) */
+    uint8_t x_array = xpos - GRID_POSITION_MIN_X;
+    uint8_t y_array = ypos - GRID_POSITION_MIN_Y;
     /* Positon coordinates and AV coordinates use inverted Y direction. */
     y_array = MAX_GRID_SIZE_Y - y_array - 1;
 
@@ -192,23 +271,23 @@ static void find_adjacent_activity_variables(int8_t xpos, int8_t ypos, total_rot
     {
         case TOTAL_ROTATION_0:
             /* Faces up, so can only affect row - 1, and column, column - 1 */
-            check_add_av(x_array, y_array - 1, av_set);
-            check_add_av(x_array - 1, y_array - 1, av_set);
+            check_add_av(grid_id, x_array, y_array - 1, av_set);
+            check_add_av(grid_id, x_array - 1, y_array - 1, av_set);
             break;
         case TOTAL_ROTATION_90:
             /* Faces right, so can only affect row, row - 1, and column */   
-            check_add_av(x_array, y_array, av_set);
-            check_add_av(x_array, y_array - 1, av_set);
+            check_add_av(grid_id, x_array, y_array, av_set);
+            check_add_av(grid_id, x_array, y_array - 1, av_set);
             break;
         case TOTAL_ROTATION_180:
             /* Faces down, so can only affect row, and column, column - 1 */ 
-            check_add_av(x_array, y_array, av_set);
-            check_add_av(x_array - 1, y_array, av_set);
+            check_add_av(grid_id, x_array, y_array, av_set);
+            check_add_av(grid_id, x_array - 1, y_array, av_set);
             break;
         case TOTAL_ROTATION_270:
             /* Faces left, so can only affect row, row - 1, column - 1 */
-            check_add_av(x_array - 1, y_array, av_set);
-            check_add_av(x_array - 1, y_array - 1, av_set);
+            check_add_av(grid_id, x_array - 1, y_array, av_set);
+            check_add_av(grid_id, x_array - 1, y_array - 1, av_set);
             break;
         default:
             /* Current design does not support intermediate angles. */
@@ -220,7 +299,7 @@ static void find_adjacent_activity_variables(int8_t xpos, int8_t ypos, total_rot
 /**
  * Checks an av coordinate for validity, then adds to av_set if valid.
  */
-static void check_add_av(uint8_t x, uint8_t y, activity_variable_set_t* av_set)
+static void check_add_av(uint8_t grid_id, uint8_t x, uint8_t y, activity_variable_set_t* av_set)
 {
     /* Check bounds on input */
     if(x >= MAX_AV_SIZE_X)
@@ -235,6 +314,6 @@ static void check_add_av(uint8_t x, uint8_t y, activity_variable_set_t* av_set)
 
     /* Save to av_set */
     APP_ERROR_CHECK(av_set->av_count >= MAX_ADJACENT_ACTIVITY_VARIABLES);
-    av_set->avs[av_set->av_count] = mm_av_access(x, y);
+    av_set->avs[av_set->av_count] = mm_av_access(grid_id, x, y);
     av_set->av_count++;
 }
@@ -13,6 +13,7 @@ notes:
 #include "mm_sensor_transmission.h"
 #include "mm_position_config.h"
 #include "mm_sensor_algorithm_config.h"
+#include "mm_sensor_registry.h"
 
 /**********************************************************
                         TYPES
@@ -25,21 +26,31 @@ notes:
 /**
  * Initialize growth logic.
  */
-void mm_activity_variable_growth_init(void);
+void mm_activity_variable_growth_init(uint8_t grid_id);
 
 /**
- * On sensor detection.
+ * On sensor detection, handle is the registry handle for the sensor that sent evt.
  */
-void mm_activity_variable_growth_on_sensor_detection(sensor_evt_t const * evt);
+void mm_activity_variable_growth_on_sensor_detection(uint8_t grid_id, sensor_evt_t const * evt, mm_sensor_handle_t handle);
 
 /**
  * Call once per second.
  */
-void mm_activity_variable_growth_on_second_elapsed(void);
+void mm_activity_variable_growth_on_second_elapsed(uint8_t grid_id);
+
+/**
+ * Check if any sensor is still detecting, and so will trickle growth on the next second.
+ */
+bool mm_activity_variable_growth_is_trickling(uint8_t grid_id);
 
 /**
     Called before clearing node position changed flag.
 */
-void mm_activity_variable_growth_on_node_positions_update(void);
+void mm_activity_variable_growth_on_node_positions_update(uint8_t grid_id);
+
+/**
+    Called after a new algorithm config has been applied to a grid.
+*/
+void mm_activity_variable_growth_on_config_update(uint8_t grid_id);
 
 #endif /* MM_ACTIVITY_VARIABLE_GROWTH_H */
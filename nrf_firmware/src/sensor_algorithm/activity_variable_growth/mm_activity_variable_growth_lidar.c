@@ -29,85 +29,89 @@ notes:
                           TYPES
 **********************************************************/
 
-typedef struct
-{
-    lidar_region_t   region;        /* Region as originally measured. */
-    int8_t           xpos;          /* Effective detection position. */
-    int8_t           ypos;          /* Effective detection position.*/
-    total_rotation_t direction;     /* Effective detection direction. */
-} abstract_lidar_detection_t;
-
 /**********************************************************
                        DECLARATIONS
 **********************************************************/
 
 /**
- * Calulate which AV region a lidar detection occured in.
- * 
- * [out] which region, a position to consider the detection from, and a total direction of the detection
- * 
- * return false if evt was invalid.
+ * Fetch the detection plan for a lidar record, compiling it first if the node positions have changed.
+ *
+ * return NULL if the node the lidar is on doesn't have a position.
+ */
+static sensor_plan_t const * get_lidar_plan(uint8_t grid_id, sensor_record_t * record);
+
+/**
+ * Calculate which region a measured distance falls in using a compiled plan.
  */
-static bool sensor_evt_to_lidar_detection(lidar_evt_data_t const * evt, abstract_lidar_detection_t* detection);
+static lidar_region_t get_lidar_region(sensor_plan_t const * plan, uint16_t distance_measured);
 
 /**
- * Process a lidar record, and send an abstract detection event out if the record is active.
+ * Compile the plan for one lidar region, the region is left invalid if it falls outside the network.
  */
-static void lidar_on_second_evt(sensor_record_t const * record);
+static void compile_lidar_region(uint8_t grid_id, int8_t x, int8_t y, total_rotation_t rotation, detection_plan_t* region_plan);
 
 /**
- * Fetch a virtual location for a lidar detection using the detection region and the original sensor position.
+ * Process a lidar record, and grow the activity variables if the record is active.
  */
-static void sensor_record_to_lidar_detection(sensor_record_t const * record, abstract_lidar_detection_t* detection);
+static void lidar_on_second_evt(uint8_t grid_id, sensor_record_t * record);
 
 /**
  * Grabs the position for a node in the grid. Creates a 'mock' default position if there isn't a node there.
- * 
+ *
  * [out] A mm_node_position_t object describing a node at x,y. That node may or may not actually exist.
  */
-static void fetch_or_mock_node_position(int8_t x, int8_t y, mm_node_position_t* position_out);
+static void fetch_or_mock_node_position(uint8_t grid_id, int8_t x, int8_t y, mm_node_position_t* position_out);
 
 /**
  * Collect the constants that define how AVs grow in reponse to lidar events.
  */
-static void generate_growth_constants(abstract_lidar_detection_t const * detection, activity_variable_sensor_constants_t* constants);
+static void generate_growth_constants(uint8_t grid_id, int8_t ypos, activity_variable_sensor_constants_t* constants);
 
 /**
  * Collect the constants that define how AVs grow in reponse to second events while a lidar is detecting.
  */
-static void generate_trickle_constants(abstract_lidar_detection_t const * detection, activity_variable_sensor_constants_t* constants);
+static void generate_trickle_constants(uint8_t grid_id, int8_t ypos, activity_variable_sensor_constants_t* constants);
 
 /**********************************************************
                        DEFINITIONS
 **********************************************************/
 
 /**
- * Translates a lidar detection event into an abstract detection event.
+ * Translates a lidar detection event into activity variable growth.
  */
-void translate_lidar_detection(sensor_evt_t const * sensor_evt)
+void translate_lidar_detection(uint8_t grid_id, sensor_evt_t const * sensor_evt, mm_sensor_handle_t handle)
 {
     lidar_evt_data_t const * evt = &sensor_evt->lidar_data;
 
-    /* Translate into an abstract detection: */
-    abstract_lidar_detection_t detection;
-    if(!sensor_evt_to_lidar_detection(evt, &detection))
+    /* Fetch the sensor record to compare against. */
+    sensor_record_t* record = get_sensor_record(grid_id, handle);
+
+    /* Look up where detections from this lidar apply: */
+    sensor_plan_t const * plan = get_lidar_plan(grid_id, record);
+    if(plan == NULL)
+    {
+        /* Unknown position, therefore invalid event. */
+        return;
+    }
+
+    lidar_region_t region = get_lidar_region(plan, evt->distance_measured);
+
+    if(region != LIDAR_REGION_REGION_NONE &&
+       !plan->regions[region - LIDAR_REGION_REGION_0].is_valid)
     {
-        /* Invalid event. */
+        /* Detection falls outside the network, so it isn't valid. */
         return;
     }
 
     /* Is the sensor hyperactive and detecting something? */
-    if(mm_sensor_error_is_sensor_hyperactive(sensor_evt) &&
-       detection.region != LIDAR_REGION_REGION_NONE)
+    if(mm_sensor_error_is_hyperactive(grid_id, handle) &&
+       region != LIDAR_REGION_REGION_NONE)
     {
         /* If so, don't process further. */
         return;
     }
 
-    /* Fetch the sensor record to compare against. */
-    sensor_record_t* record = get_sensor_record(evt->node_id, evt->sensor_rotation, SENSOR_TYPE_LIDAR);
-
-    if(record->detection_status == detection.region)
+    if(record->detection_status == region)
     {
         /* It isn't a new detection because it's the same data, no need to apply it. */
         return;
@@ -119,92 +123,94 @@ void translate_lidar_detection(sensor_evt_t const * sensor_evt)
         evt->node_id,
         evt->sensor_rotation,
         evt->distance_measured,
-        detection.region
+        region
         );
 
-    if(detection.region == LIDAR_REGION_REGION_NONE)
+    if(region == LIDAR_REGION_REGION_NONE)
     {
         /* End of detection, modify record and stop processing it. */
-        record->detection_status = LIDAR_REGION_REGION_NONE;
+        set_sensor_record_detection_status(grid_id, record, LIDAR_REGION_REGION_NONE);
         return;
     }
 
-    /* By now it is a new detection, generate an abstract event to grow the activity variables. */
-    abstract_sensor_detection_t abstract_detection;
-    memset(&abstract_detection, 0, sizeof(abstract_detection));
-    abstract_detection.xpos = detection.xpos;
-    abstract_detection.ypos = detection.ypos;
-    abstract_detection.rotation = detection.direction;
-    generate_growth_constants(&detection, &abstract_detection.constants);
-
-    process_abstract_detection(&abstract_detection);
+    /* By now it is a new detection, grow the activity variables. */
+    detection_plan_t const * region_plan = &(plan->regions[region - LIDAR_REGION_REGION_0]);
+    apply_detection_plan(grid_id, region_plan, region_plan->growth_factor);
+    report_detection_plan(grid_id, region_plan);
 
     /* Update detection state. */
-    record->detection_status = detection.region;
+    set_sensor_record_detection_status(grid_id, record, region);
 }
 
 /**
- * Translates an on second event into 0 or more abstract detection events.
+ * Translates an on second event into trickle growth for each detecting lidar.
  */
-void translate_on_second_evt_lidar(void)
+void translate_on_second_evt_lidar(uint8_t grid_id)
 {
-    /* Iterate through lidar records. */
+    /* Iterate through detecting lidar records, idle ones have nothing to trickle. */
     sensor_record_iterator_t it =
     {
         .sensor_type = SENSOR_TYPE_LIDAR,
-        .next_id = 0
+        .next_id = 0,
+        .grid_id = grid_id
     };
 
-    for(sensor_record_t* record = next_sensor_record(&it); record; record = next_sensor_record(&it))
+    for(sensor_record_t* record = next_detecting_sensor_record(&it); record; record = next_detecting_sensor_record(&it))
     {
-        lidar_on_second_evt(record);
+        lidar_on_second_evt(grid_id, record);
     }
 }
 
-static void lidar_on_second_evt(sensor_record_t const * record)
+static void lidar_on_second_evt(uint8_t grid_id, sensor_record_t * record)
 {
-    /* Translate into an abstract detection: */
-    abstract_lidar_detection_t detection;
-    sensor_record_to_lidar_detection(record, &detection);
-
-    if(detection.region == LIDAR_REGION_REGION_NONE)
+    if(record->detection_status == LIDAR_REGION_REGION_NONE)
     {
-        /* Not detecting, don't send event. */
+        /* Not detecting, no growth. */
         return;
     }
 
-    /* Still detecting, send a trickle event. */
-    abstract_sensor_detection_t abstract_detection;
-    memset(&abstract_detection, 0, sizeof(abstract_detection));
-    abstract_detection.xpos = detection.xpos;
-    abstract_detection.ypos = detection.ypos;
-    abstract_detection.rotation = detection.direction;
-    generate_trickle_constants(&detection, &abstract_detection.constants);
+    sensor_plan_t const * plan = get_lidar_plan(grid_id, record);
+
+    if(plan == NULL)
+    {
+        /* We don't know where this event came from, but we should because it's detecting.*/
+        APP_ERROR_CHECK(true);
+        return;
+    }
 
-    process_abstract_detection(&abstract_detection);
+    /* Still detecting, trickle growth in the region it was detected in. */
+    detection_plan_t const * region_plan = &(plan->regions[record->detection_status - LIDAR_REGION_REGION_0]);
+    apply_detection_plan(grid_id, region_plan, region_plan->trickle_factor);
 }
 
 /**
- * Calculate which region a lidar detection belongs to
- */ 
-static bool sensor_evt_to_lidar_detection(lidar_evt_data_t const * evt, abstract_lidar_detection_t* detection)
+ * Fetch the detection plan for a lidar record, compiling it first if the node positions have changed.
+ */
+static sensor_plan_t const * get_lidar_plan(uint8_t grid_id, sensor_record_t * record)
 {
-    memset(detection, 0, sizeof(abstract_lidar_detection_t));
-    /* The regions can shift around a lot due to the offset system, so we need 2 values:
-            - distance to first node
-            - distance to second node
-        keep in mind that either of those nodes may not exist, so we will populate a 'default' position for them in that case */
-    mm_node_position_t const * position = get_position_for_node(evt->node_id);
+    sensor_plan_t* plan = &(record->plan);
 
+    if(plan->is_compiled)
+    {
+        return plan;
+    }
+
+    mm_node_position_t const * position = mm_sensor_registry_get_position(grid_id, record->handle);
 
     if(position == NULL)
     {
-        /* Unknown position, therefore invalid event. */
-        return false;
+        /* We don't know where this sensor is, try again after the next position update. */
+        return NULL;
     }
 
+    memset(plan, 0, sizeof(sensor_plan_t));
+    /* The regions can shift around a lot due to the offset system, so we need 2 values:
+            - distance to first node
+            - distance to second node
+        keep in mind that either of those nodes may not exist, so we will populate a 'default' position for them in that case */
+
     /* Figure out what direction the lidar is pointing in. */
-    total_rotation_t rotation = (evt->sensor_rotation + position->node_rotation) % TOTAL_ROTATION_360;
+    total_rotation_t rotation = (record->sensor_rotation + position->node_rotation) % TOTAL_ROTATION_360;
     int8_t dx = 0;
     int8_t dy = 0;
     get_grid_direction(rotation, &dx, &dy);
@@ -214,8 +220,8 @@ static bool sensor_evt_to_lidar_detection(lidar_evt_data_t const * evt, abstract
     mm_node_position_t position_2_forward;
     int8_t x = position->grid_position_x;
     int8_t y = position->grid_position_y;
-    fetch_or_mock_node_position(x + 1 * dx, y + 1 * dy, &position_1_forward);
-    fetch_or_mock_node_position(x + 2 * dx, y + 2 * dy, &position_2_forward);
+    fetch_or_mock_node_position(grid_id, x + 1 * dx, y + 1 * dy, &position_1_forward);
+    fetch_or_mock_node_position(grid_id, x + 2 * dx, y + 2 * dy, &position_2_forward);
 
     /* Fetch relevant offsets for distance calculation: */
     int8_t node_0_forward_offset = 0;
@@ -229,87 +235,67 @@ static bool sensor_evt_to_lidar_detection(lidar_evt_data_t const * evt, abstract
     node_1_forward_offset += dy * position_1_forward.grid_offset_y;
     node_2_forward_offset += dy * position_2_forward.grid_offset_y;
 
-    uint16_t distance_to_1_node_cm = NODE_SEPERATION_CM + (node_1_forward_offset - node_0_forward_offset) * NODE_OFFSET_SCALE_CM;
-    uint16_t distance_to_2_node_cm = 2 * NODE_SEPERATION_CM + (node_2_forward_offset - node_0_forward_offset) * NODE_OFFSET_SCALE_CM;
+    plan->region_limits_cm[0] = NODE_SEPERATION_CM + (node_1_forward_offset - node_0_forward_offset) * NODE_OFFSET_SCALE_CM;
+    plan->region_limits_cm[1] = 2 * NODE_SEPERATION_CM + (node_2_forward_offset - node_0_forward_offset) * NODE_OFFSET_SCALE_CM;
+
+    /* Region 0 is in front of the lidar, region 1 is one node further on. */
+    compile_lidar_region(grid_id, x, y, rotation, &(plan->regions[0]));
+    compile_lidar_region(grid_id, x + dx, y + dy, rotation, &(plan->regions[1]));
 
-    /* Now we know distances to both regions... is the distance within it? */
-    uint16_t distance_measured = evt->distance_measured;
+    plan->is_compiled = true;
+
+    return plan;
+}
 
-    if(distance_measured < distance_to_1_node_cm)
+/**
+ * Calculate which region a measured distance falls in using a compiled plan.
+ */
+static lidar_region_t get_lidar_region(sensor_plan_t const * plan, uint16_t distance_measured)
+{
+    if(distance_measured < plan->region_limits_cm[0])
     {
-        detection->region = LIDAR_REGION_REGION_0;
-        detection->xpos = x;
-        detection->ypos = y;
-        detection->direction = rotation;
+        return LIDAR_REGION_REGION_0;
     }
-    else if(distance_measured < distance_to_2_node_cm)
+    else if(distance_measured < plan->region_limits_cm[1])
     {
-        detection->region = LIDAR_REGION_REGION_1;
-        detection->xpos = x + dx;
-        detection->ypos = y + dy;
-        detection->direction = rotation;
+        return LIDAR_REGION_REGION_1;
     }
     else
     {
-        detection->region = LIDAR_REGION_REGION_NONE;    
-    }
-
-    if( ( detection->xpos < -1 || detection->xpos > 1 ) ||
-        ( detection->ypos < -1 || detection->ypos > 1 ) )
-    {
-        /* Detection falls outside the network, so it isn't valid. */
-        return false;
+        return LIDAR_REGION_REGION_NONE;
     }
-
-    return true;
 }
 
 /**
- * Fetch a virtual location for a lidar detection using the detection region and the original sensor position.
+ * Compile the plan for one lidar region, the region is left invalid if it falls outside the network.
  */
-static void sensor_record_to_lidar_detection(sensor_record_t const * record, abstract_lidar_detection_t* detection)
+static void compile_lidar_region(uint8_t grid_id, int8_t x, int8_t y, total_rotation_t rotation, detection_plan_t* region_plan)
 {
-    memset(detection, 0, sizeof(abstract_lidar_detection_t));
-
-    detection->region = record->detection_status;
+    memset(region_plan, 0, sizeof(detection_plan_t));
 
-    if(record->detection_status == LIDAR_REGION_REGION_NONE)
+    if( ( x < GRID_POSITION_MIN_X || x > GRID_POSITION_MAX_X ) ||
+        ( y < GRID_POSITION_MIN_Y || y > GRID_POSITION_MAX_Y ) )
     {
-        /* No detection, so no need to know where it came from. */
+        /* Region falls outside the network, detections in it aren't valid. */
         return;
     }
 
-    mm_node_position_t const * position = get_position_for_node(record->node_id);
-    total_rotation_t rotation = (record->sensor_rotation + position->node_rotation) % TOTAL_ROTATION_360;
-    detection->direction = rotation;
+    activity_variable_sensor_constants_t growth_constants;
+    activity_variable_sensor_constants_t trickle_constants;
+    generate_growth_constants(grid_id, y, &growth_constants);
+    generate_trickle_constants(grid_id, y, &trickle_constants);
 
-    int8_t x = position->grid_position_x;
-    int8_t y = position->grid_position_y;
-
-    if(record->detection_status == LIDAR_REGION_REGION_0)
-    {
-        /* If first region, it came from the original position. */
-        detection->xpos = x;
-        detection->ypos = y;   
-        return;
-    }
-
-    /* Now we need to mock out a position in the direction of the sensor: */
-    int8_t dx = 0;
-    int8_t dy = 0;
-    get_grid_direction(rotation, &dx, &dy);
-
-    detection->xpos = x + dx;
-    detection->ypos = y + dy;   
+    compile_detection_plan(grid_id, x, y, rotation, &growth_constants, &trickle_constants, region_plan);
 }
 
-static void fetch_or_mock_node_position(int8_t x, int8_t y, mm_node_position_t* position_out)
+static void fetch_or_mock_node_position(uint8_t grid_id, int8_t x, int8_t y, mm_node_position_t* position_out)
 {
-    mm_node_position_t const * p_position = get_node_for_position(x, y);
+    mm_node_position_t const * p_position = get_node_for_position(grid_id, x, y);
 
     if(p_position == NULL)
     {
         memset(position_out, 0, sizeof(mm_node_position_t));
+        position_out->grid_id = grid_id;
         position_out->grid_position_x = x;
         position_out->grid_position_y = y;
     }
@@ -319,52 +305,54 @@ static void fetch_or_mock_node_position(int8_t x, int8_t y, mm_node_position_t*
     }
 }
 
-static void generate_growth_constants(abstract_lidar_detection_t const * detection, activity_variable_sensor_constants_t* constants)
+static void generate_growth_constants(uint8_t grid_id, int8_t ypos, activity_variable_sensor_constants_t* constants)
 {
     memset(constants, 0, sizeof(activity_variable_sensor_constants_t));
 
-    constants->common_sensor_weight_factor = mm_sensor_algorithm_config()->common_sensor_weight_factor;
-    constants->base_sensor_weight_factor   = mm_sensor_algorithm_config()->base_sensor_weight_factor_lidar;
+    constants->common_sensor_weight_factor = mm_sensor_algorithm_config(grid_id)->common_sensor_weight_factor;
+    constants->base_sensor_weight_factor   = mm_sensor_algorithm_config(grid_id)->base_sensor_weight_factor_lidar;
 
-    switch(detection->ypos)
+    /* Rows further than two from the road share the last proximity factor. */
+    int8_t road_distance = GRID_POSITION_MAX_Y - ypos;
+
+    switch(road_distance)
     {
-        case 1:
-            constants->road_proximity_factor = mm_sensor_algorithm_config()->road_proximity_factor_0;
-            break;
         case 0:
-            constants->road_proximity_factor = mm_sensor_algorithm_config()->road_proximity_factor_1;
+            constants->road_proximity_factor = mm_sensor_algorithm_config(grid_id)->road_proximity_factor_0;
             break;
-        case -1:
-            constants->road_proximity_factor = mm_sensor_algorithm_config()->road_proximity_factor_2;
+        case 1:
+            constants->road_proximity_factor = mm_sensor_algorithm_config(grid_id)->road_proximity_factor_1;
             break;
         default:
             /* Invalid grid position given grid height */
-            APP_ERROR_CHECK(true);
+            APP_ERROR_CHECK(road_distance < 0);
+            constants->road_proximity_factor = mm_sensor_algorithm_config(grid_id)->road_proximity_factor_2;
             break;
     }
 }
 
-static void generate_trickle_constants(abstract_lidar_detection_t const * detection, activity_variable_sensor_constants_t* constants)
+static void generate_trickle_constants(uint8_t grid_id, int8_t ypos, activity_variable_sensor_constants_t* constants)
 {
     memset(constants, 0, sizeof(activity_variable_sensor_constants_t));
 
-    constants->common_sensor_weight_factor = mm_sensor_algorithm_config()->common_sensor_trickle_factor;
-    constants->base_sensor_weight_factor   = mm_sensor_algorithm_config()->base_sensor_trickle_factor_lidar;
+    constants->common_sensor_weight_factor = mm_sensor_algorithm_config(grid_id)->common_sensor_trickle_factor;
+    constants->base_sensor_weight_factor   = mm_sensor_algorithm_config(grid_id)->base_sensor_trickle_factor_lidar;
 
-    switch(detection->ypos)
+    /* Rows further than two from the road share the last proximity factor. */
+    int8_t road_distance = GRID_POSITION_MAX_Y - ypos;
+
+    switch(road_distance)
     {
-        case 1:
-            constants->road_proximity_factor = mm_sensor_algorithm_config()->road_trickle_proximity_factor_0;
-            break;
         case 0:
-            constants->road_proximity_factor = mm_sensor_algorithm_config()->road_trickle_proximity_factor_1;
+            constants->road_proximity_factor = mm_sensor_algorithm_config(grid_id)->road_trickle_proximity_factor_0;
             break;
-        case -1:
-            constants->road_proximity_factor = mm_sensor_algorithm_config()->road_trickle_proximity_factor_2;
+        case 1:
+            constants->road_proximity_factor = mm_sensor_algorithm_config(grid_id)->road_trickle_proximity_factor_1;
             break;
         default:
             /* Invalid grid position given grid height */
-            APP_ERROR_CHECK(true);
+            APP_ERROR_CHECK(road_distance < 0);
+            constants->road_proximity_factor = mm_sensor_algorithm_config(grid_id)->road_trickle_proximity_factor_2;
             break;
     }
 }
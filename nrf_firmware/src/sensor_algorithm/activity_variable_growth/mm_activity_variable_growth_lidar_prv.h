@@ -12,6 +12,7 @@ notes:
 
 #include "mm_sensor_transmission.h"
 #include "mm_sensor_algorithm_config.h"
+#include "mm_sensor_registry.h"
 
 /**********************************************************
                           TYPES
@@ -24,11 +25,11 @@ notes:
 /**
  * Translates a lidar detection event into an abstract detection event.
  */
-void translate_lidar_detection(sensor_evt_t const * sensor_evt);
+void translate_lidar_detection(uint8_t grid_id, sensor_evt_t const * sensor_evt, mm_sensor_handle_t handle);
 
 /**
  * Translates an on second event into 0 or more abstract detection events.
  */
-void translate_on_second_evt_lidar(void);
+void translate_on_second_evt_lidar(uint8_t grid_id);
 
 #endif /* MM_ACTIVITY_VARIABLE_GROWTH_LIDAR_PRV_H */
@@ -28,78 +28,63 @@ notes:
                           TYPES
 **********************************************************/
 
-typedef struct
-{
-    bool             detected;      /* Is the detction active. */
-    int8_t           xpos;          /* Effective detection position. */
-    int8_t           ypos;          /* Effective detection position.*/
-    total_rotation_t direction;     /* Effective detection direction. */
-} abstract_pir_detection_t;
-
 /**********************************************************
                        DECLARATIONS
 **********************************************************/
 
 /**
- * Calulate which AV region a pir detection occured in.
- * 
- * [out] which region, a position to consider the detection from, and a total direction of the detection
- * 
- * return false if evt was invalid.
- */
-static bool sensor_evt_to_pir_detection(pir_evt_data_t const * evt, abstract_pir_detection_t* detection);
-
-/**
- * Process a pir record, and send an abstract detection event out if the record is active.
+ * Fetch the detection plan for a pir record, compiling it first if the node positions have changed.
+ *
+ * return NULL if the node the pir is on doesn't have a position.
  */
-static void pir_on_second_evt(sensor_record_t const * record);
+static detection_plan_t const * get_pir_plan(uint8_t grid_id, sensor_record_t * record);
 
 /**
- * Fetch a virtual location for a pir detection using the detection region and the original sensor position.
+ * Process a pir record, and grow the activity variables if the record is active.
  */
-static void sensor_record_to_pir_detection(sensor_record_t const * record, abstract_pir_detection_t* detection);
+static void pir_on_second_evt(uint8_t grid_id, sensor_record_t * record);
 
 /**
  * Collect the constants that define how AVs grow in reponse to pir events.
  */
-static void generate_growth_constants(abstract_pir_detection_t const * detection, activity_variable_sensor_constants_t* constants);
+static void generate_growth_constants(uint8_t grid_id, int8_t ypos, activity_variable_sensor_constants_t* constants);
 
 /**
  * Collect the constants that define how AVs grow in reponse to second events while a pir is detecting.
  */
-static void generate_trickle_constants(abstract_pir_detection_t const * detection, activity_variable_sensor_constants_t* constants);
+static void generate_trickle_constants(uint8_t grid_id, int8_t ypos, activity_variable_sensor_constants_t* constants);
 
 /**********************************************************
                        DEFINITIONS
 **********************************************************/
 
 /**
- * Translates a pir detection event into an abstract detection event.
+ * Translates a pir detection event into activity variable growth.
  */
-void translate_pir_detection(sensor_evt_t const * sensor_evt)
+void translate_pir_detection(uint8_t grid_id, sensor_evt_t const * sensor_evt, mm_sensor_handle_t handle)
 {
     pir_evt_data_t const * evt = &(sensor_evt->pir_data);
 
-    /* Translate into an abstract detection: */
-    abstract_pir_detection_t detection;
-    if(!sensor_evt_to_pir_detection(evt, &detection))
+    /* Fetch the sensor record to compare against. */
+    sensor_record_t* record = get_sensor_record(grid_id, handle);
+
+    /* Look up where the detection applies: */
+    detection_plan_t const * plan = get_pir_plan(grid_id, record);
+    if(plan == NULL)
     {
         /* Invalid event. */
         return;
     }
 
     /* Is the sensor hyperactive and detection something? */
-    if(mm_sensor_error_is_sensor_hyperactive(sensor_evt) &&
+    if(mm_sensor_error_is_hyperactive(grid_id, handle) &&
        evt->detection)
     {
         /* If so, don't process further. */
         return;
     }
 
-    /* Fetch the sensor record to compare against. */
-    sensor_record_t* record = get_sensor_record(evt->node_id, evt->sensor_rotation, SENSOR_TYPE_PIR);
-
-    if(record->detection_status == detection.detected)
+    if(record->detection_status == evt->detection)
     {
         /* It isn't a new detection because it's the same data, no need to apply it. */
         return;
@@ -113,173 +98,155 @@ void translate_pir_detection(sensor_evt_t const * sensor_evt)
         evt->detection
         );
 
-    if(!detection.detected)
+    if(!evt->detection)
     {
         /* End of detection, modify record and stop processing it. */
-        record->detection_status = false;
+        set_sensor_record_detection_status(grid_id, record, false);
         return;
     }
 
-    /* By now it is a new detection, generate an abstract event to grow the activity variables. */
-    abstract_sensor_detection_t abstract_detection;
-    memset(&abstract_detection, 0, sizeof(abstract_detection));
-    abstract_detection.xpos = detection.xpos;
-    abstract_detection.ypos = detection.ypos;
-    abstract_detection.rotation = detection.direction;
-    generate_growth_constants(&detection, &abstract_detection.constants);
-
-    process_abstract_detection(&abstract_detection);
+    /* By now it is a new detection, grow the activity variables. */
+    apply_detection_plan(grid_id, plan, plan->growth_factor);
+    report_detection_plan(grid_id, plan);
 
     /* Update detection state. */
-    record->detection_status = true;
+    set_sensor_record_detection_status(grid_id, record, true);
 }
 
 /**
- * Translates an on second event into 0 or more abstract detection events.
+ * Translates an on second event into trickle growth for each detecting pir.
  */
-void translate_on_second_evt_pir(void)
+void translate_on_second_evt_pir(uint8_t grid_id)
 {
-    /* Iterate through pir records. */
+    /* Iterate through detecting pir records, idle ones have nothing to trickle. */
     sensor_record_iterator_t it =
     {
         .sensor_type = SENSOR_TYPE_PIR,
-        .next_id = 0
+        .next_id = 0,
+        .grid_id = grid_id
     };
 
-    for(sensor_record_t* record = next_sensor_record(&it); record; record = next_sensor_record(&it))
+    for(sensor_record_t* record = next_detecting_sensor_record(&it); record; record = next_detecting_sensor_record(&it))
     {
-        pir_on_second_evt(record);
+        pir_on_second_evt(grid_id, record);
     }
 }
 
-static void pir_on_second_evt(sensor_record_t const * record)
+static void pir_on_second_evt(uint8_t grid_id, sensor_record_t * record)
 {
-    /* Translate into an abstract detection: */
-    abstract_pir_detection_t detection;
-    sensor_record_to_pir_detection(record, &detection);
-
-    if(!detection.detected)
+    if(!record->detection_status)
     {
-        /* Not detecting, don't send event. */
+        /* Not detecting, no growth. */
         return;
     }
 
-    /* Still detecting, send a trickle event. */
-    abstract_sensor_detection_t abstract_detection;
-    memset(&abstract_detection, 0, sizeof(abstract_detection));
-    abstract_detection.xpos = detection.xpos;
-    abstract_detection.ypos = detection.ypos;
-    abstract_detection.rotation = detection.direction;
-    generate_trickle_constants(&detection, &abstract_detection.constants);
+    detection_plan_t const * plan = get_pir_plan(grid_id, record);
 
-    process_abstract_detection(&abstract_detection);
-}
-
-/**
- * Translate sensor event to an abstract pir detection event.
- */ 
-static bool sensor_evt_to_pir_detection(pir_evt_data_t const * evt, abstract_pir_detection_t* detection)
-{
-    memset(detection, 0, sizeof(abstract_pir_detection_t));
-
-    mm_node_position_t const * position = get_position_for_node(evt->node_id);
-
-    if(position == NULL)
+    if(plan == NULL)
     {
-        /* We don't know where this event came from */
-        return false;
+        /* We don't know where this event came from, but we should because it's detecting.*/
+        APP_ERROR_CHECK(true);
+        return;
     }
 
-    /* Figure out what direction the pir is pointing in. */
-    total_rotation_t rotation = (evt->sensor_rotation + position->node_rotation) % TOTAL_ROTATION_360;
-
-    /* Populate detection */
-    detection->xpos = position->grid_position_x;
-    detection->ypos = position->grid_position_y;
-    detection->direction = rotation;
-    detection->detected = evt->detection;
-
-    return true;
+    /* Still detecting, trickle growth. */
+    apply_detection_plan(grid_id, plan, plan->trickle_factor);
 }
 
 /**
- * Translate sensor record to an abstract pir detection event.
+ * Fetch the detection plan for a pir record, compiling it first if the node positions have changed.
  */
-static void sensor_record_to_pir_detection(sensor_record_t const * record, abstract_pir_detection_t* detection)
+static detection_plan_t const * get_pir_plan(uint8_t grid_id, sensor_record_t * record)
 {
-    memset(detection, 0, sizeof(abstract_pir_detection_t));
+    sensor_plan_t* plan = &(record->plan);
 
-    if(!record->detection_status)
+    if(plan->is_compiled)
     {
-        /* No detection, so no need to know where it came from. */
-        return;
+        return &(plan->regions[0]);
     }
 
-    /* Figure out where the record is from. */
-    mm_node_position_t const * position = get_position_for_node(record->node_id);
+    mm_node_position_t const * position = mm_sensor_registry_get_position(grid_id, record->handle);
 
     if(position == NULL)
     {
-        /* We don't know where this event came from, but we should because it's detecting.*/
-        APP_ERROR_CHECK(true);
-        return;
+        /* We don't know where this sensor is, try again after the next position update. */
+        return NULL;
     }
 
+    memset(plan, 0, sizeof(sensor_plan_t));
+
+    /* Figure out what direction the pir is pointing in. */
     total_rotation_t rotation = (record->sensor_rotation + position->node_rotation) % TOTAL_ROTATION_360;
 
-    /* Populate detection */
-    detection->xpos = position->grid_position_x;
-    detection->ypos = position->grid_position_y;
-    detection->direction = rotation;
-    detection->detected = true;
+    activity_variable_sensor_constants_t growth_constants;
+    activity_variable_sensor_constants_t trickle_constants;
+    generate_growth_constants(grid_id, position->grid_position_y, &growth_constants);
+    generate_trickle_constants(grid_id, position->grid_position_y, &trickle_constants);
+
+    compile_detection_plan
+        (
+        grid_id,
+        position->grid_position_x,
+        position->grid_position_y,
+        rotation,
+        &growth_constants,
+        &trickle_constants,
+        &(plan->regions[0])
+        );
+
+    plan->is_compiled = true;
+
+    return &(plan->regions[0]);
 }
 
-static void generate_growth_constants(abstract_pir_detection_t const * detection, activity_variable_sensor_constants_t* constants)
+static void generate_growth_constants(uint8_t grid_id, int8_t ypos, activity_variable_sensor_constants_t* constants)
 {
     memset(constants, 0, sizeof(activity_variable_sensor_constants_t));
 
-    constants->common_sensor_weight_factor = mm_sensor_algorithm_config()->common_sensor_weight_factor;
-    constants->base_sensor_weight_factor   = mm_sensor_algorithm_config()->base_sensor_weight_factor_pir;
+    constants->common_sensor_weight_factor = mm_sensor_algorithm_config(grid_id)->common_sensor_weight_factor;
+    constants->base_sensor_weight_factor   = mm_sensor_algorithm_config(grid_id)->base_sensor_weight_factor_pir;
 
-    switch(detection->ypos)
+    /* Rows further than two from the road share the last proximity factor. */
+    int8_t road_distance = GRID_POSITION_MAX_Y - ypos;
+
+    switch(road_distance)
     {
-        case 1:
-            constants->road_proximity_factor = mm_sensor_algorithm_config()->road_proximity_factor_0;
-            break;
         case 0:
-            constants->road_proximity_factor = mm_sensor_algorithm_config()->road_proximity_factor_1;
+            constants->road_proximity_factor = mm_sensor_algorithm_config(grid_id)->road_proximity_factor_0;
             break;
-        case -1:
-            constants->road_proximity_factor = mm_sensor_algorithm_config()->road_proximity_factor_2;
+        case 1:
+            constants->road_proximity_factor = mm_sensor_algorithm_config(grid_id)->road_proximity_factor_1;
             break;
         default:
             /* Invalid grid position given grid height */
-            APP_ERROR_CHECK(true);
+            APP_ERROR_CHECK(road_distance < 0);
+            constants->road_proximity_factor = mm_sensor_algorithm_config(grid_id)->road_proximity_factor_2;
             break;
     }
 }
 
-static void generate_trickle_constants(abstract_pir_detection_t const * detection, activity_variable_sensor_constants_t* constants)
+static void generate_trickle_constants(uint8_t grid_id, int8_t ypos, activity_variable_sensor_constants_t* constants)
 {
     memset(constants, 0, sizeof(activity_variable_sensor_constants_t));
 
-    constants->common_sensor_weight_factor = mm_sensor_algorithm_config()->common_sensor_trickle_factor;
-    constants->base_sensor_weight_factor   = mm_sensor_algorithm_config()->base_sensor_trickle_factor_pir;
+    constants->common_sensor_weight_factor = mm_sensor_algorithm_config(grid_id)->common_sensor_trickle_factor;
+    constants->base_sensor_weight_factor   = mm_sensor_algorithm_config(grid_id)->base_sensor_trickle_factor_pir;
+
+    /* Rows further than two from the road share the last proximity factor. */
+    int8_t road_distance = GRID_POSITION_MAX_Y - ypos;
 
-    switch(detection->ypos)
+    switch(road_distance)
     {
-        case 1:
-            constants->road_proximity_factor = mm_sensor_algorithm_config()->road_trickle_proximity_factor_0;
-            break;
         case 0:
-            constants->road_proximity_factor = mm_sensor_algorithm_config()->road_trickle_proximity_factor_1;
+            constants->road_proximity_factor = mm_sensor_algorithm_config(grid_id)->road_trickle_proximity_factor_0;
             break;
-        case -1:
-            constants->road_proximity_factor = mm_sensor_algorithm_config()->road_trickle_proximity_factor_2;
+        case 1:
+            constants->road_proximity_factor = mm_sensor_algorithm_config(grid_id)->road_trickle_proximity_factor_1;
             break;
         default:
             /* Invalid grid position given grid height */
-            APP_ERROR_CHECK(true);
+            APP_ERROR_CHECK(road_distance < 0);
+            constants->road_proximity_factor = mm_sensor_algorithm_config(grid_id)->road_trickle_proximity_factor_2;
             break;
     }
 }
@@ -11,6 +11,13 @@ notes:
 **********************************************************/
 
 #include "mm_activity_variable_growth.h"
+#include "mm_activity_variables.h"
+
+/**********************************************************
+                        CONSTANTS
+**********************************************************/
+
+#define MAX_ADJACENT_ACTIVITY_VARIABLES ( 2 )   /* The max number of regions a sensor can affect per detection. */
 
 /**********************************************************
                           TYPES
@@ -40,20 +47,51 @@ typedef struct
 
 typedef struct
 {
-    int8_t xpos;                    /* Where the detection came from. */
-    int8_t ypos;                    /* Where the detection came from.*/
-    total_rotation_t rotation;      /* Which direction the detection came from. */
-    activity_variable_sensor_constants_t constants; /* Constants to use while applying the detection. */
-} abstract_sensor_detection_t;
+    mm_activity_variable_t* avs[MAX_ADJACENT_ACTIVITY_VARIABLES];
+    uint8_t                 av_count;
+} activity_variable_set_t;
+
+/**
+ * Everything needed to apply a detection from one place in one direction,
+ * worked out ahead of time so applying it is just a multiply per AV.
+ */
+typedef struct
+{
+    activity_variable_set_t av_set;         /* Which AVs the detection applies to. */
+    float                   growth_factor;  /* Product of the growth constants. */
+    float                   trickle_factor; /* Product of the trickle constants. */
+    bool                    is_valid;       /* False if the detection falls outside the network. */
+} detection_plan_t;
 
 /**********************************************************
                        DECLARATIONS
 **********************************************************/
 
 /**
- * Processes an abstract detection.
+ * Work out which AVs a detection from (xpos, ypos) facing rotation applies to, and
+ * collapse the growth and trickle constants into single factors.
+ */
+void compile_detection_plan
+    (
+    uint8_t grid_id,
+    int8_t xpos,
+    int8_t ypos,
+    total_rotation_t rotation,
+    activity_variable_sensor_constants_t const * growth_constants,
+    activity_variable_sensor_constants_t const * trickle_constants,
+    detection_plan_t* plan
+    );
+
+/**
+ * Grow the AVs in a plan by factor, either the plan's growth or trickle factor.
+ */
+void apply_detection_plan(uint8_t grid_id, detection_plan_t const * plan, float factor);
+
+/**
+ * Report a new detection covering the AVs in a plan to the trajectory tracker
+ * and the wildlife statistics.
  */
-void process_abstract_detection(abstract_sensor_detection_t* detection);
+void report_detection_plan(uint8_t grid_id, detection_plan_t const * plan);
 
 /**
  * Get the direction along the grid in a [rotation] direction.
@@ -15,20 +15,29 @@ notes:
 #include "app_error.h"
 
 #include "mm_activity_variable_growth_sensor_records_prv.h"
-
-/**********************************************************
-                        MACROS
-**********************************************************/
+#include "mm_wildlife_statistics.h"
 
 /**********************************************************
                           TYPES
 **********************************************************/
 
+/**
+ * Sensor records for one grid.
+ */
+typedef struct
+{
+    sensor_record_t     sensor_records[MAX_SENSOR_HANDLES];
+
+    /* Indices of records with a non-default detection status, in ascending order. */
+    uint16_t            detecting_records[MAX_SENSOR_HANDLES];
+    uint16_t            detecting_count;
+} sensor_record_instance_t;
+
 /**********************************************************
                        VARIABLES
 **********************************************************/
 
-static sensor_record_t      sensor_records[MAX_SENSOR_COUNT];
+static sensor_record_instance_t instances[MAX_SENSOR_GRIDS];
 
 
 /**********************************************************
@@ -42,76 +51,136 @@ static sensor_record_t      sensor_records[MAX_SENSOR_COUNT];
 /**
  * Initialize all sensor records to default values.
  */
-void init_sensor_records(void)
+void init_sensor_records(uint8_t grid_id)
 {
-    memset(&(sensor_records[0]), 0, sizeof(sensor_records));
+    memset(&(instances[grid_id].sensor_records[0]), 0, sizeof(instances[grid_id].sensor_records));
+    instances[grid_id].detecting_count = 0;
 }
 
 /**
- * Fetch a detection record for a sensor, create one if needed.
+ * Fetch the detection record for a sensor handle, create one if needed.
  */ 
-sensor_record_t* get_sensor_record(uint16_t node_id, sensor_rotation_t sensor_rotation, sensor_type_t sensor_type)
+sensor_record_t* get_sensor_record(uint8_t grid_id, mm_sensor_handle_t handle)
 {  
-    sensor_record_t * empty = NULL; 
-    for(uint16_t i = 0; i < MAX_SENSOR_COUNT; ++i)
+    APP_ERROR_CHECK(handle >= MAX_SENSOR_HANDLES);
+
+    /* Records are indexed by handle. */
+    sensor_record_t * record = &(instances[grid_id].sensor_records[handle]);
+
+    if(record->is_valid)
     {
-        sensor_record_t * record = &(sensor_records[i]);
+        /* Existing record */
+        return record;
+    }
 
-        if(!record->is_valid)
-        {
-            /* Grab an empty slot while we're here */
-            if(NULL == empty)
-            {
-                empty = record;
-            }
+    /* Return a new record. */
+    mm_sensor_registry_entry_t const * sensor = mm_sensor_registry_get(grid_id, handle);
+
+    memset(record, 0, sizeof(sensor_record_t));
+    record->handle = handle;
+    record->node_id = sensor->node_id;
+    record->sensor_rotation = sensor->sensor_rotation;
+    record->sensor_type = sensor->sensor_type;
+    record->detection_status = 0; /*Default. */
+    record->is_valid = true;
+    return record;
+}
 
-            continue;
-        }
+sensor_record_t* next_sensor_record(sensor_record_iterator_t* iterator)
+{
+    uint8_t grid_id = iterator->grid_id;
 
-        if(record->node_id != node_id)
+    for(uint16_t i = iterator->next_id; i < MAX_SENSOR_HANDLES; ++i)
+    {
+        if(instances[grid_id].sensor_records[i].sensor_type == iterator->sensor_type &&
+           instances[grid_id].sensor_records[i].is_valid)
         {
-            continue;
+            iterator->next_id = i + 1;
+            return &instances[grid_id].sensor_records[i];
         }
+    }
 
-        if(record->sensor_rotation != sensor_rotation)
-        {
-            continue;
-        }
+    iterator->next_id = UINT16_MAX;
+    return NULL;
+}
+
+/**
+ * Update the detection status of a record, tracking which records are detecting.
+ */
+void set_sensor_record_detection_status(uint8_t grid_id, sensor_record_t* record, uint8_t detection_status)
+{
+    uint16_t index = record - &(instances[grid_id].sensor_records[0]);
+    APP_ERROR_CHECK(index >= MAX_SENSOR_HANDLES);
+
+    bool was_detecting = (record->detection_status != 0);
+    bool is_detecting = (detection_status != 0);
+    record->detection_status = detection_status;
 
-        if(record->sensor_type != sensor_type)
+    if(is_detecting && !was_detecting)
+    {
+        /* Insert in order, shuffling larger indices up. */
+        uint16_t i = instances[grid_id].detecting_count;
+        while(i > 0 && instances[grid_id].detecting_records[i - 1] > index)
         {
-            continue;
+            instances[grid_id].detecting_records[i] = instances[grid_id].detecting_records[i - 1];
+            i--;
         }
 
-        /* Existing record */
-        return record;
+        instances[grid_id].detecting_records[i] = index;
+        instances[grid_id].detecting_count++;
+
+        mm_wildlife_statistics_on_detection_start(grid_id, record->handle);
     }
+    else if(!is_detecting && was_detecting)
+    {
+        /* Remove, shuffling larger indices down. */
+        uint16_t i = 0;
+        while(instances[grid_id].detecting_records[i] != index)
+        {
+            i++;
+        }
 
-    /* No existing record, should have grabbed a slot while looking */
-    APP_ERROR_CHECK(!empty);
+        instances[grid_id].detecting_count--;
+        memmove(&instances[grid_id].detecting_records[i], &instances[grid_id].detecting_records[i + 1], (instances[grid_id].detecting_count - i) * sizeof(instances[grid_id].detecting_records[0]));
 
-    /* Return a new record. */
-    memset(empty, 0, sizeof(sensor_record_t));
-    empty->node_id = node_id;
-    empty->sensor_rotation = sensor_rotation;
-    empty->sensor_type = sensor_type;
-    empty->detection_status = 0; /*Default. */
-    empty->is_valid = true;
-    return empty;
+        mm_wildlife_statistics_on_detection_end(grid_id, record->handle);
+    }
 }
 
-sensor_record_t* next_sensor_record(sensor_record_iterator_t* iterator)
+sensor_record_t* next_detecting_sensor_record(sensor_record_iterator_t* iterator)
 {
-    for(uint16_t i = iterator->next_id; i < MAX_SENSOR_COUNT; ++i)
+    uint8_t grid_id = iterator->grid_id;
+
+    for(uint16_t i = iterator->next_id; i < instances[grid_id].detecting_count; ++i)
     {
-        if(sensor_records[i].sensor_type == iterator->sensor_type &&
-           sensor_records[i].is_valid)
+        sensor_record_t* record = &instances[grid_id].sensor_records[instances[grid_id].detecting_records[i]];
+
+        if(record->sensor_type == iterator->sensor_type)
         {
             iterator->next_id = i + 1;
-            return &sensor_records[i];
+            return record;
         }
     }
 
     iterator->next_id = UINT16_MAX;
     return NULL;
+}
+
+/**
+ * Check if any sensor record has a non-default detection status.
+ */
+bool any_sensor_record_detecting(uint8_t grid_id)
+{
+    return (instances[grid_id].detecting_count != 0);
+}
+
+/**
+ * Mark every record's plan as out of date so it is compiled again on next use.
+ */
+void invalidate_sensor_plans(uint8_t grid_id)
+{
+    for(uint16_t i = 0; i < MAX_SENSOR_HANDLES; ++i)
+    {
+        instances[grid_id].sensor_records[i].plan.is_compiled = false;
+    }
 }
\ No newline at end of file
@@ -12,17 +12,37 @@ notes:
 
 #include "mm_sensor_transmission.h"
 #include "mm_sensor_algorithm_config.h"
+#include "mm_sensor_registry.h"
+#include "mm_activity_variable_growth_prv.h"
+
+/**********************************************************
+                        CONSTANTS
+**********************************************************/
+
+#define MAX_SENSOR_PLAN_REGIONS ( 2 )   /* A lidar can place a detection in one of two regions. */
 
 /**********************************************************
                           TYPES
 **********************************************************/
 
+/**
+ * A sensor's detections worked out ahead of time from its position.
+ */
 typedef struct
 {
+    uint16_t          region_limits_cm[MAX_SENSOR_PLAN_REGIONS];  /* Lidar only, region i covers distances below region_limits_cm[i]. */
+    detection_plan_t  regions[MAX_SENSOR_PLAN_REGIONS];           /* Pir only uses region 0. */
+    bool              is_compiled;
+} sensor_plan_t;
+
+typedef struct
+{
+    mm_sensor_handle_t handle;
     uint16_t          node_id;
     sensor_type_t     sensor_type;
     sensor_rotation_t sensor_rotation;
     uint8_t           detection_status; /* User defined status byte, 0 default. */
+    sensor_plan_t     plan;             /* Compiled by the sensor type on first use. */
     bool is_valid;
 } sensor_record_t;
 
@@ -30,6 +50,7 @@ typedef struct
 {
     sensor_type_t sensor_type;
     uint16_t      next_id;  
+    uint8_t       grid_id;
 } sensor_record_iterator_t;
 
 /**********************************************************
@@ -39,21 +60,45 @@ typedef struct
 /**
  * Initialize all sensor records to default values.
  */
-void init_sensor_records(void);
+void init_sensor_records(uint8_t grid_id);
 
 /**
- * Fetch a detection record for a sensor, create one if needed.
+ * Fetch the detection record for a sensor handle, create one if needed.
  */ 
-sensor_record_t* get_sensor_record(uint16_t node_id, sensor_rotation_t sensor_rotation, sensor_type_t sensor_type);
+sensor_record_t* get_sensor_record(uint8_t grid_id, mm_sensor_handle_t handle);
 
 /**
  * Iterate through sensor records for specific sensor types.
  * 
- * sensor_record_iterator_t it = { SENSOR_TYPE_XXX, 0 };
+ * sensor_record_iterator_t it = { SENSOR_TYPE_XXX, 0, grid_id };
  * sensor_record_t* item = next_sensor_record(&it);
  * 
  * Returns NULL after list has been exhausted.
  */ 
 sensor_record_t* next_sensor_record(sensor_record_iterator_t* iterator);
 
+/**
+ * Update the detection status of a record. Always use this rather than
+ * writing detection_status directly so detecting records can be tracked.
+ */
+void set_sensor_record_detection_status(uint8_t grid_id, sensor_record_t* record, uint8_t detection_status);
+
+/**
+ * Iterate through sensor records for specific sensor types that have a
+ * non-default detection status. Same usage as next_sensor_record.
+ *
+ * Returns NULL after list has been exhausted.
+ */
+sensor_record_t* next_detecting_sensor_record(sensor_record_iterator_t* iterator);
+
+/**
+ * Check if any sensor record has a non-default detection status.
+ */
+bool any_sensor_record_detecting(uint8_t grid_id);
+
+/**
+ * Mark every record's plan as out of date so it is compiled again on next use.
+ */
+void invalidate_sensor_plans(uint8_t grid_id);
+
 #endif /* MM_ACTIVITY_VARIABLE_GROWTH_SENSOR_RECORDS_PRV_H */
\ No newline at end of file
@@ -12,29 +12,95 @@
 #include "mm_activity_variable_drain.h"
 #include "mm_activity_variables.h"
 
+/**********************************************************
+                       DEFINITIONS
+**********************************************************/
+
+/**
+    Applies the activity variable drain factor to a single value.
+*/
+static void apply_drain_factor(uint8_t grid_id, mm_activity_variable_t * p_av);
+
 /**********************************************************
                        DECLARATIONS
 **********************************************************/
 
 /**
-    Applies the activity variable drain factor to all activity variables.
+    Applies the activity variable drain factor to all of a grid's activity variables.
+*/
+void mm_apply_activity_variable_drain_factor(uint8_t grid_id)
+{
+    /* Anything that finished draining last second has already been seen
+       at the minimum by everyone, so it can stop being processed. */
+    mm_av_prune_inactive(grid_id);
+
+    uint8_t x;
+    uint8_t y;
+    mm_av_iterator_t it;
+    mm_av_iterator_init(grid_id, &it);
+
+    while ( mm_av_iterator_next(&it, &x, &y) )
+    {
+        apply_drain_factor(grid_id, &AV(grid_id, x, y));
+    }
+}
+
+/**
+    Counts how many more drain factor applications it will take before
+    any of a grid's activity variables changes state. Returns max_seconds
+    if none will change state within that time.
 */
-void mm_apply_activity_variable_drain_factor(void)
+uint32_t mm_activity_variable_drain_seconds_until_state_change(uint8_t grid_id, uint32_t max_seconds)
 {
-    for ( uint8_t x = 0; x < MAX_AV_SIZE_X; x++ )
+    uint32_t seconds = max_seconds;
+
+    uint8_t x;
+    uint8_t y;
+    mm_av_iterator_t it;
+    mm_av_iterator_init(grid_id, &it);
+
+    while ( mm_av_iterator_next(&it, &x, &y) )
     {
-        for ( uint8_t y = 0; y < MAX_AV_SIZE_Y; y++ )
+        /* Run the drain forward on a copy, the exact same operations are
+           applied so the result matches what the real drain will do. */
+        bool is_roadside = ( y == AV_RS_THRESHOLD_ROW );
+        mm_activity_variable_t av = AV(grid_id, x, y);
+        activity_variable_state_t state = mm_get_status_for_av_value(grid_id, av, is_roadside);
+
+        for ( uint32_t i = 1; i < seconds; i++ )
         {
-            if ( AV(x, y) > mm_sensor_algorithm_config()->activity_variable_min )
+            if ( av <= mm_sensor_algorithm_config(grid_id)->activity_variable_min )
             {
-                AV(x, y) *= mm_sensor_algorithm_config()->activity_variable_decay_factor;
+                /* Fully drained, nothing more will happen. */
+                break;
+            }
+
+            apply_drain_factor(grid_id, &av);
 
-                /* Enforce ACTIVITY_VARIABLE_MIN */
-                if ( AV(x, y) < mm_sensor_algorithm_config()->activity_variable_min )
-                {
-                    AV(x, y) = mm_sensor_algorithm_config()->activity_variable_min;
-                }
+            if ( mm_get_status_for_av_value(grid_id, av, is_roadside) != state )
+            {
+                seconds = i;
+                break;
             }
         }
     }
+
+    return seconds;
+}
+
+/**
+    Applies the activity variable drain factor to a single value.
+*/
+static void apply_drain_factor(uint8_t grid_id, mm_activity_variable_t * p_av)
+{
+    if ( *p_av > mm_sensor_algorithm_config(grid_id)->activity_variable_min )
+    {
+        *p_av *= mm_sensor_algorithm_config(grid_id)->activity_variable_decay_factor;
+
+        /* Enforce ACTIVITY_VARIABLE_MIN */
+        if ( *p_av < mm_sensor_algorithm_config(grid_id)->activity_variable_min )
+        {
+            *p_av = mm_sensor_algorithm_config(grid_id)->activity_variable_min;
+        }
+    }
 }
@@ -19,8 +19,15 @@
 **********************************************************/
 
 /**
-    Applies the activity variable drain factor to all activity variables.
+    Applies the activity variable drain factor to all of a grid's activity variables.
 */
-void mm_apply_activity_variable_drain_factor(void);
+void mm_apply_activity_variable_drain_factor(uint8_t grid_id);
+
+/**
+    Counts how many more drain factor applications it will take before
+    any of a grid's activity variables changes state. Returns max_seconds
+    if none will change state within that time.
+*/
+uint32_t mm_activity_variable_drain_seconds_until_state_change(uint8_t grid_id, uint32_t max_seconds);
 
 #endif /* MM_ACTIVITY_VARIABLE_DRAIN_H */
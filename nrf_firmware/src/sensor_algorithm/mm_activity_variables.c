@@ -13,82 +13,251 @@ notes:
 #include <stdbool.h>
 #include <stdlib.h>
 
-#include "mm_activity_variables.h"
+#include "app_error.h"
 
-/**********************************************************
-                        MACROS
-**********************************************************/
+#include "mm_activity_variables.h"
 
 /**********************************************************
                           TYPES
 **********************************************************/
 
+/**
+    Activity variable state for one grid.
+*/
+typedef struct
+{
+    /**
+         Activity variable definition, can be accessed as AV(grid_id, x, y).
+
+         X is indexed left -> right. (In direction of North-American traffic)
+         Y is indexed top -> bottom. (Moving away from the road)
+
+         Variable (x, y) is located at activity_variables[y * MAX_AV_SIZE_X + x]
+    */
+    mm_activity_variable_t  activity_variables[ACTIVITY_VARIABLES_NUM];
+
+    /**
+         Indices of activity variables above the minimum, kept in ascending order so
+         processing happens in the same order as a full sweep would.
+    */
+    uint16_t                active_indices[ACTIVITY_VARIABLES_NUM];
+    uint16_t                active_count;
+    bool                    is_active[ACTIVITY_VARIABLES_NUM];
+} activity_variable_instance_t;
+
 /**********************************************************
                        VARIABLES
 **********************************************************/
 
-/**
-     Activity variable definition, can be accessed as AV(x, y).
-
-     X is indexed left -> right. (In direction of North-American traffic)
-     Y is indexed top -> bottom. (Moving away from the road)
-
-     Variable (x, y) is located at activity_variables[y * MAX_AV_SIZE_Y + x]
-*/
-static mm_activity_variable_t activity_variables[ACTIVITY_VARIABLES_NUM];
+static activity_variable_instance_t instances[MAX_SENSOR_GRIDS];
 
 /**********************************************************
                        DECLARATIONS
 **********************************************************/
 
+/**
+    Checks if activity variables sitting at the minimum are idle in every row.
+    If not, every activity variable needs processing, not just the active ones.
+*/
+static bool is_minimum_idle(uint8_t grid_id);
+
 /**********************************************************
                        DEFINITIONS
 **********************************************************/
 
-void mm_activity_variables_init(void)
+void mm_activity_variables_init(uint8_t grid_id)
 {
     /* Initialize activity variables. */
-    memset(&(activity_variables[0]), 0, sizeof(activity_variables));
+    memset(&(instances[grid_id].activity_variables[0]), 0, sizeof(instances[grid_id].activity_variables));
 
     for(uint16_t i = 0; i < ACTIVITY_VARIABLES_NUM; ++i)
     {
-        activity_variables[i] = mm_sensor_algorithm_config()->activity_variable_min;
+        instances[grid_id].activity_variables[i] = mm_sensor_algorithm_config(grid_id)->activity_variable_min;
     }
+
+    memset(&(instances[grid_id].is_active[0]), 0, sizeof(instances[grid_id].is_active));
+    instances[grid_id].active_count = 0;
 }
 
+/**
+    Keeps activity variables within the range of a newly applied config without resetting them.
+*/
+void mm_activity_variables_on_config_update(uint8_t grid_id)
+{
+    mm_activity_variable_t min = mm_sensor_algorithm_config(grid_id)->activity_variable_min;
+    mm_activity_variable_t max = mm_sensor_algorithm_config(grid_id)->activity_variable_max;
+
+    for(uint16_t i = 0; i < ACTIVITY_VARIABLES_NUM; ++i)
+    {
+        mm_activity_variable_t* av = &(instances[grid_id].activity_variables[i]);
 
-mm_activity_variable_t* mm_av_access(uint8_t x, uint8_t y)
+        if (*av < min)
+        {
+            *av = min;
+        }
+        else if (*av > max)
+        {
+            *av = max;
+        }
+
+        /* A lowered minimum leaves idle AVs above it, they need to drain like any other. */
+        if (*av > min)
+        {
+            mm_av_set_active(grid_id, av);
+        }
+    }
+
+    mm_av_prune_inactive(grid_id);
+}
+
+/**
+    Copies a grid's activity variables, to persist them across a reset.
+*/
+void mm_activity_variables_save(uint8_t grid_id, mm_activity_variable_t * values)
 {
-    return &activity_variables[y * MAX_AV_SIZE_Y + x];
+    memcpy(values, &(instances[grid_id].activity_variables[0]), sizeof(instances[grid_id].activity_variables));
+}
+
+/**
+    Restores activity variables copied by mm_activity_variables_save.
+*/
+void mm_activity_variables_restore(uint8_t grid_id, mm_activity_variable_t const * values)
+{
+    memcpy(&(instances[grid_id].activity_variables[0]), values, sizeof(instances[grid_id].activity_variables));
+
+    /* The config may have changed since they were saved, and any above the minimum need to drain. */
+    mm_activity_variables_on_config_update(grid_id);
+}
+
+
+mm_activity_variable_t* mm_av_access(uint8_t grid_id, uint8_t x, uint8_t y)
+{
+    return &instances[grid_id].activity_variables[y * MAX_AV_SIZE_X + x];
 }
 
 
 /**
-    Gets the status for an AV based on the appropriate detection threshold value.
+    Adds an activity variable to the active set.
 */
-activity_variable_state_t mm_get_status_for_av(mm_activity_variable_t const * av)
+void mm_av_set_active(uint8_t grid_id, mm_activity_variable_t const * av)
 {
-    /* Check if provided av is roadside. */
-    bool is_roadside = false;
-    for (uint8_t x = 0; x < MAX_AV_SIZE_X; ++x)
+    uint16_t index = av - &(instances[grid_id].activity_variables[0]);
+    APP_ERROR_CHECK(index >= ACTIVITY_VARIABLES_NUM);
+
+    if (instances[grid_id].is_active[index])
+    {
+        return;
+    }
+
+    /* Insert in order, shuffling larger indices up. */
+    uint16_t i = instances[grid_id].active_count;
+    while (i > 0 && instances[grid_id].active_indices[i - 1] > index)
     {
-        if (av == mm_av_access(x, 1))
+        instances[grid_id].active_indices[i] = instances[grid_id].active_indices[i - 1];
+        i--;
+    }
+
+    instances[grid_id].active_indices[i] = index;
+    instances[grid_id].active_count++;
+    instances[grid_id].is_active[index] = true;
+}
+
+/**
+    Removes activity variables that have drained back to the minimum from the active set.
+*/
+void mm_av_prune_inactive(uint8_t grid_id)
+{
+    uint16_t kept = 0;
+
+    for (uint16_t i = 0; i < instances[grid_id].active_count; ++i)
+    {
+        uint16_t index = instances[grid_id].active_indices[i];
+
+        if (instances[grid_id].activity_variables[index] > mm_sensor_algorithm_config(grid_id)->activity_variable_min)
+        {
+            instances[grid_id].active_indices[kept] = index;
+            kept++;
+        }
+        else
+        {
+            instances[grid_id].is_active[index] = false;
+        }
+    }
+
+    instances[grid_id].active_count = kept;
+}
+
+/**
+    Starts iterating over the activity variables that need per-second processing.
+*/
+void mm_av_iterator_init(uint8_t grid_id, mm_av_iterator_t* iterator)
+{
+    iterator->grid_id = grid_id;
+    iterator->next_id = 0;
+    iterator->dense = !is_minimum_idle(grid_id);
+}
+
+/**
+    Gets the position of the next activity variable that needs per-second processing.
+*/
+bool mm_av_iterator_next(mm_av_iterator_t* iterator, uint8_t* x, uint8_t* y)
+{
+    uint8_t grid_id = iterator->grid_id;
+    uint16_t index;
+
+    if (iterator->dense)
+    {
+        if (iterator->next_id >= ACTIVITY_VARIABLES_NUM)
         {
-            is_roadside = true;
-            break;
+            return false;
         }
+
+        index = iterator->next_id;
+    }
+    else
+    {
+        if (iterator->next_id >= instances[grid_id].active_count)
+        {
+            return false;
+        }
+
+        index = instances[grid_id].active_indices[iterator->next_id];
     }
 
+    iterator->next_id++;
+
+    *x = index % MAX_AV_SIZE_X;
+    *y = index / MAX_AV_SIZE_X;
+    return true;
+}
+
+/**
+    Gets the status for an AV based on the appropriate detection threshold value.
+*/
+activity_variable_state_t mm_get_status_for_av(uint8_t grid_id, mm_activity_variable_t const * av)
+{
+    /* Check if provided av is roadside. */
+    uint16_t index = av - &(instances[grid_id].activity_variables[0]);
+    bool is_roadside = ( index / MAX_AV_SIZE_X == AV_RS_THRESHOLD_ROW );
+
+    return mm_get_status_for_av_value(grid_id, *av, is_roadside);
+}
+
+/**
+    Gets the status an AV would have if it held value.
+*/
+activity_variable_state_t mm_get_status_for_av_value(uint8_t grid_id, mm_activity_variable_t value, bool is_roadside)
+{
     /* Collect the correct thresholds. */
-    float low_thresh = is_roadside ? mm_sensor_algorithm_config()->possible_detection_threshold_rs : mm_sensor_algorithm_config()->possible_detection_threshold_nrs;
-    float high_thresh = is_roadside ? mm_sensor_algorithm_config()->detection_threshold_rs : mm_sensor_algorithm_config()->detection_threshold_nrs;
+    float low_thresh = is_roadside ? mm_sensor_algorithm_config(grid_id)->possible_detection_threshold_rs : mm_sensor_algorithm_config(grid_id)->possible_detection_threshold_nrs;
+    float high_thresh = is_roadside ? mm_sensor_algorithm_config(grid_id)->detection_threshold_rs : mm_sensor_algorithm_config(grid_id)->detection_threshold_nrs;
 
     /* Check against the thresholds. */
-    if (*av < low_thresh)
+    if (value < low_thresh)
     {
         return ACTIVITY_VARIABLE_STATE_IDLE;
     }
-    else if (*av < high_thresh)
+    else if (value < high_thresh)
     {
         return ACTIVITY_VARIABLE_STATE_POSSIBLE_DETECTION;
     }
@@ -97,3 +266,14 @@ activity_variable_state_t mm_get_status_for_av(mm_activity_variable_t const * av
         return ACTIVITY_VARIABLE_STATE_DETECTION;
     }
 }
+
+/**
+    Checks if activity variables sitting at the minimum are idle in every row.
+*/
+static bool is_minimum_idle(uint8_t grid_id)
+{
+    mm_activity_variable_t min = mm_sensor_algorithm_config(grid_id)->activity_variable_min;
+
+    return mm_get_status_for_av_value(grid_id, min, true) == ACTIVITY_VARIABLE_STATE_IDLE &&
+           mm_get_status_for_av_value(grid_id, min, false) == ACTIVITY_VARIABLE_STATE_IDLE;
+}
@@ -13,6 +13,7 @@ notes:
 **********************************************************/
 
 #include <stdint.h>
+#include <stdbool.h>
 
 #include "mm_sensor_algorithm_config.h"
 
@@ -24,6 +25,13 @@ notes:
 #define MAX_AV_SIZE_Y           ( MAX_GRID_SIZE_Y - 1 )
 #define ACTIVITY_VARIABLES_NUM  ( MAX_AV_SIZE_X * MAX_AV_SIZE_Y )
 
+/*
+   AV row which is checked against the *_rs detection thresholds. This isn't
+   the row nearest the road, that is row 0. The tuned configs were fitted
+   with the thresholds applied to the last row, so they stay there.
+   */
+#define AV_RS_THRESHOLD_ROW     ( MAX_AV_SIZE_Y - 1 )
+
 /**********************************************************
                         MACROS
 **********************************************************/
@@ -31,16 +39,16 @@ notes:
 /*
    Ease of access macros, optional usage:
    ex.
-   AV(0, 1) = 1.2f;
-   AV_TOP_LEFT = 1.2f;
-   AV_TOP_LEFT = AV_TOP_RIGHT;
+   AV(grid_id, 0, 1) = 1.2f;
+   AV_TOP_LEFT(grid_id) = 1.2f;
+   AV_TOP_LEFT(grid_id) = AV_TOP_RIGHT(grid_id);
 
    */
-#define AV(x, y)                (*(mm_av_access((x),(y))))
-#define AV_TOP_LEFT             AV(0, 0)
-#define AV_TOP_RIGHT            AV(1, 0)
-#define AV_BOTTOM_LEFT          AV(0, 1)
-#define AV_BOTTOM_RIGHT         AV(1, 1)
+#define AV(grid_id, x, y)           (*(mm_av_access((grid_id),(x),(y))))
+#define AV_TOP_LEFT(grid_id)        AV((grid_id), 0, 0)
+#define AV_TOP_RIGHT(grid_id)       AV((grid_id), 1, 0)
+#define AV_BOTTOM_LEFT(grid_id)     AV((grid_id), 0, 1)
+#define AV_BOTTOM_RIGHT(grid_id)    AV((grid_id), 1, 1)
 
 /**********************************************************
                         TYPES
@@ -48,6 +56,20 @@ notes:
 
 typedef float mm_activity_variable_t;
 
+/*
+   Iterates over the activity variables that need per-second processing.
+   ex.
+   mm_av_iterator_t it;
+   mm_av_iterator_init(grid_id, &it);
+   while(mm_av_iterator_next(&it, &x, &y)) { ... }
+   */
+typedef struct
+{
+    uint8_t  grid_id;
+    uint16_t next_id;
+    bool     dense;     /* Visit every activity variable rather than just the active ones. */
+} mm_av_iterator_t;
+
 typedef enum
 {
     ACTIVITY_VARIABLE_STATE_IDLE,
@@ -62,18 +84,61 @@ typedef enum
 **********************************************************/
 
 /**
- * Initialize activity variables.
+ * Initialize a grid's activity variables.
+ */
+void mm_activity_variables_init(uint8_t grid_id);
+
+/**
+ * Keep a grid's activity variables within the range of a newly applied config without resetting them.
+ */
+void mm_activity_variables_on_config_update(uint8_t grid_id);
+
+/**
+ * Copy a grid's ACTIVITY_VARIABLES_NUM activity variables into values, to persist them across a reset.
+ */
+void mm_activity_variables_save(uint8_t grid_id, mm_activity_variable_t * values);
+
+/**
+ * Restore activity variables copied by mm_activity_variables_save, kept within the range of the current config.
  */
-void mm_activity_variables_init(void);
+void mm_activity_variables_restore(uint8_t grid_id, mm_activity_variable_t const * values);
 
 /**
  * Access AV value.
  */
-mm_activity_variable_t* mm_av_access(uint8_t x, uint8_t y);
+mm_activity_variable_t* mm_av_access(uint8_t grid_id, uint8_t x, uint8_t y);
+
+/**
+ * Add an activity variable to the active set. Active activity variables
+ * are visited by per-second processing until they drain back to the minimum.
+ */
+void mm_av_set_active(uint8_t grid_id, mm_activity_variable_t const * av);
+
+/**
+ * Remove activity variables that have drained back to the minimum from the active set.
+ */
+void mm_av_prune_inactive(uint8_t grid_id);
+
+/**
+ * Start iterating over a grid's activity variables that need per-second processing.
+ */
+void mm_av_iterator_init(uint8_t grid_id, mm_av_iterator_t* iterator);
+
+/**
+ * Get the position of the next activity variable that needs per-second processing.
+ *
+ * Returns false after the set has been exhausted.
+ */
+bool mm_av_iterator_next(mm_av_iterator_t* iterator, uint8_t* x, uint8_t* y);
 
 /**
  * Check which threshold an activity variable falls under.
  */
-activity_variable_state_t mm_get_status_for_av(mm_activity_variable_t const * av);
+activity_variable_state_t mm_get_status_for_av(uint8_t grid_id, mm_activity_variable_t const * av);
+
+/**
+ * Check which threshold a value would fall under for a roadside or non-roadside activity variable.
+ */
+activity_variable_state_t mm_get_status_for_av_value(uint8_t grid_id, mm_activity_variable_t value, bool is_roadside);
 
 #endif /* MM_ACTIVITY_VARIABLES_H */
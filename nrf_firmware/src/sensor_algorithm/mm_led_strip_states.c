@@ -20,18 +20,28 @@
 #include "mm_position_config.h"
 #include "mm_av_transmission.h"
 #include "mm_led_transmission.h"
+#include "mm_trajectory_tracker.h"
 
 /**********************************************************
                         CONSTANTS
 **********************************************************/
 
-#define LED_STATE_REINFORCEMENT             ( true )
-#define LED_STATE_REINFORCEMENT_PERIOD_S    ( 10 )
+/**
+    Output sets only cover LEDs near an AV. The window starts OUTPUT_UPSTREAM_REACH
+    LEDs before the AV's own column and extends far enough downstream that every
+    LED past it would always be IDLE.
+*/
+#define OUTPUT_UPSTREAM_REACH               ( 1 )
+#define OUTPUT_WINDOW_SIZE                  ( OUTPUT_UPSTREAM_REACH + 3 )
 
 /**********************************************************
                         MACROS
 **********************************************************/
 
+/* Grid position of the LED node for signalling state record i. */
+#define LED_POSITION_X(i)                   ( (int8_t)(i) + GRID_POSITION_MIN_X )
+#define LED_POSITION_Y                      ( GRID_POSITION_LED_Y )
+
 /**********************************************************
                         TYPES
 **********************************************************/
@@ -44,9 +54,10 @@ typedef enum
     ALARM
 } led_signalling_state_t;
 
+/* Output states for the LEDs in an AV's window, starting OUTPUT_UPSTREAM_REACH before the AV's column. */
 typedef struct
 {
-    led_signalling_state_t states[MAX_GRID_SIZE_X];
+    led_signalling_state_t states[OUTPUT_WINDOW_SIZE];
 }  output_set_t;
 
 typedef struct
@@ -71,37 +82,60 @@ typedef struct
 /**
     Updates the current_av_states based on the raw AV values
 */
-static void update_current_av_states(void);
+static void update_current_av_states(uint8_t grid_id);
 
 /**
-    Updates the current_output_states by considering any state changes
-    and timeouts.
+    Recomputes the current_av_states from the raw AV values without
+    reporting the AVs to the monitoring application.
 */
-static void update_current_output_states(void);
+static void evaluate_current_av_states(uint8_t grid_id);
 
-#if(LED_STATE_REINFORCEMENT)
+#if(TRAJECTORY_PREDICTION)
     /**
-        Send a duplicate led output update event to each led.
-    
-        (This can help recover from dropped network packets if channels are not reliable)
+        Escalates the LEDs either side of each AV column an animal is
+        predicted to reach the road in.
     */
-    static void reinforce_current_output_states(uint32_t seconds);
+    static void escalate_predicted_av_states(uint8_t grid_id);
 #endif
 
 /**
-    Sends an signalling state update to an LED node.
+    Updates the current_output_states by considering any state changes
+    and timeouts.
+*/
+static void update_current_output_states(uint8_t grid_id);
+
+/**
+    Applies any pending escalations to the current_output_states.
+    De-escalations are left for the periodic update.
+*/
+static void escalate_current_output_states(uint8_t grid_id);
+
+/**
+    Raises a record's current_output_state to its current_av_state,
+    restarts the minimum signalling timeout and notifies the monitoring application.
+    The LED node is left for send_led_output_states.
+*/
+static void escalate_record(uint8_t grid_id, int8_t i);
+
+/**
+    Sends every LED node its signalling state in one group message.
 */
-static void set_led_output_state(int8_t x, int8_t y, led_signalling_state_t state);
+static void send_led_output_states(uint8_t grid_id);
+
+/**
+    Gets the LED output for the LED node at a position, false if there is no node there.
+*/
+static bool get_led_output_state(uint8_t grid_id, int8_t x, int8_t y, led_signalling_state_t state, led_node_output_t * output);
 
 /**
     Sends an signalling state update to the monitoring application.
 */
-static void set_led_monitoring_state(int8_t x, int8_t y, led_signalling_state_t state);
+static void set_led_monitoring_state(uint8_t grid_id, int8_t x, int8_t y, led_signalling_state_t state);
 
 /**
     Updates the LED signalling states based on an output set.
 */
-static void escalate_set(led_signalling_state_record_t * p_record, output_set_t const * escalate_to);
+static void escalate_set(led_signalling_state_record_t * p_record, output_set_t const * escalate_to, uint16_t av_x);
 
 /**
     Updates an individual LED signalling state, escalating compounding CONCERN states.
@@ -113,172 +147,241 @@ static void escalate_output(led_signalling_state_t* p_state, led_signalling_stat
 */
 static output_table_t const * get_output_table_for_av(uint16_t x, uint16_t y);
 
+/**
+    Generates the output tables for each AV row from the distance-to-LED rule.
+*/
+static void generate_output_tables(void);
+
+/**
+    Gets the output state for an LED at a given distance from a detection.
+*/
+static led_signalling_state_t get_output_for_distance(int16_t distance);
+
 /**
     Gets the output set for an AV based on it's location and current value.
 */
-static output_set_t const * get_output_set_for_av(mm_activity_variable_t const * av, output_table_t const * output_table);
+static output_set_t const * get_output_set_for_av(uint8_t grid_id, mm_activity_variable_t const * av, output_table_t const * output_table);
 
 /**
     Determines if a current_output_state has timed out.
 */
-static bool has_current_output_state_timed_out(led_signalling_state_record_t const * p_record);
+static bool has_current_output_state_timed_out(uint8_t grid_id, led_signalling_state_record_t const * p_record);
+
+/**
+    Gets the minimum signalling duration for a current_output_state.
+*/
+static uint32_t get_minimum_signal_duration(uint8_t grid_id, led_signalling_state_t state);
 
 /**
     Resets all current_av_states.
 */
-static void clear_all_current_av_states(void);
+static void clear_all_current_av_states(uint8_t grid_id);
 
 /**********************************************************
                        VARIABLES
 **********************************************************/
 
 /**
-    Records for managing minimum signalling duration timeouts.
+    Records for managing minimum signalling duration timeouts, for each grid.
     Assumes that there are MAX_GRID_SIZE_X nodes with LEDs.
 */
-static led_signalling_state_record_t led_signalling_state_records [MAX_GRID_SIZE_X];
+static led_signalling_state_record_t led_signalling_state_records [MAX_SENSOR_GRIDS][MAX_GRID_SIZE_X];
 
-static output_table_t const top_left_output =
+/**
+    Output tables for each AV row, generated at init. An AV's outputs only depend on
+    its distance from the road and from each LED, so every AV in a row shares a table.
+*/
+static output_table_t output_tables[MAX_AV_SIZE_Y];
+
+/**********************************************************
+                       DECLARATIONS
+**********************************************************/
+
+void mm_led_strip_states_init(uint8_t grid_id)
 {
-    {
-        { IDLE, IDLE, IDLE }
-    },
-    {
-        { ALARM, CONCERN, IDLE }
-    },
-    {
-        { ALARM, ALARM, CONCERN }
-    }
-};
+    /* Initialize LED signalling states */
+    memset( &led_signalling_state_records[grid_id][0], 0, sizeof(led_signalling_state_records[grid_id]) );
+
+    generate_output_tables();
+}
 
-static output_table_t const top_right_output =
+/**
+    Updates current LED signalling states and increments
+    timeout counter.
+*/
+void mm_led_signalling_states_on_second_elapsed(uint8_t grid_id, uint32_t seconds)
 {
-    {
-        { IDLE, IDLE, IDLE }
-    },
-    {
-        { ALARM, ALARM, CONCERN }
-    },
-    {
-        { ALARM, ALARM, ALARM }
-    }
-};
+    update_current_av_states(grid_id);
+    update_current_output_states(grid_id);
+}
 
-static output_table_t const bottom_left_output =
+/**
+    Counts how many more seconds can elapse before a signalling state
+    times out.
+*/
+uint32_t mm_led_signalling_states_seconds_until_update(uint8_t grid_id, uint32_t max_seconds)
 {
+    uint32_t remaining = max_seconds;
+
+    for (int8_t i = 0; i < MAX_GRID_SIZE_X; i++)
     {
-        { IDLE, IDLE, IDLE }
-    },
-    {
-        { CONCERN, IDLE, IDLE }
-    },
-    {
-        { ALARM, CONCERN, IDLE }
+        led_signalling_state_record_t const * p_record = &(led_signalling_state_records[grid_id][i]);
+
+        /* Only outputs waiting to de-escalate have a timeout that matters. */
+        if (!p_record->timeout_active || p_record->current_av_state >= p_record->current_output_state)
+        {
+            continue;
+        }
+
+        /* The counter is checked before it is incremented, so the update
+         * lands one second after the counter reaches the duration. */
+        uint32_t duration = get_minimum_signal_duration(grid_id, p_record->current_output_state);
+        uint32_t timeout = 1;
+        if (p_record->second_counter < duration)
+        {
+            timeout = duration - p_record->second_counter + 1;
+        }
+
+        if (timeout < remaining)
+        {
+            remaining = timeout;
+        }
     }
-};
 
-static output_table_t const bottom_right_output =
+    return remaining;
+}
+
+/**
+    Immediately applies any escalations caused by a sensor detection.
+*/
+void mm_led_signalling_states_on_sensor_detection(uint8_t grid_id)
 {
-    {
-        { IDLE, IDLE, IDLE }
-    },
-    {
-        { ALARM, CONCERN, IDLE }
-    },
-    {
-        { ALARM, ALARM, CONCERN }
-    }
-};
+    evaluate_current_av_states(grid_id);
+    escalate_current_output_states(grid_id);
+}
 
-static output_table_t const default_output =
+/**
+ *  When node positions are updated refresh all of the output nodes in case their state is wrong.
+ */
+void mm_led_signalling_states_on_position_update(uint8_t grid_id)
 {
+    send_led_output_states(grid_id);
+
+    for(int8_t i = 0; i < MAX_GRID_SIZE_X; ++i)
     {
-        { IDLE, IDLE, IDLE }
-    },
-    {
-        { IDLE, IDLE, IDLE }
-    },
-    {
-        { IDLE, IDLE, IDLE }
+        set_led_monitoring_state(grid_id, LED_POSITION_X(i), LED_POSITION_Y, led_signalling_state_records[grid_id][i].current_output_state);
     }
-};
-
-/**********************************************************
-                       DECLARATIONS
-**********************************************************/
+}
 
-void mm_led_strip_states_init(void)
+/**
+    Copies a grid's signalling records into a snapshot.
+*/
+void mm_led_strip_states_save(uint8_t grid_id, mm_led_strip_states_snapshot_t * snapshot)
 {
-    /* Initialize LED signalling states */
-    memset( &led_signalling_state_records[0], 0, sizeof(led_signalling_state_records) );
+    for (int8_t i = 0; i < MAX_GRID_SIZE_X; i++)
+    {
+        snapshot->output_states[i] = led_signalling_state_records[grid_id][i].current_output_state;
+        snapshot->timeouts_active[i] = led_signalling_state_records[grid_id][i].timeout_active;
+        snapshot->second_counters[i] = ( led_signalling_state_records[grid_id][i].second_counter > UINT16_MAX ) ? UINT16_MAX : led_signalling_state_records[grid_id][i].second_counter;
+    }
 }
 
 /**
-    Updates current LED signalling states and increments
-    timeout counter.
+    Restores a grid's signalling records from a snapshot.
 */
-void mm_led_signalling_states_on_second_elapsed(uint32_t seconds)
+void mm_led_strip_states_restore(uint8_t grid_id, mm_led_strip_states_snapshot_t const * snapshot)
 {
-    update_current_av_states();
-    update_current_output_states();
+    for (int8_t i = 0; i < MAX_GRID_SIZE_X; i++)
+    {
+        led_signalling_state_t output_state = (led_signalling_state_t)snapshot->output_states[i];
+        if (output_state > ALARM)
+        {
+            output_state = IDLE;
+        }
 
-#if(LED_STATE_REINFORCEMENT)
-    reinforce_current_output_states(seconds);
-#endif
+        /* The AV states are recomputed from the restored AVs on the next second. Until
+         * then, hold the outputs where they were so nothing de-escalates early. */
+        led_signalling_state_records[grid_id][i].current_av_state = output_state;
+        led_signalling_state_records[grid_id][i].current_output_state = output_state;
+        led_signalling_state_records[grid_id][i].timeout_active = snapshot->timeouts_active[i] && ( output_state != IDLE );
+        led_signalling_state_records[grid_id][i].second_counter = led_signalling_state_records[grid_id][i].timeout_active ? snapshot->second_counters[i] : 0;
+    }
+
+    /* The LED nodes may have been left showing anything while the gateway was down. */
+    mm_led_signalling_states_on_position_update(grid_id);
 }
 
 /**
- *  When node positions are updated refresh all of the output nodes in case their state is wrong.
- */
-void mm_led_signalling_states_on_position_update(void)
+    Updates the current_av_states based on the raw AV values
+*/
+static void update_current_av_states(uint8_t grid_id)
 {
-    for(int8_t i = 0; i < MAX_GRID_SIZE_X; ++i)
+    evaluate_current_av_states(grid_id);
+
+    /* The monitoring application only displays a single grid of AVs. */
+    if (grid_id == MONITORED_SENSOR_GRID)
     {
-        set_led_output_state(i - 1, 1, led_signalling_state_records[i].current_output_state);
-        set_led_monitoring_state(i - 1, 1, led_signalling_state_records[i].current_output_state);
+        mm_av_transmission_send_all_avs();
     }
 }
 
 /**
-    Updates the current_av_states based on the raw AV values
+    Recomputes the current_av_states from the raw AV values without
+    reporting the AVs to the monitoring application.
 */
-static void update_current_av_states(void)
+static void evaluate_current_av_states(uint8_t grid_id)
 {
     /* Clear previous states */
-    clear_all_current_av_states();
+    clear_all_current_av_states(grid_id);
+
+    /* Inactive AVs are idle, so they can never escalate anything. */
+    uint8_t x;
+    uint8_t y;
+    mm_av_iterator_t it;
+    mm_av_iterator_init(grid_id, &it);
 
-    for (uint8_t x = 0; x < (MAX_AV_SIZE_X); x++)
+    while (mm_av_iterator_next(&it, &x, &y))
     {
-        for (uint8_t y = 0; y < (MAX_AV_SIZE_Y); y++)
-        {
-            output_table_t const * output_table = get_output_table_for_av(x, y);
-            output_set_t const * output_set = get_output_set_for_av(&AV(x, y), output_table);
-            escalate_set(led_signalling_state_records, output_set);
-        }
+        output_table_t const * output_table = get_output_table_for_av(x, y);
+        output_set_t const * output_set = get_output_set_for_av(grid_id, &AV(grid_id, x, y), output_table);
+        escalate_set(led_signalling_state_records[grid_id], output_set, x);
     }
 
-    mm_av_transmission_send_all_avs();
+#if(TRAJECTORY_PREDICTION)
+    escalate_predicted_av_states(grid_id);
+#endif
 }
 
-#if(LED_STATE_REINFORCEMENT)
+#if(TRAJECTORY_PREDICTION)
     /**
-        Send a duplicate led output update event to each led.
-    
-        (This can help recover from dropped network packets if channels are not reliable)
+        Escalates the LEDs either side of each AV column an animal is
+        predicted to reach the road in.
     */
-    static void reinforce_current_output_states(uint32_t seconds)
+    static void escalate_predicted_av_states(uint8_t grid_id)
     {
-        /* Only send an update on multiples of the reinforcment period. */
-        if(seconds % LED_STATE_REINFORCEMENT_PERIOD_S != 0)
+        activity_variable_state_t predictions[MAX_AV_SIZE_X];
+        mm_trajectory_tracker_get_road_predictions(grid_id, predictions);
+
+        for (uint16_t x = 0; x < MAX_AV_SIZE_X; x++)
         {
-            return;
-        }
+            led_signalling_state_t state = IDLE;
+            if (predictions[x] == ACTIVITY_VARIABLE_STATE_DETECTION)
+            {
+                state = ALARM;
+            }
+            else if (predictions[x] == ACTIVITY_VARIABLE_STATE_POSSIBLE_DETECTION)
+            {
+                state = CONCERN;
+            }
 
-        /* Send an update to each led. */
-        for (int8_t i = 0; i < MAX_GRID_SIZE_X; i++)
-        {   
-            /* Hardcoded right now. Assumes that the roadside nodes have LEDs. */
-            set_led_output_state(i - 1, 1, led_signalling_state_records[i].current_output_state);
+            /* A prediction only sets a floor, it doesn't compound with the AV outputs like a second detection would. */
+            for (uint16_t i = x; i <= x + 1; i++)
+            {
+                if (state > led_signalling_state_records[grid_id][i].current_av_state)
+                {
+                    led_signalling_state_records[grid_id][i].current_av_state = state;
+                }
+            }
         }
     }
 #endif
@@ -287,108 +390,164 @@ static void update_current_av_states(void)
     Updates the current_output_states by considering any state changes
     and timeouts.
 */
-static void update_current_output_states(void)
+static void update_current_output_states(uint8_t grid_id)
 {
+    bool outputs_changed = false;
+
     for (int8_t i = 0; i < MAX_GRID_SIZE_X; i++)
     {   
-        if (led_signalling_state_records[i].current_av_state > led_signalling_state_records[i].current_output_state)
+        if (led_signalling_state_records[grid_id][i].current_av_state > led_signalling_state_records[grid_id][i].current_output_state)
         {
             /* If the current_av_state is greater than the current_output_state,
              * start the timeout and update the output state. */
-            led_signalling_state_records[i].second_counter = 0;
-            led_signalling_state_records[i].timeout_active = true;
-            led_signalling_state_records[i].current_output_state = led_signalling_state_records[i].current_av_state;
-
-            /* Hardcoded right now. Assumes that the roadside nodes have LEDs. */
-            set_led_output_state(i - 1, 1, led_signalling_state_records[i].current_output_state);
-            set_led_monitoring_state(i - 1, 1, led_signalling_state_records[i].current_output_state);
+            escalate_record(grid_id, i);
+            outputs_changed = true;
         }
-        else if (led_signalling_state_records[i].current_av_state == led_signalling_state_records[i].current_output_state)
+        else if (led_signalling_state_records[grid_id][i].current_av_state == led_signalling_state_records[grid_id][i].current_output_state)
         {
             /* If there was no change in state, just update the timeout counter
              * if the timeout is active. */
-            if (led_signalling_state_records[i].timeout_active)
+            if (led_signalling_state_records[grid_id][i].timeout_active)
             {
-                led_signalling_state_records[i].second_counter++;
+                led_signalling_state_records[grid_id][i].second_counter++;
             }
         }
         else
         {
             /* If the current_av_state is less than the current_output_state,
              * check to see if the current_output_state has timed out.. */
-            if (has_current_output_state_timed_out(&(led_signalling_state_records[i])))
+            if (has_current_output_state_timed_out(grid_id, &(led_signalling_state_records[grid_id][i])))
             {
                 /* ...if it has, turn off timeout and update current_output_state. */
-                if (led_signalling_state_records[i].current_av_state == IDLE)
+                if (led_signalling_state_records[grid_id][i].current_av_state == IDLE)
                 {
-                    led_signalling_state_records[i].second_counter = 0;
-                    led_signalling_state_records[i].timeout_active = false;
+                    led_signalling_state_records[grid_id][i].second_counter = 0;
+                    led_signalling_state_records[grid_id][i].timeout_active = false;
                 }
 
-                led_signalling_state_records[i].current_output_state = led_signalling_state_records[i].current_av_state;
+                led_signalling_state_records[grid_id][i].current_output_state = led_signalling_state_records[grid_id][i].current_av_state;
+                outputs_changed = true;
 
-                /* Hardcoded right now. Assumes that the roadside nodes have LEDs. */
-                set_led_output_state(i - 1, 1, led_signalling_state_records[i].current_output_state);
-                set_led_monitoring_state(i - 1, 1, led_signalling_state_records[i].current_output_state);
+                set_led_monitoring_state(grid_id, LED_POSITION_X(i), LED_POSITION_Y, led_signalling_state_records[grid_id][i].current_output_state);
             }
             else
             {
                 /* ...otherwise, just update the timeout counter. */
-                led_signalling_state_records[i].second_counter++;
+                led_signalling_state_records[grid_id][i].second_counter++;
             }
         }
     }
+
+    /* Every change goes out together, one message for all of the LED nodes. */
+    if (outputs_changed)
+    {
+        send_led_output_states(grid_id);
+    }
 }
 
 /**
-    Sends an signalling state update to an LED node.
+    Applies any pending escalations to the current_output_states.
+    De-escalations are left for the periodic update.
 */
-static void set_led_output_state(int8_t x, int8_t y, led_signalling_state_t state)
+static void escalate_current_output_states(uint8_t grid_id)
 {
-    /* Get the position of the LED node. */
-    mm_node_position_t const * node_position = get_node_for_position( x, y);
+    bool outputs_changed = false;
 
-    /* Check to make sure that this node actually exists before sending anything!*/
-    if (node_position != NULL)
+    for (int8_t i = 0; i < MAX_GRID_SIZE_X; i++)
     {
-        switch ( state )
+        if (led_signalling_state_records[grid_id][i].current_av_state > led_signalling_state_records[grid_id][i].current_output_state)
         {
-            case CONCERN:
-                mm_led_control_update_node_leds
-                (
-                    node_position->node_id,
-                    LED_FUNCTION_LEDS_BLINKING,
-                    LED_COLOURS_YELLOW
-                );
-                break;
-            case ALARM:
-                mm_led_control_update_node_leds
-                (
-                    node_position->node_id,
-                    LED_FUNCTION_LEDS_BLINKING,
-                    LED_COLOURS_RED
-                );
-                break;
-            case IDLE:
-            default:
-                mm_led_control_update_node_leds
-                (
-                    node_position->node_id,
-                    LED_FUNCTION_LEDS_OFF,
-                    LED_COLOURS_RED
-                );
-                break;
+            escalate_record(grid_id, i);
+            outputs_changed = true;
         }
     }
+
+    if (outputs_changed)
+    {
+        send_led_output_states(grid_id);
+    }
+}
+
+/**
+    Raises a record's current_output_state to its current_av_state,
+    restarts the minimum signalling timeout and notifies the monitoring application.
+    The LED node is left for send_led_output_states.
+*/
+static void escalate_record(uint8_t grid_id, int8_t i)
+{
+    led_signalling_state_records[grid_id][i].second_counter = 0;
+    led_signalling_state_records[grid_id][i].timeout_active = true;
+    led_signalling_state_records[grid_id][i].current_output_state = led_signalling_state_records[grid_id][i].current_av_state;
+
+    set_led_monitoring_state(grid_id, LED_POSITION_X(i), LED_POSITION_Y, led_signalling_state_records[grid_id][i].current_output_state);
+}
+
+/**
+    Sends every LED node its signalling state in one group message.
+*/
+static void send_led_output_states(uint8_t grid_id)
+{
+    led_node_output_t outputs[MAX_GRID_SIZE_X];
+    uint8_t count = 0;
+
+    for (int8_t i = 0; i < MAX_GRID_SIZE_X; i++)
+    {
+        /* Assumes that the roadside nodes have LEDs. */
+        if (get_led_output_state(grid_id, LED_POSITION_X(i), LED_POSITION_Y, led_signalling_state_records[grid_id][i].current_output_state, &outputs[count]))
+        {
+            count++;
+        }
+    }
+
+    if (count > 0)
+    {
+        mm_led_control_update_all_node_leds(&outputs[0], count);
+    }
+}
+
+/**
+    Gets the LED output for the LED node at a position, false if there is no node there.
+*/
+static bool get_led_output_state(uint8_t grid_id, int8_t x, int8_t y, led_signalling_state_t state, led_node_output_t * output)
+{
+    /* Get the position of the LED node. */
+    mm_node_position_t const * node_position = get_node_for_position(grid_id, x, y);
+
+    /* Check to make sure that this node actually exists before sending anything!*/
+    if (node_position == NULL)
+    {
+        return false;
+    }
+
+    output->node_id = node_position->node_id;
+
+    switch ( state )
+    {
+        case CONCERN:
+            output->led_function = LED_FUNCTION_LEDS_BLINKING;
+            output->led_colour = LED_COLOURS_YELLOW;
+            break;
+        case ALARM:
+            output->led_function = LED_FUNCTION_LEDS_BLINKING;
+            output->led_colour = LED_COLOURS_RED;
+            break;
+        case IDLE:
+        default:
+            output->led_function = LED_FUNCTION_LEDS_OFF;
+            output->led_colour = LED_COLOURS_RED;
+            break;
+    }
+
+    return true;
 }
 
 /**
     Updates the LED signalling states based on an output set.
 */
-static void set_led_monitoring_state(int8_t x, int8_t y, led_signalling_state_t state)
+static void set_led_monitoring_state(uint8_t grid_id, int8_t x, int8_t y, led_signalling_state_t state)
 {
     /* Get the position of the LED node. */
-    mm_node_position_t const * node_position = get_node_for_position(x, y);
+    mm_node_position_t const * node_position = get_node_for_position(grid_id, x, y);
 
     /* Check to make sure that this node actually exists before sending anything!*/
     if (node_position != NULL)
@@ -428,11 +587,20 @@ static void set_led_monitoring_state(int8_t x, int8_t y, led_signalling_state_t
 /**
     Updates the LED signalling states based on an output set.
 */
-static void escalate_set(led_signalling_state_record_t * p_record, output_set_t const * escalate_to)
+static void escalate_set(led_signalling_state_record_t * p_record, output_set_t const * escalate_to, uint16_t av_x)
 {
-    for(uint8_t i = 0; i < MAX_GRID_SIZE_X; ++i)
+    /* LEDs outside the window are always IDLE, which can't escalate anything. */
+    int16_t first_led = (int16_t)av_x - OUTPUT_UPSTREAM_REACH;
+
+    for(int16_t w = 0; w < OUTPUT_WINDOW_SIZE; ++w)
     {
-        escalate_output(&(p_record[i].current_av_state), escalate_to->states[i]);
+        int16_t i = first_led + w;
+        if(i < 0 || i >= MAX_GRID_SIZE_X)
+        {
+            continue;
+        }
+
+        escalate_output(&(p_record[i].current_av_state), escalate_to->states[w]);
     }
 }
 
@@ -456,37 +624,59 @@ static void escalate_output(led_signalling_state_t* p_state, led_signalling_stat
 */
 static output_table_t const * get_output_table_for_av(uint16_t x, uint16_t y)
 {
-    if (x == 0 && y == 0)
-    {
-        return &top_left_output;
-    }
-    else if ( x == 1 && y == 0)
+    /* Tables are shared across a row, only the window position depends on x. */
+    APP_ERROR_CHECK(x >= MAX_AV_SIZE_X || y >= MAX_AV_SIZE_Y);
+
+    return &output_tables[y];
+}
+
+/**
+    Generates the output tables for each AV row from the distance-to-LED rule.
+*/
+static void generate_output_tables(void)
+{
+    for (uint16_t y = 0; y < MAX_AV_SIZE_Y; y++)
     {
-        return &top_right_output;
+        output_table_t * p_table = &output_tables[y];
+
+        for (uint16_t w = 0; w < OUTPUT_WINDOW_SIZE; w++)
+        {
+            /* Distance counts LEDs downstream of the AV's column plus AV rows away from the road.
+             * A full detection reaches one LED further than a possible detection. */
+            int16_t distance = ( (int16_t)w - OUTPUT_UPSTREAM_REACH ) + (int16_t)y;
+
+            p_table->no_detection.states[w]       = IDLE;
+            p_table->possible_detection.states[w] = get_output_for_distance(distance);
+            p_table->detection.states[w]          = get_output_for_distance(distance - 1);
+        }
     }
-    else if ( x == 0 && y == 1)
+}
+
+/**
+    Gets the output state for an LED at a given distance from a detection.
+*/
+static led_signalling_state_t get_output_for_distance(int16_t distance)
+{
+    if (distance <= 0)
     {
-        return &bottom_left_output;
+        return ALARM;
     }
-    else if ( x == 1 && y == 1)
+    else if (distance == 1)
     {
-        return &bottom_right_output;
+        return CONCERN;
     }
     else
     {
-        /* We don't support anything other than 3x3 configurations right now. */
-
-        APP_ERROR_CHECK(true);
-        return &default_output;
+        return IDLE;
     }
 }
 
 /**
     Gets the output set for an AV based on it's location and current value.
 */
-static output_set_t const * get_output_set_for_av(mm_activity_variable_t const * av, output_table_t const * output_table)
+static output_set_t const * get_output_set_for_av(uint8_t grid_id, mm_activity_variable_t const * av, output_table_t const * output_table)
 {
-    activity_variable_state_t av_state = mm_get_status_for_av(av);
+    activity_variable_state_t av_state = mm_get_status_for_av(grid_id, av);
 
     switch (av_state)
     {
@@ -509,24 +699,41 @@ static output_set_t const * get_output_set_for_av(mm_activity_variable_t const *
 /**
     Determines if a current_output_state has timed out.
 */
-static bool has_current_output_state_timed_out(led_signalling_state_record_t const * p_record)
+static bool has_current_output_state_timed_out(uint8_t grid_id, led_signalling_state_record_t const * p_record)
 {
     /* If the timeout isn't running, something is wrong! */
     APP_ERROR_CHECK(!p_record->timeout_active);
 
     return (
-            (p_record->current_output_state == CONCERN && p_record->second_counter >= mm_sensor_algorithm_config()->minimum_concern_signal_duration_s) ||
-            (p_record->current_output_state == ALARM && p_record->second_counter >= mm_sensor_algorithm_config()->minimum_alarm_signal_duration_s)
+            (p_record->current_output_state == CONCERN && p_record->second_counter >= mm_sensor_algorithm_config(grid_id)->minimum_concern_signal_duration_s) ||
+            (p_record->current_output_state == ALARM && p_record->second_counter >= mm_sensor_algorithm_config(grid_id)->minimum_alarm_signal_duration_s)
            );
 }
 
+/**
+    Gets the minimum signalling duration for a current_output_state.
+*/
+static uint32_t get_minimum_signal_duration(uint8_t grid_id, led_signalling_state_t state)
+{
+    switch (state)
+    {
+        case CONCERN:
+            return mm_sensor_algorithm_config(grid_id)->minimum_concern_signal_duration_s;
+        case ALARM:
+            return mm_sensor_algorithm_config(grid_id)->minimum_alarm_signal_duration_s;
+        case IDLE:
+        default:
+            return 0;
+    }
+}
+
 /**
     Resets all current_av_states.
 */
-static void clear_all_current_av_states(void)
+static void clear_all_current_av_states(uint8_t grid_id)
 {
     for (uint16_t i = 0; i < MAX_GRID_SIZE_X; i++)
     {
-        led_signalling_state_records[i].current_av_state = IDLE;
+        led_signalling_state_records[grid_id][i].current_av_state = IDLE;
     }
 }
@@ -22,21 +22,60 @@
                         MACROS
 **********************************************************/
 
+/**********************************************************
+                        TYPES
+**********************************************************/
+
+/**
+    Compact copy of one grid's LED signalling records, to persist them across a reset.
+*/
+typedef struct
+{
+    uint8_t     output_states[MAX_GRID_SIZE_X];
+    bool        timeouts_active[MAX_GRID_SIZE_X];
+    uint16_t    second_counters[MAX_GRID_SIZE_X];   /* Seconds into the minimum signal duration. */
+} mm_led_strip_states_snapshot_t;
+
 /**********************************************************
                        DECLARATIONS
 **********************************************************/
 
-void mm_led_strip_states_init(void);
+void mm_led_strip_states_init(uint8_t grid_id);
 
 /**
     Updates current LED signalling states and increments
     timeout counter.
 */
-void mm_led_signalling_states_on_second_elapsed(uint32_t seconds);
+void mm_led_signalling_states_on_second_elapsed(uint8_t grid_id, uint32_t seconds);
+
+/**
+    Counts how many more seconds can elapse before a signalling state
+    times out. Returns max_seconds if nothing is due within that time.
+*/
+uint32_t mm_led_signalling_states_seconds_until_update(uint8_t grid_id, uint32_t max_seconds);
+
+/**
+    Re-evaluates LED signalling states right after a sensor detection
+    and sends any escalations immediately. De-escalations still wait
+    for the once-per-second update so minimum signal durations hold.
+*/
+void mm_led_signalling_states_on_sensor_detection(uint8_t grid_id);
 
 /**
  * Updates LED signalling states for all output nodes in case their positions have changed.
  */
-void mm_led_signalling_states_on_position_update(void);
+void mm_led_signalling_states_on_position_update(uint8_t grid_id);
+
+/**
+    Copies a grid's signalling records into a snapshot.
+*/
+void mm_led_strip_states_save(uint8_t grid_id, mm_led_strip_states_snapshot_t * snapshot);
+
+/**
+    Restores a grid's signalling records from a snapshot, and sends the
+    restored outputs to the LED nodes. Nodes without a position yet are sent theirs
+    once node positions are updated.
+*/
+void mm_led_strip_states_restore(uint8_t grid_id, mm_led_strip_states_snapshot_t const * snapshot);
 
 #endif /* MM_LED_STRIP_STATES_H */
@@ -0,0 +1,127 @@
+/**
+file: mm_network_mode.c
+brief: Picks the BLAZE channel period the network runs at from the activity in the grids.
+notes:
+*/
+
+/**********************************************************
+                        INCLUDES
+**********************************************************/
+
+#include <stdbool.h>
+
+#include "mm_network_mode.h"
+#include "mm_channel_period_control.h"
+#include "mm_sensor_algorithm_config.h"
+#include "mm_activity_variables.h"
+#include "mm_activity_variable_growth.h"
+
+/**********************************************************
+                       DECLARATIONS
+**********************************************************/
+
+/**
+    Check whether a grid has any detecting sensors or non-idle AVs.
+*/
+static bool is_grid_active(uint8_t grid_id);
+
+/**
+    Switch the network to a mode, if it isn't already in it.
+*/
+static void set_mode(mm_channel_period_mode_t mode);
+
+/**********************************************************
+                       VARIABLES
+**********************************************************/
+
+static mm_channel_period_mode_t current_mode;
+static uint32_t idle_seconds;
+
+/**********************************************************
+                       DEFINITIONS
+**********************************************************/
+
+void mm_network_mode_init(void)
+{
+    current_mode = CHANNEL_PERIOD_MODE_LOW_LATENCY;
+    idle_seconds = 0;
+}
+
+void mm_network_mode_on_sensor_evt(uint8_t grid_id)
+{
+    if (is_grid_active(grid_id))
+    {
+        idle_seconds = 0;
+        set_mode(CHANNEL_PERIOD_MODE_LOW_LATENCY);
+    }
+}
+
+void mm_network_mode_on_second_elapsed(void)
+{
+    bool active = false;
+
+    for (uint8_t grid_id = 0; grid_id < MAX_SENSOR_GRIDS && !active; grid_id++)
+    {
+        active = is_grid_active(grid_id);
+    }
+
+    if (active)
+    {
+        idle_seconds = 0;
+        set_mode(CHANNEL_PERIOD_MODE_LOW_LATENCY);
+    }
+    else if (current_mode == CHANNEL_PERIOD_MODE_LOW_LATENCY)
+    {
+        idle_seconds++;
+        if (idle_seconds >= NETWORK_MODE_IDLE_HOLD_S)
+        {
+            set_mode(CHANNEL_PERIOD_MODE_LOW_POWER);
+        }
+    }
+}
+
+uint32_t mm_network_mode_seconds_until_update(uint32_t max_seconds)
+{
+    /* Activity ending is already a deadline of the AVs, only the hold after it counts here. */
+    if (current_mode != CHANNEL_PERIOD_MODE_LOW_LATENCY)
+    {
+        return max_seconds;
+    }
+
+    uint32_t remaining = ( idle_seconds < NETWORK_MODE_IDLE_HOLD_S ) ? ( NETWORK_MODE_IDLE_HOLD_S - idle_seconds ) : 1;
+
+    return ( remaining < max_seconds ) ? remaining : max_seconds;
+}
+
+static bool is_grid_active(uint8_t grid_id)
+{
+    if (mm_activity_variable_growth_is_trickling(grid_id))
+    {
+        return true;
+    }
+
+    uint8_t x;
+    uint8_t y;
+    mm_av_iterator_t it;
+    mm_av_iterator_init(grid_id, &it);
+
+    /* Idle AVs are skipped by the iterator once they have drained, the check covers the rest. */
+    while (mm_av_iterator_next(&it, &x, &y))
+    {
+        if (mm_get_status_for_av(grid_id, &AV(grid_id, x, y)) != ACTIVITY_VARIABLE_STATE_IDLE)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void set_mode(mm_channel_period_mode_t mode)
+{
+    if (mode != current_mode)
+    {
+        current_mode = mode;
+        mm_channel_period_control_set_mode(mode);
+    }
+}
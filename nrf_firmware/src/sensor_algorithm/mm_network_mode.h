@@ -0,0 +1,54 @@
+/**
+file: mm_network_mode.h
+brief: Picks the BLAZE channel period the network runs at from the activity in the grids.
+notes:
+    A sensor event that leaves its grid active switches the network to the
+    low-latency period right away, so the rest of a crossing reaches the
+    gateway quickly. The network stays there until every grid has been
+    quiet for NETWORK_MODE_IDLE_HOLD_S, then drops back to the low-power
+    period. A grid is quiet while none of its sensors are detecting and all
+    of its AVs are idle.
+*/
+#ifndef MM_NETWORK_MODE_H
+#define MM_NETWORK_MODE_H
+
+/**********************************************************
+                        INCLUDES
+**********************************************************/
+
+#include <stdint.h>
+
+/**********************************************************
+                        CONSTANTS
+**********************************************************/
+
+#define NETWORK_MODE_IDLE_HOLD_S    ( 60 )
+
+/**********************************************************
+                       DECLARATIONS
+**********************************************************/
+
+/**
+    Start in the low-latency mode, the period every node starts at.
+*/
+void mm_network_mode_init(void);
+
+/**
+    Check a grid after it has processed a sensor event, switching
+    to the low-latency mode if the grid is active. Reinforcements of a quiet
+    sensor leave the mode alone.
+*/
+void mm_network_mode_on_sensor_evt(uint8_t grid_id);
+
+/**
+    Call once per second, after every grid has processed the second.
+*/
+void mm_network_mode_on_second_elapsed(void);
+
+/**
+    Counts how many more seconds can elapse before the network should drop to
+    the low-power mode, capped at max_seconds.
+*/
+uint32_t mm_network_mode_seconds_until_update(uint32_t max_seconds);
+
+#endif /* MM_NETWORK_MODE_H */
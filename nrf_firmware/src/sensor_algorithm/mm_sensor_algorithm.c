@@ -21,8 +21,13 @@ notes:
 #include "mm_activity_variable_drain.h"
 #include "mm_led_strip_states.h"
 #include "mm_activity_variable_growth.h"
+#include "mm_trajectory_tracker.h"
+#include "mm_wildlife_statistics.h"
+#include "mm_sensor_algorithm_snapshot.h"
 #include "mm_position_config.h"
 #include "mm_sensor_error_check.h"
+#include "mm_sensor_registry.h"
+#include "mm_network_mode.h"
 
 /**********************************************************
                         CONSTANTS
@@ -35,6 +40,10 @@ notes:
 #define MINUTES_PER_HOUR    ( 60  )
 #define HOURS_PER_DAY       ( 24  )
 
+/*  When tickless, the timer is only armed for the next second that can
+    change an output. Skipped seconds are caught up on the next wakeup. */
+#define SENSOR_ALGORITHM_TICKLESS   ( true )
+
 /**********************************************************
                           TYPES
 **********************************************************/
@@ -48,11 +57,52 @@ notes:
 */
 static void sensor_data_evt_handler(sensor_evt_t const * evt);
 
+/**
+    Gets the grid the sensor in an event belongs to.
+    Returns false if the sensor isn't part of any grid this gateway runs.
+*/
+static bool get_grid_for_evt(sensor_evt_t const * evt, uint8_t * p_grid_id);
+
 /**
     Timer handler to process second tick.
 */
 static void one_second_timer_handler(void * p_context);
 
+#if(SENSOR_ALGORITHM_TICKLESS)
+    /**
+        Called from main context when the deadline timer expires.
+    */
+    static void on_wakeup(void* p_unused, uint16_t size_0);
+
+    /**
+        Runs on_second_elapsed for every whole second that has passed
+        since the last one was processed.
+    */
+    static void catch_up_elapsed_seconds(void);
+
+    /**
+        Gets the number of whole seconds that have passed but have not
+        been processed yet.
+    */
+    static uint32_t get_pending_seconds(void);
+
+    /**
+        Marks one pending second as processed.
+    */
+    static void consume_pending_second(void);
+
+    /**
+        Arms the timer for the next deadline.
+    */
+    static void schedule_next_wakeup(void);
+
+    /**
+        Gets the number of seconds until the earliest second that can
+        change an output. Always at least 1.
+    */
+    static uint32_t get_seconds_until_next_deadline(void);
+#endif
+
 /**
     Check if node positions have changed, and apply an update to all
     users if so.
@@ -61,6 +111,12 @@ static void one_second_timer_handler(void * p_context);
  */
 static void update_node_positions(void);
 
+/**
+    Swap in a grid's staged config, if it has one, and bring
+    the grid's algorithm state in line with it. Activity variables carry over.
+ */
+static void apply_staged_config(uint8_t grid_id);
+
 /**
  * Tick events, second, minute, etc.
  *
@@ -89,6 +145,23 @@ static uint32_t second_counter = 0;
 static uint32_t minute_counter = 0;
 static uint32_t hour_counter = 0;
 
+#if(SENSOR_ALGORITHM_TICKLESS)
+    #ifdef MM_ALLOW_SIMULATED_TIME
+        /* Simulated seconds that have passed but not been processed yet. */
+        static uint32_t simulated_pending_seconds = 0;
+        /* Number of pending seconds that will trigger the next wakeup. */
+        static uint32_t simulated_deadline_s = 0;
+    #else
+        /* Timer count at the start of the last processed second. */
+        static uint32_t last_second_ticks = 0;
+    #endif
+#endif
+
+#ifdef MM_ALLOW_SIMULATED_TIME
+    /* Number of timer wakeups, for measuring idle cost. */
+    static uint32_t wakeup_count = 0;
+#endif
+
 /**********************************************************
                        DECLARATIONS
 **********************************************************/
@@ -102,18 +175,53 @@ void mm_sensor_algorithm_init(mm_sensor_algorithm_config_t const * config)
     minute_counter = 0;
     hour_counter = 0;
 
-    /* Initialize dynamic algorithm constants. */
-    mm_sensor_algorithm_config_init(config);
+#ifdef MM_ALLOW_SIMULATED_TIME
+    wakeup_count = 0;
+#endif
 
-    /* Initialize algorithm components. */
-    mm_sensor_error_init();
-    mm_activity_variables_init();
-    mm_activity_variable_growth_init();
-    mm_led_strip_states_init();
+    for (uint8_t grid_id = 0; grid_id < MAX_SENSOR_GRIDS; grid_id++)
+    {
+        /* Initialize dynamic algorithm constants. */
+        mm_sensor_algorithm_config_init(grid_id, config);
+
+        /* Initialize algorithm components. */
+        mm_sensor_registry_init(grid_id);
+        mm_sensor_error_init(grid_id);
+        mm_activity_variables_init(grid_id);
+        mm_activity_variable_growth_init(grid_id);
+        mm_trajectory_tracker_init(grid_id);
+        mm_wildlife_statistics_init(grid_id);
+        mm_led_strip_states_init(grid_id);
+    }
+
+    mm_network_mode_init();
+
+    /* Carry on from before a reset, aged by about how long the gateway was down. */
+    if (mm_sensor_algorithm_snapshot_restore(get_minute_timestamp()))
+    {
+        for (uint32_t i = 0; i < SNAPSHOT_ESTIMATED_DOWNTIME_S; i++)
+        {
+            on_second_elapsed(NULL, 0);
+        }
+    }
 
     /* Register for sensor data with sensor_transmission.h */
     mm_sensor_transmission_register_sensor_data(sensor_data_evt_handler);
 
+#if(SENSOR_ALGORITHM_TICKLESS)
+    /* Initialize deadline timer. */
+    uint32_t err_code;
+    err_code = app_timer_create(&m_second_timer_id, APP_TIMER_MODE_SINGLE_SHOT, one_second_timer_handler);
+    APP_ERROR_CHECK(err_code);
+
+    #ifdef MM_ALLOW_SIMULATED_TIME
+        simulated_pending_seconds = 0;
+    #else
+        last_second_ticks = app_timer_cnt_get();
+    #endif
+
+    schedule_next_wakeup();
+#else
     /* Initialize 1 second timer. */
     uint32_t err_code;
     err_code = app_timer_create(&m_second_timer_id, APP_TIMER_MODE_REPEATED, one_second_timer_handler);
@@ -121,6 +229,35 @@ void mm_sensor_algorithm_init(mm_sensor_algorithm_config_t const * config)
 
     err_code = app_timer_start(m_second_timer_id, ONE_SECOND_TICKS, NULL);
     APP_ERROR_CHECK(err_code);
+#endif
+}
+
+/**
+ * Replace the dynamic algorithm constants for one grid, leaving the other grids
+ * on the config they were initialized with. Resets that grid's activity variables.
+ */
+void mm_sensor_algorithm_set_grid_config(uint8_t grid_id, mm_sensor_algorithm_config_t const * config)
+{
+    mm_sensor_algorithm_config_init(grid_id, config);
+
+    /* Activity variables start at the config's minimum. */
+    mm_activity_variables_init(grid_id);
+
+#if(SENSOR_ALGORITHM_TICKLESS)
+    schedule_next_wakeup();
+#endif
+}
+
+/**
+ * Called once a new config has been staged for a grid. The config is applied
+ * at the start of the next second, so every component sees the same config for a whole tick.
+ */
+void mm_sensor_algorithm_on_config_staged(void)
+{
+#if(SENSOR_ALGORITHM_TICKLESS)
+    /* Wake up for the next second to apply it. */
+    schedule_next_wakeup();
+#endif
 }
 
 #ifdef MM_ALLOW_SIMULATED_TIME
@@ -129,7 +266,25 @@ void mm_sensor_algorithm_init(mm_sensor_algorithm_config_t const * config)
  */
 void mm_sensor_algorithm_on_second_elapsed(void)
 {
+#if(SENSOR_ALGORITHM_TICKLESS)
+    /* Only wake up if the timer would have expired. */
+    simulated_pending_seconds++;
+    if (simulated_pending_seconds >= simulated_deadline_s)
+    {
+        on_wakeup(NULL, 0);
+    }
+#else
+    wakeup_count++;
     on_second_elapsed(NULL, 0);
+#endif
+}
+
+/**
+ * Get the number of times the algorithm has been woken by its timer.
+ */
+uint32_t mm_sensor_algorithm_get_wakeup_count(void)
+{
+    return wakeup_count;
 }
 #endif
 
@@ -138,13 +293,67 @@ void mm_sensor_algorithm_on_second_elapsed(void)
 */
 static void sensor_data_evt_handler(sensor_evt_t const * evt)
 {
+#if(SENSOR_ALGORITHM_TICKLESS)
+    /* Bring the algorithm up to date before applying the new data. */
+    catch_up_elapsed_seconds();
+#endif
+
     /* Make sure everyone has valid node positions before processing the event. */
     update_node_positions();
 
-    /* Now sensor data can be processed with respect to the algorithm. */
-    mm_sensor_error_record_sensor_activity(evt, get_minute_timestamp());
+    /* Only the grid the sensor belongs to sees the event. */
+    uint8_t grid_id;
+    if (get_grid_for_evt(evt, &grid_id))
+    {
+        /* Resolve which sensor sent the event once, everything after this works off the handle. */
+        mm_sensor_handle_t handle = mm_sensor_registry_resolve_evt(grid_id, evt);
 
-    mm_activity_variable_growth_on_sensor_detection(evt);
+        /* Now sensor data can be processed with respect to the algorithm. */
+        mm_sensor_error_record_sensor_activity(grid_id, handle, get_minute_timestamp());
+
+        mm_activity_variable_growth_on_sensor_detection(grid_id, evt, handle);
+
+        /* Escalate LED outputs now rather than waiting for the next second tick. */
+        mm_led_signalling_states_on_sensor_detection(grid_id);
+
+        /* Speed the network up for the rest of the crossing. */
+        mm_network_mode_on_sensor_evt(grid_id);
+    }
+
+#if(SENSOR_ALGORITHM_TICKLESS)
+    /* The new data may have brought the next deadline closer. */
+    schedule_next_wakeup();
+#endif
+}
+
+/**
+    Gets the grid the sensor in an event belongs to.
+    Returns false if the sensor isn't part of any grid this gateway runs.
+*/
+static bool get_grid_for_evt(sensor_evt_t const * evt, uint8_t * p_grid_id)
+{
+    uint16_t node_id;
+
+    switch (evt->sensor_type)
+    {
+        case SENSOR_TYPE_PIR:
+            node_id = evt->pir_data.node_id;
+            break;
+        case SENSOR_TYPE_LIDAR:
+            node_id = evt->lidar_data.node_id;
+            break;
+        default:
+            /* App error, unknown sensor data type. */
+            APP_ERROR_CHECK(true);
+            return false;
+    }
+
+    /* Nodes without a position yet can't be placed in a grid, the default grid
+       still registers them so they are tracked once their position arrives. */
+    mm_node_position_t const * position = get_position_for_node(node_id);
+    *p_grid_id = ( position == NULL ) ? DEFAULT_GRID_ID : position->grid_id;
+
+    return ( *p_grid_id < MAX_SENSOR_GRIDS );
 }
 
 /**
@@ -153,10 +362,151 @@ static void sensor_data_evt_handler(sensor_evt_t const * evt)
 static void one_second_timer_handler(void * p_context)
 {
     /* Kick timer event to main. */
+#if(SENSOR_ALGORITHM_TICKLESS)
+    uint32_t err_code = app_sched_event_put(NULL, 0, on_wakeup);
+#else
     uint32_t err_code = app_sched_event_put(NULL, 0, on_second_elapsed);
+#endif
     APP_ERROR_CHECK(err_code);
 }
 
+#if(SENSOR_ALGORITHM_TICKLESS)
+    /**
+        Called from main context when the deadline timer expires.
+    */
+    static void on_wakeup(void* p_unused, uint16_t size_0)
+    {
+    #ifdef MM_ALLOW_SIMULATED_TIME
+        wakeup_count++;
+    #endif
+
+        catch_up_elapsed_seconds();
+        schedule_next_wakeup();
+    }
+
+    /**
+        Runs on_second_elapsed for every whole second that has passed
+        since the last one was processed.
+
+        Deadlines guarantee none of the skipped seconds would have changed
+        an output, so replaying them late gives the same result.
+    */
+    static void catch_up_elapsed_seconds(void)
+    {
+        for (uint32_t pending = get_pending_seconds(); pending > 0; --pending)
+        {
+            consume_pending_second();
+            on_second_elapsed(NULL, 0);
+        }
+    }
+
+    /**
+        Gets the number of whole seconds that have passed but have not
+        been processed yet.
+    */
+    static uint32_t get_pending_seconds(void)
+    {
+    #ifdef MM_ALLOW_SIMULATED_TIME
+        return simulated_pending_seconds;
+    #else
+        return app_timer_cnt_diff_compute(app_timer_cnt_get(), last_second_ticks) / ONE_SECOND_TICKS;
+    #endif
+    }
+
+    /**
+        Marks one pending second as processed.
+    */
+    static void consume_pending_second(void)
+    {
+    #ifdef MM_ALLOW_SIMULATED_TIME
+        simulated_pending_seconds--;
+    #else
+        /* Counter difference is masked to the counter width, so wrapping here is fine. */
+        last_second_ticks += ONE_SECOND_TICKS;
+    #endif
+    }
+
+    /**
+        Arms the timer for the next deadline.
+    */
+    static void schedule_next_wakeup(void)
+    {
+        uint32_t seconds = get_seconds_until_next_deadline();
+
+    #ifdef MM_ALLOW_SIMULATED_TIME
+        simulated_deadline_s = seconds;
+    #else
+        /* Keep the deadline aligned to the original second boundaries. */
+        uint32_t elapsed_ticks = app_timer_cnt_diff_compute(app_timer_cnt_get(), last_second_ticks);
+        uint32_t timeout_ticks = seconds * ONE_SECOND_TICKS;
+
+        if (timeout_ticks > elapsed_ticks + APP_TIMER_MIN_TIMEOUT_TICKS)
+        {
+            timeout_ticks -= elapsed_ticks;
+        }
+        else
+        {
+            timeout_ticks = APP_TIMER_MIN_TIMEOUT_TICKS;
+        }
+
+        uint32_t err_code;
+        err_code = app_timer_stop(m_second_timer_id);
+        APP_ERROR_CHECK(err_code);
+
+        err_code = app_timer_start(m_second_timer_id, timeout_ticks, NULL);
+        APP_ERROR_CHECK(err_code);
+    #endif
+    }
+
+    /**
+        Gets the number of seconds until the earliest second that can
+        change an output. Always at least 1.
+    */
+    static uint32_t get_seconds_until_next_deadline(void)
+    {
+        /* Pending position and config updates need every second. */
+        if (have_node_positions_changed() || mm_sensor_algorithm_config_has_staged())
+        {
+            return 1;
+        }
+
+        /* Sensor error checks run on each minute boundary. */
+        uint32_t seconds = SECONDS_PER_MINUTE - second_counter;
+
+        /* The earliest deadline across every grid wins. */
+        for (uint8_t grid_id = 0; grid_id < MAX_SENSOR_GRIDS; grid_id++)
+        {
+            /* Active sensors need every second. */
+            if (mm_activity_variable_growth_is_trickling(grid_id))
+            {
+                return 1;
+            }
+
+        #if(TRAJECTORY_PREDICTION)
+            /* Predictions move on every second while an animal is tracked. */
+            if (mm_trajectory_tracker_is_tracking(grid_id))
+            {
+                return 1;
+            }
+        #endif
+
+            /* AV threshold crossings as the AVs drain. */
+            seconds = mm_activity_variable_drain_seconds_until_state_change(grid_id, seconds);
+
+            /* LED minimum duration expiries. */
+            seconds = mm_led_signalling_states_seconds_until_update(grid_id, seconds);
+        }
+
+        /* Changed state is written to flash within a snapshot period. */
+        seconds = mm_sensor_algorithm_snapshot_seconds_until_write(get_minute_timestamp(), seconds);
+
+        /* The network slows down once it has been quiet for long enough. */
+        seconds = mm_network_mode_seconds_until_update(seconds);
+
+        return seconds;
+    }
+#endif
+
 /**
     Called every second from main context.
 */
@@ -173,9 +523,21 @@ static void on_second_elapsed(void* p_unused, uint16_t size_0)
         on_minute_elapsed();
     }
 
-    mm_activity_variable_growth_on_second_elapsed();
-    mm_apply_activity_variable_drain_factor();
-    mm_led_signalling_states_on_second_elapsed(get_second_timestamp());
+    for (uint8_t grid_id = 0; grid_id < MAX_SENSOR_GRIDS; grid_id++)
+    {
+        /* Config updates only take effect on a tick boundary. */
+        apply_staged_config(grid_id);
+
+        mm_activity_variable_growth_on_second_elapsed(grid_id);
+        mm_trajectory_tracker_on_second_elapsed(grid_id);
+        mm_wildlife_statistics_on_second_elapsed(grid_id);
+        mm_apply_activity_variable_drain_factor(grid_id);
+        mm_led_signalling_states_on_second_elapsed(grid_id, get_second_timestamp());
+    }
+
+    mm_sensor_algorithm_snapshot_on_second_elapsed(get_minute_timestamp());
+
+    mm_network_mode_on_second_elapsed();
 
     /* Space left to add other once-per-second updates if
      * necessary in the future. */
@@ -194,7 +556,10 @@ static void on_minute_elapsed(void)
         hour_counter++;
     }
 
-    mm_sensor_error_on_minute_elapsed(get_minute_timestamp());
+    for (uint8_t grid_id = 0; grid_id < MAX_SENSOR_GRIDS; grid_id++)
+    {
+        mm_sensor_error_on_minute_elapsed(grid_id);
+    }
 }
 
 /**
@@ -223,10 +588,28 @@ static void update_node_positions(void)
 {
     if(have_node_positions_changed())
     {
-        /* Tell all users we are about to clear the flag: */
-        mm_sensor_error_on_node_positions_update(get_minute_timestamp());
-        mm_led_signalling_states_on_position_update();
+        /* Tell all users in every grid we are about to clear the flag: */
+        for (uint8_t grid_id = 0; grid_id < MAX_SENSOR_GRIDS; grid_id++)
+        {
+            mm_sensor_registry_on_node_positions_update(grid_id);
+            mm_sensor_error_on_node_positions_update(grid_id);
+            mm_activity_variable_growth_on_node_positions_update(grid_id);
+            mm_led_signalling_states_on_position_update(grid_id);
+        }
         /* Clear the flag: */
         clear_unread_node_positions();
     }
 }
+
+/**
+    Swap in a grid's staged config, if it has one, and bring
+    the grid's algorithm state in line with it. Activity variables carry over.
+ */
+static void apply_staged_config(uint8_t grid_id)
+{
+    if(mm_sensor_algorithm_config_apply_staged(grid_id))
+    {
+        mm_activity_variables_on_config_update(grid_id);
+        mm_activity_variable_growth_on_config_update(grid_id);
+    }
+}
@@ -21,17 +21,35 @@ notes:
 **********************************************************/
 
 /**
- * Initialize and start the sensor data processing algorithm.
+ * Initialize and start the sensor data processing algorithm. Every grid
+ * starts with the same config.
  *
  * Note: Requires sensor_transmission.h is initialized.
  */
 void mm_sensor_algorithm_init(mm_sensor_algorithm_config_t const * config);
 
+/**
+ * Replace the dynamic algorithm constants for one grid, leaving the other grids
+ * on the config they were initialized with. Resets that grid's activity variables.
+ */
+void mm_sensor_algorithm_set_grid_config(uint8_t grid_id, mm_sensor_algorithm_config_t const * config);
+
+/**
+ * Called once a new config has been staged for a grid. The config is applied
+ * at the start of the next second, so every component sees the same config for a whole tick.
+ */
+void mm_sensor_algorithm_on_config_staged(void);
+
 #ifdef MM_ALLOW_SIMULATED_TIME
     /**
      * Simulate a second passing, only use for simulating time, not in production.
      */
     void mm_sensor_algorithm_on_second_elapsed(void);
+
+    /**
+     * Get the number of times the algorithm has been woken by its timer.
+     */
+    uint32_t mm_sensor_algorithm_get_wakeup_count(void);
 #endif
 
 #endif /* MM_SENSOR_ALGORITHM_H */
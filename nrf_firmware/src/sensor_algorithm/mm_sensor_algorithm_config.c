@@ -8,14 +8,45 @@ notes:
                         INCLUDES
 **********************************************************/
 
+#include <string.h>
+
+#include "app_error.h"
+
 #include "mm_sensor_algorithm_config.h"
 
+/**********************************************************
+                          TYPES
+**********************************************************/
+
+/**
+    Double buffered config for one grid. The algorithm only ever reads the active
+    buffer, updates are written to the other one and swapped in between ticks.
+*/
+typedef struct
+{
+    mm_sensor_algorithm_config_t    buffers[2];
+    uint8_t                         active;
+    bool                            is_editing; /* Shadow holds a copy of the active config being edited. */
+    bool                            is_staged;  /* Shadow has been validated and is waiting to be applied. */
+} algorithm_config_instance_t;
+
 /**********************************************************
              ALGORITHM CONFIGURATION INSTANCE
 **********************************************************/
 
-/* Singleton container for the dynamic sensor algorithm constants. */
-mm_sensor_algorithm_config_t const * sensor_algorithm_config;
+/* Container for the dynamic sensor algorithm constants of each grid. */
+static algorithm_config_instance_t sensor_algorithm_configs[MAX_SENSOR_GRIDS];
+
+/**********************************************************
+                       DECLARATIONS
+**********************************************************/
+
+#ifndef MM_STATIC_ALGORITHM_CONFIG
+/**
+    Checks that a config describes a usable algorithm.
+*/
+static bool is_config_valid(mm_sensor_algorithm_config_t const * config);
+#endif
 
 /**********************************************************
                        DEFINITIONS
@@ -23,19 +54,174 @@ mm_sensor_algorithm_config_t const * sensor_algorithm_config;
 
 /**
     Initializes the dynamic sensor algorithm configuration
-    constants. Should never be used more than once!
+    constants for a grid. Should never be used more than once per grid!
+    MM_STATIC_ALGORITHM_CONFIG builds read the folded config regardless.
+*/
+void mm_sensor_algorithm_config_init(uint8_t grid_id, mm_sensor_algorithm_config_t const * config)
+{
+    APP_ERROR_CHECK(grid_id >= MAX_SENSOR_GRIDS);
+
+    algorithm_config_instance_t* instance = &sensor_algorithm_configs[grid_id];
+
+    memcpy(&(instance->buffers[0]), config, sizeof(mm_sensor_algorithm_config_t));
+    instance->active = 0;
+    instance->is_editing = false;
+    instance->is_staged = false;
+}
+
+#ifndef MM_STATIC_ALGORITHM_CONFIG
+/**
+    Gets the dynamic sensor algorithm configuration constants for a
+    grid. Assumes that they have been previously configured
+    using mm_sensor_algorithm_config_init once before!
+*/
+mm_sensor_algorithm_config_t const * mm_sensor_algorithm_config(uint8_t grid_id)
+{
+    algorithm_config_instance_t const * instance = &sensor_algorithm_configs[grid_id];
+
+    return &(instance->buffers[instance->active]);
+}
+#endif
+
+/**
+    Gets the shadow config for a grid so an update can be written into it.
+    The shadow starts as a copy of the active config, and stays open for
+    edits until it is staged. Editing a staged shadow withdraws it until it
+    is staged again.
+*/
+mm_sensor_algorithm_config_t * mm_sensor_algorithm_config_shadow(uint8_t grid_id)
+{
+    APP_ERROR_CHECK(grid_id >= MAX_SENSOR_GRIDS);
+
+    algorithm_config_instance_t* instance = &sensor_algorithm_configs[grid_id];
+    mm_sensor_algorithm_config_t* shadow = &(instance->buffers[1 - instance->active]);
+
+    if (!instance->is_editing)
+    {
+        memcpy(shadow, &(instance->buffers[instance->active]), sizeof(mm_sensor_algorithm_config_t));
+        instance->is_editing = true;
+    }
+
+    instance->is_staged = false;
+
+    return shadow;
+}
+
+/**
+    Validates the shadow config for a grid and, if it is usable, stages it to be
+    applied at the next tick. An invalid shadow is discarded, as is every shadow
+    in MM_STATIC_ALGORITHM_CONFIG builds.
+
+    Returns true if the shadow was staged.
 */
-void mm_sensor_algorithm_config_init(mm_sensor_algorithm_config_t const * config)
+bool mm_sensor_algorithm_config_stage(uint8_t grid_id)
 {
-    sensor_algorithm_config = config;
+    APP_ERROR_CHECK(grid_id >= MAX_SENSOR_GRIDS);
+
+    algorithm_config_instance_t* instance = &sensor_algorithm_configs[grid_id];
+
+    if (!instance->is_editing)
+    {
+        /* Nothing has been written since the last update. */
+        return false;
+    }
+
+    instance->is_editing = false;
+#ifdef MM_STATIC_ALGORITHM_CONFIG
+    /* The active config is folded into the build, there is nothing to swap an update into. */
+    instance->is_staged = false;
+#else
+    instance->is_staged = is_config_valid(&(instance->buffers[1 - instance->active]));
+#endif
+
+    return instance->is_staged;
 }
 
 /**
-    Gets the dynamic sensor algorithm configuration constants. Assumes that
-    they have been previously configured using mm_sensor_algorithm_config_init
-    once before!
+    Checks if any grid has a staged config waiting to be applied.
 */
-mm_sensor_algorithm_config_t const * mm_sensor_algorithm_config(void)
+bool mm_sensor_algorithm_config_has_staged(void)
 {
-    return sensor_algorithm_config;
+    for (uint8_t grid_id = 0; grid_id < MAX_SENSOR_GRIDS; grid_id++)
+    {
+        if (sensor_algorithm_configs[grid_id].is_staged)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+    Swaps a grid's staged config in as its active config.
+    Only call between ticks, so every component sees the same config for a whole tick.
+
+    Returns true if a config was applied.
+*/
+bool mm_sensor_algorithm_config_apply_staged(uint8_t grid_id)
+{
+    APP_ERROR_CHECK(grid_id >= MAX_SENSOR_GRIDS);
+
+    algorithm_config_instance_t* instance = &sensor_algorithm_configs[grid_id];
+
+    if (!instance->is_staged)
+    {
+        return false;
+    }
+
+    instance->active = 1 - instance->active;
+    instance->is_staged = false;
+
+    return true;
+}
+
+#ifndef MM_STATIC_ALGORITHM_CONFIG
+/**
+    Checks that a config describes a usable algorithm.
+*/
+static bool is_config_valid(mm_sensor_algorithm_config_t const * config)
+{
+    /* AVs need room to grow, and must stay positive for the decay factor to drain them. */
+    if (!(config->activity_variable_min > 0.0f) ||
+        !(config->activity_variable_min < config->activity_variable_max))
+    {
+        return false;
+    }
+
+    /* Weights multiply together, a non-positive one would drain AVs on detection. */
+    if (!(config->common_sensor_weight_factor > 0.0f) ||
+        !(config->base_sensor_weight_factor_pir > 0.0f) ||
+        !(config->base_sensor_weight_factor_lidar > 0.0f) ||
+        !(config->road_proximity_factor_0 > 0.0f) ||
+        !(config->road_proximity_factor_1 > 0.0f) ||
+        !(config->road_proximity_factor_2 > 0.0f) ||
+        !(config->common_sensor_trickle_factor > 0.0f) ||
+        !(config->base_sensor_trickle_factor_pir > 0.0f) ||
+        !(config->base_sensor_trickle_factor_lidar > 0.0f) ||
+        !(config->road_trickle_proximity_factor_0 > 0.0f) ||
+        !(config->road_trickle_proximity_factor_1 > 0.0f) ||
+        !(config->road_trickle_proximity_factor_2 > 0.0f))
+    {
+        return false;
+    }
+
+    /* AVs have to drain back to the minimum, but not vanish in a single step. */
+    if (!(config->activity_variable_decay_factor > 0.0f) ||
+        !(config->activity_variable_decay_factor < 1.0f))
+    {
+        return false;
+    }
+
+    /* Possible detections have to come before detections, and both have to be reachable. */
+    if (!(config->possible_detection_threshold_rs < config->detection_threshold_rs) ||
+        !(config->possible_detection_threshold_nrs < config->detection_threshold_nrs) ||
+        !(config->detection_threshold_rs <= config->activity_variable_max) ||
+        !(config->detection_threshold_nrs <= config->activity_variable_max))
+    {
+        return false;
+    }
+
+    return true;
 }
+#endif
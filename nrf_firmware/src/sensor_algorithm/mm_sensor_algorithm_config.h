@@ -12,6 +12,7 @@ notes:
 **********************************************************/
 
 #include "stdint.h"
+#include "stdbool.h"
 
 /**********************************************************
                     ALGORITHM CONSTANTS
@@ -20,16 +21,59 @@ notes:
 /**
     Static sensor algorithm constants.
 */
+/* Grid dimensions may be overridden at build time (e.g. -DMAX_GRID_SIZE_X=8) to cover a longer stretch of road. */
+#ifndef MAX_GRID_SIZE_X
 #define MAX_GRID_SIZE_X                     ( 3 )
+#endif
+#ifndef MAX_GRID_SIZE_Y
 #define MAX_GRID_SIZE_Y                     ( 3 )
+#endif
 #define MAX_NUMBER_NODES                    ( MAX_GRID_SIZE_X * MAX_GRID_SIZE_Y )
 #define MAX_SENSORS_PER_NODE                ( 2 )
 #define MAX_SENSOR_COUNT                    ( MAX_NUMBER_NODES * MAX_SENSORS_PER_NODE )
 
+/* Sensors are registered from both node positions and the data they send, which only
+   disagree when a node is misconfigured. Leave room for both. */
+#define MAX_SENSOR_HANDLES                  ( 2 * MAX_SENSOR_COUNT )
+
+/* A gateway can run several independent grids, each with its own algorithm instance and config.
+   Grid sizes above apply to each grid. Only MONITORED_SENSOR_GRID streams AVs to the monitoring application. */
+#ifndef MAX_SENSOR_GRIDS
+#define MAX_SENSOR_GRIDS                    ( 1 )
+#endif
+#define MAX_GATEWAY_NODES                   ( MAX_NUMBER_NODES * MAX_SENSOR_GRIDS )
+#define MONITORED_SENSOR_GRID               ( 0 )
+
+/**
+    Range of node grid positions. Nodes are placed from (GRID_POSITION_MIN_X, GRID_POSITION_MIN_Y),
+    the row furthest from the road, up to GRID_POSITION_MAX_Y, the roadside row which carries the LEDs.
+*/
+#define GRID_POSITION_MIN_X                 ( -1 )
+#define GRID_POSITION_MAX_X                 ( GRID_POSITION_MIN_X + MAX_GRID_SIZE_X - 1 )
+#define GRID_POSITION_MIN_Y                 ( -1 )
+#define GRID_POSITION_MAX_Y                 ( GRID_POSITION_MIN_Y + MAX_GRID_SIZE_Y - 1 )
+#define GRID_POSITION_LED_Y                 ( GRID_POSITION_MAX_Y )
+
+/* Position pages carry grid positions as signed 4-bit values, -8 to 7, and a grid needs at least one AV. */
+#if ( GRID_POSITION_MAX_X > 7 ) || ( GRID_POSITION_MAX_Y > 7 )
+#error "MAX_GRID_SIZE_X and MAX_GRID_SIZE_Y can be at most 9, position pages only hold grid positions -8 to 7."
+#endif
+#if ( MAX_GRID_SIZE_X < 2 ) || ( MAX_GRID_SIZE_Y < 2 )
+#error "MAX_GRID_SIZE_X and MAX_GRID_SIZE_Y must be at least 2."
+#endif
+
 #define SENSOR_INACTIVITY_THRESHOLD_MIN         ( 60 * 24 )
 #define SENSOR_HYPERACTIVITY_EVENT_WINDOW_SIZE  ( 120 )
 #define SENSOR_HYPERACTIVITY_FREQUENCY_THRES    ( 1.0 ) // events / SENSOR_HYPERACTIVITY_DETECTION_PERIOD
 
+/**
+    Hyperactivity is estimated by counting events in fixed width buckets over the
+    last SENSOR_HYPERACTIVITY_EVENT_WINDOW_SIZE / SENSOR_HYPERACTIVITY_FREQUENCY_THRES minutes.
+    BUCKET_MIN * BUCKET_COUNT must cover that span.
+*/
+#define SENSOR_HYPERACTIVITY_BUCKET_MIN         ( 8 )
+#define SENSOR_HYPERACTIVITY_BUCKET_COUNT       ( 15 )
+
 /**********************************************************
                     ALGORITHM TUNING
 **********************************************************/
@@ -70,6 +114,16 @@ typedef struct
     uint16_t minimum_alarm_signal_duration_s;
 } mm_sensor_algorithm_config_t;
 
+/**
+    Production builds can fold a tuned config into the firmware as compile time
+    constants instead of reading it at runtime. The config comes from
+    mm_sensor_algorithm_static_config.h, generated by genetic_algo.py.
+    Tuning builds leave this off so configs can be swapped at runtime.
+*/
+#ifdef MM_STATIC_ALGORITHM_CONFIG
+#include "mm_sensor_algorithm_static_config.h"
+#endif
+
 
 /**********************************************************
                      DECLARATIONS
@@ -77,16 +131,58 @@ typedef struct
 
 /**
     Initializes the dynamic sensor algorithm configuration
-    constants. Should never be used more than once!
+    constants for a grid. Should never be used more than once per grid!
+*/
+void mm_sensor_algorithm_config_init(uint8_t grid_id, mm_sensor_algorithm_config_t const * config);
+
+#ifdef MM_STATIC_ALGORITHM_CONFIG
+/**
+    Gets the sensor algorithm configuration constants folded into the build.
+    Every grid shares them, and since the accessor is inline every field
+    read compiles to an immediate. Factors of 1.0 drop out entirely.
 */
-void mm_sensor_algorithm_config_init(mm_sensor_algorithm_config_t const * config);
+static inline mm_sensor_algorithm_config_t const * mm_sensor_algorithm_config(uint8_t grid_id)
+{
+    return &sensor_algorithm_static_config;
+}
+#else
+/**
+    Gets the dynamic sensor algorithm configuration constants for a
+    grid. Assumes that they have been previously configured
+    using mm_sensor_algorithm_config_init once before!
+*/
+mm_sensor_algorithm_config_t const * mm_sensor_algorithm_config(uint8_t grid_id);
+#endif
+
+/**
+    Gets the shadow config for a grid so an update can be written into it.
+    The shadow starts as a copy of the active config, and stays open for
+    edits until it is staged. Editing a staged shadow withdraws it until it
+    is staged again.
+*/
+mm_sensor_algorithm_config_t * mm_sensor_algorithm_config_shadow(uint8_t grid_id);
+
+/**
+    Validates the shadow config for a grid and, if it is usable, stages it to be
+    applied at the next tick. An invalid shadow is discarded, as is every shadow
+    in MM_STATIC_ALGORITHM_CONFIG builds.
+
+    Returns true if the shadow was staged.
+*/
+bool mm_sensor_algorithm_config_stage(uint8_t grid_id);
 
 /**
-    Gets the dynamic sensor algorithm configuration constants. Assumes that
-    they have been previously configured using mm_sensor_algorithm_config_init
-    once before!
+    Checks if any grid has a staged config waiting to be applied.
+*/
+bool mm_sensor_algorithm_config_has_staged(void);
+
+/**
+    Swaps a grid's staged config in as its active config.
+    Only call between ticks, so every component sees the same config for a whole tick.
+
+    Returns true if a config was applied.
 */
-mm_sensor_algorithm_config_t const * mm_sensor_algorithm_config(void);
+bool mm_sensor_algorithm_config_apply_staged(uint8_t grid_id);
 
 #endif /* MM_SENSOR_ALGORITHM_CONFIG_H */
 
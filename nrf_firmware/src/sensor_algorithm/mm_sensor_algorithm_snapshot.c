@@ -0,0 +1,207 @@
+/**
+file: mm_sensor_algorithm_snapshot.c
+brief: Keeps a copy of the sensor algorithm's state in flash, so a reset gateway can carry on where it was.
+notes:
+    A snapshot is only written when it differs from the last one written, so
+    an idle grid doesn't wear the flash. While an animal is around the AVs and
+    LED timeouts change every second, which costs a write every SNAPSHOT_PERIOD_S.
+
+    Only changed LED outputs wake a tickless algorithm to write them. Draining
+    AVs and sensor error changes are written at its next wakeup, so the tail of
+    a detection doesn't cost a wakeup every SNAPSHOT_PERIOD_S.
+
+    Snapshots carry a version, bump it whenever the layout changes so a gateway
+    doesn't restore a snapshot written by different firmware. Grids too large
+    for a flash record (see FLASH_STORAGE_MAX_RECORD_SIZE) are never persisted.
+*/
+
+/**********************************************************
+                       INCLUDES
+**********************************************************/
+
+#include <string.h>
+
+#include "mm_sensor_algorithm_snapshot.h"
+#include "mm_sensor_algorithm_config.h"
+#include "mm_activity_variables.h"
+#include "mm_led_strip_states.h"
+#include "mm_sensor_error_check.h"
+#include "mm_flash_storage_pub.h"
+
+/**********************************************************
+                        CONSTANTS
+**********************************************************/
+
+#define SNAPSHOT_VERSION    ( 1 )
+
+/**********************************************************
+                          TYPES
+**********************************************************/
+
+typedef struct
+{
+    mm_activity_variable_t          activity_variables[ACTIVITY_VARIABLES_NUM];
+    mm_led_strip_states_snapshot_t  led_states;
+    mm_sensor_error_snapshot_t      sensor_errors;
+} grid_snapshot_t;
+
+typedef struct
+{
+    uint32_t        version;
+    uint32_t        grid_count;
+    grid_snapshot_t grids[MAX_SENSOR_GRIDS];
+} algorithm_snapshot_t;
+
+/**********************************************************
+                       DECLARATIONS
+**********************************************************/
+
+/**
+    Fill a snapshot with the state of every grid.
+*/
+static void take_snapshot(algorithm_snapshot_t * p_snapshot, uint32_t minute_count);
+
+/**
+    Check whether any grid's LED outputs differ between two snapshots.
+*/
+static bool have_outputs_changed(algorithm_snapshot_t const * p_snapshot, algorithm_snapshot_t const * p_previous);
+
+/**********************************************************
+                       VARIABLES
+**********************************************************/
+
+static algorithm_snapshot_t snapshot;
+static algorithm_snapshot_t last_written_snapshot;
+
+static uint32_t seconds_since_snapshot = 0;
+
+/**********************************************************
+                       DEFINITIONS
+**********************************************************/
+
+/**
+    Restore every grid from the last snapshot, right after the algorithm components are initialized.
+*/
+bool mm_sensor_algorithm_snapshot_restore(uint32_t minute_count)
+{
+    seconds_since_snapshot = 0;
+
+    if (!mm_flash_storage_read(FLASH_AREA_ALGORITHM_SNAPSHOT, &snapshot, sizeof(snapshot)) ||
+        snapshot.version != SNAPSHOT_VERSION ||
+        snapshot.grid_count != MAX_SENSOR_GRIDS)
+    {
+        /* Starting from scratch restores the same state, so there is nothing to write until something changes. */
+        take_snapshot(&last_written_snapshot, minute_count);
+        return false;
+    }
+
+    /* Nothing to write until something changes. */
+    memcpy(&last_written_snapshot, &snapshot, sizeof(snapshot));
+
+    for (uint8_t grid_id = 0; grid_id < MAX_SENSOR_GRIDS; grid_id++)
+    {
+        grid_snapshot_t const * grid = &snapshot.grids[grid_id];
+
+        /* Sensor errors first, so sensors are registered in the order they were saved. */
+        mm_sensor_error_restore(grid_id, &grid->sensor_errors, minute_count);
+        mm_activity_variables_restore(grid_id, &grid->activity_variables[0]);
+        mm_led_strip_states_restore(grid_id, &grid->led_states);
+    }
+
+    return true;
+}
+
+/**
+    Call once per second, after every grid has been updated.
+*/
+void mm_sensor_algorithm_snapshot_on_second_elapsed(uint32_t minute_count)
+{
+    seconds_since_snapshot++;
+
+    if (seconds_since_snapshot < SNAPSHOT_PERIOD_S || sizeof(snapshot) > FLASH_STORAGE_MAX_RECORD_SIZE)
+    {
+        return;
+    }
+
+    take_snapshot(&snapshot, minute_count);
+
+    if (memcmp(&snapshot, &last_written_snapshot, sizeof(snapshot)) == 0)
+    {
+        seconds_since_snapshot = 0;
+        return;
+    }
+
+    /* If flash is still busy, try again next second. */
+    if (mm_flash_storage_write(FLASH_AREA_ALGORITHM_SNAPSHOT, &snapshot, sizeof(snapshot)))
+    {
+        memcpy(&last_written_snapshot, &snapshot, sizeof(snapshot));
+        seconds_since_snapshot = 0;
+    }
+}
+
+/**
+    Counts how many more seconds can elapse before a changed snapshot is due to be written.
+*/
+uint32_t mm_sensor_algorithm_snapshot_seconds_until_write(uint32_t minute_count, uint32_t max_seconds)
+{
+    if (sizeof(snapshot) > FLASH_STORAGE_MAX_RECORD_SIZE)
+    {
+        return max_seconds;
+    }
+
+    take_snapshot(&snapshot, minute_count);
+    if (!have_outputs_changed(&snapshot, &last_written_snapshot))
+    {
+        return max_seconds;
+    }
+
+    uint32_t remaining = 1;
+    if (seconds_since_snapshot + 1 < SNAPSHOT_PERIOD_S)
+    {
+        remaining = SNAPSHOT_PERIOD_S - seconds_since_snapshot;
+    }
+
+    return ( remaining < max_seconds ) ? remaining : max_seconds;
+}
+
+/**
+    Fill a snapshot with the state of every grid.
+*/
+static void take_snapshot(algorithm_snapshot_t * p_snapshot, uint32_t minute_count)
+{
+    /* Clear padding and unused records, so unchanged state compares equal. */
+    memset(p_snapshot, 0, sizeof(algorithm_snapshot_t));
+
+    p_snapshot->version = SNAPSHOT_VERSION;
+    p_snapshot->grid_count = MAX_SENSOR_GRIDS;
+
+    for (uint8_t grid_id = 0; grid_id < MAX_SENSOR_GRIDS; grid_id++)
+    {
+        grid_snapshot_t * grid = &p_snapshot->grids[grid_id];
+
+        mm_activity_variables_save(grid_id, &grid->activity_variables[0]);
+        mm_led_strip_states_save(grid_id, &grid->led_states);
+        mm_sensor_error_save(grid_id, &grid->sensor_errors, minute_count);
+    }
+}
+
+/**
+    Check whether any grid's LED outputs differ between two snapshots.
+*/
+static bool have_outputs_changed(algorithm_snapshot_t const * p_snapshot, algorithm_snapshot_t const * p_previous)
+{
+    for (uint8_t grid_id = 0; grid_id < MAX_SENSOR_GRIDS; grid_id++)
+    {
+        grid_snapshot_t const * grid = &p_snapshot->grids[grid_id];
+        grid_snapshot_t const * previous = &p_previous->grids[grid_id];
+
+        /* Timeout counters tick every second an output is held, they're written at the next wakeup. */
+        if (memcmp(grid->led_states.output_states, previous->led_states.output_states, sizeof(grid->led_states.output_states)) != 0 ||
+            memcmp(grid->led_states.timeouts_active, previous->led_states.timeouts_active, sizeof(grid->led_states.timeouts_active)) != 0)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
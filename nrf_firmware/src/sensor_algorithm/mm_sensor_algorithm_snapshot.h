@@ -0,0 +1,52 @@
+/**
+file: mm_sensor_algorithm_snapshot.h
+brief: Keeps a copy of the sensor algorithm's state in flash, so a reset gateway can carry on where it was.
+notes:
+    Only what decides the outputs is kept: activity variables, LED signalling
+    records and sensor error state. Statistics, trajectories and in-progress
+    detections start over.
+*/
+#ifndef MM_SENSOR_ALGORITHM_SNAPSHOT_H
+#define MM_SENSOR_ALGORITHM_SNAPSHOT_H
+
+/**********************************************************
+                        INCLUDES
+**********************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**********************************************************
+                        CONSTANTS
+**********************************************************/
+
+/* Seconds between snapshots. Snapshots that haven't changed since the last one aren't written. */
+#define SNAPSHOT_PERIOD_S               ( 15 )
+
+/* The gateway has no clock that keeps running through a reset, so assume it went down
+   halfway through a snapshot period and took a couple of seconds to start back up. */
+#define SNAPSHOT_ESTIMATED_DOWNTIME_S   ( SNAPSHOT_PERIOD_S / 2 + 2 )
+
+/**********************************************************
+                       DECLARATIONS
+**********************************************************/
+
+/**
+    Restore every grid from the last snapshot, right after the algorithm components are initialized.
+
+    return false if there is no snapshot from this firmware to restore.
+*/
+bool mm_sensor_algorithm_snapshot_restore(uint32_t minute_count);
+
+/**
+    Call once per second, after every grid has been updated. Writes a snapshot every SNAPSHOT_PERIOD_S.
+*/
+void mm_sensor_algorithm_snapshot_on_second_elapsed(uint32_t minute_count);
+
+/**
+    Counts how many more seconds can elapse before changed LED outputs are
+    due to be written. Other changes are written at the next wakeup.
+*/
+uint32_t mm_sensor_algorithm_snapshot_seconds_until_write(uint32_t minute_count, uint32_t max_seconds);
+
+#endif /* MM_SENSOR_ALGORITHM_SNAPSHOT_H */
@@ -2,6 +2,11 @@
 file: mm_sensor_error_check.c
 brief:
 notes:
+    Inactivity deadlines are kept in a two level timer wheel driven by minute
+    ticks rather than timestamps, so the minute timestamp rolling over doesn't
+    affect them. Level 0 holds deadlines due within INACTIVITY_WHEEL_L0_SIZE
+    minutes, level 1 holds later ones grouped by INACTIVITY_WHEEL_L0_SIZE
+    minute blocks, which are moved down to level 0 as their block starts.
 */
 
 /**********************************************************
@@ -22,502 +27,626 @@ notes:
                         CONSTANTS
 **********************************************************/
 
+#define INACTIVITY_WHEEL_L0_BITS    ( 6 )
+#define INACTIVITY_WHEEL_L0_SIZE    ( 1 << INACTIVITY_WHEEL_L0_BITS )   /* Minutes, one slot each. */
+#define INACTIVITY_WHEEL_L1_SIZE    ( 32 )                              /* Blocks of INACTIVITY_WHEEL_L0_SIZE minutes. */
+#define INACTIVITY_WHEEL_SLOT_COUNT ( INACTIVITY_WHEEL_L0_SIZE + INACTIVITY_WHEEL_L1_SIZE )
+
+/* The furthest deadline the wheel can hold, in minutes. */
+#define INACTIVITY_WHEEL_MAX_DELAY  ( INACTIVITY_WHEEL_L0_SIZE * ( INACTIVITY_WHEEL_L1_SIZE - 1 ) )
+
 /**********************************************************
                           TYPES
 **********************************************************/
 
 typedef struct
 {
-    uint16_t          node_id;
-    sensor_rotation_t sensor_rotation;
-} sensor_def_t;
-
-typedef struct
-{
-    sensor_def_t      sensor;
-    uint32_t          t_last_detection;
-    bool              is_inactive;
-    bool              is_valid;
+    uint32_t           t_deadline;  /* Wheel tick at which the sensor becomes inactive. */
+    mm_sensor_handle_t next;        /* Next sensor in the same wheel slot. */
+    mm_sensor_handle_t prev;        /* Previous sensor in the same wheel slot. */
+    uint8_t            slot;        /* Wheel slot, only meaningful while is_scheduled. */
+    bool               is_scheduled;
+    bool               is_inactive;
+    bool               is_valid;     /* Only sensors on nodes with a position are checked for inactivity. */
 } sensor_inactivity_record_t;
 
 typedef struct
 {
-    sensor_def_t      sensor;
-    uint32_t          activity_timestamps[SENSOR_HYPERACTIVITY_EVENT_WINDOW_SIZE];
-    uint16_t          activity_timestamp_index;
+    uint8_t           bucket_counts[SENSOR_HYPERACTIVITY_BUCKET_COUNT];  /* Events per bucket, saturates at UINT8_MAX. */
+    uint16_t          newest_bucket;    /* Bucket of the most recent event, minute / SENSOR_HYPERACTIVITY_BUCKET_MIN. */
+    uint16_t          window_count;     /* Sum of bucket_counts. */
     bool              sensor_hyperactive;
-    bool              is_valid;
 } sensor_hyperactivity_record_t;
 
+/* Sensor error state for one grid. */
+typedef struct
+{
+    /* Indexed by sensor handle. */
+    sensor_inactivity_record_t      sensor_inactivity_records[MAX_SENSOR_HANDLES];
+    sensor_hyperactivity_record_t   sensor_hyperactivity_records[MAX_SENSOR_HANDLES];
+
+    /* Heads of the per-slot lists of sensor handles, level 0 slots first. */
+    mm_sensor_handle_t              inactivity_wheel[INACTIVITY_WHEEL_SLOT_COUNT];
+    /* Minutes elapsed since init. */
+    uint32_t                        inactivity_wheel_now;
+} sensor_error_instance_t;
+
 /**********************************************************
                        DEFINITIONS
 **********************************************************/
 
-/**
-    Create a sensor_def_t from the given sensor_evt_t
-*/
-static void create_sensor_record(sensor_evt_t const * evt, sensor_def_t * sensor);
-
 /**
     Process a sensor event for possible inactivity.
 */
-static void on_sensor_evt_inactive_update(sensor_evt_t const * evt, uint32_t minute_count);
+static void on_sensor_evt_inactive_update(uint8_t grid_id, mm_sensor_handle_t handle);
 
 /**
     Create inactive sensor records for the provided position where they do not exist.
 */
-static void force_exist_inactive_sensor_records(mm_node_position_t const * position, uint32_t minute_count);
+static void force_exist_inactive_sensor_records(uint8_t grid_id, mm_node_position_t const * position);
 
 /**
     Create inactive sensor record for the provided sensor where it does not exist.
  */
-static void force_exist_inactive_sensor_record(sensor_def_t const * sensor, uint32_t minute_count);
+static void force_exist_inactive_sensor_record(uint8_t grid_id, mm_sensor_handle_t handle);
 
 /**
     Process a sensor event for possible hyperactivity.
  */
-static void on_sensor_evt_hyperactive_update(sensor_evt_t const * evt, uint32_t minute_count);
+static void on_sensor_evt_hyperactive_update(uint8_t grid_id, mm_sensor_handle_t handle, uint32_t minute_count);
 
 /**
-    Fetches or creates a sensor hyperactivity record.
+    Move a hyperactivity window forward to end at the provided bucket, dropping expired buckets.
  */
-static sensor_hyperactivity_record_t* get_sensor_hyperactivity_record(sensor_evt_t const * evt);
+static void advance_hyperactivity_window(sensor_hyperactivity_record_t * record, uint16_t bucket);
 
 /**
-    Fetches or creates a sensor inactivity record.
+    Advance the inactivity wheel by a minute and flag sensors whose deadline has passed.
  */
-static sensor_inactivity_record_t* get_sensor_inactivity_record(sensor_evt_t const * evt);
+static void evaluate_sensor_inactivity(uint8_t grid_id);
 
 /**
-    Check for and flag inactive sensors.
+    Flag a sensor as inactive now that its deadline has passed.
  */
-static void evaluate_sensor_inactivity(uint32_t minute_count);
+static void on_sensor_inactivity_deadline(uint8_t grid_id, mm_sensor_handle_t handle);
+
+/**
+    (Re)schedule a sensor to become inactive SENSOR_INACTIVITY_THRESHOLD_MIN minutes from now.
+ */
+static void schedule_inactivity_deadline(uint8_t grid_id, mm_sensor_handle_t handle);
+
+/**
+    Place a sensor into the wheel slot for its deadline.
+ */
+static void wheel_insert(uint8_t grid_id, mm_sensor_handle_t handle);
+
+/**
+    Remove a sensor from its wheel slot.
+ */
+static void wheel_remove(uint8_t grid_id, mm_sensor_handle_t handle);
+
+/**
+    Move every sensor in a level 1 slot down to level 0.
+ */
+static void wheel_cascade(uint8_t grid_id, uint8_t slot);
 
 /**
     Check for and flag hyperactive sensors.
  */
-static void evaluate_sensor_hyperactivity(void);
+static void evaluate_sensor_hyperactivity(uint8_t grid_id);
+
+/**
+    Get the number of events a sensor had in the bucket bucket_age buckets before the provided one.
+ */
+static uint8_t get_hyperactivity_count(sensor_hyperactivity_record_t const * record, uint16_t bucket, uint16_t bucket_age);
 
 /**
     Check for and flag a specific hyperactive sensor.
  */
-static void evaluate_sensor_hyperactivity_record(sensor_hyperactivity_record_t * record);
+static void evaluate_sensor_hyperactivity_record(uint8_t grid_id, mm_sensor_handle_t handle);
 
 /**********************************************************
                        VARIABLES
 **********************************************************/
 
-static sensor_inactivity_record_t       sensor_inactivity_records[MAX_SENSOR_COUNT];
-static sensor_hyperactivity_record_t    sensor_hyperactivity_records[MAX_SENSOR_COUNT];
+static sensor_error_instance_t          instances[MAX_SENSOR_GRIDS];
 
 /**********************************************************
                        DECLARATIONS
 **********************************************************/
 
-void mm_sensor_error_init(void)
+void mm_sensor_error_init(uint8_t grid_id)
 {
-    memset(&sensor_inactivity_records[0], 0, sizeof(sensor_inactivity_records));
-    memset(&sensor_hyperactivity_records[0], 0, sizeof(sensor_hyperactivity_records));
+    memset(&instances[grid_id].sensor_inactivity_records[0], 0, sizeof(instances[grid_id].sensor_inactivity_records));
+    memset(&instances[grid_id].sensor_hyperactivity_records[0], 0, sizeof(instances[grid_id].sensor_hyperactivity_records));
+
+    for (uint16_t i = 0; i < INACTIVITY_WHEEL_SLOT_COUNT; i++)
+    {
+        instances[grid_id].inactivity_wheel[i] = SENSOR_HANDLE_INVALID;
+    }
+    instances[grid_id].inactivity_wheel_now = 0;
+
+    /* The wheel must be able to hold a full inactivity period. */
+    APP_ERROR_CHECK(SENSOR_INACTIVITY_THRESHOLD_MIN > INACTIVITY_WHEEL_MAX_DELAY);
 }
 
 /**
     Record that a sensor has been active (has had a detection event).
 */
-void mm_sensor_error_record_sensor_activity(sensor_evt_t const * evt, uint32_t minute_count)
+void mm_sensor_error_record_sensor_activity(uint8_t grid_id, mm_sensor_handle_t handle, uint32_t minute_count)
 {
-    on_sensor_evt_inactive_update(evt, minute_count);
-    on_sensor_evt_hyperactive_update(evt, minute_count);
+    on_sensor_evt_inactive_update(grid_id, handle);
+    on_sensor_evt_hyperactive_update(grid_id, handle, minute_count);
 }
 
-void mm_sensor_error_on_minute_elapsed(uint32_t minute_count)
+void mm_sensor_error_on_minute_elapsed(uint8_t grid_id)
 {
-    evaluate_sensor_inactivity(minute_count);
-    evaluate_sensor_hyperactivity();
+    evaluate_sensor_inactivity(grid_id);
+    evaluate_sensor_hyperactivity(grid_id);
 }
 
 /**
     Returns true if the sensor in the given event is marked as hyperactive.
 */
-bool mm_sensor_error_is_sensor_hyperactive(sensor_evt_t const * evt)
+bool mm_sensor_error_is_sensor_hyperactive(uint8_t grid_id, sensor_evt_t const * evt)
 {
-    sensor_hyperactivity_record_t const * record = get_sensor_hyperactivity_record(evt);
+    return mm_sensor_error_is_hyperactive(grid_id, mm_sensor_registry_resolve_evt(grid_id, evt));
+}
 
-    /* Records should always exist. */
-    APP_ERROR_CHECK(record == NULL);
+/**
+    Returns true if the sensor with the given handle is marked as hyperactive.
+*/
+bool mm_sensor_error_is_hyperactive(uint8_t grid_id, mm_sensor_handle_t handle)
+{
+    APP_ERROR_CHECK(handle >= mm_sensor_registry_get_count(grid_id));
 
-    return record->sensor_hyperactive;
+    return instances[grid_id].sensor_hyperactivity_records[handle].sensor_hyperactive;
 }
 
 /**
     Returns true if the sensor in the given event is marked as inactive
 */
-bool mm_sensor_error_is_sensor_inactive(sensor_evt_t const * evt)
+bool mm_sensor_error_is_sensor_inactive(uint8_t grid_id, sensor_evt_t const * evt)
 {
-    sensor_inactivity_record_t const* record = get_sensor_inactivity_record(evt);
+    sensor_inactivity_record_t const* record = &instances[grid_id].sensor_inactivity_records[mm_sensor_registry_resolve_evt(grid_id, evt)];
 
     /* Records should always exist. */
-    APP_ERROR_CHECK(record == NULL);
+    APP_ERROR_CHECK(!record->is_valid);
 
     return record->is_inactive;
 }
 
 /**
-    Called before clearing node position changed flag.
+    Copies a grid's sensor error state into a snapshot.
 */
-void mm_sensor_error_on_node_positions_update(uint32_t minute_count)
+void mm_sensor_error_save(uint8_t grid_id, mm_sensor_error_snapshot_t * snapshot, uint32_t minute_count)
 {
-    /* The node positions have changed, which means
-       there are potentially new sensors to track inactivity
-       for. Go through each node position and fetch an inactivity record for it. */
+    uint16_t bucket = (uint16_t)(minute_count / SENSOR_HYPERACTIVITY_BUCKET_MIN);
 
-    for (uint16_t i = 0; i < MAX_NUMBER_NODES; i++)
-    {
-        mm_node_position_t const * position = &(get_node_positions()[i]);
+    snapshot->record_count = mm_sensor_registry_get_count(grid_id);
 
-        /* Emplace sensor records for each one. */
-        force_exist_inactive_sensor_records(position, minute_count);
+    for (mm_sensor_handle_t handle = 0; handle < snapshot->record_count; handle++)
+    {
+        mm_sensor_registry_entry_t const * sensor = mm_sensor_registry_get(grid_id, handle);
+        sensor_inactivity_record_t const * inactivity_record = &instances[grid_id].sensor_inactivity_records[handle];
+        sensor_hyperactivity_record_t const * hyperactivity_record = &instances[grid_id].sensor_hyperactivity_records[handle];
+        mm_sensor_error_snapshot_record_t * saved = &snapshot->records[handle];
+
+        saved->node_id = sensor->node_id;
+        saved->sensor_rotation = sensor->sensor_rotation;
+        saved->is_inactivity_checked = inactivity_record->is_valid;
+        saved->is_inactive = inactivity_record->is_inactive;
+        saved->is_hyperactive = hyperactivity_record->sensor_hyperactive;
+
+        for (uint16_t bucket_age = 0; bucket_age < SENSOR_HYPERACTIVITY_BUCKET_COUNT; bucket_age++)
+        {
+            saved->hyperactivity_counts[bucket_age] = get_hyperactivity_count(hyperactivity_record, bucket, bucket_age);
+        }
     }
 }
 
 /**
-    Create a sensor_record_t from the given sensor_evt_t
+    Restores a grid's sensor error state from a snapshot.
 */
-static void create_sensor_record(sensor_evt_t const * evt, sensor_def_t * sensor)
+void mm_sensor_error_restore(uint8_t grid_id, mm_sensor_error_snapshot_t const * snapshot, uint32_t minute_count)
 {
-    memset(sensor, 0, sizeof(sensor_def_t));
+    uint16_t bucket = (uint16_t)(minute_count / SENSOR_HYPERACTIVITY_BUCKET_MIN);
 
-    switch(evt->sensor_type)
+    for (uint16_t i = 0; i < snapshot->record_count && i < MAX_SENSOR_HANDLES; i++)
     {
-        case SENSOR_TYPE_PIR:
-            sensor->node_id = evt->pir_data.node_id;
-            sensor->sensor_rotation = evt->pir_data.sensor_rotation;
-            break;
-        case SENSOR_TYPE_LIDAR:
-            sensor->node_id = evt->lidar_data.node_id;
-            sensor->sensor_rotation = evt->lidar_data.sensor_rotation;
-            break;
-        default:
-            /* App error, unknown sensor data type. */
-            APP_ERROR_CHECK(true);
-            break;
+        mm_sensor_error_snapshot_record_t const * saved = &snapshot->records[i];
+
+        if (saved->sensor_rotation >= SENSOR_ROTATION_COUNT)
+        {
+            continue;
+        }
+
+        mm_sensor_handle_t handle = mm_sensor_registry_resolve(grid_id, saved->node_id, (sensor_rotation_t)saved->sensor_rotation, SENSOR_TYPE_UNKNOWN);
+        if (handle == SENSOR_HANDLE_INVALID)
+        {
+            continue;
+        }
+
+        sensor_inactivity_record_t* inactivity_record = &instances[grid_id].sensor_inactivity_records[handle];
+        sensor_hyperactivity_record_t* hyperactivity_record = &instances[grid_id].sensor_hyperactivity_records[handle];
+
+        if (saved->is_inactivity_checked && !inactivity_record->is_valid)
+        {
+            inactivity_record->is_valid = true;
+            inactivity_record->is_inactive = saved->is_inactive;
+
+            /* Deadlines aren't saved, they would change the snapshot every minute and wear out
+               the flash. A reset only delays flagging a sensor that has stopped working. */
+            if (!saved->is_inactive)
+            {
+                schedule_inactivity_deadline(grid_id, handle);
+            }
+        }
+
+        /* Lay the counts back out so the newest lands in the current bucket. */
+        memset(hyperactivity_record, 0, sizeof(sensor_hyperactivity_record_t));
+        hyperactivity_record->newest_bucket = bucket;
+        hyperactivity_record->sensor_hyperactive = saved->is_hyperactive;
+
+        for (uint16_t bucket_age = 0; bucket_age < SENSOR_HYPERACTIVITY_BUCKET_COUNT; bucket_age++)
+        {
+            uint16_t index = ( bucket % SENSOR_HYPERACTIVITY_BUCKET_COUNT + SENSOR_HYPERACTIVITY_BUCKET_COUNT - bucket_age ) % SENSOR_HYPERACTIVITY_BUCKET_COUNT;
+
+            hyperactivity_record->bucket_counts[index] = saved->hyperactivity_counts[bucket_age];
+            hyperactivity_record->window_count += saved->hyperactivity_counts[bucket_age];
+        }
     }
 }
 
 /**
-    Process a sensor event for possible inactivity.
+    Called before clearing node position changed flag.
 */
-static void on_sensor_evt_inactive_update(sensor_evt_t const * evt, uint32_t minute_count)
+void mm_sensor_error_on_node_positions_update(uint8_t grid_id)
 {
-    /* Fetch a template to search for a sensor with. */
-    sensor_def_t sensor;
-    create_sensor_record(evt, &sensor);
+    /* The node positions have changed, which means
+       there are potentially new sensors to track inactivity
+       for. Go through each node position and fetch an inactivity record for it. */
 
-    /* Find the inactive record for that sensor, mark the minutes since last detection. */
-    for (uint16_t i = 0; i < MAX_SENSOR_COUNT; i++)
+    for (uint16_t i = 0; i < MAX_GATEWAY_NODES; i++)
     {
-        sensor_inactivity_record_t* record = &sensor_inactivity_records[i];
+        mm_node_position_t const * position = &(get_node_positions()[i]);
 
-        if (sensor.node_id == record->sensor.node_id &&
-            sensor.sensor_rotation == record->sensor.sensor_rotation &&
-            record->is_valid)
+        if (!position->is_valid)
         {
-            if(record->is_inactive)
-            {
-                /*Send update to the monitoring application if it is becoming inactive */ 
-                record->is_inactive = false;
-                mm_sensor_error_transmission_send_inactivity_update
-                (
-                    record->sensor.node_id,
-                    SENSOR_TYPE_UNKNOWN,
-                    record->sensor.sensor_rotation,
-                    record->is_inactive
-                );
-            }
+            /* Empty slot, no sensors to track. */
+            continue;
+        }
 
-            record->t_last_detection = minute_count;        
-            return;
+        if (position->grid_id != grid_id)
+        {
+            /* Tracked by another grid's instance. */
+            continue;
         }
+
+        /* Emplace sensor records for each one. */
+        force_exist_inactive_sensor_records(grid_id, position);
+    }
+}
+
+/**
+    Process a sensor event for possible inactivity.
+*/
+static void on_sensor_evt_inactive_update(uint8_t grid_id, mm_sensor_handle_t handle)
+{
+    sensor_inactivity_record_t* record = &instances[grid_id].sensor_inactivity_records[handle];
+
+    if (!record->is_valid)
+    {
+        /* If we got here, it means we got sensor data before the node that caused it has had it's position configured.
+           Which can happen, but it doesn't leave us any reasonable way to process it. */
+        return;
+    }
+
+    /* Mark the minutes since last detection. */
+    if(record->is_inactive)
+    {
+        /*Send update to the monitoring application if it is becoming inactive */
+        mm_sensor_registry_entry_t const * sensor = mm_sensor_registry_get(grid_id, handle);
+
+        record->is_inactive = false;
+        mm_sensor_error_transmission_send_inactivity_update
+        (
+            sensor->node_id,
+            SENSOR_TYPE_UNKNOWN,
+            sensor->sensor_rotation,
+            record->is_inactive
+        );
     }
 
-    /* If we got here, it means we got sensor data before the node that caused it has had it's position configured.
-       Which can happen, but it doesn't leave us any reasonable way to process it. */
+    /* Push the deadline back. */
+    schedule_inactivity_deadline(grid_id, handle);
 }
 
 /**
     Create inactive sensor records for the provided position where they do not exist.
 */
-static void force_exist_inactive_sensor_records(mm_node_position_t const * position, uint32_t minute_count)
+static void force_exist_inactive_sensor_records(uint8_t grid_id, mm_node_position_t const * position)
 {
     /* Which sensors does this node have? */
     sensor_rotation_t node_sensor_rotations[MAX_SENSORS_PER_NODE];
-    get_sensor_rotations(position->node_type, MAX_SENSORS_PER_NODE, node_sensor_rotations);
+    uint8_t sensor_count = get_sensor_rotations(position->node_type, MAX_SENSORS_PER_NODE, node_sensor_rotations);
 
     /* Create a record for each one. */
-    for (uint16_t i = 0; i < MAX_SENSORS_PER_NODE; ++i)
+    for (uint16_t i = 0; i < sensor_count; ++i)
     {
-        sensor_def_t sensor;
-        memset(&sensor, 0, sizeof(sensor));
-        sensor.node_id = position->node_id;
-        sensor.sensor_rotation = node_sensor_rotations[i];
+        mm_sensor_handle_t handle = mm_sensor_registry_resolve(grid_id, position->node_id, node_sensor_rotations[i], SENSOR_TYPE_UNKNOWN);
 
-        force_exist_inactive_sensor_record(&sensor, minute_count);
+        force_exist_inactive_sensor_record(grid_id, handle);
     }
 }
 
 /**
     Create inactive sensor record for the provided sensor where it does not exist.
  */
-static void force_exist_inactive_sensor_record(sensor_def_t const * sensor, uint32_t minute_count)
+static void force_exist_inactive_sensor_record(uint8_t grid_id, mm_sensor_handle_t handle)
 {
-    /* First check if the record exists already. */
-    sensor_inactivity_record_t* empty_record = NULL;
-    for (uint16_t i = 0; i < MAX_SENSOR_COUNT; ++i)
-    {
-        sensor_inactivity_record_t const * record = &sensor_inactivity_records[i];
-
-        if (sensor->node_id == record->sensor.node_id &&
-            sensor->sensor_rotation == record->sensor.sensor_rotation &&
-            record->is_valid)
-        {
-            /* The record already exists. */
-            return;
-        }
+    sensor_inactivity_record_t* record = &instances[grid_id].sensor_inactivity_records[handle];
 
-        /* Grab an empty record if one does not exist. */
-        if (!record->is_valid &&
-            empty_record == NULL)
-        {
-            empty_record = &sensor_inactivity_records[i];
-        }
+    if (record->is_valid)
+    {
+        /* The record already exists. */
+        return;
     }
 
-    memset(empty_record, 0, sizeof(sensor_inactivity_record_t));
-    memcpy(&empty_record->sensor, sensor, sizeof(sensor_def_t));
-    empty_record->is_valid = true;
-    empty_record->is_inactive = false;
-    empty_record->t_last_detection = minute_count; /* Save the current timestamp so it is not immedietly hyperactive. */
+    memset(record, 0, sizeof(sensor_inactivity_record_t));
+    record->is_valid = true;
+    record->is_inactive = false;
+
+    /* Start the inactivity period now so it is not immedietly inactive. */
+    schedule_inactivity_deadline(grid_id, handle);
 }
 
 /**
     Process a sensor event for possible hyperactivity.
  */
-static void on_sensor_evt_hyperactive_update(sensor_evt_t const * evt, uint32_t minute_count)
+static void on_sensor_evt_hyperactive_update(uint8_t grid_id, mm_sensor_handle_t handle, uint32_t minute_count)
 {
     /* Fetch the record to write to. */
-    sensor_hyperactivity_record_t* record = get_sensor_hyperactivity_record(evt);
+    sensor_hyperactivity_record_t* record = &instances[grid_id].sensor_hyperactivity_records[handle];
 
-    /* No existing record, something is wrong. */
-    APP_ERROR_CHECK(record == NULL);
+    /* Make sure the newest bucket is the one for this event. */
+    uint16_t bucket = (uint16_t)(minute_count / SENSOR_HYPERACTIVITY_BUCKET_MIN);
+    advance_hyperactivity_window(record, bucket);
 
-    /* Emplace the detection timestamp. */
-    record->activity_timestamps[record->activity_timestamp_index] = minute_count;
+    /* Count the event. */
+    uint8_t* count = &record->bucket_counts[bucket % SENSOR_HYPERACTIVITY_BUCKET_COUNT];
 
-    /* Increment queue index */
-    record->activity_timestamp_index++;
-    record->activity_timestamp_index %= SENSOR_HYPERACTIVITY_EVENT_WINDOW_SIZE;
+    if (*count < UINT8_MAX)
+    {
+        (*count)++;
+        record->window_count++;
+    }
 }
 
 /**
-    Fetches or creates a sensor hyperactivity record.
+    Move a hyperactivity window forward to end at the provided bucket, dropping expired buckets.
  */
-static sensor_hyperactivity_record_t* get_sensor_hyperactivity_record(sensor_evt_t const * evt)
+static void advance_hyperactivity_window(sensor_hyperactivity_record_t * record, uint16_t bucket)
 {
-    /* Fetch a template to search for a sensor with. */
-    sensor_def_t sensor;
-    create_sensor_record(evt, &sensor);
-
-    /* check to see if this sensor has an existing hyperactivity record and if it does add to it */
-    for (uint16_t i = 0; i < MAX_SENSOR_COUNT; i++)
+    if (bucket < record->newest_bucket ||
+        bucket - record->newest_bucket >= SENSOR_HYPERACTIVITY_BUCKET_COUNT)
     {
-        sensor_hyperactivity_record_t* existing_record = &sensor_hyperactivity_records[i];
-
-        /* Does this record match the event? */
-        if (sensor.node_id != existing_record->sensor.node_id ||
-            sensor.sensor_rotation != existing_record->sensor.sensor_rotation ||
-            !existing_record->is_valid)
+        /* Either every bucket has expired, or the timestamp rolled over. Start over. */
+        memset(&record->bucket_counts[0], 0, sizeof(record->bucket_counts));
+        record->window_count = 0;
+    }
+    else
+    {
+        /* Drop the buckets that fall out of the window, at most SENSOR_HYPERACTIVITY_BUCKET_COUNT. */
+        for (uint16_t b = record->newest_bucket + 1; b <= bucket; b++)
         {
-            /* No it doesn't */
-            continue;
+            uint8_t* count = &record->bucket_counts[b % SENSOR_HYPERACTIVITY_BUCKET_COUNT];
+
+            record->window_count -= *count;
+            *count = 0;
         }
+    }
 
-        return existing_record;
+    record->newest_bucket = bucket;
+}
+
+/**
+    Advance the inactivity wheel by a minute and flag sensors whose deadline has passed.
+ */
+static void evaluate_sensor_inactivity(uint8_t grid_id)
+{
+    instances[grid_id].inactivity_wheel_now++;
+
+    uint8_t slot = instances[grid_id].inactivity_wheel_now % INACTIVITY_WHEEL_L0_SIZE;
+
+    if (slot == 0)
+    {
+        /* Start of a new block, bring its deadlines down to level 0. */
+        uint32_t block = instances[grid_id].inactivity_wheel_now >> INACTIVITY_WHEEL_L0_BITS;
+        wheel_cascade(grid_id, INACTIVITY_WHEEL_L0_SIZE + block % INACTIVITY_WHEEL_L1_SIZE);
     }
 
-    for (uint16_t i = 0; i < MAX_SENSOR_COUNT; i++)
+    /* Everything left in the current level 0 slot is due now. */
+    while (instances[grid_id].inactivity_wheel[slot] != SENSOR_HANDLE_INVALID)
     {
-        sensor_hyperactivity_record_t* new_record = &sensor_hyperactivity_records[i];
+        mm_sensor_handle_t handle = instances[grid_id].inactivity_wheel[slot];
 
-        /* Skip valid records. */
-        if (new_record->is_valid)
-        {
-            continue;
-        }
+        APP_ERROR_CHECK(instances[grid_id].sensor_inactivity_records[handle].t_deadline != instances[grid_id].inactivity_wheel_now);
 
-        /* Initialize the new record. */
-        memset(new_record, 0, sizeof(sensor_hyperactivity_record_t));
-        memcpy(&new_record->sensor, &sensor, sizeof(sensor_def_t));
-        new_record->sensor_hyperactive = false;
-        new_record->is_valid = true;
+        wheel_remove(grid_id, handle);
+        on_sensor_inactivity_deadline(grid_id, handle);
+    }
+}
+
+/**
+    Flag a sensor as inactive now that its deadline has passed.
+ */
+static void on_sensor_inactivity_deadline(uint8_t grid_id, mm_sensor_handle_t handle)
+{
+    sensor_inactivity_record_t* record = &instances[grid_id].sensor_inactivity_records[handle];
+    mm_sensor_registry_entry_t const * sensor = mm_sensor_registry_get(grid_id, handle);
+
+    record->is_inactive = true;
+    /* Note: will be set is_inactive = false when a sensor event occurs for that sensor. */
+    /* Inactivity detected, send an update to the monitoring application. */
+    mm_sensor_error_transmission_send_inactivity_update
+        (
+            sensor->node_id,
+            SENSOR_TYPE_UNKNOWN,
+            sensor->sensor_rotation,
+            record->is_inactive
+        );
+}
+
+/**
+    (Re)schedule a sensor to become inactive SENSOR_INACTIVITY_THRESHOLD_MIN minutes from now.
+ */
+static void schedule_inactivity_deadline(uint8_t grid_id, mm_sensor_handle_t handle)
+{
+    sensor_inactivity_record_t* record = &instances[grid_id].sensor_inactivity_records[handle];
 
-        return new_record;
+    if (record->is_scheduled)
+    {
+        wheel_remove(grid_id, handle);
     }
 
-    /* Couldn't find or allocate record. */
-    APP_ERROR_CHECK(true);
-    return NULL;
+    record->t_deadline = instances[grid_id].inactivity_wheel_now + SENSOR_INACTIVITY_THRESHOLD_MIN;
+    wheel_insert(grid_id, handle);
 }
 
 /**
-    Fetches a sensor inactivity record.
+    Place a sensor into the wheel slot for its deadline.
  */
-static sensor_inactivity_record_t* get_sensor_inactivity_record(sensor_evt_t const * evt)
+static void wheel_insert(uint8_t grid_id, mm_sensor_handle_t handle)
 {
-    /* Fetch a template to search for a sensor with. */
-    sensor_def_t sensor;
-    create_sensor_record(evt, &sensor);
+    sensor_inactivity_record_t* record = &instances[grid_id].sensor_inactivity_records[handle];
 
-    /* check to see if this sensor has an existing inactivity record and if it does add to it */
-    for (uint16_t i = 0; i < MAX_SENSOR_COUNT; i++)
+    /* Unsigned difference, so this holds across the tick counter wrapping. */
+    uint32_t delay = record->t_deadline - instances[grid_id].inactivity_wheel_now;
+    APP_ERROR_CHECK(delay > INACTIVITY_WHEEL_MAX_DELAY);
+
+    if (delay < INACTIVITY_WHEEL_L0_SIZE)
+    {
+        record->slot = record->t_deadline % INACTIVITY_WHEEL_L0_SIZE;
+    }
+    else
     {
-        sensor_inactivity_record_t* existing_record = &sensor_inactivity_records[i];
+        record->slot = INACTIVITY_WHEEL_L0_SIZE + (record->t_deadline >> INACTIVITY_WHEEL_L0_BITS) % INACTIVITY_WHEEL_L1_SIZE;
+    }
 
-        /* Does this record match the event? */
-        if (sensor.node_id != existing_record->sensor.node_id ||
-            sensor.sensor_rotation != existing_record->sensor.sensor_rotation ||
-            !existing_record->is_valid)
-        {
-            /* No it doesn't */
-            continue;
-        }
+    /* Push onto the front of the slot's list. */
+    record->prev = SENSOR_HANDLE_INVALID;
+    record->next = instances[grid_id].inactivity_wheel[record->slot];
 
-        return existing_record;
+    if (record->next != SENSOR_HANDLE_INVALID)
+    {
+        instances[grid_id].sensor_inactivity_records[record->next].prev = handle;
     }
 
-    /* Couldn't find or allocate record. */
-    APP_ERROR_CHECK(true);
-    return NULL;
+    instances[grid_id].inactivity_wheel[record->slot] = handle;
+    record->is_scheduled = true;
 }
 
 /**
-    Check for and flag inactive sensors.
+    Remove a sensor from its wheel slot.
  */
-static void evaluate_sensor_inactivity(uint32_t minute_count)
+static void wheel_remove(uint8_t grid_id, mm_sensor_handle_t handle)
 {
-    /* Check for and flag any sensors where the last detection is too old. */
-    for (uint16_t i = 0; i < MAX_SENSOR_COUNT; ++i)
+    sensor_inactivity_record_t* record = &instances[grid_id].sensor_inactivity_records[handle];
+
+    APP_ERROR_CHECK(!record->is_scheduled);
+
+    if (record->prev == SENSOR_HANDLE_INVALID)
+    {
+        instances[grid_id].inactivity_wheel[record->slot] = record->next;
+    }
+    else
     {
-        sensor_inactivity_record_t* record = &sensor_inactivity_records[i];
+        instances[grid_id].sensor_inactivity_records[record->prev].next = record->next;
+    }
 
-        if (!record->is_valid)
-        {
-            /* Invalid record. */
-            continue;
-        }
+    if (record->next != SENSOR_HANDLE_INVALID)
+    {
+        instances[grid_id].sensor_inactivity_records[record->next].prev = record->prev;
+    }
 
-        if (record->is_inactive)
-        {
-            /* Still inactive. */
-            continue;
-        }
+    record->is_scheduled = false;
+}
 
-        uint32_t dt = minute_count - record->t_last_detection;
+/**
+    Move every sensor in a level 1 slot down to level 0.
+ */
+static void wheel_cascade(uint8_t grid_id, uint8_t slot)
+{
+    /* Deadlines in the slot are all within the block that just started. */
+    while (instances[grid_id].inactivity_wheel[slot] != SENSOR_HANDLE_INVALID)
+    {
+        mm_sensor_handle_t handle = instances[grid_id].inactivity_wheel[slot];
 
-        if (dt >= SENSOR_INACTIVITY_THRESHOLD_MIN)
-        {
-            record->is_inactive = true;
-            /* Note: will be set is_inactive = false when a sensor event occurs for that sensor. */
-            /* Inactivity detected, send an update to the monitoring application. */
-            mm_sensor_error_transmission_send_inactivity_update
-                (
-                    record->sensor.node_id,
-                    SENSOR_TYPE_UNKNOWN,
-                    record->sensor.sensor_rotation,
-                    record->is_inactive
-                );
-        }
+        wheel_remove(grid_id, handle);
+        wheel_insert(grid_id, handle);
     }
 }
 
 /**
     Check for and flag hyperactive sensors.
  */
-static void evaluate_sensor_hyperactivity(void)
+static void evaluate_sensor_hyperactivity(uint8_t grid_id)
 {
-    for (uint16_t i = 0; i < MAX_SENSOR_COUNT; i++)
+    for (mm_sensor_handle_t handle = 0; handle < mm_sensor_registry_get_count(grid_id); handle++)
     {
-        sensor_hyperactivity_record_t * record = &sensor_hyperactivity_records[i];
-
-        if (!record->is_valid)
-        {
-            /* Invalid record, skip it. */
-            continue;
-        }
-
         /* Check if it is hyperactive. */
-        evaluate_sensor_hyperactivity_record(record);
+        evaluate_sensor_hyperactivity_record(grid_id, handle);
     }
 }
 
 /**
-    Check for and flag a specific hyperactive sensor.
+    Get the number of events a sensor had in the bucket bucket_age buckets before the provided one.
  */
-static void evaluate_sensor_hyperactivity_record(sensor_hyperactivity_record_t * record)
+static uint8_t get_hyperactivity_count(sensor_hyperactivity_record_t const * record, uint16_t bucket, uint16_t bucket_age)
 {
-    uint32_t tmax = 0;
-    uint32_t tmin = UINT32_MAX;
-
-    /* Calculate the duration the events were collected over. */
-    for (uint16_t i = 0; i < SENSOR_HYPERACTIVITY_EVENT_WINDOW_SIZE; i++)
+    if (bucket < record->newest_bucket || bucket_age > bucket)
     {
-        uint32_t t = record->activity_timestamps[i];
-
-        if (t > tmax)
-        {
-            tmax = t;
-        }
-        if (t < tmin)
-        {
-            tmin = t;
-        }
+        /* The timestamp rolled over, or the bucket is from before time started. */
+        return 0;
     }
 
-    bool hyperactive_initial_value = record->sensor_hyperactive;
+    uint16_t counted_bucket = bucket - bucket_age;
 
-    if (tmin == 0)
+    if (counted_bucket > record->newest_bucket ||
+        record->newest_bucket - counted_bucket >= SENSOR_HYPERACTIVITY_BUCKET_COUNT)
     {
-        /* The detection buffer is not full, so the frequency cannot be too high. */
-        record->sensor_hyperactive = false;
+        /* Nothing has been counted in that bucket yet, or it has expired. */
+        return 0;
     }
-    else if (tmin == tmax)
-    {
-        /* Detections all occured within the same minute, so the sensor is definitely hyperactive. */
-        record->sensor_hyperactive = true;
-    }
-    else
-    {
-        /* Edge condition checks passed, so the buffer is full and the events occured over more than a minute. */
-        float dt = (float)(tmax - tmin);
 
-        float detection_frequency = SENSOR_HYPERACTIVITY_EVENT_WINDOW_SIZE / dt; /* In detection/minute */
+    return record->bucket_counts[counted_bucket % SENSOR_HYPERACTIVITY_BUCKET_COUNT];
+}
 
-        if (detection_frequency >= SENSOR_HYPERACTIVITY_FREQUENCY_THRES)
-        {
-            record->sensor_hyperactive = true;
-        }
-        else
-        {
-            record->sensor_hyperactive = false;
-        }
-    }
+/**
+    Check for and flag a specific hyperactive sensor.
+ */
+static void evaluate_sensor_hyperactivity_record(uint8_t grid_id, mm_sensor_handle_t handle)
+{
+    sensor_hyperactivity_record_t * record = &instances[grid_id].sensor_hyperactivity_records[handle];
+
+    bool hyperactive_initial_value = record->sensor_hyperactive;
+
+    /* The window ends at the most recent event and spans
+       SENSOR_HYPERACTIVITY_EVENT_WINDOW_SIZE / SENSOR_HYPERACTIVITY_FREQUENCY_THRES minutes,
+       so enough events in it means the detection frequency is too high. */
+    record->sensor_hyperactive = (record->window_count >= SENSOR_HYPERACTIVITY_EVENT_WINDOW_SIZE);
 
     /* Send transmission with hyperactivity update */
     if(hyperactive_initial_value != record->sensor_hyperactive)
     {
+        mm_sensor_registry_entry_t const * sensor = mm_sensor_registry_get(grid_id, handle);
+
         mm_sensor_error_transmission_send_hyperactivity_update
             (
-            record->sensor.node_id,
+            sensor->node_id,
             SENSOR_TYPE_UNKNOWN,
-            record->sensor.sensor_rotation,
+            sensor->sensor_rotation,
             record->sensor_hyperactive
             );
     }
@@ -12,6 +12,34 @@ notes:
 
 #include "mm_sensor_transmission.h"
 #include "mm_sensor_algorithm_config.h"
+#include "mm_sensor_registry.h"
+
+/**********************************************************
+                          TYPES
+**********************************************************/
+
+/**
+    Compact copy of one sensor's error state, to persist it across a reset.
+    Sensors are kept by node and rotation, handles aren't stable across resets.
+*/
+typedef struct
+{
+    uint16_t    node_id;
+    uint8_t     sensor_rotation;
+    bool        is_inactivity_checked;      /* The sensor's node had a position, so it was being checked for inactivity. */
+    bool        is_inactive;
+    bool        is_hyperactive;
+    uint8_t     hyperactivity_counts[SENSOR_HYPERACTIVITY_BUCKET_COUNT];   /* Events per bucket, newest bucket first. */
+} mm_sensor_error_snapshot_record_t;
+
+/**
+    Compact copy of one grid's sensor error state.
+*/
+typedef struct
+{
+    mm_sensor_error_snapshot_record_t   records[MAX_SENSOR_HANDLES];
+    uint16_t                            record_count;
+} mm_sensor_error_snapshot_t;
 
 /**********************************************************
                        DECLARATIONS
@@ -20,32 +48,47 @@ notes:
 /**
     Initialize sensor error checking.
 */
-void mm_sensor_error_init(void);
+void mm_sensor_error_init(uint8_t grid_id);
 
 /**
     Record that a sensor has been active (has had a detection event).
 */
-void mm_sensor_error_record_sensor_activity(sensor_evt_t const * evt, uint32_t minute_count);
+void mm_sensor_error_record_sensor_activity(uint8_t grid_id, mm_sensor_handle_t handle, uint32_t minute_count);
 
 /**
     Analyze collected data and update error states.
  */
-void mm_sensor_error_on_minute_elapsed(uint32_t minute_count);
+void mm_sensor_error_on_minute_elapsed(uint8_t grid_id);
 
 /**
     Called before clearing node position changed flag.
 */
-void mm_sensor_error_on_node_positions_update(uint32_t minute_count);
+void mm_sensor_error_on_node_positions_update(uint8_t grid_id);
 
 /**
     Returns true if the sensor in the given event is marked as hyperactive
 */
-bool mm_sensor_error_is_sensor_hyperactive(sensor_evt_t const * evt);
+bool mm_sensor_error_is_sensor_hyperactive(uint8_t grid_id, sensor_evt_t const * evt);
+
+/**
+    Returns true if the sensor with the given handle is marked as hyperactive.
+*/
+bool mm_sensor_error_is_hyperactive(uint8_t grid_id, mm_sensor_handle_t handle);
 
 /**
     Returns true if the sensor in the given event is marked as inactive
 */
-bool mm_sensor_error_is_sensor_inactive(sensor_evt_t const * evt);
+bool mm_sensor_error_is_sensor_inactive(uint8_t grid_id, sensor_evt_t const * evt);
+
+/**
+    Copies a grid's sensor error state into a snapshot.
+*/
+void mm_sensor_error_save(uint8_t grid_id, mm_sensor_error_snapshot_t * snapshot, uint32_t minute_count);
 
+/**
+    Restores a grid's sensor error state from a snapshot. Hyperactivity windows
+    carry on from where they were, sensors that weren't inactive get a full inactivity period.
+*/
+void mm_sensor_error_restore(uint8_t grid_id, mm_sensor_error_snapshot_t const * snapshot, uint32_t minute_count);
 
 #endif /* MM_SENSOR_ERROR_CHECK_H */
\ No newline at end of file
@@ -0,0 +1,210 @@
+/**
+file: mm_sensor_registry.c
+brief: Maps sensors to dense handles so per-sensor state can be kept in handle-indexed arrays.
+notes:
+    Sensors are keyed by node id and rotation, which is unique per sensor.
+    Keys are found through an open addressing hash table, so resolving a
+    handle doesn't depend on how many sensors are registered. Sensors are
+    never removed, a node that is moved keeps the handles for its sensors.
+*/
+
+/**********************************************************
+                       INCLUDES
+**********************************************************/
+
+#include <string.h>
+
+#include "app_error.h"
+
+#include "mm_sensor_registry.h"
+
+/**********************************************************
+                        CONSTANTS
+**********************************************************/
+
+/* Keep the table at most half full so probe sequences stay short. */
+#define SENSOR_REGISTRY_HASH_SIZE   ( 2 * MAX_SENSOR_HANDLES + 1 )
+
+/**********************************************************
+                          TYPES
+**********************************************************/
+
+/**
+    Registered sensors for one grid.
+*/
+typedef struct
+{
+    mm_sensor_registry_entry_t  entries[MAX_SENSOR_HANDLES];
+    uint16_t                    entry_count;
+
+    mm_sensor_handle_t          hash_table[SENSOR_REGISTRY_HASH_SIZE];
+} sensor_registry_instance_t;
+
+/**********************************************************
+                       DEFINITIONS
+**********************************************************/
+
+/**
+    Find the hash table slot for a sensor. The slot holds SENSOR_HANDLE_INVALID
+    if the sensor isn't registered.
+*/
+static uint16_t find_hash_slot(uint8_t grid_id, uint16_t node_id, sensor_rotation_t sensor_rotation);
+
+/**
+    Fetch the position for a node, NULL if the node has no position or is part of another grid.
+*/
+static mm_node_position_t const * get_grid_position_for_node(uint8_t grid_id, uint16_t node_id);
+
+/**********************************************************
+                       VARIABLES
+**********************************************************/
+
+static sensor_registry_instance_t   instances[MAX_SENSOR_GRIDS];
+
+/**********************************************************
+                       DECLARATIONS
+**********************************************************/
+
+/**
+    Clear all of a grid's registered sensors.
+*/
+void mm_sensor_registry_init(uint8_t grid_id)
+{
+    memset(&instances[grid_id].entries[0], 0, sizeof(instances[grid_id].entries));
+    instances[grid_id].entry_count = 0;
+
+    for (uint16_t i = 0; i < SENSOR_REGISTRY_HASH_SIZE; i++)
+    {
+        instances[grid_id].hash_table[i] = SENSOR_HANDLE_INVALID;
+    }
+}
+
+/**
+    Fetch the handle for a sensor, registering it if it is new.
+*/
+mm_sensor_handle_t mm_sensor_registry_resolve(uint8_t grid_id, uint16_t node_id, sensor_rotation_t sensor_rotation, sensor_type_t sensor_type)
+{
+    uint16_t slot = find_hash_slot(grid_id, node_id, sensor_rotation);
+    mm_sensor_handle_t handle = instances[grid_id].hash_table[slot];
+
+    if (handle == SENSOR_HANDLE_INVALID)
+    {
+        /* New sensor, take the next handle. */
+        APP_ERROR_CHECK(instances[grid_id].entry_count >= MAX_SENSOR_HANDLES);
+
+        handle = instances[grid_id].entry_count;
+        instances[grid_id].entry_count++;
+        instances[grid_id].hash_table[slot] = handle;
+
+        mm_sensor_registry_entry_t * entry = &instances[grid_id].entries[handle];
+        entry->node_id = node_id;
+        entry->sensor_rotation = sensor_rotation;
+        entry->sensor_type = SENSOR_TYPE_UNKNOWN;
+        entry->position = get_grid_position_for_node(grid_id, node_id);
+    }
+
+    /* Sensors registered from a node position don't know their type until they send data. */
+    if (sensor_type != SENSOR_TYPE_UNKNOWN)
+    {
+        instances[grid_id].entries[handle].sensor_type = sensor_type;
+    }
+
+    return handle;
+}
+
+/**
+    Fetch the handle for the sensor that sent an event, registering it if it is new.
+*/
+mm_sensor_handle_t mm_sensor_registry_resolve_evt(uint8_t grid_id, sensor_evt_t const * evt)
+{
+    switch (evt->sensor_type)
+    {
+        case SENSOR_TYPE_PIR:
+            return mm_sensor_registry_resolve(grid_id, evt->pir_data.node_id, evt->pir_data.sensor_rotation, SENSOR_TYPE_PIR);
+        case SENSOR_TYPE_LIDAR:
+            return mm_sensor_registry_resolve(grid_id, evt->lidar_data.node_id, evt->lidar_data.sensor_rotation, SENSOR_TYPE_LIDAR);
+        default:
+            /* App error, unknown sensor data type. */
+            APP_ERROR_CHECK(true);
+            return SENSOR_HANDLE_INVALID;
+    }
+}
+
+/**
+    Fetch the registry entry for a handle.
+*/
+mm_sensor_registry_entry_t const * mm_sensor_registry_get(uint8_t grid_id, mm_sensor_handle_t handle)
+{
+    APP_ERROR_CHECK(handle >= instances[grid_id].entry_count);
+
+    return &instances[grid_id].entries[handle];
+}
+
+/**
+    Fetch the cached node position for a handle, NULL if the node has no position yet.
+*/
+mm_node_position_t const * mm_sensor_registry_get_position(uint8_t grid_id, mm_sensor_handle_t handle)
+{
+    return mm_sensor_registry_get(grid_id, handle)->position;
+}
+
+/**
+    Get the number of registered sensors. Handles are always less than this.
+*/
+uint16_t mm_sensor_registry_get_count(uint8_t grid_id)
+{
+    return instances[grid_id].entry_count;
+}
+
+/**
+    Called before clearing node position changed flag, refreshes cached positions.
+*/
+void mm_sensor_registry_on_node_positions_update(uint8_t grid_id)
+{
+    /* Positions only change on configuration, so a full refresh is fine here. */
+    for (uint16_t i = 0; i < instances[grid_id].entry_count; i++)
+    {
+        instances[grid_id].entries[i].position = get_grid_position_for_node(grid_id, instances[grid_id].entries[i].node_id);
+    }
+}
+
+/**
+    Find the hash table slot for a sensor. The slot holds SENSOR_HANDLE_INVALID
+    if the sensor isn't registered.
+*/
+static uint16_t find_hash_slot(uint8_t grid_id, uint16_t node_id, sensor_rotation_t sensor_rotation)
+{
+    uint32_t key = (uint32_t)node_id * SENSOR_ROTATION_COUNT + sensor_rotation;
+    uint16_t slot = key % SENSOR_REGISTRY_HASH_SIZE;
+
+    /* Linear probe, the table is never full so this always ends. */
+    while (instances[grid_id].hash_table[slot] != SENSOR_HANDLE_INVALID)
+    {
+        mm_sensor_registry_entry_t const * entry = &instances[grid_id].entries[instances[grid_id].hash_table[slot]];
+
+        if (entry->node_id == node_id && entry->sensor_rotation == sensor_rotation)
+        {
+            break;
+        }
+
+        slot = (slot + 1) % SENSOR_REGISTRY_HASH_SIZE;
+    }
+
+    return slot;
+}
+
+/**
+    Fetch the position for a node, NULL if the node has no position or is part of another grid.
+*/
+static mm_node_position_t const * get_grid_position_for_node(uint8_t grid_id, uint16_t node_id)
+{
+    mm_node_position_t const * position = get_position_for_node(node_id);
+
+    if (position == NULL || position->grid_id != grid_id)
+    {
+        /* Sensors on another grid's nodes don't contribute to this grid. */
+        return NULL;
+    }
+
+    return position;
+}
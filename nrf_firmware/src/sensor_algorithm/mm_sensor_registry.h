@@ -0,0 +1,80 @@
+/**
+file: mm_sensor_registry.h
+brief: Maps sensors to dense handles so per-sensor state can be kept in handle-indexed arrays.
+notes:
+*/
+#ifndef MM_SENSOR_REGISTRY_H
+#define MM_SENSOR_REGISTRY_H
+
+/**********************************************************
+                        INCLUDES
+**********************************************************/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "mm_sensor_transmission.h"
+#include "mm_position_config.h"
+#include "mm_sensor_algorithm_config.h"
+
+/**********************************************************
+                        CONSTANTS
+**********************************************************/
+
+#define SENSOR_HANDLE_INVALID       ( UINT16_MAX )
+
+/**********************************************************
+                          TYPES
+**********************************************************/
+
+/* Dense index for a sensor, 0 to MAX_SENSOR_HANDLES - 1 in order of registration. */
+typedef uint16_t mm_sensor_handle_t;
+
+typedef struct
+{
+    uint16_t                    node_id;
+    sensor_rotation_t           sensor_rotation;
+    sensor_type_t               sensor_type;    /* SENSOR_TYPE_UNKNOWN until the sensor sends data. */
+    mm_node_position_t const *  position;       /* NULL if the node has no position yet. */
+} mm_sensor_registry_entry_t;
+
+/**********************************************************
+                       DECLARATIONS
+**********************************************************/
+
+/**
+    Clear all of a grid's registered sensors.
+*/
+void mm_sensor_registry_init(uint8_t grid_id);
+
+/**
+    Fetch the handle for a sensor, registering it if it is new.
+*/
+mm_sensor_handle_t mm_sensor_registry_resolve(uint8_t grid_id, uint16_t node_id, sensor_rotation_t sensor_rotation, sensor_type_t sensor_type);
+
+/**
+    Fetch the handle for the sensor that sent an event, registering it if it is new.
+*/
+mm_sensor_handle_t mm_sensor_registry_resolve_evt(uint8_t grid_id, sensor_evt_t const * evt);
+
+/**
+    Fetch the registry entry for a handle.
+*/
+mm_sensor_registry_entry_t const * mm_sensor_registry_get(uint8_t grid_id, mm_sensor_handle_t handle);
+
+/**
+    Fetch the cached node position for a handle, NULL if the node has no position yet.
+*/
+mm_node_position_t const * mm_sensor_registry_get_position(uint8_t grid_id, mm_sensor_handle_t handle);
+
+/**
+    Get the number of registered sensors. Handles are always less than this.
+*/
+uint16_t mm_sensor_registry_get_count(uint8_t grid_id);
+
+/**
+    Called before clearing node position changed flag, refreshes cached positions.
+*/
+void mm_sensor_registry_on_node_positions_update(uint8_t grid_id);
+
+#endif /* MM_SENSOR_REGISTRY_H */
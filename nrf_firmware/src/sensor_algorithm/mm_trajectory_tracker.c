@@ -0,0 +1,367 @@
+/**
+file: mm_trajectory_tracker.c
+brief: Tracks animals moving through a grid and predicts where they will reach the road.
+notes:
+    Each detection is reduced to the centre of the AVs it grows. A detection
+    joins the track whose predicted position is nearest, if the animal could
+    have got there since the track was last seen, otherwise it starts a new
+    track. This keeps animals in neighbouring cells apart unless one of them
+    has had time to walk over. Velocity is smoothed across detections so a
+    single jumpy sensor doesn't swing the prediction.
+
+    Only tracks seen more than once make predictions, a lone detection has
+    no direction yet and is already covered by AV growth.
+*/
+
+/**********************************************************
+                       INCLUDES
+**********************************************************/
+
+#include <string.h>
+
+#include "mm_trajectory_tracker.h"
+#include "mm_sensor_algorithm_config.h"
+
+/**********************************************************
+                        CONSTANTS
+**********************************************************/
+
+#define MAX_TRACKS                  ( 4 )
+
+#define TRACK_GATE_CELLS            ( 1.0f )    /* Furthest a detection can be from a track and still join it. */
+#define TRACK_SENSOR_SPREAD_CELLS   ( 0.5f )    /* How far apart two sensors seeing the same animal can place it. */
+#define TRACK_MAX_SPEED             ( 0.2f )    /* Cells per second, fastest an animal is expected to wander. */
+#define TRACK_TIMEOUT_S             ( 8 )       /* Tracks not seen for this long are dropped. */
+#define TRACK_CONFIRM_HITS          ( 2 )       /* Detections needed before a track predicts anything. */
+#define TRACK_VELOCITY_SMOOTHING    ( 0.5f )    /* Weight given to the newest velocity measurement. */
+#define TRACK_MIN_ROAD_SPEED        ( 0.05f )   /* Cells per second, slower tracks aren't heading anywhere. */
+
+/* How soon an animal has to reach the road for its column to escalate. */
+#define TRACK_POSSIBLE_DETECTION_S  ( 10 )
+#define TRACK_DETECTION_S           ( 3 )
+
+/**********************************************************
+                          TYPES
+**********************************************************/
+
+typedef struct
+{
+    float    x;             /* Position at last_seen_s, in AV coordinates. */
+    float    y;
+    float    vx;            /* Velocity, in cells per second. */
+    float    vy;
+    uint32_t last_seen_s;
+    uint8_t  hits;
+    bool     is_active;
+} track_t;
+
+typedef struct
+{
+    track_t  tracks[MAX_TRACKS];
+    uint32_t seconds;       /* Seconds since init, only used for differences. */
+} tracker_instance_t;
+
+/**********************************************************
+                       DECLARATIONS
+**********************************************************/
+
+/**
+    Find the live track whose predicted position is nearest (x, y), or NULL
+    if none are within TRACK_GATE_CELLS.
+*/
+static track_t * find_nearest_track(uint8_t grid_id, float x, float y);
+
+/**
+    Find a free track slot, reusing the stalest track if they are all live.
+*/
+static track_t * allocate_track(uint8_t grid_id);
+
+/**
+    Fold a new detection at (x, y) into an existing track.
+*/
+static void update_track(uint8_t grid_id, track_t * track, float x, float y);
+
+/**
+    Predict where a confirmed track will reach the road.
+
+    return false if the track isn't heading for the road.
+*/
+static bool predict_road_crossing(uint8_t grid_id, track_t const * track, uint8_t * column, uint32_t * seconds_to_road);
+
+/**********************************************************
+                       VARIABLES
+**********************************************************/
+
+static tracker_instance_t instances[MAX_SENSOR_GRIDS];
+
+#ifdef MM_ALLOW_SIMULATED_TIME
+    /* Lets the test framework measure how much the predictions add. */
+    static bool are_predictions_enabled = true;
+#endif
+
+/**********************************************************
+                       DEFINITIONS
+**********************************************************/
+
+/**
+    Clear all tracks in a grid.
+*/
+void mm_trajectory_tracker_init(uint8_t grid_id)
+{
+    memset(&instances[grid_id], 0, sizeof(instances[grid_id]));
+}
+
+/**
+    Add a detection centred on (x, y) to a grid, either extending
+    the nearest track or starting a new one.
+*/
+void mm_trajectory_tracker_on_detection(uint8_t grid_id, float x, float y)
+{
+    track_t * track = find_nearest_track(grid_id, x, y);
+
+    if (track != NULL)
+    {
+        update_track(grid_id, track, x, y);
+        return;
+    }
+
+    /* Nothing close enough, this is a new animal. */
+    track = allocate_track(grid_id);
+    memset(track, 0, sizeof(track_t));
+    track->x = x;
+    track->y = y;
+    track->last_seen_s = instances[grid_id].seconds;
+    track->hits = 1;
+    track->is_active = true;
+}
+
+/**
+    Call once per second, drops tracks that haven't been seen recently.
+*/
+void mm_trajectory_tracker_on_second_elapsed(uint8_t grid_id)
+{
+    instances[grid_id].seconds++;
+
+    for (uint8_t i = 0; i < MAX_TRACKS; i++)
+    {
+        track_t * track = &instances[grid_id].tracks[i];
+
+        if (track->is_active && instances[grid_id].seconds - track->last_seen_s >= TRACK_TIMEOUT_S)
+        {
+            track->is_active = false;
+        }
+    }
+}
+
+/**
+    Check if a grid has any live tracks, which move every second.
+*/
+bool mm_trajectory_tracker_is_tracking(uint8_t grid_id)
+{
+    for (uint8_t i = 0; i < MAX_TRACKS; i++)
+    {
+        if (instances[grid_id].tracks[i].is_active)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+    Predict which AV columns animals will reach the road in.
+*/
+void mm_trajectory_tracker_get_road_predictions(uint8_t grid_id, activity_variable_state_t predictions[MAX_AV_SIZE_X])
+{
+    for (uint8_t x = 0; x < MAX_AV_SIZE_X; x++)
+    {
+        predictions[x] = ACTIVITY_VARIABLE_STATE_IDLE;
+    }
+
+#ifdef MM_ALLOW_SIMULATED_TIME
+    if (!are_predictions_enabled)
+    {
+        return;
+    }
+#endif
+
+    for (uint8_t i = 0; i < MAX_TRACKS; i++)
+    {
+        uint8_t column;
+        uint32_t seconds_to_road;
+
+        if (!predict_road_crossing(grid_id, &instances[grid_id].tracks[i], &column, &seconds_to_road))
+        {
+            continue;
+        }
+
+        /* The closest animal heading for a column decides its state. */
+        activity_variable_state_t state = ACTIVITY_VARIABLE_STATE_IDLE;
+        if (seconds_to_road <= TRACK_DETECTION_S)
+        {
+            state = ACTIVITY_VARIABLE_STATE_DETECTION;
+        }
+        else if (seconds_to_road <= TRACK_POSSIBLE_DETECTION_S)
+        {
+            state = ACTIVITY_VARIABLE_STATE_POSSIBLE_DETECTION;
+        }
+
+        if (state > predictions[column])
+        {
+            predictions[column] = state;
+        }
+    }
+}
+
+#ifdef MM_ALLOW_SIMULATED_TIME
+/**
+    Turn road predictions on or off, only use for measuring them in testing.
+*/
+void mm_trajectory_tracker_set_predictions_enabled(bool enabled)
+{
+    are_predictions_enabled = enabled;
+}
+#endif
+
+/**
+    Find the live track whose predicted position is nearest (x, y), or NULL
+    if the animal couldn't have reached (x, y) from any of them.
+*/
+static track_t * find_nearest_track(uint8_t grid_id, float x, float y)
+{
+    track_t * nearest = NULL;
+    float nearest_distance_sq = TRACK_GATE_CELLS * TRACK_GATE_CELLS;
+
+    for (uint8_t i = 0; i < MAX_TRACKS; i++)
+    {
+        track_t * track = &instances[grid_id].tracks[i];
+
+        if (!track->is_active)
+        {
+            continue;
+        }
+
+        /* Compare against where the animal should be by now. */
+        float age = (float)(instances[grid_id].seconds - track->last_seen_s);
+        float dx = x - ( track->x + track->vx * age );
+        float dy = y - ( track->y + track->vy * age );
+        float distance_sq = dx * dx + dy * dy;
+
+        /* Recently seen tracks can't have wandered far. */
+        float reach = TRACK_SENSOR_SPREAD_CELLS + TRACK_MAX_SPEED * age;
+        if (reach < TRACK_GATE_CELLS && distance_sq > reach * reach)
+        {
+            continue;
+        }
+
+        if (distance_sq <= nearest_distance_sq)
+        {
+            nearest = track;
+            nearest_distance_sq = distance_sq;
+        }
+    }
+
+    return nearest;
+}
+
+/**
+    Find a free track slot, reusing the stalest track if they are all live.
+*/
+static track_t * allocate_track(uint8_t grid_id)
+{
+    track_t * stalest = &instances[grid_id].tracks[0];
+
+    for (uint8_t i = 0; i < MAX_TRACKS; i++)
+    {
+        track_t * track = &instances[grid_id].tracks[i];
+
+        if (!track->is_active)
+        {
+            return track;
+        }
+
+        if (track->last_seen_s < stalest->last_seen_s)
+        {
+            stalest = track;
+        }
+    }
+
+    return stalest;
+}
+
+/**
+    Fold a new detection at (x, y) into an existing track.
+*/
+static void update_track(uint8_t grid_id, track_t * track, float x, float y)
+{
+    uint32_t dt = instances[grid_id].seconds - track->last_seen_s;
+
+    if (dt == 0)
+    {
+        /* Several sensors seeing the animal in the same second, average them. */
+        track->x = ( track->x + x ) / 2.0f;
+        track->y = ( track->y + y ) / 2.0f;
+        return;
+    }
+
+    float vx = ( x - track->x ) / (float)dt;
+    float vy = ( y - track->y ) / (float)dt;
+
+    if (track->hits == 1)
+    {
+        /* First movement, nothing to smooth against yet. */
+        track->vx = vx;
+        track->vy = vy;
+    }
+    else
+    {
+        track->vx += TRACK_VELOCITY_SMOOTHING * ( vx - track->vx );
+        track->vy += TRACK_VELOCITY_SMOOTHING * ( vy - track->vy );
+    }
+    track->x = x;
+    track->y = y;
+    track->last_seen_s = instances[grid_id].seconds;
+
+    if (track->hits < TRACK_CONFIRM_HITS)
+    {
+        track->hits++;
+    }
+}
+
+/**
+    Predict where a confirmed track will reach the road.
+*/
+static bool predict_road_crossing(uint8_t grid_id, track_t const * track, uint8_t * column, uint32_t * seconds_to_road)
+{
+    if (!track->is_active || track->hits < TRACK_CONFIRM_HITS)
+    {
+        return false;
+    }
+
+    /* The road is at y = 0, so only tracks moving towards it matter. */
+    if (track->vy > -TRACK_MIN_ROAD_SPEED)
+    {
+        return false;
+    }
+
+    float age = (float)(instances[grid_id].seconds - track->last_seen_s);
+    float y = track->y + track->vy * age;
+    float time_to_road = ( y > 0.0f ) ? ( y / -track->vy ) : 0.0f;
+
+    /* Carry the sideways motion on to the road, the road ends at the grid edges. */
+    float x = track->x + track->vx * ( age + time_to_road );
+    if (x < 0.0f)
+    {
+        x = 0.0f;
+    }
+    else if (x > (float)( MAX_AV_SIZE_X - 1 ))
+    {
+        x = (float)( MAX_AV_SIZE_X - 1 );
+    }
+
+    *column = (uint8_t)x;
+    *seconds_to_road = (uint32_t)time_to_road;
+
+    return true;
+}
@@ -0,0 +1,68 @@
+/**
+file: mm_trajectory_tracker.h
+brief: Tracks animals moving through a grid and predicts where they will reach the road.
+notes:
+    Detections are associated into tracks by position, each track keeps a
+    velocity estimate so the LEDs can be escalated before the animal reaches
+    the road-side AVs. Positions are in AV coordinates, AV (x, y) covers
+    x..x+1 and y..y+1, and the road runs along y = 0.
+*/
+#ifndef MM_TRAJECTORY_TRACKER_H
+#define MM_TRAJECTORY_TRACKER_H
+
+/**********************************************************
+                        INCLUDES
+**********************************************************/
+
+#include <stdbool.h>
+
+#include "mm_activity_variables.h"
+
+/**********************************************************
+                        CONSTANTS
+**********************************************************/
+
+/* When false, tracks are still kept but never escalate an LED. */
+#define TRAJECTORY_PREDICTION       ( true )
+
+/**********************************************************
+                       DECLARATIONS
+**********************************************************/
+
+/**
+    Clear all tracks in a grid.
+*/
+void mm_trajectory_tracker_init(uint8_t grid_id);
+
+/**
+    Add a detection centred on (x, y) to a grid, either extending
+    the nearest track or starting a new one.
+*/
+void mm_trajectory_tracker_on_detection(uint8_t grid_id, float x, float y);
+
+/**
+    Call once per second, drops tracks that haven't been seen recently.
+*/
+void mm_trajectory_tracker_on_second_elapsed(uint8_t grid_id);
+
+/**
+    Check if a grid has any live tracks, which move every second.
+*/
+bool mm_trajectory_tracker_is_tracking(uint8_t grid_id);
+
+/**
+    Predict which AV columns animals will reach the road in.
+
+    [out] predictions: For each AV column, how close the nearest animal heading
+          there is to reaching the road. Columns with no animal heading for them are IDLE.
+*/
+void mm_trajectory_tracker_get_road_predictions(uint8_t grid_id, activity_variable_state_t predictions[MAX_AV_SIZE_X]);
+
+#ifdef MM_ALLOW_SIMULATED_TIME
+    /**
+        Turn road predictions on or off, only use for measuring them in testing.
+    */
+    void mm_trajectory_tracker_set_predictions_enabled(bool enabled);
+#endif
+
+#endif /* MM_TRAJECTORY_TRACKER_H */
@@ -0,0 +1,352 @@
+/**
+file: mm_wildlife_statistics.c
+brief: Long term statistics on when and where animals are detected in a grid.
+notes:
+    Every table is sized at compile time and every update touches a single
+    counter, so the statistics cost the same after a year as after a minute.
+    Counters saturate rather than wrap, a full counter just means "a lot".
+
+    Per-sensor counts are kept as a ring of daily counts, today's column is
+    cleared as the day starts so the ring always holds the last week.
+*/
+
+/**********************************************************
+                       INCLUDES
+**********************************************************/
+
+#include <string.h>
+
+#include "mm_wildlife_statistics.h"
+#include "mm_activity_variables.h"
+
+/**********************************************************
+                        CONSTANTS
+**********************************************************/
+
+#define SECONDS_PER_HOUR    ( 60 * 60 )
+#define SECONDS_PER_DAY     ( SECONDS_PER_HOUR * STATISTICS_HOURS_PER_DAY )
+
+/* Sections of the export, see mm_wildlife_statistics_export. */
+#define EXPORT_REGION_HOURLY_SIZE   ( ACTIVITY_VARIABLES_NUM * STATISTICS_HOURS_PER_DAY * sizeof(uint16_t) )
+#define EXPORT_DURATION_SIZE        ( SENSOR_TYPE_COUNT * DURATION_HISTOGRAM_BUCKETS * sizeof(uint16_t) )
+#define EXPORT_SENSOR_SIZE          ( sizeof(uint16_t) + sizeof(uint8_t) + STATISTICS_DAYS_PER_WEEK * sizeof(uint16_t) )
+#define EXPORT_SIZE                 ( EXPORT_REGION_HOURLY_SIZE + EXPORT_DURATION_SIZE + MAX_SENSOR_HANDLES * EXPORT_SENSOR_SIZE )
+
+/**********************************************************
+                          TYPES
+**********************************************************/
+
+typedef struct
+{
+    uint16_t region_hourly_counts[ACTIVITY_VARIABLES_NUM][STATISTICS_HOURS_PER_DAY];
+    uint16_t duration_histograms[SENSOR_TYPE_COUNT][DURATION_HISTOGRAM_BUCKETS];
+    uint16_t sensor_daily_counts[MAX_SENSOR_HANDLES][STATISTICS_DAYS_PER_WEEK];
+
+    uint32_t detection_start_s[MAX_SENSOR_HANDLES];
+    bool     is_detecting[MAX_SENSOR_HANDLES];
+
+    uint32_t seconds;   /* Seconds since init. */
+    uint8_t  today;     /* Column of sensor_daily_counts being counted into. */
+} statistics_instance_t;
+
+/**********************************************************
+                       DECLARATIONS
+**********************************************************/
+
+/**
+    Add one to a counter, stopping at its maximum.
+*/
+static void saturating_increment(uint16_t* counter);
+
+/**
+    Get the histogram bucket for a detection lasting duration_s.
+*/
+static uint8_t get_duration_bucket(uint32_t duration_s);
+
+/**
+    Get one byte of a grid's export.
+*/
+static uint8_t get_export_byte(uint8_t grid_id, uint16_t position);
+
+/**
+    Get the low (byte 0) or high (byte 1) byte of a count, so counts are exported little endian.
+*/
+static uint8_t get_count_byte(uint16_t count, uint16_t byte);
+
+/**********************************************************
+                       VARIABLES
+**********************************************************/
+
+static statistics_instance_t instances[MAX_SENSOR_GRIDS];
+
+/**********************************************************
+                       DEFINITIONS
+**********************************************************/
+
+/**
+    Clear the statistics for a grid.
+*/
+void mm_wildlife_statistics_init(uint8_t grid_id)
+{
+    memset(&instances[grid_id], 0, sizeof(instances[grid_id]));
+}
+
+/**
+    Count a detection in region (an AV index) of a grid.
+*/
+void mm_wildlife_statistics_on_region_detection(uint8_t grid_id, uint16_t region)
+{
+    if (region >= ACTIVITY_VARIABLES_NUM)
+    {
+        return;
+    }
+
+    uint8_t hour = ( instances[grid_id].seconds / SECONDS_PER_HOUR ) % STATISTICS_HOURS_PER_DAY;
+    saturating_increment(&instances[grid_id].region_hourly_counts[region][hour]);
+}
+
+/**
+    Called when a sensor in a grid starts detecting.
+*/
+void mm_wildlife_statistics_on_detection_start(uint8_t grid_id, mm_sensor_handle_t handle)
+{
+    if (handle >= MAX_SENSOR_HANDLES || instances[grid_id].is_detecting[handle])
+    {
+        return;
+    }
+
+    instances[grid_id].is_detecting[handle] = true;
+    instances[grid_id].detection_start_s[handle] = instances[grid_id].seconds;
+    saturating_increment(&instances[grid_id].sensor_daily_counts[handle][instances[grid_id].today]);
+}
+
+/**
+    Called when a sensor in a grid stops detecting.
+*/
+void mm_wildlife_statistics_on_detection_end(uint8_t grid_id, mm_sensor_handle_t handle)
+{
+    if (handle >= MAX_SENSOR_HANDLES || !instances[grid_id].is_detecting[handle])
+    {
+        return;
+    }
+
+    instances[grid_id].is_detecting[handle] = false;
+
+    sensor_type_t sensor_type = mm_sensor_registry_get(grid_id, handle)->sensor_type;
+    if (sensor_type >= SENSOR_TYPE_COUNT)
+    {
+        return;
+    }
+
+    uint8_t bucket = get_duration_bucket(instances[grid_id].seconds - instances[grid_id].detection_start_s[handle]);
+    saturating_increment(&instances[grid_id].duration_histograms[sensor_type][bucket]);
+}
+
+/**
+    Call once per second for each grid.
+*/
+void mm_wildlife_statistics_on_second_elapsed(uint8_t grid_id)
+{
+    instances[grid_id].seconds++;
+
+    if (instances[grid_id].seconds % SECONDS_PER_DAY != 0)
+    {
+        return;
+    }
+
+    /* New day, the oldest day in the ring makes room for it. */
+    instances[grid_id].today = ( instances[grid_id].today + 1 ) % STATISTICS_DAYS_PER_WEEK;
+
+    for (uint16_t handle = 0; handle < MAX_SENSOR_HANDLES; handle++)
+    {
+        instances[grid_id].sensor_daily_counts[handle][instances[grid_id].today] = 0;
+    }
+}
+
+/**
+    Read one counter from a grid's statistics.
+*/
+bool mm_wildlife_statistics_get
+    (
+    uint8_t grid_id,
+    wildlife_statistic_t statistic,
+    uint16_t index,
+    uint8_t bucket,
+    uint16_t* count
+    )
+{
+    if (grid_id >= MAX_SENSOR_GRIDS)
+    {
+        return false;
+    }
+
+    statistics_instance_t const * instance = &instances[grid_id];
+
+    switch (statistic)
+    {
+        case WILDLIFE_STATISTIC_REGION_HOURLY:
+            if (index >= ACTIVITY_VARIABLES_NUM || bucket >= STATISTICS_HOURS_PER_DAY)
+            {
+                return false;
+            }
+            *count = instance->region_hourly_counts[index][bucket];
+            return true;
+
+        case WILDLIFE_STATISTIC_DURATION:
+            if (index >= SENSOR_TYPE_COUNT || bucket >= DURATION_HISTOGRAM_BUCKETS)
+            {
+                return false;
+            }
+            *count = instance->duration_histograms[index][bucket];
+            return true;
+
+        default:
+            /* Sensor counts are looked up by sensor, see mm_wildlife_statistics_get_sensor_daily. */
+            return false;
+    }
+}
+
+/**
+    Read how many detections a sensor in a grid made days_ago days ago, 0 is today so far.
+*/
+bool mm_wildlife_statistics_get_sensor_daily
+    (
+    uint8_t grid_id,
+    uint16_t node_id,
+    sensor_rotation_t sensor_rotation,
+    uint8_t days_ago,
+    uint16_t* count
+    )
+{
+    if (grid_id >= MAX_SENSOR_GRIDS || days_ago >= STATISTICS_DAYS_PER_WEEK)
+    {
+        return false;
+    }
+
+    *count = 0;
+
+    /* Handles belong to the grid's registry, so look the sensor up there. */
+    for (mm_sensor_handle_t handle = 0; handle < mm_sensor_registry_get_count(grid_id); handle++)
+    {
+        mm_sensor_registry_entry_t const * sensor = mm_sensor_registry_get(grid_id, handle);
+
+        if (sensor->node_id == node_id && sensor->sensor_rotation == sensor_rotation)
+        {
+            uint8_t day = ( instances[grid_id].today + STATISTICS_DAYS_PER_WEEK - days_ago ) % STATISTICS_DAYS_PER_WEEK;
+            *count = instances[grid_id].sensor_daily_counts[handle][day];
+            break;
+        }
+    }
+
+    return true;
+}
+
+/**
+    Size of a grid's statistics as written by mm_wildlife_statistics_export, the same for every grid.
+*/
+uint16_t mm_wildlife_statistics_get_export_size(void)
+{
+    return EXPORT_SIZE;
+}
+
+/**
+    Write size bytes of a grid's statistics, starting offset bytes in.
+*/
+bool mm_wildlife_statistics_export(uint8_t grid_id, uint16_t offset, uint8_t* data, uint16_t size)
+{
+    if (grid_id >= MAX_SENSOR_GRIDS || (uint32_t)offset + size > EXPORT_SIZE)
+    {
+        return false;
+    }
+
+    for (uint16_t i = 0; i < size; i++)
+    {
+        data[i] = get_export_byte(grid_id, offset + i);
+    }
+
+    return true;
+}
+
+/**
+    Add one to a counter, stopping at its maximum.
+*/
+static void saturating_increment(uint16_t* counter)
+{
+    if (*counter < UINT16_MAX)
+    {
+        (*counter)++;
+    }
+}
+
+/**
+    Get the histogram bucket for a detection lasting duration_s.
+*/
+static uint8_t get_duration_bucket(uint32_t duration_s)
+{
+    uint8_t bucket = 0;
+
+    /* Bucket b holds durations under 2^b seconds. */
+    while (bucket < DURATION_HISTOGRAM_BUCKETS - 1 && duration_s >= ( 1u << bucket ))
+    {
+        bucket++;
+    }
+
+    return bucket;
+}
+
+/**
+    Get one byte of a grid's export.
+*/
+static uint8_t get_export_byte(uint8_t grid_id, uint16_t position)
+{
+    if (position < EXPORT_REGION_HOURLY_SIZE)
+    {
+        uint16_t counter = position / sizeof(uint16_t);
+        uint16_t count = instances[grid_id].region_hourly_counts[counter / STATISTICS_HOURS_PER_DAY][counter % STATISTICS_HOURS_PER_DAY];
+        return get_count_byte(count, position % sizeof(uint16_t));
+    }
+    position -= EXPORT_REGION_HOURLY_SIZE;
+
+    if (position < EXPORT_DURATION_SIZE)
+    {
+        uint16_t counter = position / sizeof(uint16_t);
+        uint16_t count = instances[grid_id].duration_histograms[counter / DURATION_HISTOGRAM_BUCKETS][counter % DURATION_HISTOGRAM_BUCKETS];
+        return get_count_byte(count, position % sizeof(uint16_t));
+    }
+    position -= EXPORT_DURATION_SIZE;
+
+    mm_sensor_handle_t handle = position / EXPORT_SENSOR_SIZE;
+    position %= EXPORT_SENSOR_SIZE;
+
+    if (handle >= mm_sensor_registry_get_count(grid_id))
+    {
+        /* No sensor, which node id 0 says. */
+        return 0;
+    }
+
+    mm_sensor_registry_entry_t const * sensor = mm_sensor_registry_get(grid_id, handle);
+
+    if (position < sizeof(uint16_t))
+    {
+        return get_count_byte(sensor->node_id, position);
+    }
+    position -= sizeof(uint16_t);
+
+    if (position < sizeof(uint8_t))
+    {
+        return (uint8_t)sensor->sensor_rotation;
+    }
+    position -= sizeof(uint8_t);
+
+    uint8_t days_ago = position / sizeof(uint16_t);
+    uint8_t day = ( instances[grid_id].today + STATISTICS_DAYS_PER_WEEK - days_ago ) % STATISTICS_DAYS_PER_WEEK;
+    return get_count_byte(instances[grid_id].sensor_daily_counts[handle][day], position % sizeof(uint16_t));
+}
+
+/**
+    Get the low (byte 0) or high (byte 1) byte of a count, so counts are exported little endian.
+*/
+static uint8_t get_count_byte(uint16_t count, uint16_t byte)
+{
+    return (uint8_t)( count >> ( 8 * byte ) );
+}
@@ -0,0 +1,122 @@
+/**
+file: mm_wildlife_statistics.h
+brief: Long term statistics on when and where animals are detected in a grid.
+notes:
+    Everything is a fixed size table of saturating counters, updated in constant
+    time per detection. The gateway has no wall clock, so hours and days are
+    counted from when the algorithm was started.
+*/
+#ifndef MM_WILDLIFE_STATISTICS_H
+#define MM_WILDLIFE_STATISTICS_H
+
+/**********************************************************
+                        INCLUDES
+**********************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "mm_sensor_transmission.h"
+#include "mm_sensor_registry.h"
+
+/**********************************************************
+                        CONSTANTS
+**********************************************************/
+
+#define STATISTICS_HOURS_PER_DAY        ( 24 )
+#define STATISTICS_DAYS_PER_WEEK        ( 7 )
+
+/* Bucket b counts detections lasting under 2^b seconds that didn't fit an earlier bucket,
+   the last bucket also counts everything longer. */
+#define DURATION_HISTOGRAM_BUCKETS      ( 8 )
+
+/**********************************************************
+                          TYPES
+**********************************************************/
+
+typedef enum
+{
+    WILDLIFE_STATISTIC_REGION_HOURLY,   /* Detections per AV region, by hour of the day. */
+    WILDLIFE_STATISTIC_DURATION,        /* Detection durations per sensor type. */
+    WILDLIFE_STATISTIC_SENSOR_DAILY,    /* Detections per sensor, for each of the last week of days. */
+
+    WILDLIFE_STATISTIC_COUNT
+} wildlife_statistic_t;
+
+/**********************************************************
+                       DECLARATIONS
+**********************************************************/
+
+/**
+    Clear the statistics for a grid.
+*/
+void mm_wildlife_statistics_init(uint8_t grid_id);
+
+/**
+    Count a detection in region (an AV index) of a grid.
+*/
+void mm_wildlife_statistics_on_region_detection(uint8_t grid_id, uint16_t region);
+
+/**
+    Called when a sensor in a grid starts detecting.
+*/
+void mm_wildlife_statistics_on_detection_start(uint8_t grid_id, mm_sensor_handle_t handle);
+
+/**
+    Called when a sensor in a grid stops detecting.
+*/
+void mm_wildlife_statistics_on_detection_end(uint8_t grid_id, mm_sensor_handle_t handle);
+
+/**
+    Call once per second for each grid.
+*/
+void mm_wildlife_statistics_on_second_elapsed(uint8_t grid_id);
+
+/**
+    Read one counter from a grid's statistics.
+
+    index:  AV index for WILDLIFE_STATISTIC_REGION_HOURLY, sensor_type_t for WILDLIFE_STATISTIC_DURATION.
+    bucket: Hour of the day, or duration histogram bucket.
+
+    return false if the statistic, index or bucket is out of range.
+*/
+bool mm_wildlife_statistics_get
+    (
+    uint8_t grid_id,
+    wildlife_statistic_t statistic,
+    uint16_t index,
+    uint8_t bucket,
+    uint16_t* count
+    );
+
+/**
+    Read how many detections a sensor in a grid made days_ago days ago, 0 is today so far.
+
+    return false if days_ago is out of range. Sensors that haven't been seen have a count of 0.
+*/
+bool mm_wildlife_statistics_get_sensor_daily
+    (
+    uint8_t grid_id,
+    uint16_t node_id,
+    sensor_rotation_t sensor_rotation,
+    uint8_t days_ago,
+    uint16_t* count
+    );
+
+/**
+    Size of a grid's statistics as written by mm_wildlife_statistics_export, the same for every grid.
+*/
+uint16_t mm_wildlife_statistics_get_export_size(void);
+
+/**
+    Write size bytes of a grid's statistics, starting offset bytes in. Counts are little endian uint16:
+        region hourly:  ACTIVITY_VARIABLES_NUM regions of STATISTICS_HOURS_PER_DAY hours
+        duration:       SENSOR_TYPE_COUNT sensor types of DURATION_HISTOGRAM_BUCKETS buckets
+        sensor daily:   MAX_SENSOR_HANDLES sensors of node id (uint16, 0 for no sensor),
+                        sensor rotation (uint8), then STATISTICS_DAYS_PER_WEEK counts from today back
+
+    return false if the grid doesn't exist or the range runs past the end.
+*/
+bool mm_wildlife_statistics_export(uint8_t grid_id, uint16_t offset, uint8_t* data, uint16_t size);
+
+#endif /* MM_WILDLIFE_STATISTICS_H */
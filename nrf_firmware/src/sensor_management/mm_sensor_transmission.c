@@ -2,6 +2,19 @@
 file: mm_sensor_transmission.c
 brief:
 notes:
+    Nodes don't send each sensor event on its own. Events are collected for
+    SENSOR_BATCH_WINDOW_MS after the first one, then sent to the gateway as
+    one message. An event that doesn't change its sensor's state, like the
+    sensor drivers' periodic reinforcement, is folded into the event
+    already queued for that sensor. Changes of state are always sent, in order.
+
+    Batch message:
+        byte 0: BLAZE_SENSOR_BATCH_PAGE_NUMBER
+        byte 1: event count
+        then SENSOR_BATCH_EVENT_SIZE bytes per event:
+            byte 0: sensor type << 4 | sensor rotation
+            byte 1: time since the batch's first event, in SENSOR_BATCH_TIMESTAMP_MS
+            byte 2-3: PIR detection (0 or 1), or lidar distance little endian
 */
 
 /**********************************************************
@@ -12,6 +25,7 @@ notes:
 
 #include "app_error.h"
 #include "app_scheduler.h"
+#include "app_timer.h"
 
 #include "mm_sensor_transmission.h"
 #include "mm_blaze_control.h"
@@ -24,6 +38,38 @@ notes:
 #define MAX_NUMBER_LISTENERS             ( 4 )
 #define BLAZE_LIDAR_DATA_PAGE_NUMBER     ( 0x01 )
 #define BLAZE_PIR_DATA_PAGE_NUMBER       ( 0x02 )
+#define BLAZE_SENSOR_BATCH_PAGE_NUMBER   ( 0x04 )
+
+/* How long a node collects sensor events before sending them. Can be overridden by the build. */
+#ifndef SENSOR_BATCH_WINDOW_MS
+#define SENSOR_BATCH_WINDOW_MS           ( 250 )
+#endif
+
+#define SENSOR_BATCH_HEADER_SIZE         ( 2 )
+#define SENSOR_BATCH_EVENT_SIZE          ( 4 )
+#define SENSOR_BATCH_MAX_EVENTS          ( ( ANT_BLAZE_MAX_MESSAGE_LENGTH - SENSOR_BATCH_HEADER_SIZE ) / SENSOR_BATCH_EVENT_SIZE )
+#define SENSOR_BATCH_TIMESTAMP_MS        ( 10 )
+
+#if SENSOR_BATCH_WINDOW_MS / SENSOR_BATCH_TIMESTAMP_MS > UINT8_MAX
+#error "SENSOR_BATCH_WINDOW_MS is too long for the batch timestamps."
+#endif
+
+/* A lidar measurement this close to the one queued for the same sensor replaces it. */
+#define LIDAR_COALESCE_DISTANCE_CM       ( 10 )
+
+/**********************************************************
+                          TYPES
+**********************************************************/
+
+#ifndef MM_BLAZE_GATEWAY
+typedef struct
+{
+    sensor_type_t       sensor_type;
+    sensor_rotation_t   sensor_rotation;
+    uint16_t            value;          /* Detection for a PIR, distance for a lidar. */
+    uint32_t            ticks;          /* When the sensor entered this state. */
+} batched_sensor_evt_t;
+#endif
 
 /**********************************************************
                         VARIABLES
@@ -31,6 +77,12 @@ notes:
 
 #ifdef MM_BLAZE_GATEWAY
 static sensor_data_evt_handler_t listeners[MAX_NUMBER_LISTENERS];
+#else
+APP_TIMER_DEF(m_batch_timer_id);
+
+static batched_sensor_evt_t batched_evts[SENSOR_BATCH_MAX_EVENTS];
+static uint8_t batched_evt_count = 0;
+static uint32_t batch_start_ticks;
 #endif
 
 /**********************************************************
@@ -41,6 +93,13 @@ static sensor_data_evt_handler_t listeners[MAX_NUMBER_LISTENERS];
 static void blaze_rx_handler(ant_blaze_message_t msg);
 static void on_rx_sensor_data(void* p_data, uint16_t size);
 static void sensor_data_evt_message_dispatch(sensor_evt_t const * sensor_evt);
+static void dispatch_batched_evt(uint16_t node_id, uint8_t const * batched_evt);
+#else
+static void batch_sensor_evt(sensor_type_t sensor_type, sensor_rotation_t sensor_rotation, uint16_t value);
+static bool is_same_state(batched_sensor_evt_t const * batched_evt, uint16_t value);
+static void send_batch(void);
+static void batch_timer_event(void * p_context);
+static void on_batch_timeout(void* p_data, uint16_t size);
 #endif
 
 /**********************************************************
@@ -52,6 +111,12 @@ void mm_sensor_transmission_init()
 #ifdef MM_BLAZE_GATEWAY
     mm_blaze_register_message_listener(blaze_rx_handler);
     memset(&listeners[0], 0, sizeof(listeners));
+#else
+    batched_evt_count = 0;
+
+    uint32_t err_code;
+    err_code = app_timer_create(&m_batch_timer_id, APP_TIMER_MODE_SINGLE_SHOT, batch_timer_event);
+    APP_ERROR_CHECK(err_code);
 #endif
 }
 
@@ -86,27 +151,9 @@ void mm_send_pir_data(sensor_rotation_t sensor_rotation, bool detection)
 
     sensor_data_evt_message_dispatch(&sensor_evt);
 #else
-    // Non-gateway nodes encode their sensor data events to
+    // Non-gateway nodes batch their sensor data events to
     // broadcast to the gateway node over blaze...
-    ant_blaze_message_t blaze_message;
-    memset(&blaze_message, 0, sizeof(blaze_message));
-
-    blaze_message.address = MM_GATEWAY_ID;
-    blaze_message.index = 0;
-    blaze_message.length = 5;
-
-    uint8_t payload [5];
-    memset(&payload[0], 0, sizeof(payload));
-
-    payload[0] = BLAZE_PIR_DATA_PAGE_NUMBER;
-    payload[1] = sensor_rotation;
-    payload[2] = detection ? 1 : 0;
-
-    memset( &payload[3], 0xFF, 2);
-
-    blaze_message.p_data = &payload[0];
-
-    mm_blaze_send_message(&blaze_message);
+    batch_sensor_evt(SENSOR_TYPE_PIR, sensor_rotation, detection ? 1 : 0);
 #endif
 }
 
@@ -125,27 +172,9 @@ void mm_send_lidar_data(sensor_rotation_t sensor_rotation, uint16_t distance_mea
 
     sensor_data_evt_message_dispatch(&sensor_evt);
 #else
-    // Non-gateway nodes encode their sensor data events to
+    // Non-gateway nodes batch their sensor data events to
     // broadcast to the gateway node over blaze...
-    ant_blaze_message_t blaze_message;
-    memset(&blaze_message, 0, sizeof(blaze_message));
-
-    blaze_message.address = MM_GATEWAY_ID;
-    blaze_message.index = 0;
-    blaze_message.length = 5;
-
-    uint8_t payload [5];
-    memset(&payload[0], 0, sizeof(payload));
-
-    payload[0] = BLAZE_LIDAR_DATA_PAGE_NUMBER;
-    payload[1] = sensor_rotation;
-    memcpy(&payload[2], &distance_measured, sizeof(distance_measured));
-
-    memset(&payload[4], 0xFF, 1);
-
-    blaze_message.p_data = &payload[0];
-
-    mm_blaze_send_message(&blaze_message);
+    batch_sensor_evt(SENSOR_TYPE_LIDAR, sensor_rotation, distance_measured);
 #endif
 }
 
@@ -160,6 +189,7 @@ static void blaze_rx_handler(ant_blaze_message_t msg)
     {
         case BLAZE_LIDAR_DATA_PAGE_NUMBER:
         case BLAZE_PIR_DATA_PAGE_NUMBER:
+        case BLAZE_SENSOR_BATCH_PAGE_NUMBER:
             break;
         default:
             return;
@@ -199,6 +229,13 @@ static void on_rx_sensor_data(void* p_data, uint16_t size)
             sensor_evt.pir_data.sensor_rotation = payload[1];
             sensor_evt.pir_data.detection = payload[2];
             break;
+        case BLAZE_SENSOR_BATCH_PAGE_NUMBER:
+            /* The algorithm works in whole seconds, so the events are dispatched in order as they arrive. */
+            for (uint8_t i = 0; i < payload[1] && i < SENSOR_BATCH_MAX_EVENTS; i++)
+            {
+                dispatch_batched_evt(msg->message.address, &payload[SENSOR_BATCH_HEADER_SIZE + i * SENSOR_BATCH_EVENT_SIZE]);
+            }
+            return;
         default:
             /* Message type should have been filtered already. */
             APP_ERROR_CHECK(true);
@@ -221,6 +258,153 @@ static void sensor_data_evt_message_dispatch(sensor_evt_t const * sensor_evt)
         }
     }
 }
+
+/* Unpacks one event of a batch message and notifies listeners. */
+static void dispatch_batched_evt(uint16_t node_id, uint8_t const * batched_evt)
+{
+    sensor_evt_t sensor_evt;
+    memset( &sensor_evt, 0, sizeof( sensor_evt ) );
+
+    sensor_evt.sensor_type = (sensor_type_t)( batched_evt[0] >> 4 );
+    sensor_rotation_t sensor_rotation = (sensor_rotation_t)( batched_evt[0] & 0x0F );
+
+    switch( sensor_evt.sensor_type )
+    {
+        case SENSOR_TYPE_LIDAR:
+            sensor_evt.lidar_data.node_id = node_id;
+            sensor_evt.lidar_data.sensor_rotation = sensor_rotation;
+            memcpy(&sensor_evt.lidar_data.distance_measured, &batched_evt[2], 2);
+            break;
+        case SENSOR_TYPE_PIR:
+            sensor_evt.pir_data.node_id = node_id;
+            sensor_evt.pir_data.sensor_rotation = sensor_rotation;
+            sensor_evt.pir_data.detection = batched_evt[2];
+            break;
+        default:
+            /* From newer firmware, skip it. */
+            return;
+    }
+
+    sensor_data_evt_message_dispatch( &sensor_evt );
+}
+#else
+/* Queues a sensor event, folding it into the sensor's queued event if its state hasn't changed. */
+static void batch_sensor_evt(sensor_type_t sensor_type, sensor_rotation_t sensor_rotation, uint16_t value)
+{
+    /* Only the sensor's latest queued event can be folded into, anything earlier would reorder a change of state. */
+    for (uint8_t i = batched_evt_count; i > 0; i--)
+    {
+        batched_sensor_evt_t * batched_evt = &batched_evts[i - 1];
+
+        if (batched_evt->sensor_type == sensor_type && batched_evt->sensor_rotation == sensor_rotation)
+        {
+            if (is_same_state(batched_evt, value))
+            {
+                batched_evt->value = value;
+                return;
+            }
+            break;
+        }
+    }
+
+    if (batched_evt_count == SENSOR_BATCH_MAX_EVENTS)
+    {
+        send_batch();
+    }
+
+    uint32_t ticks = app_timer_cnt_get();
+
+    if (batched_evt_count == 0)
+    {
+        batch_start_ticks = ticks;
+
+        uint32_t err_code;
+        err_code = app_timer_start(m_batch_timer_id, APP_TIMER_TICKS(SENSOR_BATCH_WINDOW_MS), NULL);
+        APP_ERROR_CHECK(err_code);
+    }
+
+    batched_sensor_evt_t * batched_evt = &batched_evts[batched_evt_count];
+    batched_evt->sensor_type = sensor_type;
+    batched_evt->sensor_rotation = sensor_rotation;
+    batched_evt->value = value;
+    batched_evt->ticks = ticks;
+
+    batched_evt_count++;
+}
+
+/* Checks whether a new reading leaves a queued event's sensor in the same state. */
+static bool is_same_state(batched_sensor_evt_t const * batched_evt, uint16_t value)
+{
+    if (batched_evt->sensor_type == SENSOR_TYPE_LIDAR)
+    {
+        uint16_t difference = ( value > batched_evt->value ) ? ( value - batched_evt->value ) : ( batched_evt->value - value );
+        return difference < LIDAR_COALESCE_DISTANCE_CM;
+    }
+
+    return value == batched_evt->value;
+}
+
+/* Sends every queued event to the gateway as one message. */
+static void send_batch(void)
+{
+    (void)app_timer_stop(m_batch_timer_id);
+
+    if (batched_evt_count == 0)
+    {
+        return;
+    }
+
+    uint8_t payload[SENSOR_BATCH_HEADER_SIZE + SENSOR_BATCH_MAX_EVENTS * SENSOR_BATCH_EVENT_SIZE];
+    memset(&payload[0], 0xFF, sizeof(payload));
+
+    payload[0] = BLAZE_SENSOR_BATCH_PAGE_NUMBER;
+    payload[1] = batched_evt_count;
+
+    for (uint8_t i = 0; i < batched_evt_count; i++)
+    {
+        batched_sensor_evt_t const * batched_evt = &batched_evts[i];
+        uint8_t * encoded = &payload[SENSOR_BATCH_HEADER_SIZE + i * SENSOR_BATCH_EVENT_SIZE];
+
+        uint32_t elapsed_ticks = app_timer_cnt_diff_compute(batched_evt->ticks, batch_start_ticks);
+        uint32_t timestamp = elapsed_ticks / APP_TIMER_TICKS(SENSOR_BATCH_TIMESTAMP_MS);
+
+        encoded[0] = ( batched_evt->sensor_type << 4 ) | batched_evt->sensor_rotation;
+        encoded[1] = ( timestamp > UINT8_MAX ) ? UINT8_MAX : timestamp;
+
+        if (batched_evt->sensor_type == SENSOR_TYPE_LIDAR)
+        {
+            memcpy(&encoded[2], &batched_evt->value, sizeof(uint16_t));
+        }
+        else
+        {
+            encoded[2] = batched_evt->value;
+        }
+    }
+
+    ant_blaze_message_t blaze_message;
+    memset(&blaze_message, 0, sizeof(blaze_message));
+
+    blaze_message.address = MM_GATEWAY_ID;
+    blaze_message.index = 0;
+    blaze_message.length = SENSOR_BATCH_HEADER_SIZE + batched_evt_count * SENSOR_BATCH_EVENT_SIZE;
+    blaze_message.p_data = &payload[0];
+
+    mm_blaze_send_message(&blaze_message);
+
+    batched_evt_count = 0;
+}
+
+static void batch_timer_event(void * p_context)
+{
+    uint32_t err_code;
+    err_code = app_sched_event_put(NULL, 0, on_batch_timeout);
+    APP_ERROR_CHECK(err_code);
+}
+
+static void on_batch_timeout(void* p_data, uint16_t size)
+{
+    send_batch();
+}
 #endif
 
 
@@ -21,6 +21,7 @@ notes:
 #include "ant_channel_config.h"
 #include "ant_key_manager.h"
 #include "softdevice_handler.h"
+#include "app_scheduler.h"
 #include "boards.h"
 
 /**********************************************************
@@ -36,6 +37,9 @@ notes:
 /* Internal callback for handling low level ant events. */
 static void ant_evt_dispatch(ant_evt_t * p_ant_evt);
 
+/* Sends the broadcast payload set during a burst, once the burst has ended. */
+static void on_burst_end(void* evt_data, uint16_t evt_size);
+
 /**********************************************************
                        VARIABLES
 **********************************************************/
@@ -44,6 +48,11 @@ static mm_ant_evt_handler_t ant_evt_handlers[MAX_EVT_HANDLERS];
 
 static bool ant_broadcast_active;
 
+/* The broadcast can't be changed during a burst, the latest payload waits for it to end. */
+static bool ant_burst_active;
+static bool is_payload_pending;
+static mm_ant_payload_t pending_payload;
+
 /**********************************************************
                        DEFINITIONS
 **********************************************************/
@@ -118,6 +127,13 @@ void mm_ant_set_payload(mm_ant_payload_t const * payload)
     mm_ant_payload_t local_payload;
     memcpy(&local_payload, payload, sizeof(local_payload));
 
+    if (ant_burst_active)
+    {
+        memcpy(&pending_payload, payload, sizeof(pending_payload));
+        is_payload_pending = true;
+        return;
+    }
+
     // Broadcast the data.
     err_code = sd_ant_broadcast_message_tx(MM_CHANNEL_NUMBER,
                                                 ANT_STANDARD_DATA_PAYLOAD_SIZE,
@@ -149,8 +165,42 @@ bool mm_ant_get_broadcast_state(void)
     return ant_broadcast_active;
 }
 
+bool mm_ant_burst_send(uint8_t * data, uint16_t size)
+{
+    APP_ERROR_CHECK(size == 0 || size % MM_ANT_BURST_PACKET_SIZE != 0);
+
+    if (ant_burst_active || !ant_broadcast_active)
+    {
+        return false;
+    }
+
+    uint32_t err_code;
+    err_code = sd_ant_burst_handler_request(MM_CHANNEL_NUMBER,
+                                            size,
+                                            data,
+                                            BURST_SEGMENT_START | BURST_SEGMENT_END);
+    APP_ERROR_CHECK(err_code);
+
+    ant_burst_active = true;
+    return true;
+}
+
+bool mm_ant_get_burst_state(void)
+{
+    return ant_burst_active;
+}
+
 static void ant_evt_dispatch(ant_evt_t * p_ant_evt)
 {
+    if (p_ant_evt->channel == MM_CHANNEL_NUMBER &&
+        (p_ant_evt->event == EVENT_TRANSFER_TX_COMPLETED || p_ant_evt->event == EVENT_TRANSFER_TX_FAILED))
+    {
+        /* Queued ahead of the listeners, so the burst has ended by the time they hear about it. */
+        uint32_t err_code;
+        err_code = app_sched_event_put(NULL, 0, on_burst_end);
+        APP_ERROR_CHECK(err_code);
+    }
+
     // Forward ANT event to listeners
     for (uint32_t i = 0; i < MAX_EVT_HANDLERS; i++)
     {
@@ -165,3 +215,13 @@ static void ant_evt_dispatch(ant_evt_t * p_ant_evt)
     }
 }
 
+static void on_burst_end(void* evt_data, uint16_t evt_size)
+{
+    ant_burst_active = false;
+
+    if (is_payload_pending)
+    {
+        is_payload_pending = false;
+        mm_ant_set_payload(&pending_payload);
+    }
+}
@@ -18,6 +18,9 @@ notes:
                         CONSTANTS
 **********************************************************/
 
+/* Bursts are sent as whole packets of this size. */
+#define MM_ANT_BURST_PACKET_SIZE    ( ANT_STANDARD_DATA_PAYLOAD_SIZE )
+
 /**********************************************************
                        DECLARATIONS
 **********************************************************/
@@ -53,4 +56,13 @@ void mm_ant_resume_broadcast(void);
 /* Get the current broadcast state, true for active, false for inactive. */
 bool mm_ant_get_broadcast_state(void);
 
+/* Start a burst transfer of size bytes, a multiple of MM_ANT_BURST_PACKET_SIZE. The data
+   must be left alone until EVENT_TRANSFER_TX_COMPLETED or EVENT_TRANSFER_TX_FAILED.
+   Broadcast payloads set during the burst are sent once it ends.
+   Returns false if a burst is already in progress or the broadcast is paused. */
+bool mm_ant_burst_send(uint8_t * data, uint16_t size);
+
+/* Get the current burst state, true while a burst is in progress. */
+bool mm_ant_get_burst_state(void);
+
 #endif /* MM_ANT_CONTROL_H */
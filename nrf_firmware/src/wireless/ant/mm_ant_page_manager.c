@@ -1,3 +1,18 @@
+/**
+file: mm_ant_page_manager.c
+brief: Shares the broadcast channel between every page that wants to be sent.
+notes:
+    Pages are kept in a pool of ANT_PAGE_MANAGER_MAX_QUEUE_SIZE elements.
+    Free elements are on a list, and queued elements are on a ring per
+    priority class, so adding a page and picking the next one are O(1).
+
+    Each timer tick picks a class by smooth weighted round robin: every
+    class with pages queued earns its weight in credit, the class with the
+    most credit is sent and pays back the total weight. With weights 4:2:1
+    a high priority page waits at most one slot while any normal or low
+    priority pages are queued, and the other classes still get their turns.
+*/
+
 /**********************************************************
                         INCLUDES
 **********************************************************/
@@ -16,7 +31,13 @@
 
 #define ANT_PAGE_MANAGER_TIMEOUT_INTERVAL   ( ( MM_CHAN_PERIOD * 2000 ) / 32768 )
 #define TIMER_TICKS APP_TIMER_TICKS(ANT_PAGE_MANAGER_TIMEOUT_INTERVAL)
-#define ANT_PAGE_MANAGER_MAX_QUEUE_SIZE     (10)
+
+/* Marks the end of the free list, or an empty ring. */
+#define INVALID_ELEMENT                     ( 0xFF )
+
+#if ANT_PAGE_MANAGER_MAX_QUEUE_SIZE >= INVALID_ELEMENT
+#error "ANT_PAGE_MANAGER_MAX_QUEUE_SIZE must fit in an element index."
+#endif
 
 APP_TIMER_DEF(m_timer_id);
 
@@ -24,22 +45,50 @@ APP_TIMER_DEF(m_timer_id);
                        DECLARATIONS
 **********************************************************/
 
-static void add_page_single ( uint8_t page_number, mm_ant_payload_t const * payload );
-static void timer_event(void * p_context);
-static void next_page(void* evt_data, uint16_t evt_size);
-
 typedef struct page_queue_element_struct
 {
-    uint8_t             page_number;
+    uint8_t             page_number;    /* 0 if the element is free. */
+    uint8_t             priority;
+    uint8_t             next;
+    uint8_t             prev;
     mm_ant_payload_t    payload;
 } page_queue_element_t;
 
+typedef struct page_fill_struct
+{
+    uint8_t                     page_number;    /* 0 if unused. */
+    mm_ant_page_fill_handler_t  fill_handler;
+} page_fill_t;
+
+typedef struct page_class_struct
+{
+    uint8_t             next_element;   /* Next element of the class to send, INVALID_ELEMENT if the class is empty. */
+    int16_t             credit;
+} page_class_t;
+
+static void add_page_single ( uint8_t page_number, mm_ant_payload_t const * payload, mm_ant_page_priority_t priority );
+static void remove_element ( uint8_t index );
+static void timer_event(void * p_context);
+static void next_page(void* evt_data, uint16_t evt_size);
+static page_class_t * next_class ( void );
+static mm_ant_page_fill_handler_t get_fill_handler ( uint8_t page_number );
+
 /**********************************************************
                        VARIABLES
 **********************************************************/
 
+/* Share of the broadcast slots each class gets while it has pages queued. */
+static int16_t const class_weights[ANT_PAGE_PRIORITY_COUNT] =
+{
+    4,  /* ANT_PAGE_PRIORITY_HIGH */
+    2,  /* ANT_PAGE_PRIORITY_NORMAL */
+    1   /* ANT_PAGE_PRIORITY_LOW */
+};
+
 static page_queue_element_t ant_page_manager_message_queue [ANT_PAGE_MANAGER_MAX_QUEUE_SIZE];
-static uint32_t page_queue_index = 0;
+static page_class_t page_classes [ANT_PAGE_PRIORITY_COUNT];
+static page_fill_t page_fills [ANT_PAGE_MANAGER_MAX_FILL_HANDLERS];
+static uint8_t free_element = INVALID_ELEMENT;
 static uint32_t page_queue_size = 0;
 
 /**********************************************************
@@ -55,6 +104,23 @@ void mm_ant_page_manager_init( void )
         sizeof(page_queue_element_t) * ANT_PAGE_MANAGER_MAX_QUEUE_SIZE
         );
 
+    /* Every element starts on the free list. */
+    for ( uint8_t i = 0; i < ANT_PAGE_MANAGER_MAX_QUEUE_SIZE; i++ )
+    {
+        ant_page_manager_message_queue[i].next = ( i + 1 < ANT_PAGE_MANAGER_MAX_QUEUE_SIZE ) ? ( i + 1 ) : INVALID_ELEMENT;
+    }
+    free_element = 0;
+
+    for ( uint8_t i = 0; i < ANT_PAGE_PRIORITY_COUNT; i++ )
+    {
+        page_classes[i].next_element = INVALID_ELEMENT;
+        page_classes[i].credit = 0;
+    }
+
+    memset(&page_fills[0], 0, sizeof(page_fills));
+
+    page_queue_size = 0;
+
     uint32_t err_code;
 
     err_code = app_timer_create(&m_timer_id, APP_TIMER_MODE_REPEATED, timer_event);
@@ -64,11 +130,11 @@ void mm_ant_page_manager_init( void )
     APP_ERROR_CHECK(err_code);
 }
 
-void mm_ant_page_manager_add_page(uint8_t page_number, mm_ant_payload_t const * payload, uint8_t copies)
+void mm_ant_page_manager_add_page(uint8_t page_number, mm_ant_payload_t const * payload, uint8_t copies, mm_ant_page_priority_t priority)
 {
     for (uint8_t i = 0; i < copies; i++)
     {
-        add_page_single(page_number, payload);
+        add_page_single(page_number, payload, priority);
     }
 }
 
@@ -78,8 +144,7 @@ void mm_ant_page_manager_remove_all_pages( uint8_t page_number )
     {
         if (ant_page_manager_message_queue[i].page_number == page_number )
         {
-            ant_page_manager_message_queue[i].page_number = 0;
-            page_queue_size--;
+            remove_element(i);
 
             if ( page_queue_size == 0 )
             {
@@ -108,6 +173,22 @@ void mm_ant_page_manager_replace_all_pages(uint8_t page_number, mm_ant_payload_t
     }
 }
 
+void mm_ant_page_manager_set_fill_handler(uint8_t page_number, mm_ant_page_fill_handler_t fill_handler)
+{
+    for ( uint8_t i = 0; i < ANT_PAGE_MANAGER_MAX_FILL_HANDLERS; i++ )
+    {
+        if ( page_fills[i].page_number == 0 || page_fills[i].page_number == page_number )
+        {
+            page_fills[i].page_number = page_number;
+            page_fills[i].fill_handler = fill_handler;
+            return;
+        }
+    }
+
+    /* Raise ANT_PAGE_MANAGER_MAX_FILL_HANDLERS. */
+    APP_ERROR_CHECK(true);
+}
+
 static void timer_event(void * p_context)
 {
     uint32_t err_code;
@@ -122,34 +203,136 @@ static void next_page(void* evt_data, uint16_t evt_size)
         return;
     }
 
-    do
+    page_class_t * page_class = next_class();
+    page_queue_element_t * element = &ant_page_manager_message_queue[page_class->next_element];
+
+    page_class->next_element = element->next;
+
+    mm_ant_page_fill_handler_t fill_handler = get_fill_handler(element->page_number);
+    if ( fill_handler != NULL )
     {
-        page_queue_index++;
-        page_queue_index %= ANT_PAGE_MANAGER_MAX_QUEUE_SIZE;
+        fill_handler( &( element->payload ) );
     }
-    while(ant_page_manager_message_queue[page_queue_index].page_number == 0);
 
-    mm_ant_set_payload( &( ant_page_manager_message_queue[page_queue_index].payload ) );
+    mm_ant_set_payload( &( element->payload ) );
 }
 
-static void add_page_single ( uint8_t page_number, mm_ant_payload_t const * payload )
+static mm_ant_page_fill_handler_t get_fill_handler ( uint8_t page_number )
 {
-    for (uint8_t i = 0; i < ANT_PAGE_MANAGER_MAX_QUEUE_SIZE; i++)
+    for ( uint8_t i = 0; i < ANT_PAGE_MANAGER_MAX_FILL_HANDLERS; i++ )
     {
-        if ( ant_page_manager_message_queue[i].page_number == 0 )
+        if ( page_fills[i].page_number == page_number )
         {
-            ant_page_manager_message_queue[i].page_number = page_number;
-            memcpy( &( ant_page_manager_message_queue[i].payload ), payload, sizeof(mm_ant_payload_t) );
+            return page_fills[i].fill_handler;
+        }
+    }
 
-            if ( page_queue_size == 0)
-            {
-                mm_ant_set_payload( payload );
-            }
+    return NULL;
+}
 
-            page_queue_size++;
-            return;
+/**
+    Pick the class to send next by smooth weighted round robin. Only called while pages are queued.
+*/
+static page_class_t * next_class ( void )
+{
+    page_class_t * chosen = NULL;
+    int16_t total_weight = 0;
+
+    for ( uint8_t i = 0; i < ANT_PAGE_PRIORITY_COUNT; i++ )
+    {
+        page_class_t * page_class = &page_classes[i];
+
+        if ( page_class->next_element == INVALID_ELEMENT )
+        {
+            continue;
+        }
+
+        page_class->credit += class_weights[i];
+        total_weight += class_weights[i];
+
+        if ( chosen == NULL || page_class->credit > chosen->credit )
+        {
+            chosen = page_class;
         }
     }
 
-    APP_ERROR_CHECK(true);
+    chosen->credit -= total_weight;
+    return chosen;
+}
+
+static void add_page_single ( uint8_t page_number, mm_ant_payload_t const * payload, mm_ant_page_priority_t priority )
+{
+    if ( free_element == INVALID_ELEMENT || priority >= ANT_PAGE_PRIORITY_COUNT )
+    {
+        APP_ERROR_CHECK(true);
+        return;
+    }
+
+    uint8_t index = free_element;
+    page_queue_element_t * element = &ant_page_manager_message_queue[index];
+    page_class_t * page_class = &page_classes[priority];
+
+    free_element = element->next;
+
+    element->page_number = page_number;
+    element->priority = priority;
+    memcpy( &( element->payload ), payload, sizeof(mm_ant_payload_t) );
+
+    if ( page_class->next_element == INVALID_ELEMENT )
+    {
+        element->next = index;
+        element->prev = index;
+        page_class->next_element = index;
+
+        /* Don't let a class that was idle spend credit from a previous burst. */
+        page_class->credit = 0;
+    }
+    else
+    {
+        /* Join the end of the rotation, just before the page due next. */
+        page_queue_element_t * next = &ant_page_manager_message_queue[page_class->next_element];
+
+        element->next = page_class->next_element;
+        element->prev = next->prev;
+        ant_page_manager_message_queue[next->prev].next = index;
+        next->prev = index;
+    }
+
+    if ( page_queue_size == 0)
+    {
+        mm_ant_set_payload( payload );
+    }
+
+    page_queue_size++;
+}
+
+/**
+    Unlink an element from its class' ring and return it to the free list.
+*/
+static void remove_element ( uint8_t index )
+{
+    page_queue_element_t * element = &ant_page_manager_message_queue[index];
+    page_class_t * page_class = &page_classes[element->priority];
+
+    if ( element->next == index )
+    {
+        /* Last page of its class. */
+        page_class->next_element = INVALID_ELEMENT;
+    }
+    else
+    {
+        ant_page_manager_message_queue[element->prev].next = element->next;
+        ant_page_manager_message_queue[element->next].prev = element->prev;
+
+        if ( page_class->next_element == index )
+        {
+            page_class->next_element = element->next;
+        }
+    }
+
+    element->page_number = 0;
+    element->next = free_element;
+    free_element = index;
+
+    page_queue_size--;
 }
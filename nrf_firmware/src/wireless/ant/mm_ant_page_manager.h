@@ -18,20 +18,57 @@
 #define LIDAR_MONITORING_APP_DATA_PAGE                      ( 0x21 )
 #define PIR_MONITORING_APP_DATA PAGE                        ( 0x22 )
 
+/* Pages that can be queued at once, across every priority. Can be overridden by the build. */
+#ifndef ANT_PAGE_MANAGER_MAX_QUEUE_SIZE
+#define ANT_PAGE_MANAGER_MAX_QUEUE_SIZE                     ( 32 )
+#endif
+
+/* Page numbers that can have a fill handler, see mm_ant_page_manager_set_fill_handler. */
+#define ANT_PAGE_MANAGER_MAX_FILL_HANDLERS                  ( 2 )
+
 /**********************************************************
                        DECLARATIONS
 **********************************************************/
 
+/**
+    Priority classes for broadcast pages. Every class with pages queued gets
+    a share of the broadcast slots in proportion to its weight (see
+    mm_ant_page_manager.c), so a high priority page is never more than a
+    couple of slots away, and low priority pages are never starved.
+    Within a class, pages take turns, and a page added with more copies
+    gets more turns.
+*/
+typedef enum
+{
+    ANT_PAGE_PRIORITY_HIGH,     ///< Outputs the user can see, like LED states.
+    ANT_PAGE_PRIORITY_NORMAL,   ///< Status and replies, like errors, AVs and config results.
+    ANT_PAGE_PRIORITY_LOW,      ///< Bulk data, like monitoring pages and node status.
+
+    ANT_PAGE_PRIORITY_COUNT
+} mm_ant_page_priority_t;
+
+/**
+    Fills in a page's payload right before it is broadcast.
+*/
+typedef void (*mm_ant_page_fill_handler_t)(mm_ant_payload_t * payload);
+
 /**********************************************************
                        DEFINITIONS
 **********************************************************/
 
 void mm_ant_page_manager_init( void );
 
-void mm_ant_page_manager_add_page(uint8_t page_number, mm_ant_payload_t const * payload, uint8_t copies);
+void mm_ant_page_manager_add_page(uint8_t page_number, mm_ant_payload_t const * payload, uint8_t copies, mm_ant_page_priority_t priority);
 
 void mm_ant_page_manager_remove_all_pages(uint8_t page_number);
 
 void mm_ant_page_manager_replace_all_pages(uint8_t page_number, mm_ant_payload_t const * payload);
 
+/**
+    Have every page with this page number filled in by a handler each time it comes up
+    for broadcast, rather than repeating the payload it was added with. For pages that
+    send something new every time, like a stream of snapshots.
+*/
+void mm_ant_page_manager_set_fill_handler(uint8_t page_number, mm_ant_page_fill_handler_t fill_handler);
+
 #endif /* MM_ANT_PAGE_MANAGER_H */
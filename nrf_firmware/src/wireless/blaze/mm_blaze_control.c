@@ -32,7 +32,6 @@ notes:
     #include "bsp.h"
 #endif
 
-#define DEFAULT_GROUP ((uint16_t) 511)
 #define TIMER_TICKS APP_TIMER_TICKS(ANT_BLAZE_TIMEOUT_INTERVAL)
 APP_TIMER_DEF(m_timer_id);
 
@@ -100,6 +99,30 @@ void mm_blaze_send_message(ant_blaze_message_t * message)
     APP_ERROR_CHECK(err_code);
 }
 
+void mm_blaze_set_channel_period(uint16_t channel_period)
+{
+    uint32_t err_code;
+
+    // Applied on-the-fly by the library.
+#ifdef MM_BLAZE_NODE
+    node_config.channel_period = channel_period;
+    err_code = ant_blaze_node_config(&node_config);
+#else
+    gateway_config.channel_period = channel_period;
+    err_code = ant_blaze_gateway_config(&gateway_config);
+#endif
+    APP_ERROR_CHECK(err_code);
+}
+
+uint16_t mm_blaze_get_node_id(void)
+{
+    uint16_t this_node_id;
+    uint16_t this_network_id;
+    get_node_and_network_id(&this_node_id, &this_network_id);
+
+    return this_node_id;
+}
+
 void mm_blaze_register_message_listener(mm_blaze_message_handler_t rx_handler)
 {
     uint32_t i;
@@ -155,7 +178,7 @@ void mm_blaze_pack_message(ant_blaze_message_t const * unpacked, mm_blaze_messag
         APP_ERROR_CHECK(err_code);
 
         // Add node to groups, if using the grouping feature
-        err_code = ant_blaze_node_add_to_group(DEFAULT_GROUP);
+        err_code = ant_blaze_node_add_to_group(MM_DEFAULT_GROUP_ID);
         APP_ERROR_CHECK(err_code);
 
         mm_blaze_common_init();
@@ -182,6 +205,7 @@ void mm_blaze_pack_message(ant_blaze_message_t const * unpacked, mm_blaze_messag
         gateway_config.radio_freqs[1] = MM_FREQ_B;
         gateway_config.radio_freqs[2] = MM_FREQ_C;
 
+        gateway_config.channel_period = MM_CHANNEL_PERIOD;
         gateway_config.tx_power = MM_TX_POWER;
         gateway_config.encryption_enabled = MM_USE_ENCRYPTION;
         gateway_config.p_ant_network_key = m_ant_network_key;
@@ -36,6 +36,12 @@ typedef struct
 
 void mm_blaze_init(uint16_t assigned_node_id, uint16_t assigned_network_id);
 
+/* Get this node's blaze address */
+uint16_t mm_blaze_get_node_id(void);
+
+/* Change the channel period while blaze is running */
+void mm_blaze_set_channel_period(uint16_t channel_period);
+
 /* Messages may arrive in interrupt context, use mm_blaze_message_serialized_t to kick to main. */
 void mm_blaze_register_message_listener(mm_blaze_message_handler_t rx_handler);
 
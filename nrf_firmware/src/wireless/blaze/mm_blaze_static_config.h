@@ -20,7 +20,9 @@ notes:
 
 #define MM_NETWORK_ID          ( (uint16_t) 20000 )
 #define MM_TX_POWER            ( RADIO_TX_POWER_LVL_3 )
-#define MM_CHANNEL_PERIOD      ( ANT_BLAZE_CHANNEL_PERIOD_DYNAMIC )
+#define MM_CHANNEL_PERIOD_LOW_POWER    ( ANT_BLAZE_CHANNEL_PERIOD_2HZ )  /**< While the grids are quiet. */
+#define MM_CHANNEL_PERIOD_LOW_LATENCY  ( ANT_BLAZE_CHANNEL_PERIOD_8HZ )  /**< While there is activity, a multiple of the low-power rate so both stay in step. */
+#define MM_CHANNEL_PERIOD      ( MM_CHANNEL_PERIOD_LOW_LATENCY )   /**< Every node starts at this period, see mm_channel_period_control.h. */
 #define MM_FREQ_NUM            ( (uint8_t) 1 )     /**< Set to number of desired radio frequencies (1 - 3).  */
 #define MM_FREQ_A              ( (uint8_t) 11 )    /**< 2411MHz. */
 #define MM_FREQ_B              ( (uint8_t) 22 )    /**< 2422MHz. */
@@ -28,6 +30,7 @@ notes:
 #define MM_USE_ENCRYPTION      ( ANT_BLAZE_PAYLOAD_ENCRYPTION_ENABLED )
 #define MM_NUM_GROUP_ADDRESSES ( (uint16_t) 32 )
 #define MM_GATEWAY_ID          ( (uint16_t) 246 )
+#define MM_DEFAULT_GROUP_ID    ( (uint16_t) 511 )  /**< Group every node joins, for messages to all nodes. */
 
 /**********************************************************
                        DECLARATIONS
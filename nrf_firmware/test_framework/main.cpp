@@ -123,7 +123,7 @@ int main(int argc, char* argv[])
         // We're getting some arguments from the genetic algorithm :D
         mm_sensor_algorithm_config_t parameters;
         test_demo_parse_parameters(&parameters, std::string(argv[0]), std::string(argv[1]));
-        float score = test_runner_init(tests, &parameters);
+        float score = test_runner_init(tests, &parameters, false);
         test_demo_write_score(score, std::string(argv[0]), std::string(argv[1]));
     }
     else
@@ -138,7 +138,15 @@ int main(int argc, char* argv[])
 		test_one_animal_zig_zag(tests);
 		test_more_than_two_animals_through_network(tests);
 		test_sensors_not_working(tests);
-        test_runner_init(tests, &sensor_algorithm_config_default);
+		test_detection_latency_add_tests(tests);
+		test_idle_wakeups_add_tests(tests);
+		test_position_table_add_tests(tests);
+		test_multiple_grids_add_tests(tests);
+		test_algorithm_config_update_add_tests(tests);
+		test_trajectory_prediction_add_tests(tests);
+		test_wildlife_statistics_add_tests(tests);
+		test_warm_restart_add_tests(tests);
+        test_runner_init(tests, &sensor_algorithm_config_default, true);
     }
 
     return 0;
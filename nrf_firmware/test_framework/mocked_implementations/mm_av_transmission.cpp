@@ -62,7 +62,7 @@ void mm_av_transmission_send_av_update
 }
 
 /**
- * Broadcast all activity variable state over ANT.
+ * Broadcast all of MONITORED_SENSOR_GRID's activity variable state over ANT.
  */
 void mm_av_transmission_send_all_avs(void)
 {
@@ -72,15 +72,15 @@ void mm_av_transmission_send_all_avs(void)
     {
         for (uint8_t y = 0; y < MAX_AV_SIZE_Y; ++y)
         {
-            if (AV(x, y) != av_cache[x][y])
+            if (AV(MONITORED_SENSOR_GRID, x, y) != av_cache[x][y])
             {
-                av_cache[x][y] = AV(x, y);
+                av_cache[x][y] = AV(MONITORED_SENSOR_GRID, x, y);
 
                 /* Get the region status for AV transmission... */
-                activity_variable_state_t av_status = mm_get_status_for_av(&AV(x, y));
+                activity_variable_state_t av_status = mm_get_status_for_av(MONITORED_SENSOR_GRID, &AV(MONITORED_SENSOR_GRID, x, y));
 
                 /* Broadcast raw AV values to monitoring application over ANT. */
-                mm_av_transmission_send_av_update(x, y, AV(x, y), av_status);
+                mm_av_transmission_send_av_update(x, y, AV(MONITORED_SENSOR_GRID, x, y), av_status);
             }
         }
     }
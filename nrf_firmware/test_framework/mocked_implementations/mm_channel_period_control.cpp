@@ -0,0 +1,153 @@
+/**
+file: mm_channel_period_control.cpp
+brief: Mocked channel period switching, measures the time spent at each period
+notes:
+    Switches happen straight away, the firmware's switch delay is short
+    next to the simulated second.
+*/
+
+/**********************************************************
+                        INCLUDES
+**********************************************************/
+
+#include <string>
+
+#include "mm_channel_period_control.hpp"
+#include "test_output_logger.hpp"
+#include "simulate_time.hpp"
+
+extern "C" {
+#include "mm_channel_period_control.h"
+}
+
+/**********************************************************
+                        CONSTANTS
+**********************************************************/
+
+/* Must match MM_CHANNEL_PERIOD_LOW_POWER and MM_CHANNEL_PERIOD_LOW_LATENCY. */
+static float const channel_period_hz[CHANNEL_PERIOD_MODE_COUNT] = { 2.0f, 8.0f };
+
+/**********************************************************
+                       VARIABLES
+**********************************************************/
+
+static mm_channel_period_mode_t current_mode;
+static uint32_t mode_start_s;
+static uint32_t seconds_in_mode[CHANNEL_PERIOD_MODE_COUNT];
+static uint32_t switch_count;
+static uint32_t message_count;
+static float message_latency_sum_ms;
+
+/**********************************************************
+                       DECLARATIONS
+**********************************************************/
+
+/**
+ * Get the seconds spent at each period, including the mode the network is in now.
+ */
+static void get_seconds_in_modes(uint32_t seconds[CHANNEL_PERIOD_MODE_COUNT]);
+
+/**********************************************************
+                       DEFINITIONS
+**********************************************************/
+
+/**
+ * Start at the low-latency period, like the firmware.
+ */
+void mm_channel_period_control_init(void)
+{
+    current_mode = CHANNEL_PERIOD_MODE_LOW_LATENCY;
+    mode_start_s = get_simulated_time_elapsed();
+    for (uint8_t i = 0; i < CHANNEL_PERIOD_MODE_COUNT; i++)
+    {
+        seconds_in_mode[i] = 0;
+    }
+    switch_count = 0;
+    message_count = 0;
+    message_latency_sum_ms = 0.0f;
+}
+
+/**
+ * Switch the network to a mode.
+ */
+void mm_channel_period_control_set_mode(mm_channel_period_mode_t mode)
+{
+    if (mode == current_mode)
+    {
+        return;
+    }
+
+    uint32_t now = get_simulated_time_elapsed();
+    seconds_in_mode[current_mode] += now - mode_start_s;
+    mode_start_s = now;
+    current_mode = mode;
+    switch_count++;
+
+    log_message("CHANNEL PERIOD EVENT,mode," + std::to_string(mode));
+}
+
+void test_channel_period_on_message(void)
+{
+    message_count++;
+    message_latency_sum_ms += 1000.0f / ( 2.0f * channel_period_hz[current_mode] );
+}
+
+uint32_t test_channel_period_get_switch_count(void)
+{
+    return switch_count;
+}
+
+float test_channel_period_get_low_power_fraction(void)
+{
+    uint32_t seconds[CHANNEL_PERIOD_MODE_COUNT];
+    get_seconds_in_modes(seconds);
+
+    uint32_t total = seconds[CHANNEL_PERIOD_MODE_LOW_POWER] + seconds[CHANNEL_PERIOD_MODE_LOW_LATENCY];
+    if (total == 0)
+    {
+        return 0.0f;
+    }
+
+    return (float)seconds[CHANNEL_PERIOD_MODE_LOW_POWER] / total;
+}
+
+float test_channel_period_get_relative_radio_duty(void)
+{
+    uint32_t seconds[CHANNEL_PERIOD_MODE_COUNT];
+    get_seconds_in_modes(seconds);
+
+    /* Radio on-time scales with the number of channel periods. */
+    float periods = 0.0f;
+    uint32_t total = 0;
+    for (uint8_t i = 0; i < CHANNEL_PERIOD_MODE_COUNT; i++)
+    {
+        periods += seconds[i] * channel_period_hz[i];
+        total += seconds[i];
+    }
+
+    if (total == 0)
+    {
+        return 1.0f;
+    }
+
+    return periods / ( total * channel_period_hz[CHANNEL_PERIOD_MODE_LOW_LATENCY] );
+}
+
+float test_channel_period_get_average_latency_ms(void)
+{
+    if (message_count == 0)
+    {
+        return 0.0f;
+    }
+
+    return message_latency_sum_ms / message_count;
+}
+
+static void get_seconds_in_modes(uint32_t seconds[CHANNEL_PERIOD_MODE_COUNT])
+{
+    for (uint8_t i = 0; i < CHANNEL_PERIOD_MODE_COUNT; i++)
+    {
+        seconds[i] = seconds_in_mode[i];
+    }
+    seconds[current_mode] += get_simulated_time_elapsed() - mode_start_s;
+}
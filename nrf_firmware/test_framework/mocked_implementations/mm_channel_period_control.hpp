@@ -0,0 +1,48 @@
+/**
+file: mm_channel_period_control.hpp
+brief: Test framework functions for measuring the channel period the algorithm runs the network at
+notes:
+    The radio isn't simulated, the time spent at each period is used to
+    model its cost instead. A message waits half a period for its slot on
+    average, so that is the latency added to each sensor message.
+*/
+
+#ifndef MM_CHANNEL_PERIOD_CONTROL_HPP
+#define MM_CHANNEL_PERIOD_CONTROL_HPP
+
+/**********************************************************
+                        INCLUDES
+**********************************************************/
+
+#include <cstdint>
+
+/**********************************************************
+                       DEFINITIONS
+**********************************************************/
+
+/**
+ * Record a sensor message arriving at the current period.
+ */
+void test_channel_period_on_message(void);
+
+/**
+ * Get the number of times the network changed period in the current test.
+ */
+uint32_t test_channel_period_get_switch_count(void);
+
+/**
+ * Get the fraction of the current test spent at the low-power period.
+ */
+float test_channel_period_get_low_power_fraction(void);
+
+/**
+ * Get the radio duty over the current test, relative to running at the low-latency period throughout.
+ */
+float test_channel_period_get_relative_radio_duty(void);
+
+/**
+ * Get the average latency the channel period added to sensor messages in the current test, in ms.
+ */
+float test_channel_period_get_average_latency_ms(void);
+
+#endif
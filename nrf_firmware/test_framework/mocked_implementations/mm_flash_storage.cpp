@@ -0,0 +1,86 @@
+/**
+file: mm_flash_storage.cpp
+brief: Mocking out the mm_flash_storage.c file with records kept in memory
+notes: Writes finish immediately, and the records outlast mm_flash_storage_init
+       like they would a reset. Call test_flash_storage_erase to start from blank flash.
+*/
+
+/**********************************************************
+                        INCLUDES
+**********************************************************/
+
+#include <vector>
+
+#include "mm_flash_storage.hpp"
+
+/**********************************************************
+                        VARIABLES
+**********************************************************/
+
+static std::vector<uint8_t> records[FLASH_AREA_COUNT];
+static uint32_t write_count = 0;
+
+/**********************************************************
+                       DEFINITIONS
+**********************************************************/
+
+void mm_flash_storage_init(void)
+{
+    // Nothing to find, the records are already in memory.
+}
+
+bool mm_flash_storage_read(mm_flash_area_t area, void * data, uint16_t size)
+{
+    if (records[area].size() != size)
+    {
+        return false;
+    }
+
+    memcpy(data, records[area].data(), size);
+    return true;
+}
+
+bool mm_flash_storage_write(mm_flash_area_t area, void const * data, uint16_t size)
+{
+    if (size > FLASH_STORAGE_MAX_RECORD_SIZE)
+    {
+        return false;
+    }
+
+    uint8_t const * bytes = (uint8_t const *)data;
+    records[area].assign(bytes, bytes + size);
+    write_count++;
+    return true;
+}
+
+bool mm_flash_storage_queue_write(mm_flash_area_t area, void const * data, uint16_t size)
+{
+    // Flash is never busy, so queued writes happen right away.
+    return mm_flash_storage_write(area, data, size);
+}
+
+bool mm_flash_storage_is_busy(void)
+{
+    return false;
+}
+
+/**
+ * Erase every area, as on a freshly programmed gateway.
+ */
+void test_flash_storage_erase(void)
+{
+    for (uint8_t area = 0; area < FLASH_AREA_COUNT; area++)
+    {
+        records[area].clear();
+    }
+
+    write_count = 0;
+}
+
+/**
+ * Get the number of writes since flash was last erased.
+ */
+uint32_t test_flash_storage_get_write_count(void)
+{
+    return write_count;
+}
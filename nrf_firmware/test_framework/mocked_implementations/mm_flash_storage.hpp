@@ -0,0 +1,32 @@
+/**
+file: mm_flash_storage.hpp
+brief: Header file for test framework functions used to control the simulated flash
+notes:
+*/
+
+#ifndef MM_FLASH_STORAGE_HPP
+#define MM_FLASH_STORAGE_HPP
+
+/**********************************************************
+                        INCLUDES
+**********************************************************/
+
+extern "C" {
+#include "mm_flash_storage_pub.h"
+}
+
+/**********************************************************
+                       DECLARATIONS
+**********************************************************/
+
+/**
+ * Erase every area, as on a freshly programmed gateway.
+ */
+void test_flash_storage_erase(void);
+
+/**
+ * Get the number of writes since flash was last erased.
+ */
+uint32_t test_flash_storage_get_write_count(void);
+
+#endif
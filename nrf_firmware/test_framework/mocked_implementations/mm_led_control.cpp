@@ -68,6 +68,27 @@ void mm_led_control_update_node_leds
     );
 }
 
+/**
+ * Set led states for several nodes.
+ */
+void mm_led_control_update_all_node_leds(led_node_output_t const * outputs, uint8_t count)
+{
+    /* The group message reaches every node, log it as an update to each. */
+    for (uint8_t i = 0; i < count; i++)
+    {
+        /* LED control only sends a node a state it doesn't already have, so repeats aren't logged. */
+        LedUpdate const * last = testOutput.getLastLedUpdate(outputs[i].node_id);
+        if (last != NULL &&
+            last->ledFunctionM == outputs[i].led_function &&
+            last->ledColourM == outputs[i].led_colour)
+        {
+            continue;
+        }
+
+        mm_led_control_update_node_leds(outputs[i].node_id, outputs[i].led_function, outputs[i].led_colour);
+    }
+}
+
 /**
  * Get the output log for the current test.
  */
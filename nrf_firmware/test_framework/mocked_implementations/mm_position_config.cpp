@@ -11,6 +11,7 @@ Author: Elijah Pennoyer
 **********************************************************/
 extern "C" {
     #include "mm_position_config.h"
+    #include "mm_sensor_algorithm_config.h"
     #include "mm_switch_config.h"
     #include "app_error.h"
 }
@@ -20,7 +21,9 @@ extern "C" {
 /**********************************************************
                         CONSTANTS
 **********************************************************/
-#define MAX_NUMBER_NODES                    ( 9 )
+
+/* Node IDs in grid n are the grid 0 node IDs plus n * GRID_NODE_ID_OFFSET. */
+#define GRID_NODE_ID_OFFSET                 ( 10 )
 
 
 /**********************************************************
@@ -34,7 +37,7 @@ extern "C" {
 /**********************************************************
                        VARIABLES
 **********************************************************/
-static std::vector<mm_node_position_t> node_positions(MAX_NUMBER_NODES);
+static std::vector<mm_node_position_t> node_positions(MAX_GATEWAY_NODES);
 static bool have_positions_changed = true;
 
 /**********************************************************
@@ -61,6 +64,7 @@ void mm_position_config_init(void)
     top_left.node_id = 1;
     top_left.node_type = HARDWARE_CONFIG_PIR_LIDAR_LED;
     top_left.node_rotation = NODE_ROTATION_90;
+    top_left.grid_id = DEFAULT_GRID_ID;
     top_left.grid_position_x = -1;
     top_left.grid_position_y = 1;
     top_left.grid_offset_x = 0;
@@ -72,6 +76,7 @@ void mm_position_config_init(void)
     top_middle.node_id = 2;
     top_middle.node_type = HARDWARE_CONFIG_PIR_LIDAR_LED;
     top_middle.node_rotation = NODE_ROTATION_180;
+    top_middle.grid_id = DEFAULT_GRID_ID;
     top_middle.grid_position_x = 0;
     top_middle.grid_position_y = 1;
     top_middle.grid_offset_x = 0;
@@ -83,6 +88,7 @@ void mm_position_config_init(void)
     top_right.node_id = 3;
     top_right.node_type = HARDWARE_CONFIG_PIR_LIDAR_LED;
     top_right.node_rotation = NODE_ROTATION_180;
+    top_right.grid_id = DEFAULT_GRID_ID;
     top_right.grid_position_x = 1;
     top_right.grid_position_y = 1;
     top_right.grid_offset_x = 0;
@@ -94,6 +100,7 @@ void mm_position_config_init(void)
     middle_left.node_id = 4;
     middle_left.node_type = HARDWARE_CONFIG_PIR_LIDAR;
     middle_left.node_rotation = NODE_ROTATION_90;
+    middle_left.grid_id = DEFAULT_GRID_ID;
     middle_left.grid_position_x = -1;
     middle_left.grid_position_y = 0;
     middle_left.grid_offset_x = 0;
@@ -105,6 +112,7 @@ void mm_position_config_init(void)
     middle_middle.node_id = 5;
     middle_middle.node_type = HARDWARE_CONFIG_PIR_PIR;
     middle_middle.node_rotation = NODE_ROTATION_0;
+    middle_middle.grid_id = DEFAULT_GRID_ID;
     middle_middle.grid_position_x = 0;
     middle_middle.grid_position_y = 0;
     middle_middle.grid_offset_x = 0;
@@ -116,6 +124,7 @@ void mm_position_config_init(void)
     middle_right.node_id = 6;
     middle_right.node_type = HARDWARE_CONFIG_PIR_PIR;
     middle_right.node_rotation = NODE_ROTATION_0;
+    middle_right.grid_id = DEFAULT_GRID_ID;
     middle_right.grid_position_x = 1;
     middle_right.grid_position_y = 0;
     middle_right.grid_offset_x = 0;
@@ -127,6 +136,7 @@ void mm_position_config_init(void)
     bottom_left.node_id = 7;
     bottom_left.node_type = HARDWARE_CONFIG_PIR_LIDAR;
     bottom_left.node_rotation = NODE_ROTATION_0;
+    bottom_left.grid_id = DEFAULT_GRID_ID;
     bottom_left.grid_position_x = -1;
     bottom_left.grid_position_y = -1;
     bottom_left.grid_offset_x = 0;
@@ -138,6 +148,7 @@ void mm_position_config_init(void)
     bottom_middle.node_id = 8;
     bottom_middle.node_type = HARDWARE_CONFIG_PIR_PIR;
     bottom_middle.node_rotation = NODE_ROTATION_90;
+    bottom_middle.grid_id = DEFAULT_GRID_ID;
     bottom_middle.grid_position_x = 0;
     bottom_middle.grid_position_y = -1;
     bottom_middle.grid_offset_x = 0;
@@ -149,6 +160,7 @@ void mm_position_config_init(void)
     bottom_right.node_id = 9;
     bottom_right.node_type = HARDWARE_CONFIG_PIR_LIDAR;
     bottom_right.node_rotation = NODE_ROTATION_270;
+    bottom_right.grid_id = DEFAULT_GRID_ID;
     bottom_right.grid_position_x = 1;
     bottom_right.grid_position_y = -1;
     bottom_right.grid_offset_x = 0;
@@ -156,6 +168,18 @@ void mm_position_config_init(void)
     bottom_right.is_valid = true;
     node_positions.push_back(bottom_right);
 
+    //Every other grid gets a copy of the same network.
+    size_t grid_node_count = node_positions.size();
+    for (uint8_t grid_id = DEFAULT_GRID_ID + 1; grid_id < MAX_SENSOR_GRIDS; ++grid_id)
+    {
+        for (size_t i = 0; i < grid_node_count; ++i)
+        {
+            mm_node_position_t position = node_positions[i];
+            position.node_id += grid_id * GRID_NODE_ID_OFFSET;
+            position.grid_id = grid_id;
+            node_positions.push_back(position);
+        }
+    }
 }
 
 /* Gets the entire array of node positions for the system */
@@ -180,10 +204,10 @@ mm_node_position_t const * get_position_for_node(uint16_t node_id)
     return NULL;
 }
 
-/* Gets a specific node position by node location. Returns NULL if
- * the node doesn't exist in the list yet.
+/* Gets a specific node position by node location within a grid.
+ * Returns NULL if the node doesn't exist in the list yet.
  */
-mm_node_position_t const * get_node_for_position(int8_t x, int8_t y) 
+mm_node_position_t const * get_node_for_position(uint8_t grid_id, int8_t x, int8_t y) 
 { 
     for (auto const & position : node_positions)
     {
@@ -192,6 +216,11 @@ mm_node_position_t const * get_node_for_position(int8_t x, int8_t y)
             continue;
         }
 
+        if(position.grid_id != grid_id)
+        {
+            continue;
+        }
+
         if(position.grid_position_x != x)
         {
             continue;
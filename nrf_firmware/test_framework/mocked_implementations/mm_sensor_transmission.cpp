@@ -10,6 +10,7 @@ Author: Elijah Pennoyer
                         INCLUDES
 **********************************************************/
 #include "mm_sensor_transmission.hpp"
+#include "mm_channel_period_control.hpp"
 #include <vector>
 #include <string.h>
 
@@ -97,7 +98,7 @@ void test_send_pir_data
     bool detection
 )
 {
-    auto node = get_node_for_position(x_pos, y_pos);
+    auto node = get_node_for_position(DEFAULT_GRID_ID, x_pos, y_pos);
     sensor_rotation_t rotation = (sensor_rotation_t)((NODE_ROTATION_COUNT + total_rotation - node->node_rotation) % NODE_ROTATION_COUNT);
 
     uint16_t node_id = node->node_id;
@@ -113,7 +114,7 @@ void test_send_lidar_data
     uint16_t distance_measured
 )
 {
-    auto node = get_node_for_position(x_pos, y_pos);
+    auto node = get_node_for_position(DEFAULT_GRID_ID, x_pos, y_pos);
     sensor_rotation_t rotation = (sensor_rotation_t)((NODE_ROTATION_COUNT + total_rotation - node->node_rotation) % NODE_ROTATION_COUNT);
 
     uint16_t node_id = node->node_id;
@@ -123,6 +124,9 @@ void test_send_lidar_data
 
 static void sensor_data_evt_message_dispatch(sensor_evt_t const * sensor_evt)
 {
+    // The message waited for a slot at the current channel period on its way here.
+    test_channel_period_on_message();
+
     // Send the sensor_event_t to the listeners. Iterates through the vector.
     for(auto listener : listeners)
     {
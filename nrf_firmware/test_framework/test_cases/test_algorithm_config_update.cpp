@@ -0,0 +1,126 @@
+/**
+file: test_algorithm_config_update.cpp
+brief: Testing algorithm config updates applied while the algorithm is running
+notes: Updates are written to a shadow config and only take effect on the next
+       second, without resetting the activity variables.
+*/
+
+/**********************************************************
+                       INCLUDES
+**********************************************************/
+
+#include "tests.hpp"
+#include "expect_utils.hpp"
+
+extern "C" {
+#include "mm_position_config.h"
+#include "mm_sensor_algorithm.h"
+#include "mm_activity_variables.h"
+}
+
+/**********************************************************
+                       DECLARATIONS
+**********************************************************/
+
+// A staged update should wait for the next second, then apply without resetting the activity variables.
+static void test_case_update_applies_on_next_second(TestOutput& oracle);
+// An invalid update should be discarded, leaving the algorithm running on the old config.
+static void test_case_invalid_update_discarded(TestOutput& oracle);
+// Staging an update for another grid should only change that grid.
+static void test_case_second_grid_update(TestOutput& oracle);
+
+/**********************************************************
+                       DEFINITIONS
+**********************************************************/
+
+void test_algorithm_config_update_add_tests(std::vector<TestCase>& tests)
+{
+    // Static config builds can't apply updates at all.
+#ifndef MM_STATIC_ALGORITHM_CONFIG
+    ADD_TEST(test_case_update_applies_on_next_second);
+#if (MAX_SENSOR_GRIDS > 1)
+    ADD_TEST(test_case_second_grid_update);
+#endif
+#endif
+    ADD_TEST(test_case_invalid_update_discarded);
+}
+
+static void test_case_update_applies_on_next_second(TestOutput& oracle)
+{
+    simulate_time(MINUTES(1));
+
+    uint16_t concern_duration_s = mm_sensor_algorithm_config(DEFAULT_GRID_ID)->minimum_concern_signal_duration_s;
+
+    // Possible detection in bottom left. Output: Concern, idle, idle
+    test_send_pir_data(-1, 0, SENSOR_ROTATION_180, PIR_DETECTION_START);
+    test_send_pir_data(-1, 0, SENSOR_ROTATION_180, PIR_DETECTION_END);
+    oracle.logLedUpdate(-1, 1, LED_FUNCTION_LEDS_BLINKING, LED_COLOURS_YELLOW);
+
+    // Hold concerns for twice as long.
+    mm_sensor_algorithm_config_shadow(DEFAULT_GRID_ID)->minimum_concern_signal_duration_s = 2 * concern_duration_s;
+    expect(mm_sensor_algorithm_config_stage(DEFAULT_GRID_ID), "Valid config update was not staged.");
+    mm_sensor_algorithm_on_config_staged();
+
+    mm_activity_variable_t max_av = get_max_activity_variable();
+    expect(mm_sensor_algorithm_config(DEFAULT_GRID_ID)->minimum_concern_signal_duration_s == concern_duration_s, "Config update applied before the next second.");
+
+    simulate_time(1);
+    expect(mm_sensor_algorithm_config(DEFAULT_GRID_ID)->minimum_concern_signal_duration_s == 2 * concern_duration_s, "Config update not applied on the next second.");
+    expect(get_max_activity_variable() > mm_sensor_algorithm_config(DEFAULT_GRID_ID)->activity_variable_min, "Activity variables were reset by the config update.");
+    expect(get_max_activity_variable() < max_av, "Activity variables stopped draining after the config update.");
+
+    // The concern outlasts the old duration.
+    simulate_time(concern_duration_s);
+    expect_led_output(-1, 1, LED_FUNCTION_LEDS_BLINKING, LED_COLOURS_YELLOW);
+
+    simulate_time(concern_duration_s);
+    oracle.logLedUpdate(-1, 1, LED_FUNCTION_LEDS_OFF);
+    expect_led_output(-1, 1, LED_FUNCTION_LEDS_OFF, LED_COLOURS_RED);
+
+    simulate_time(MINUTES(2));
+}
+
+static void test_case_invalid_update_discarded(TestOutput& oracle)
+{
+    simulate_time(MINUTES(1));
+
+    mm_activity_variable_t av_min = mm_sensor_algorithm_config(DEFAULT_GRID_ID)->activity_variable_min;
+
+    // A minimum above the maximum leaves AVs nowhere to grow.
+    mm_sensor_algorithm_config_shadow(DEFAULT_GRID_ID)->activity_variable_min = mm_sensor_algorithm_config(DEFAULT_GRID_ID)->activity_variable_max + 1.0f;
+    expect(!mm_sensor_algorithm_config_stage(DEFAULT_GRID_ID), "Invalid config update was staged.");
+
+    simulate_time(1);
+    expect(mm_sensor_algorithm_config(DEFAULT_GRID_ID)->activity_variable_min == av_min, "Invalid config update was applied.");
+
+    // Detections still work on the old config. Output: Concern, idle, idle
+    test_send_pir_data(-1, 0, SENSOR_ROTATION_180, PIR_DETECTION_START);
+    test_send_pir_data(-1, 0, SENSOR_ROTATION_180, PIR_DETECTION_END);
+    oracle.logLedUpdate(-1, 1, LED_FUNCTION_LEDS_BLINKING, LED_COLOURS_YELLOW);
+    expect_led_output(-1, 1, LED_FUNCTION_LEDS_BLINKING, LED_COLOURS_YELLOW);
+
+    simulate_time(mm_sensor_algorithm_config(DEFAULT_GRID_ID)->minimum_concern_signal_duration_s + 1);
+    oracle.logLedUpdate(-1, 1, LED_FUNCTION_LEDS_OFF);
+
+    simulate_time(MINUTES(2));
+}
+
+static void test_case_second_grid_update(TestOutput& oracle)
+{
+    uint8_t const second_grid_id = DEFAULT_GRID_ID + 1;
+
+    simulate_time(MINUTES(1));
+
+    uint16_t concern_duration_s = mm_sensor_algorithm_config(DEFAULT_GRID_ID)->minimum_concern_signal_duration_s;
+
+    mm_sensor_algorithm_config_shadow(second_grid_id)->minimum_concern_signal_duration_s = 2 * concern_duration_s;
+    expect(mm_sensor_algorithm_config_stage(second_grid_id), "Valid config update was not staged.");
+    mm_sensor_algorithm_on_config_staged();
+    expect(mm_sensor_algorithm_config(second_grid_id)->minimum_concern_signal_duration_s == concern_duration_s, "Config update applied before the next second.");
+
+    simulate_time(1);
+    expect(mm_sensor_algorithm_config(DEFAULT_GRID_ID)->minimum_concern_signal_duration_s == concern_duration_s, "Config update applied to the wrong grid.");
+    expect(mm_sensor_algorithm_config(second_grid_id)->minimum_concern_signal_duration_s == 2 * concern_duration_s, "Config update not applied to its grid on the next second.");
+
+    simulate_time(MINUTES(1));
+}
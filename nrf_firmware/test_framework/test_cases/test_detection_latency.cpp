@@ -0,0 +1,84 @@
+/**
+file: test_detection_latency.cpp
+brief: Testing how quickly the LEDs respond to a detection
+notes: Escalations should be sent as soon as the detection is processed,
+       de-escalations should still respect the minimum signal durations.
+*/
+
+/**********************************************************
+                       INCLUDES
+**********************************************************/
+
+#include "tests.hpp"
+#include "expect_utils.hpp"
+
+/**********************************************************
+                       DECLARATIONS
+**********************************************************/
+
+// A PIR detection should escalate the roadside LED without waiting for a second to elapse.
+static void test_case_pir_escalates_immediately(TestOutput& oracle);
+// A lidar detection on top of a PIR detection should escalate further, again without waiting.
+static void test_case_lidar_escalates_immediately(TestOutput& oracle);
+// An immediate escalation should still hold for the minimum concern duration before turning off.
+static void test_case_immediate_escalation_holds_concern(TestOutput& oracle);
+
+/**********************************************************
+                       DEFINITIONS
+**********************************************************/
+
+void test_detection_latency_add_tests(std::vector<TestCase>& tests)
+{
+    ADD_TEST(test_case_pir_escalates_immediately);
+    ADD_TEST(test_case_lidar_escalates_immediately);
+    ADD_TEST(test_case_immediate_escalation_holds_concern);
+}
+
+static void test_case_pir_escalates_immediately(TestOutput& oracle)
+{
+    simulate_time(MINUTES(1));
+
+    // Possible detection in bottom left. Output: Concern, idle, idle
+    test_send_pir_data(-1, 0, SENSOR_ROTATION_180, PIR_DETECTION_START);
+    oracle.logLedUpdate(-1, 1, LED_FUNCTION_LEDS_BLINKING, LED_COLOURS_YELLOW);
+    expect_led_output(-1, 1, LED_FUNCTION_LEDS_BLINKING, LED_COLOURS_YELLOW);
+
+    simulate_time(5);
+}
+
+static void test_case_lidar_escalates_immediately(TestOutput& oracle)
+{
+    simulate_time(MINUTES(1));
+
+    test_send_pir_data(-1, 0, SENSOR_ROTATION_180, PIR_DETECTION_START);
+    oracle.logLedUpdate(-1, 1, LED_FUNCTION_LEDS_BLINKING, LED_COLOURS_YELLOW);
+
+    // Detection in bottom left. Output: Alarm, concern, idle
+    simulate_time(2);
+    test_send_lidar_data(-1, -1, SENSOR_ROTATION_0, 200);
+    oracle.logLedUpdate(-1, 1, LED_FUNCTION_LEDS_BLINKING, LED_COLOURS_RED);
+    oracle.logLedUpdate(0, 1, LED_FUNCTION_LEDS_BLINKING, LED_COLOURS_YELLOW);
+    expect_led_output(-1, 1, LED_FUNCTION_LEDS_BLINKING, LED_COLOURS_RED);
+    expect_led_output(0, 1, LED_FUNCTION_LEDS_BLINKING, LED_COLOURS_YELLOW);
+
+    simulate_time(MINUTES(3));
+}
+
+static void test_case_immediate_escalation_holds_concern(TestOutput& oracle)
+{
+    simulate_time(MINUTES(1));
+
+    test_send_pir_data(-1, 0, SENSOR_ROTATION_180, PIR_DETECTION_START);
+    test_send_pir_data(-1, 0, SENSOR_ROTATION_180, PIR_DETECTION_END);
+    oracle.logLedUpdate(-1, 1, LED_FUNCTION_LEDS_BLINKING, LED_COLOURS_YELLOW);
+
+    // The AV drains below the threshold quickly, but the concern must be held.
+    simulate_time(mm_sensor_algorithm_config(DEFAULT_GRID_ID)->minimum_concern_signal_duration_s);
+    expect_led_output(-1, 1, LED_FUNCTION_LEDS_BLINKING, LED_COLOURS_YELLOW);
+
+    simulate_time(1);
+    oracle.logLedUpdate(-1, 1, LED_FUNCTION_LEDS_OFF);
+    expect_led_output(-1, 1, LED_FUNCTION_LEDS_OFF, LED_COLOURS_RED);
+
+    simulate_time(MINUTES(2));
+}
@@ -35,6 +35,8 @@ static void test_case_test_sensor_hyperactivity_cooldown(TestOutput& oracle);
 static void test_case_test_sensor_inactivity(TestOutput& oracle);
 /* Test to make sure that inactivity flags on different sensors will update as time passes. */
 static void test_case_test_inactive_state_update(TestOutput& oracle);
+/* Test that inactivity deadlines keep working when activity continues over several days. */
+static void test_case_test_inactivity_across_days(TestOutput& oracle);
 
 /**********************************************************
 DEFINITIONS
@@ -47,6 +49,7 @@ void test_hyperactive_inactive_add_tests(std::vector<TestCase>& tests)
     ADD_TEST(test_case_test_sensor_hyperactivity_cooldown);
     ADD_TEST(test_case_test_sensor_inactivity);
     ADD_TEST(test_case_test_inactive_state_update);
+    ADD_TEST(test_case_test_inactivity_across_days);
 }
 
 static void test_case_test_sensor_normal_activity(TestOutput& oracle)
@@ -72,7 +75,7 @@ static void test_case_test_sensor_normal_activity(TestOutput& oracle)
     // If any sensors are listed as hyperactive, that's a fail.
     for (auto const & evt : pir_evts)
     {
-        if (mm_sensor_error_is_sensor_hyperactive(&evt))
+        if (mm_sensor_error_is_sensor_hyperactive(DEFAULT_GRID_ID, &evt))
         {
             std::stringstream ss;
             ss << "PIR sensor on node ID " << evt.pir_data.node_id << " at rotation " << evt.pir_data.sensor_rotation << " is hyperactive when it shouldn't be.";
@@ -81,7 +84,7 @@ static void test_case_test_sensor_normal_activity(TestOutput& oracle)
     }
     for (auto const & evt : lidar_evts)
     {
-        if (mm_sensor_error_is_sensor_hyperactive(&evt))
+        if (mm_sensor_error_is_sensor_hyperactive(DEFAULT_GRID_ID, &evt))
         {
             std::stringstream ss;
             ss << "LIDAR sensor on node ID " << evt.lidar_data.node_id << " at rotation " << evt.lidar_data.sensor_rotation << " is hyperactive when it shouldn't be.";
@@ -113,7 +116,7 @@ static void test_case_test_sensor_hyperactivity(TestOutput& oracle)
     // If any sensors are listed as not hyperactive, that's a fail.
     for (auto const & evt : pir_evts)
     {
-        if (!mm_sensor_error_is_sensor_hyperactive(&evt))
+        if (!mm_sensor_error_is_sensor_hyperactive(DEFAULT_GRID_ID, &evt))
         {
             std::stringstream ss;
             ss << "PIR sensor on node ID " << evt.pir_data.node_id << " at rotation " << evt.pir_data.sensor_rotation << " is not hyperactive when it should be.";
@@ -122,7 +125,7 @@ static void test_case_test_sensor_hyperactivity(TestOutput& oracle)
     }
     for (auto const & evt : lidar_evts)
     {
-        if (!mm_sensor_error_is_sensor_hyperactive(&evt))
+        if (!mm_sensor_error_is_sensor_hyperactive(DEFAULT_GRID_ID, &evt))
         {
             std::stringstream ss;
             ss << "LIDAR sensor on node ID " << evt.lidar_data.node_id << " at rotation " << evt.lidar_data.sensor_rotation << " is not hyperactive when it should be.";
@@ -155,7 +158,7 @@ static void test_case_test_sensor_hyperactivity_cooldown(TestOutput& oracle)
     and prevents us from running the rest of the test. */
     for (auto const & evt : pir_evts)
     {
-        if (!mm_sensor_error_is_sensor_hyperactive(&evt))
+        if (!mm_sensor_error_is_sensor_hyperactive(DEFAULT_GRID_ID, &evt))
         {
             std::stringstream ss;
             ss << "PIR sensor on node ID " << evt.pir_data.node_id << " at rotation " << evt.pir_data.sensor_rotation << " is not hyperactive when it should be.";
@@ -164,7 +167,7 @@ static void test_case_test_sensor_hyperactivity_cooldown(TestOutput& oracle)
     }
     for (auto const & evt : lidar_evts)
     {
-        if (!mm_sensor_error_is_sensor_hyperactive(&evt))
+        if (!mm_sensor_error_is_sensor_hyperactive(DEFAULT_GRID_ID, &evt))
         {
             std::stringstream ss;
             ss << "LIDAR sensor on node ID " << evt.lidar_data.node_id << " at rotation " << evt.lidar_data.sensor_rotation << " is not hyperactive when it should be.";
@@ -187,7 +190,7 @@ static void test_case_test_sensor_hyperactivity_cooldown(TestOutput& oracle)
     // If any sensors are listed as hyperactive, that's a fail.
     for (auto const & evt : pir_evts)
     {
-        if (mm_sensor_error_is_sensor_hyperactive(&evt))
+        if (mm_sensor_error_is_sensor_hyperactive(DEFAULT_GRID_ID, &evt))
         {
             std::stringstream ss;
             ss << "PIR sensor on node ID " << evt.pir_data.node_id << " at rotation " << evt.pir_data.sensor_rotation << " is hyperactive when it shouldn't be.";
@@ -196,7 +199,7 @@ static void test_case_test_sensor_hyperactivity_cooldown(TestOutput& oracle)
     }
     for (auto const & evt : lidar_evts)
     {
-        if (mm_sensor_error_is_sensor_hyperactive(&evt))
+        if (mm_sensor_error_is_sensor_hyperactive(DEFAULT_GRID_ID, &evt))
         {
             std::stringstream ss;
             ss << "LIDAR sensor on node ID " << evt.lidar_data.node_id << " at rotation " << evt.lidar_data.sensor_rotation << " is hyperactive when it shouldn't be.";
@@ -226,7 +229,7 @@ static void test_case_test_sensor_inactivity(TestOutput& oracle)
     /* Make sure that all the sensors are not marked as inactive */
     for (auto const & evt : pir_evts)
     {
-        if (mm_sensor_error_is_sensor_inactive(&evt))
+        if (mm_sensor_error_is_sensor_inactive(DEFAULT_GRID_ID, &evt))
         {
             std::stringstream ss;
             ss << "PIR sensor on node ID " << evt.pir_data.node_id << " at rotation " << evt.pir_data.sensor_rotation << " is inactive when it shouldn't be.";
@@ -235,7 +238,7 @@ static void test_case_test_sensor_inactivity(TestOutput& oracle)
     }
     for (auto const & evt : lidar_evts)
     {
-        if (mm_sensor_error_is_sensor_inactive(&evt))
+        if (mm_sensor_error_is_sensor_inactive(DEFAULT_GRID_ID, &evt))
         {
             std::stringstream ss;
             ss << "LIDAR sensor on node ID " << evt.lidar_data.node_id << " at rotation " << evt.lidar_data.sensor_rotation << " is inactive when it shouldn't be.";
@@ -249,7 +252,7 @@ static void test_case_test_sensor_inactivity(TestOutput& oracle)
     // If any sensors are listed as not inactive, that's a fail.
     for (auto const & evt : pir_evts)
     {
-        if (!mm_sensor_error_is_sensor_inactive(&evt))
+        if (!mm_sensor_error_is_sensor_inactive(DEFAULT_GRID_ID, &evt))
         {
             std::stringstream ss;
             ss << "PIR sensor on node ID " << evt.pir_data.node_id << " at rotation " << evt.pir_data.sensor_rotation << " is not inactive when it should be.";
@@ -258,7 +261,7 @@ static void test_case_test_sensor_inactivity(TestOutput& oracle)
     }
     for (auto const & evt : lidar_evts)
     {
-        if (!mm_sensor_error_is_sensor_inactive(&evt))
+        if (!mm_sensor_error_is_sensor_inactive(DEFAULT_GRID_ID, &evt))
         {
             std::stringstream ss;
             ss << "LIDAR sensor on node ID " << evt.lidar_data.node_id << " at rotation " << evt.lidar_data.sensor_rotation << " is not inactive when it should be.";
@@ -281,7 +284,7 @@ static void test_case_test_inactive_state_update(TestOutput& oracle)
     simulate_time(HOURS(13));
 
     // By now Sensor 1 should be inactive and sensor 2 should be active
-    if (!(mm_sensor_error_is_sensor_inactive(&pir_1_evt) && !mm_sensor_error_is_sensor_inactive(&pir_2_evt)))
+    if (!(mm_sensor_error_is_sensor_inactive(DEFAULT_GRID_ID, &pir_1_evt) && !mm_sensor_error_is_sensor_inactive(DEFAULT_GRID_ID, &pir_2_evt)))
     {
         std::stringstream ss;
         ss << "Error: PIR on node 1 should be inactive and PIR on node 2 should be active.";
@@ -291,10 +294,50 @@ static void test_case_test_inactive_state_update(TestOutput& oracle)
     simulate_time(HOURS(12));
 
     // By now Sensor 1 should be inactive and sensor 2 should be inactive
-    if (!(mm_sensor_error_is_sensor_inactive(&pir_1_evt) && mm_sensor_error_is_sensor_inactive(&pir_2_evt)))
+    if (!(mm_sensor_error_is_sensor_inactive(DEFAULT_GRID_ID, &pir_1_evt) && mm_sensor_error_is_sensor_inactive(DEFAULT_GRID_ID, &pir_2_evt)))
     {
         std::stringstream ss;
         ss << "Error: PIR on node 1 and PIR on node 2 should be inactive.";
         throw std::runtime_error(ss.str());
     }
+}
+
+static void test_case_test_inactivity_across_days(TestOutput& oracle)
+{
+    sensor_evt_t pir_1_evt = create_pir_sensor_evt(1, SENSOR_ROTATION_90, PIR_DETECTION_START);
+    sensor_evt_t pir_2_evt = create_pir_sensor_evt(2, SENSOR_ROTATION_90, PIR_DETECTION_START);
+
+    // Keep sensor 1 active with a detection every 20 hours for several days, sensor 2 only sends once.
+    test_send_pir_data(2, SENSOR_ROTATION_90, PIR_DETECTION_START);
+    for (int i = 0; i < 4; i++)
+    {
+        test_send_pir_data(1, SENSOR_ROTATION_90, PIR_DETECTION_START);
+        simulate_time(HOURS(20));
+
+        if (mm_sensor_error_is_sensor_inactive(DEFAULT_GRID_ID, &pir_1_evt))
+        {
+            std::stringstream ss;
+            ss << "Error: PIR on node 1 should be active on day " << i << ".";
+            throw std::runtime_error(ss.str());
+        }
+    }
+
+    // Sensor 2 has been quiet for 80 hours.
+    if (!mm_sensor_error_is_sensor_inactive(DEFAULT_GRID_ID, &pir_2_evt))
+    {
+        std::stringstream ss;
+        ss << "Error: PIR on node 2 should be inactive.";
+        throw std::runtime_error(ss.str());
+    }
+
+    // Sensor 2 comes back, then sensor 1 goes quiet for a full day.
+    test_send_pir_data(2, SENSOR_ROTATION_90, PIR_DETECTION_START);
+    simulate_time(HOURS(5));
+
+    if (!(mm_sensor_error_is_sensor_inactive(DEFAULT_GRID_ID, &pir_1_evt) && !mm_sensor_error_is_sensor_inactive(DEFAULT_GRID_ID, &pir_2_evt)))
+    {
+        std::stringstream ss;
+        ss << "Error: PIR on node 1 should be inactive and PIR on node 2 should be active.";
+        throw std::runtime_error(ss.str());
+    }
 }
\ No newline at end of file
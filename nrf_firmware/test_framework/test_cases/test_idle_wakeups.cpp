@@ -0,0 +1,86 @@
+/**
+file: test_idle_wakeups.cpp
+brief: Testing how often the algorithm wakes up when nothing is happening
+notes: The algorithm only arms its timer for seconds that can change an output,
+       so an idle grid should only wake up for the sensor error checks on each
+       minute boundary.
+*/
+
+/**********************************************************
+                       INCLUDES
+**********************************************************/
+
+#include "tests.hpp"
+
+#include <stdexcept>
+#include <sstream>
+
+extern "C" {
+#include "mm_sensor_algorithm.h"
+}
+
+/**********************************************************
+                       CONSTANTS
+**********************************************************/
+
+#define MAX_EXTRA_IDLE_WAKEUPS      ( 1 )   /* The idle time needn't start on a minute boundary. */
+
+/**********************************************************
+                       DECLARATIONS
+**********************************************************/
+
+// An idle grid should only wake up on minute boundaries.
+static void test_case_idle_grid_wakeups(TestOutput& oracle);
+// After a detection drains away the grid should go back to only waking up on minute boundaries.
+static void test_case_wakeups_after_detection(TestOutput& oracle);
+
+// Throws if there were too many wakeups while simulating idle_seconds.
+static void simulate_idle_time(uint32_t idle_seconds);
+
+/**********************************************************
+                       DEFINITIONS
+**********************************************************/
+
+void test_idle_wakeups_add_tests(std::vector<TestCase>& tests)
+{
+    ADD_TEST(test_case_idle_grid_wakeups);
+    ADD_TEST(test_case_wakeups_after_detection);
+}
+
+static void test_case_idle_grid_wakeups(TestOutput& oracle)
+{
+    simulate_idle_time(HOURS(1));
+}
+
+static void test_case_wakeups_after_detection(TestOutput& oracle)
+{
+    simulate_time(MINUTES(1));
+
+    // Possible detection in bottom left. Output: Concern, idle, idle
+    test_send_pir_data(-1, 0, SENSOR_ROTATION_180, PIR_DETECTION_START);
+    oracle.logLedUpdate(-1, 1, LED_FUNCTION_LEDS_BLINKING, LED_COLOURS_YELLOW);
+    simulate_time(5);
+    test_send_pir_data(-1, 0, SENSOR_ROTATION_180, PIR_DETECTION_END);
+
+    // The AV drains quickly, so the LED turns off once the concern has been held long enough.
+    simulate_time(mm_sensor_algorithm_config(DEFAULT_GRID_ID)->minimum_concern_signal_duration_s - 4);
+    oracle.logLedUpdate(-1, 1, LED_FUNCTION_LEDS_OFF);
+    simulate_time(MINUTES(2));
+
+    simulate_idle_time(HOURS(1));
+}
+
+// Throws if there were too many wakeups while simulating idle_seconds.
+static void simulate_idle_time(uint32_t idle_seconds)
+{
+    uint32_t start_wakeups = mm_sensor_algorithm_get_wakeup_count();
+    simulate_time(idle_seconds);
+    uint32_t wakeups = mm_sensor_algorithm_get_wakeup_count() - start_wakeups;
+
+    if (wakeups > idle_seconds / SECONDS_PER_MINUTE + MAX_EXTRA_IDLE_WAKEUPS)
+    {
+        std::stringstream ss;
+        ss << "Algorithm woke up " << wakeups << " times over " << idle_seconds << " idle seconds.";
+        throw std::runtime_error(ss.str());
+    }
+}
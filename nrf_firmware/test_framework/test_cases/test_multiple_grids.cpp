@@ -0,0 +1,125 @@
+/**
+file: test_multiple_grids.cpp
+brief: Testing a gateway running more than one sensor grid
+notes: Every grid has the same layout, so a detection in one grid should
+       only ever show up on the LEDs of that grid.
+*/
+
+/**********************************************************
+                       INCLUDES
+**********************************************************/
+
+#include "tests.hpp"
+#include "expect_utils.hpp"
+
+extern "C" {
+#include "mm_position_config.h"
+}
+
+/**********************************************************
+                       CONSTANTS
+**********************************************************/
+
+#define SECOND_GRID_ID  ( DEFAULT_GRID_ID + 1 )
+
+/**********************************************************
+                       DECLARATIONS
+**********************************************************/
+
+// A detection in the second grid should escalate that grid's LED and leave the default grid idle.
+static void test_case_second_grid_detection(TestOutput& oracle);
+// A detection in only one of two busy grids should only escalate that grid's LEDs further.
+static void test_case_grids_escalate_independently(TestOutput& oracle);
+
+// Sends PIR data from the node at (x, y) in a grid, rotation is the total rotation of the sensor.
+static void send_grid_pir_data(uint8_t grid_id, int8_t x, int8_t y, sensor_rotation_t total_rotation, bool detection);
+
+// Sends lidar data from the node at (x, y) in a grid, rotation is the total rotation of the sensor.
+static void send_grid_lidar_data(uint8_t grid_id, int8_t x, int8_t y, sensor_rotation_t total_rotation, uint16_t distance_measured);
+
+/**********************************************************
+                       DEFINITIONS
+**********************************************************/
+
+void test_multiple_grids_add_tests(std::vector<TestCase>& tests)
+{
+#if (MAX_SENSOR_GRIDS > 1)
+    ADD_TEST(test_case_second_grid_detection);
+    ADD_TEST(test_case_grids_escalate_independently);
+#endif
+}
+
+static void test_case_second_grid_detection(TestOutput& oracle)
+{
+    simulate_time(MINUTES(1));
+
+    // Possible detection in bottom left of the second grid. Output: Concern, idle, idle
+    send_grid_pir_data(SECOND_GRID_ID, -1, 0, SENSOR_ROTATION_180, PIR_DETECTION_START);
+    expect_led_output(SECOND_GRID_ID, -1, 1, LED_FUNCTION_LEDS_BLINKING, LED_COLOURS_YELLOW);
+    expect_led_output(DEFAULT_GRID_ID, -1, 1, LED_FUNCTION_LEDS_OFF, LED_COLOURS_RED);
+
+    send_grid_pir_data(SECOND_GRID_ID, -1, 0, SENSOR_ROTATION_180, PIR_DETECTION_END);
+
+    // The second grid drains back to idle on its own.
+    simulate_time(mm_sensor_algorithm_config(DEFAULT_GRID_ID)->minimum_concern_signal_duration_s + 1);
+    expect_led_output(SECOND_GRID_ID, -1, 1, LED_FUNCTION_LEDS_OFF, LED_COLOURS_RED);
+
+    // The same detection in the default grid is unaffected by what the second grid saw.
+    send_grid_pir_data(DEFAULT_GRID_ID, -1, 0, SENSOR_ROTATION_180, PIR_DETECTION_START);
+    send_grid_pir_data(DEFAULT_GRID_ID, -1, 0, SENSOR_ROTATION_180, PIR_DETECTION_END);
+    oracle.logLedUpdate(-1, 1, LED_FUNCTION_LEDS_BLINKING, LED_COLOURS_YELLOW);
+    expect_led_output(DEFAULT_GRID_ID, -1, 1, LED_FUNCTION_LEDS_BLINKING, LED_COLOURS_YELLOW);
+    expect_led_output(SECOND_GRID_ID, -1, 1, LED_FUNCTION_LEDS_OFF, LED_COLOURS_RED);
+
+    simulate_time(mm_sensor_algorithm_config(DEFAULT_GRID_ID)->minimum_concern_signal_duration_s + 1);
+    oracle.logLedUpdate(-1, 1, LED_FUNCTION_LEDS_OFF);
+
+    simulate_time(MINUTES(1));
+}
+
+static void test_case_grids_escalate_independently(TestOutput& oracle)
+{
+    simulate_time(MINUTES(1));
+
+    // Possible detection in bottom left of both grids. Output: Concern, idle, idle
+    send_grid_pir_data(DEFAULT_GRID_ID, -1, 0, SENSOR_ROTATION_180, PIR_DETECTION_START);
+    send_grid_pir_data(DEFAULT_GRID_ID, -1, 0, SENSOR_ROTATION_180, PIR_DETECTION_END);
+    send_grid_pir_data(SECOND_GRID_ID, -1, 0, SENSOR_ROTATION_180, PIR_DETECTION_START);
+    send_grid_pir_data(SECOND_GRID_ID, -1, 0, SENSOR_ROTATION_180, PIR_DETECTION_END);
+    oracle.logLedUpdate(-1, 1, LED_FUNCTION_LEDS_BLINKING, LED_COLOURS_YELLOW);
+
+    // Detection in bottom left of only the second grid. Output: Alarm, concern, idle
+    simulate_time(2);
+    send_grid_lidar_data(SECOND_GRID_ID, -1, -1, SENSOR_ROTATION_0, 200);
+
+    expect_led_output(SECOND_GRID_ID, -1, 1, LED_FUNCTION_LEDS_BLINKING, LED_COLOURS_RED);
+    expect_led_output(SECOND_GRID_ID, 0, 1, LED_FUNCTION_LEDS_BLINKING, LED_COLOURS_YELLOW);
+    expect_led_output(DEFAULT_GRID_ID, -1, 1, LED_FUNCTION_LEDS_BLINKING, LED_COLOURS_YELLOW);
+    expect_led_output(DEFAULT_GRID_ID, 0, 1, LED_FUNCTION_LEDS_OFF, LED_COLOURS_RED);
+
+    // The default grid's concern times out while the second grid is still detecting.
+    simulate_time(mm_sensor_algorithm_config(DEFAULT_GRID_ID)->minimum_concern_signal_duration_s - 1);
+    oracle.logLedUpdate(-1, 1, LED_FUNCTION_LEDS_OFF);
+    expect_led_output(DEFAULT_GRID_ID, -1, 1, LED_FUNCTION_LEDS_OFF, LED_COLOURS_RED);
+    expect_led_output(SECOND_GRID_ID, -1, 1, LED_FUNCTION_LEDS_BLINKING, LED_COLOURS_RED);
+
+    simulate_time(MINUTES(3));
+}
+
+// Sends PIR data from the node at (x, y) in a grid, rotation is the total rotation of the sensor.
+static void send_grid_pir_data(uint8_t grid_id, int8_t x, int8_t y, sensor_rotation_t total_rotation, bool detection)
+{
+    mm_node_position_t const * node = get_node_for_position(grid_id, x, y);
+    sensor_rotation_t rotation = (sensor_rotation_t)((NODE_ROTATION_COUNT + total_rotation - node->node_rotation) % NODE_ROTATION_COUNT);
+
+    test_send_pir_data(node->node_id, rotation, detection);
+}
+
+// Sends lidar data from the node at (x, y) in a grid, rotation is the total rotation of the sensor.
+static void send_grid_lidar_data(uint8_t grid_id, int8_t x, int8_t y, sensor_rotation_t total_rotation, uint16_t distance_measured)
+{
+    mm_node_position_t const * node = get_node_for_position(grid_id, x, y);
+    sensor_rotation_t rotation = (sensor_rotation_t)((NODE_ROTATION_COUNT + total_rotation - node->node_rotation) % NODE_ROTATION_COUNT);
+
+    test_send_lidar_data(node->node_id, rotation, distance_measured);
+}
@@ -0,0 +1,382 @@
+/**
+file: test_position_table.cpp
+brief: Testing the gateway's node position table, its lookup indexes and batches
+notes: Runs the real table directly, the rest of the tests use the mocked
+       position config.
+*/
+
+/**********************************************************
+                       INCLUDES
+**********************************************************/
+
+#include "tests.hpp"
+#include "expect_utils.hpp"
+
+extern "C" {
+#include "mm_position_table.h"
+}
+
+/**********************************************************
+                       DECLARATIONS
+**********************************************************/
+
+// Nodes whose ids share a hash slot should each still be found by id.
+static void test_case_colliding_node_ids(TestOutput& oracle);
+// A node that moves should leave its old cell and be found in its new one.
+static void test_case_node_moves_cell(TestOutput& oracle);
+// If two nodes claim a cell the first one in the table wins, until it moves away.
+static void test_case_first_node_wins_contested_cell(TestOutput& oracle);
+// Repeated pages shouldn't count as changes, changed pages should replace the node's entry.
+static void test_case_repeated_page_ignored(TestOutput& oracle);
+// Nodes outside the gateway's grids are found by id but not by cell, positions at the edge of the index still work.
+static void test_case_cells_outside_grids(TestOutput& oracle);
+
+// A batch should only change the table once its commit arrives with every node.
+static void test_case_batch_applied_on_commit(TestOutput& oracle);
+// A commit missing nodes should apply nothing, and the batch has to be sent again from the start.
+static void test_case_batch_incomplete(TestOutput& oracle);
+// A batch that doesn't fit in the table should apply nothing.
+static void test_case_batch_too_many_nodes(TestOutput& oracle);
+// Repeats of the last committed batch should be ignored, a new transaction id starts a new batch.
+static void test_case_batch_repeated_transaction(TestOutput& oracle);
+
+// Applies a position page for a node, returns true if it changed the table.
+static bool apply_position(uint16_t node_id, uint8_t grid_id, int8_t x, int8_t y);
+
+// Sends a batch entry page for a node, returns true if it was treated as a commit.
+static bool send_batch_entry(uint8_t transaction, uint16_t node_id, uint8_t grid_id, int8_t x, int8_t y);
+
+// Sends a batch commit page, returns true if it was committed rather than ignored.
+static bool send_batch_commit(uint8_t transaction, uint8_t node_count, mm_position_batch_outcome_t * outcome);
+
+// Throws if the node isn't found by id at the given cell.
+static void expect_node_at(uint16_t node_id, uint8_t grid_id, int8_t x, int8_t y);
+
+/**********************************************************
+                       DEFINITIONS
+**********************************************************/
+
+void test_position_table_add_tests(std::vector<TestCase>& tests)
+{
+    ADD_TEST(test_case_colliding_node_ids);
+    ADD_TEST(test_case_node_moves_cell);
+    ADD_TEST(test_case_first_node_wins_contested_cell);
+    ADD_TEST(test_case_repeated_page_ignored);
+    ADD_TEST(test_case_cells_outside_grids);
+    ADD_TEST(test_case_batch_applied_on_commit);
+    ADD_TEST(test_case_batch_incomplete);
+    ADD_TEST(test_case_batch_too_many_nodes);
+    ADD_TEST(test_case_batch_repeated_transaction);
+}
+
+static void test_case_colliding_node_ids(TestOutput& oracle)
+{
+    uint16_t const hash_size = POSITION_TABLE_ID_HASH_SIZE;
+
+    mm_position_table_init();
+
+    // All in the last slot, so the probe wraps around to the start of the hash.
+    apply_position(hash_size - 1, DEFAULT_GRID_ID, -1, 0);
+    apply_position(2 * hash_size - 1, DEFAULT_GRID_ID, 0, 0);
+    apply_position(3 * hash_size - 1, DEFAULT_GRID_ID, 1, 0);
+    // Belongs in the first slot, which a colliding node already took.
+    apply_position(hash_size, DEFAULT_GRID_ID, 0, 1);
+
+    expect(mm_position_table_get_node_count() == 4, "Colliding nodes not all added.");
+    expect_node_at(hash_size - 1, DEFAULT_GRID_ID, -1, 0);
+    expect_node_at(2 * hash_size - 1, DEFAULT_GRID_ID, 0, 0);
+    expect_node_at(3 * hash_size - 1, DEFAULT_GRID_ID, 1, 0);
+    expect_node_at(hash_size, DEFAULT_GRID_ID, 0, 1);
+
+    expect(mm_position_table_find_node(4 * hash_size - 1) == NULL, "Found a node that was never added.");
+    expect(mm_position_table_find_node(0) == NULL, "Found a node that was never added.");
+
+    // Moving a node rebuilds the hash, the collisions have to resolve the same way again.
+    apply_position(2 * hash_size - 1, DEFAULT_GRID_ID, 1, 1);
+    expect_node_at(hash_size - 1, DEFAULT_GRID_ID, -1, 0);
+    expect_node_at(2 * hash_size - 1, DEFAULT_GRID_ID, 1, 1);
+    expect_node_at(3 * hash_size - 1, DEFAULT_GRID_ID, 1, 0);
+    expect_node_at(hash_size, DEFAULT_GRID_ID, 0, 1);
+}
+
+static void test_case_node_moves_cell(TestOutput& oracle)
+{
+    mm_position_table_init();
+
+    apply_position(1, DEFAULT_GRID_ID, 0, 0);
+    apply_position(2, DEFAULT_GRID_ID, 1, 0);
+    apply_position(1, DEFAULT_GRID_ID, 1, -1);
+
+    expect(mm_position_table_get_node_count() == 2, "Moving a node added it again.");
+    expect(mm_position_table_find_cell(DEFAULT_GRID_ID, 0, 0) == NULL, "Moved node still in its old cell.");
+    expect_node_at(1, DEFAULT_GRID_ID, 1, -1);
+    expect_node_at(2, DEFAULT_GRID_ID, 1, 0);
+
+#if (MAX_SENSOR_GRIDS > 1)
+    // Moving to another grid leaves the cell in the old grid.
+    apply_position(1, DEFAULT_GRID_ID + 1, 1, -1);
+    expect(mm_position_table_find_cell(DEFAULT_GRID_ID, 1, -1) == NULL, "Moved node still in its old grid.");
+    expect_node_at(1, DEFAULT_GRID_ID + 1, 1, -1);
+#endif
+}
+
+static void test_case_first_node_wins_contested_cell(TestOutput& oracle)
+{
+    mm_position_table_init();
+
+    apply_position(1, DEFAULT_GRID_ID, 0, 0);
+    apply_position(2, DEFAULT_GRID_ID, 0, 0);
+
+    expect(mm_position_table_find_cell(DEFAULT_GRID_ID, 0, 0)->node_id == 1, "Later node took a contested cell.");
+    expect(mm_position_table_find_node(2) != NULL, "Node that lost a contested cell not found by id.");
+
+    // Once the first node moves, the cell goes to the one still claiming it.
+    apply_position(1, DEFAULT_GRID_ID, -1, 0);
+    expect_node_at(2, DEFAULT_GRID_ID, 0, 0);
+    expect_node_at(1, DEFAULT_GRID_ID, -1, 0);
+
+#if (MAX_SENSOR_GRIDS > 1)
+    // The same cell in another grid isn't contested.
+    apply_position(3, DEFAULT_GRID_ID + 1, 0, 0);
+    expect_node_at(3, DEFAULT_GRID_ID + 1, 0, 0);
+    expect_node_at(2, DEFAULT_GRID_ID, 0, 0);
+#endif
+}
+
+static void test_case_repeated_page_ignored(TestOutput& oracle)
+{
+    mm_position_table_init();
+
+    expect(apply_position(1, DEFAULT_GRID_ID, 0, 0), "New node not counted as a change.");
+    expect(!apply_position(1, DEFAULT_GRID_ID, 0, 0), "Repeated page counted as a change.");
+    expect(apply_position(1, DEFAULT_GRID_ID, 0, 1), "Moved node not counted as a change.");
+    expect(mm_position_table_get_node_count() == 1, "Repeated pages added the node again.");
+
+    // The kept pages are what gets written to flash.
+    position_pages_record_t const * record = mm_position_table_get_pages();
+    expect(record->node_count == 1, "Kept page count doesn't match the table.");
+
+    uint16_t node_id;
+    memcpy(&node_id, &record->pages[0][1], sizeof(node_id));
+    expect(node_id == 1, "Kept page is for the wrong node.");
+    expect(record->pages[0][5] == 0x10, "Kept page isn't the latest one for the node.");
+}
+
+static void test_case_cells_outside_grids(TestOutput& oracle)
+{
+    mm_position_table_init();
+
+    apply_position(1, MAX_SENSOR_GRIDS, 0, 0);
+    expect(mm_position_table_find_node(1) != NULL, "Node outside the grids not found by id.");
+    for (uint8_t grid_id = 0; grid_id < MAX_SENSOR_GRIDS; grid_id++)
+    {
+        expect(mm_position_table_find_cell(grid_id, 0, 0) == NULL, "Node outside the grids found in a cell.");
+    }
+    expect(mm_position_table_find_cell(MAX_SENSOR_GRIDS, 0, 0) == NULL, "Found a cell in a grid the gateway doesn't run.");
+
+    // The most negative and most positive positions a page can describe.
+    apply_position(2, DEFAULT_GRID_ID, -8, 7);
+    apply_position(3, DEFAULT_GRID_ID, 7, -8);
+    expect_node_at(2, DEFAULT_GRID_ID, -8, 7);
+    expect_node_at(3, DEFAULT_GRID_ID, 7, -8);
+
+    expect(mm_position_table_find_cell(DEFAULT_GRID_ID, 8, 0) == NULL, "Found a cell no page can describe.");
+    expect(mm_position_table_find_cell(DEFAULT_GRID_ID, 0, -9) == NULL, "Found a cell no page can describe.");
+}
+
+static void test_case_batch_applied_on_commit(TestOutput& oracle)
+{
+    mm_position_batch_outcome_t outcome;
+
+    mm_position_table_init();
+
+    expect(!send_batch_entry(1, 1, DEFAULT_GRID_ID, -1, 0), "Entry treated as a commit.");
+    send_batch_entry(1, 2, DEFAULT_GRID_ID, 0, 0);
+    send_batch_entry(1, 3, DEFAULT_GRID_ID, 1, 0);
+    // Entries are broadcast, a repeat replaces the node's staged entry.
+    send_batch_entry(1, 2, DEFAULT_GRID_ID, 0, 1);
+
+    expect(mm_position_table_get_node_count() == 0, "Batch entries applied before the commit.");
+    expect(mm_position_table_find_node(1) == NULL, "Batch entries applied before the commit.");
+
+    expect(send_batch_commit(1, 3, &outcome), "Commit ignored.");
+    expect(outcome.result == BATCH_RESULT_APPLIED, "Complete batch not applied.");
+    expect(outcome.received_count == 3, "Repeated entry counted twice.");
+    expect(outcome.has_changed, "New nodes not counted as a change.");
+
+    expect(mm_position_table_get_node_count() == 3, "Not every node in the batch was added.");
+    expect_node_at(1, DEFAULT_GRID_ID, -1, 0);
+    expect_node_at(2, DEFAULT_GRID_ID, 0, 1);
+    expect_node_at(3, DEFAULT_GRID_ID, 1, 0);
+
+    // Entries carry the type and rotation packed into one byte.
+    expect(mm_position_table_find_node(1)->node_type == 2, "Batch node type decoded wrong.");
+    expect(mm_position_table_find_node(1)->node_rotation == NODE_ROTATION_270, "Batch node rotation decoded wrong.");
+
+    // The same positions again under a new transaction change nothing.
+    send_batch_entry(2, 1, DEFAULT_GRID_ID, -1, 0);
+    send_batch_entry(2, 2, DEFAULT_GRID_ID, 0, 1);
+    send_batch_entry(2, 3, DEFAULT_GRID_ID, 1, 0);
+    expect(send_batch_commit(2, 3, &outcome), "Commit ignored.");
+    expect(outcome.result == BATCH_RESULT_APPLIED, "Complete batch not applied.");
+    expect(!outcome.has_changed, "Unchanged batch counted as a change.");
+}
+
+static void test_case_batch_incomplete(TestOutput& oracle)
+{
+    mm_position_batch_outcome_t outcome;
+
+    mm_position_table_init();
+
+    send_batch_entry(1, 1, DEFAULT_GRID_ID, -1, 0);
+    send_batch_entry(1, 2, DEFAULT_GRID_ID, 0, 0);
+
+    expect(send_batch_commit(1, 3, &outcome), "Commit ignored.");
+    expect(outcome.result == BATCH_RESULT_INCOMPLETE, "Incomplete batch not reported.");
+    expect(outcome.received_count == 2, "Wrong number of received nodes reported.");
+    expect(!outcome.has_changed, "Incomplete batch counted as a change.");
+    expect(mm_position_table_get_node_count() == 0, "Incomplete batch applied.");
+
+    // The staged entries were dropped, only the missing node isn't enough.
+    send_batch_entry(1, 3, DEFAULT_GRID_ID, 1, 0);
+    expect(send_batch_commit(1, 3, &outcome), "Commit of a failed transaction ignored.");
+    expect(outcome.result == BATCH_RESULT_INCOMPLETE, "Batch completed from entries before a failed commit.");
+    expect(outcome.received_count == 1, "Entries before a failed commit still staged.");
+
+    // Entries of another transaction don't count towards a commit.
+    send_batch_entry(2, 1, DEFAULT_GRID_ID, -1, 0);
+    expect(send_batch_commit(3, 1, &outcome), "Commit ignored.");
+    expect(outcome.result == BATCH_RESULT_INCOMPLETE, "Entries of another transaction committed.");
+    expect(outcome.received_count == 0, "Entries of another transaction counted.");
+
+    // Sent again from the start, the batch goes through.
+    send_batch_entry(1, 1, DEFAULT_GRID_ID, -1, 0);
+    send_batch_entry(1, 2, DEFAULT_GRID_ID, 0, 0);
+    send_batch_entry(1, 3, DEFAULT_GRID_ID, 1, 0);
+    expect(send_batch_commit(1, 3, &outcome), "Commit ignored.");
+    expect(outcome.result == BATCH_RESULT_APPLIED, "Resent batch not applied.");
+    expect(mm_position_table_get_node_count() == 3, "Resent batch not applied.");
+}
+
+static void test_case_batch_too_many_nodes(TestOutput& oracle)
+{
+    mm_position_batch_outcome_t outcome;
+
+    mm_position_table_init();
+
+    // One free entry left in the table.
+    for (uint16_t node_id = 1; node_id < MAX_GATEWAY_NODES; node_id++)
+    {
+        apply_position(node_id, MAX_SENSOR_GRIDS, 0, 0);
+    }
+
+    send_batch_entry(1, MAX_GATEWAY_NODES, DEFAULT_GRID_ID, 0, 0);
+    send_batch_entry(1, MAX_GATEWAY_NODES + 1, DEFAULT_GRID_ID, 1, 0);
+    expect(send_batch_commit(1, 2, &outcome), "Commit ignored.");
+    expect(outcome.result == BATCH_RESULT_TOO_MANY_NODES, "Batch larger than the free space not rejected.");
+    expect(mm_position_table_get_node_count() == MAX_GATEWAY_NODES - 1, "Rejected batch partially applied.");
+    expect(mm_position_table_find_node(MAX_GATEWAY_NODES) == NULL, "Rejected batch partially applied.");
+
+    // Nodes already in the table don't need room, only the new one does.
+    send_batch_entry(2, 1, DEFAULT_GRID_ID, -1, 0);
+    send_batch_entry(2, MAX_GATEWAY_NODES, DEFAULT_GRID_ID, 0, 0);
+    expect(send_batch_commit(2, 2, &outcome), "Commit ignored.");
+    expect(outcome.result == BATCH_RESULT_APPLIED, "Batch that fits not applied.");
+    expect(mm_position_table_get_node_count() == MAX_GATEWAY_NODES, "Batch that fits not applied.");
+    expect_node_at(1, DEFAULT_GRID_ID, -1, 0);
+
+    // More entries than the table can ever hold overflow staging.
+    mm_position_table_init();
+    for (uint16_t node_id = 1; node_id <= MAX_GATEWAY_NODES + 1; node_id++)
+    {
+        send_batch_entry(1, node_id, MAX_SENSOR_GRIDS, 0, 0);
+    }
+    expect(send_batch_commit(1, MAX_GATEWAY_NODES, &outcome), "Commit ignored.");
+    expect(outcome.result == BATCH_RESULT_TOO_MANY_NODES, "Overflowed batch not rejected.");
+    expect(mm_position_table_get_node_count() == 0, "Overflowed batch applied.");
+}
+
+static void test_case_batch_repeated_transaction(TestOutput& oracle)
+{
+    mm_position_batch_outcome_t outcome;
+
+    mm_position_table_init();
+
+    send_batch_entry(1, 1, DEFAULT_GRID_ID, 0, 0);
+    expect(send_batch_commit(1, 1, &outcome), "Commit ignored.");
+    expect(outcome.result == BATCH_RESULT_APPLIED, "Complete batch not applied.");
+
+    // The app repeats its commit and entries until it sees the outcome.
+    expect(!send_batch_commit(1, 1, &outcome), "Repeated commit applied again.");
+    send_batch_entry(1, 1, DEFAULT_GRID_ID, 1, 1);
+    expect(!send_batch_commit(1, 1, &outcome), "Repeated commit applied again.");
+    expect_node_at(1, DEFAULT_GRID_ID, 0, 0);
+
+    // A new transaction id is a new batch.
+    send_batch_entry(2, 1, DEFAULT_GRID_ID, 1, 1);
+    expect(send_batch_commit(2, 1, &outcome), "Commit of a new transaction ignored.");
+    expect(outcome.result == BATCH_RESULT_APPLIED, "New transaction not applied.");
+    expect_node_at(1, DEFAULT_GRID_ID, 1, 1);
+
+    // Only the last committed transaction is remembered, so ids can be reused after it.
+    send_batch_entry(1, 1, DEFAULT_GRID_ID, -1, -1);
+    expect(send_batch_commit(1, 1, &outcome), "Reused transaction id ignored.");
+    expect(outcome.result == BATCH_RESULT_APPLIED, "Reused transaction id not applied.");
+    expect_node_at(1, DEFAULT_GRID_ID, -1, -1);
+}
+
+// Applies a position page for a node, returns true if it changed the table.
+static bool apply_position(uint16_t node_id, uint8_t grid_id, int8_t x, int8_t y)
+{
+    uint8_t page[POSITION_PAGE_SIZE];
+
+    page[0] = POSITION_CONFIG_PAGE_NUM;
+    memcpy(&page[1], &node_id, sizeof(node_id));
+    page[3] = (uint8_t)(grid_id << 4);
+    page[4] = NODE_ROTATION_0;
+    page[5] = (uint8_t)(((y & 0x0F) << 4) | (x & 0x0F));
+    page[6] = 0;
+    page[7] = 0;
+
+    return mm_position_table_apply_page(page);
+}
+
+// Throws if the node isn't found by id at the given cell.
+static void expect_node_at(uint16_t node_id, uint8_t grid_id, int8_t x, int8_t y)
+{
+    mm_node_position_t const * by_id = mm_position_table_find_node(node_id);
+    expect(by_id != NULL, "Node not found by id.");
+    expect(by_id->node_id == node_id, "Found the wrong node by id.");
+    expect(by_id->grid_id == grid_id && by_id->grid_position_x == x && by_id->grid_position_y == y, "Node found by id has the wrong position.");
+    expect(mm_position_table_find_cell(grid_id, x, y) == by_id, "Node not found in its cell.");
+}
+
+// Sends a batch entry page for a node, returns true if it was treated as a commit.
+static bool send_batch_entry(uint8_t transaction, uint16_t node_id, uint8_t grid_id, int8_t x, int8_t y)
+{
+    uint8_t page[POSITION_PAGE_SIZE];
+    mm_position_batch_outcome_t outcome;
+
+    page[0] = POSITION_BATCH_PAGE_NUM;
+    page[BATCH_HEADER_INDEX] = (uint8_t)((transaction << 4) | grid_id);
+    memcpy(&page[2], &node_id, sizeof(node_id));
+    page[4] = (uint8_t)((NODE_ROTATION_270 << 2) | 2);
+    page[5] = (uint8_t)(((y & 0x0F) << 4) | (x & 0x0F));
+    page[6] = 0;
+    page[7] = 0;
+
+    return mm_position_table_on_batch_page(page, &outcome);
+}
+
+// Sends a batch commit page, returns true if it was committed rather than ignored.
+static bool send_batch_commit(uint8_t transaction, uint8_t node_count, mm_position_batch_outcome_t * outcome)
+{
+    uint8_t page[POSITION_PAGE_SIZE];
+    memset(page, 0xFF, sizeof(page));
+
+    page[0] = POSITION_BATCH_PAGE_NUM;
+    page[BATCH_HEADER_INDEX] = (uint8_t)(0x80 | (transaction << 4));
+    page[BATCH_NODE_COUNT_INDEX] = node_count;
+
+    return mm_position_table_on_batch_page(page, outcome);
+}
@@ -0,0 +1,133 @@
+/**
+file: test_trajectory_prediction.cpp
+brief: Testing the trajectory tracker's predictions of where animals reach the road
+notes: Predictions are checked directly rather than through the LEDs, on a 3x3 grid
+       the road-side AV outputs already cover most of what a prediction would add.
+*/
+
+/**********************************************************
+                       INCLUDES
+**********************************************************/
+
+#include "tests.hpp"
+
+#include <stdexcept>
+#include <sstream>
+
+extern "C" {
+#include "mm_trajectory_tracker.h"
+}
+
+/**********************************************************
+                       DECLARATIONS
+**********************************************************/
+
+// An animal walking straight at the road should be predicted to reach it in its own column, sooner as it gets closer.
+static void test_case_animal_towards_road_predicted(TestOutput& oracle);
+// An animal walking along the road isn't heading for it, so nothing should be predicted.
+static void test_case_animal_parallel_to_road_not_predicted(TestOutput& oracle);
+// An animal lingering beside one walking at the road should be kept on its own track.
+static void test_case_two_animals_tracked_separately(TestOutput& oracle);
+
+// Throws if the prediction for each AV column doesn't match.
+static void expect_predictions(activity_variable_state_t column_0, activity_variable_state_t column_1);
+
+/**********************************************************
+                       DEFINITIONS
+**********************************************************/
+
+void test_trajectory_prediction_add_tests(std::vector<TestCase>& tests)
+{
+    ADD_TEST(test_case_animal_towards_road_predicted);
+    ADD_TEST(test_case_animal_parallel_to_road_not_predicted);
+    ADD_TEST(test_case_two_animals_tracked_separately);
+}
+
+static void test_case_animal_towards_road_predicted(TestOutput& oracle)
+{
+    simulate_time(MINUTES(1));
+
+    // Animal enters the bottom right. A single detection has no direction yet.
+    test_send_lidar_data(1, -1, SENSOR_ROTATION_270, 300);
+    expect_predictions(ACTIVITY_VARIABLE_STATE_IDLE, ACTIVITY_VARIABLE_STATE_IDLE);
+
+    // Animal walks up to the middle right, heading for the road.
+    simulate_time(4);
+    test_send_lidar_data(1, -1, SENSOR_ROTATION_270, 2100);
+    test_send_lidar_data(1, 0, SENSOR_ROTATION_270, 300);
+    expect_predictions(ACTIVITY_VARIABLE_STATE_IDLE, ACTIVITY_VARIABLE_STATE_POSSIBLE_DETECTION);
+
+    // Still heading for the road, it should be almost there.
+    simulate_time(5);
+    expect_predictions(ACTIVITY_VARIABLE_STATE_IDLE, ACTIVITY_VARIABLE_STATE_DETECTION);
+
+    // Animal is never seen again, so the track is dropped.
+    test_send_lidar_data(1, 0, SENSOR_ROTATION_270, 2100);
+    simulate_time(MINUTES(1));
+    expect_predictions(ACTIVITY_VARIABLE_STATE_IDLE, ACTIVITY_VARIABLE_STATE_IDLE);
+
+    if (mm_trajectory_tracker_is_tracking(DEFAULT_GRID_ID))
+    {
+        throw std::runtime_error("Track was never dropped.");
+    }
+
+    simulate_time(MINUTES(2));
+}
+
+static void test_case_animal_parallel_to_road_not_predicted(TestOutput& oracle)
+{
+    simulate_time(MINUTES(1));
+
+    // Animal walks from the bottom left to the bottom right.
+    test_send_pir_data(-1, 0, SENSOR_ROTATION_180, PIR_DETECTION_START);
+    test_send_pir_data(-1, 0, SENSOR_ROTATION_180, PIR_DETECTION_END);
+    simulate_time(5);
+    test_send_pir_data(1, 0, SENSOR_ROTATION_180, PIR_DETECTION_START);
+    test_send_pir_data(1, 0, SENSOR_ROTATION_180, PIR_DETECTION_END);
+    expect_predictions(ACTIVITY_VARIABLE_STATE_IDLE, ACTIVITY_VARIABLE_STATE_IDLE);
+
+    simulate_time(5);
+    expect_predictions(ACTIVITY_VARIABLE_STATE_IDLE, ACTIVITY_VARIABLE_STATE_IDLE);
+
+    simulate_time(MINUTES(2));
+}
+
+static void test_case_two_animals_tracked_separately(TestOutput& oracle)
+{
+    simulate_time(MINUTES(1));
+
+    // Animal A is in the bottom left, a second later animal B enters the bottom right.
+    test_send_pir_data(-1, 0, SENSOR_ROTATION_180, PIR_DETECTION_START);
+    test_send_pir_data(-1, 0, SENSOR_ROTATION_180, PIR_DETECTION_END);
+    simulate_time(1);
+    test_send_lidar_data(1, -1, SENSOR_ROTATION_270, 300);
+
+    // B walks up towards the road while A stays put.
+    simulate_time(4);
+    test_send_lidar_data(1, -1, SENSOR_ROTATION_270, 2100);
+    test_send_lidar_data(1, 0, SENSOR_ROTATION_270, 300);
+    simulate_time(1);
+    test_send_pir_data(-1, 0, SENSOR_ROTATION_180, PIR_DETECTION_START);
+    test_send_pir_data(-1, 0, SENSOR_ROTATION_180, PIR_DETECTION_END);
+
+    // Only B's column is predicted, seeing A again didn't drag B's track over to it.
+    expect_predictions(ACTIVITY_VARIABLE_STATE_IDLE, ACTIVITY_VARIABLE_STATE_POSSIBLE_DETECTION);
+
+    test_send_lidar_data(1, 0, SENSOR_ROTATION_270, 2100);
+    simulate_time(MINUTES(2));
+}
+
+// Throws if the prediction for each AV column doesn't match.
+static void expect_predictions(activity_variable_state_t column_0, activity_variable_state_t column_1)
+{
+    activity_variable_state_t predictions[MAX_AV_SIZE_X];
+    mm_trajectory_tracker_get_road_predictions(DEFAULT_GRID_ID, predictions);
+
+    if (predictions[0] != column_0 || predictions[1] != column_1)
+    {
+        std::stringstream ss;
+        ss << "Predicted " << predictions[0] << ", " << predictions[1] << " instead of "
+           << column_0 << ", " << column_1 << " at " << get_simulated_time_elapsed() << "s.";
+        throw std::runtime_error(ss.str());
+    }
+}
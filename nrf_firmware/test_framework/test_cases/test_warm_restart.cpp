@@ -0,0 +1,147 @@
+/**
+file: test_warm_restart.cpp
+brief: Testing that the gateway carries on where it was after a reset
+notes: A reset is simulated by initializing the gateway's components again
+       without erasing the simulated flash, like they would be on boot.
+*/
+
+/**********************************************************
+                       INCLUDES
+**********************************************************/
+
+#include "tests.hpp"
+#include "expect_utils.hpp"
+#include "mm_flash_storage.hpp"
+#include "sensor_evt_utils.hpp"
+
+extern "C" {
+#include "mm_position_config.h"
+#include "mm_sensor_algorithm.h"
+#include "mm_sensor_algorithm_snapshot.h"
+#include "mm_activity_variables.h"
+#include "mm_sensor_error_check.h"
+}
+
+/**********************************************************
+                       DECLARATIONS
+**********************************************************/
+
+// An alarm should still be showing after a reset, then end as it would have without one.
+static void test_case_alarm_held_through_reset(TestOutput& oracle);
+// Hyperactive sensors should still be flagged after a reset, and stay flagged while their events are in the window.
+static void test_case_hyperactivity_held_through_reset(TestOutput& oracle);
+// Once everything has settled, nothing more should be written to flash.
+static void test_case_idle_gateway_stops_writing(TestOutput& oracle);
+
+// Initializes the gateway's components again, as they would be after a reset.
+static void simulate_reset(void);
+
+/**********************************************************
+                       DEFINITIONS
+**********************************************************/
+
+void test_warm_restart_add_tests(std::vector<TestCase>& tests)
+{
+    ADD_TEST(test_case_alarm_held_through_reset);
+    ADD_TEST(test_case_hyperactivity_held_through_reset);
+    ADD_TEST(test_case_idle_gateway_stops_writing);
+}
+
+static void test_case_alarm_held_through_reset(TestOutput& oracle)
+{
+    simulate_time(MINUTES(1));
+
+    // Detection in bottom left. Output: Alarm, concern, idle
+    test_send_pir_data(-1, 0, SENSOR_ROTATION_180, PIR_DETECTION_START);
+    test_send_lidar_data(-1, -1, SENSOR_ROTATION_0, 200);
+    test_send_pir_data(-1, 0, SENSOR_ROTATION_180, PIR_DETECTION_END);
+    test_send_lidar_data(-1, -1, SENSOR_ROTATION_0, 2100);
+    oracle.logLedUpdate(-1, 1, LED_FUNCTION_LEDS_BLINKING, LED_COLOURS_RED);
+    oracle.logLedUpdate(0, 1, LED_FUNCTION_LEDS_BLINKING, LED_COLOURS_YELLOW);
+    expect_led_output(-1, 1, LED_FUNCTION_LEDS_BLINKING, LED_COLOURS_RED);
+
+    // Give the gateway time to save the alarm, then reset it.
+    simulate_time(SNAPSHOT_PERIOD_S);
+    mm_activity_variable_t av_before_reset = get_max_activity_variable();
+    simulate_reset();
+
+    // A fresh gateway would have turned every LED off.
+    expect_led_output(-1, 1, LED_FUNCTION_LEDS_BLINKING, LED_COLOURS_RED);
+    expect_led_output(0, 1, LED_FUNCTION_LEDS_BLINKING, LED_COLOURS_YELLOW);
+
+    // The AVs were restored, less what they drained while the gateway was down.
+    mm_activity_variable_t av_after_reset = get_max_activity_variable();
+    expect(av_after_reset > mm_sensor_algorithm_config(DEFAULT_GRID_ID)->activity_variable_min, "Activity variables were not restored.");
+    expect(av_after_reset < av_before_reset, "Activity variables were not aged by the downtime.");
+
+    // The alarm still ends once it has been held long enough, as if there was no reset.
+    simulate_time(mm_sensor_algorithm_config(DEFAULT_GRID_ID)->minimum_alarm_signal_duration_s - SNAPSHOT_PERIOD_S);
+    oracle.logLedUpdate(-1, 1, LED_FUNCTION_LEDS_BLINKING, LED_COLOURS_YELLOW);
+    oracle.logLedUpdate(0, 1, LED_FUNCTION_LEDS_OFF);
+    expect_led_output(-1, 1, LED_FUNCTION_LEDS_BLINKING, LED_COLOURS_YELLOW);
+
+    // The concern ends once the AVs have drained.
+    simulate_time(MINUTES(1) + 10);
+    oracle.logLedUpdate(-1, 1, LED_FUNCTION_LEDS_OFF);
+    expect_led_output(-1, 1, LED_FUNCTION_LEDS_OFF, LED_COLOURS_RED);
+
+    simulate_time(MINUTES(2));
+}
+
+static void test_case_hyperactivity_held_through_reset(TestOutput& oracle)
+{
+    std::vector<sensor_evt_t> pir_evts;
+    create_all_pir_sensor_evts(pir_evts, PIR_DETECTION_START);
+
+    // Send PIR data at a high frequency until every PIR is hyperactive.
+    for (int i = 0; i < SENSOR_HYPERACTIVITY_EVENT_WINDOW_SIZE + 2; i++)
+    {
+        for (auto const & evt : pir_evts)
+        {
+            test_send_pir_data(evt.pir_data.node_id, evt.pir_data.sensor_rotation, PIR_DETECTION_START);
+        }
+        simulate_time(MINUTES(SENSOR_HYPERACTIVITY_FREQUENCY_THRES) - 5);
+    }
+
+    simulate_time(SNAPSHOT_PERIOD_S);
+    simulate_reset();
+
+    // The flags are re-evaluated each minute, so this only holds if the events were restored too.
+    simulate_time(MINUTES(1));
+    for (auto const & evt : pir_evts)
+    {
+        expect(mm_sensor_error_is_sensor_hyperactive(DEFAULT_GRID_ID, &evt), "PIR sensor is no longer hyperactive after a reset.");
+    }
+}
+
+static void test_case_idle_gateway_stops_writing(TestOutput& oracle)
+{
+    simulate_time(MINUTES(1));
+
+    // Possible detection in bottom left. Output: Concern, idle, idle
+    test_send_pir_data(-1, 0, SENSOR_ROTATION_180, PIR_DETECTION_START);
+    test_send_pir_data(-1, 0, SENSOR_ROTATION_180, PIR_DETECTION_END);
+    oracle.logLedUpdate(-1, 1, LED_FUNCTION_LEDS_BLINKING, LED_COLOURS_YELLOW);
+
+    simulate_time(mm_sensor_algorithm_config(DEFAULT_GRID_ID)->minimum_concern_signal_duration_s + 1);
+    oracle.logLedUpdate(-1, 1, LED_FUNCTION_LEDS_OFF);
+
+    // The detection is written, then the hyperactivity window moves past it.
+    simulate_time(HOURS(3));
+    uint32_t write_count = test_flash_storage_get_write_count();
+    expect(write_count > 0, "The detection was never written.");
+
+    simulate_time(HOURS(5));
+    expect(test_flash_storage_get_write_count() == write_count, "Flash was written while the gateway was idle.");
+}
+
+// Initializes the gateway's components again, as they would be after a reset.
+static void simulate_reset(void)
+{
+    // The algorithm copies its config, so take a copy before re-initializing over it.
+    mm_sensor_algorithm_config_t config = *mm_sensor_algorithm_config(DEFAULT_GRID_ID);
+
+    mm_position_config_init();
+    mm_sensor_transmission_init();
+    mm_sensor_algorithm_init(&config);
+}
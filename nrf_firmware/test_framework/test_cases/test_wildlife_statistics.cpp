@@ -0,0 +1,248 @@
+/**
+file: test_wildlife_statistics.cpp
+brief: Testing the long term wildlife statistics kept by the gateway
+notes: Hours and days are counted from when the algorithm starts, which is
+       when each test starts.
+*/
+
+/**********************************************************
+                       INCLUDES
+**********************************************************/
+
+#include "tests.hpp"
+#include "expect_utils.hpp"
+
+#include <vector>
+#include <algorithm>
+
+extern "C" {
+#include "mm_position_config.h"
+#include "mm_activity_variables.h"
+#include "mm_wildlife_statistics.h"
+}
+
+/**********************************************************
+                       DECLARATIONS
+**********************************************************/
+
+// Detections should be counted against the regions they cover, in the hour they happen.
+static void test_case_region_detections_counted_by_hour(TestOutput& oracle);
+// Each detection's length should land in the histogram bucket for its sensor type.
+static void test_case_detection_durations_histogram(TestOutput& oracle);
+// Each sensor's detections should be counted per day, and move back a day at midnight.
+static void test_case_sensor_daily_counts_roll_over(TestOutput& oracle);
+// The export should hold the same counts as the counters, however it is split up.
+static void test_case_export_matches_counters(TestOutput& oracle);
+
+// Sums the region counts for an hour of the day across the whole default grid.
+static uint32_t get_region_total(uint8_t hour);
+
+// Gets one counter from the default grid, throwing if it doesn't exist.
+static uint16_t get_statistic(wildlife_statistic_t statistic, uint16_t index, uint8_t bucket);
+
+// Gets a sensor's daily count from the default grid, throwing if it doesn't exist.
+static uint16_t get_sensor_daily(int8_t x, int8_t y, sensor_rotation_t total_rotation, uint8_t days_ago);
+
+/**********************************************************
+                       DEFINITIONS
+**********************************************************/
+
+void test_wildlife_statistics_add_tests(std::vector<TestCase>& tests)
+{
+    ADD_TEST(test_case_region_detections_counted_by_hour);
+    ADD_TEST(test_case_detection_durations_histogram);
+    ADD_TEST(test_case_sensor_daily_counts_roll_over);
+    ADD_TEST(test_case_export_matches_counters);
+}
+
+static void test_case_region_detections_counted_by_hour(TestOutput& oracle)
+{
+    simulate_time(MINUTES(1));
+
+    // Possible detection in bottom left during the first hour.
+    test_send_pir_data(-1, 0, SENSOR_ROTATION_180, PIR_DETECTION_START);
+    test_send_pir_data(-1, 0, SENSOR_ROTATION_180, PIR_DETECTION_END);
+
+    uint32_t first_hour_total = get_region_total(0);
+    expect(first_hour_total > 0, "Detection was not counted against any region.");
+    expect(get_region_total(1) == 0, "Detection was counted in the wrong hour.");
+
+    // The same detection in the second hour only adds to the second hour.
+    simulate_time(HOURS(1));
+    test_send_pir_data(-1, 0, SENSOR_ROTATION_180, PIR_DETECTION_START);
+    test_send_pir_data(-1, 0, SENSOR_ROTATION_180, PIR_DETECTION_END);
+
+    expect(get_region_total(0) == first_hour_total, "First hour changed after it ended.");
+    expect(get_region_total(1) == first_hour_total, "Detection was not counted in the second hour.");
+
+    // Hours past the end of the day don't exist.
+    uint16_t count;
+    expect(!mm_wildlife_statistics_get(DEFAULT_GRID_ID, WILDLIFE_STATISTIC_REGION_HOURLY, 0, STATISTICS_HOURS_PER_DAY, &count), "Read an hour past the end of the day.");
+
+    simulate_time(MINUTES(2));
+}
+
+static void test_case_detection_durations_histogram(TestOutput& oracle)
+{
+    simulate_time(MINUTES(1));
+
+    // Brief PIR detection in bottom left, under a second long.
+    test_send_pir_data(-1, 0, SENSOR_ROTATION_180, PIR_DETECTION_START);
+    test_send_pir_data(-1, 0, SENSOR_ROTATION_180, PIR_DETECTION_END);
+
+    expect(get_statistic(WILDLIFE_STATISTIC_DURATION, SENSOR_TYPE_PIR, 0) == 1, "Brief PIR detection not in the first bucket.");
+
+    // Lidar in bottom right sees an animal for 5 seconds, which falls in the 4 to 7 second bucket.
+    test_send_lidar_data(1, -1, SENSOR_ROTATION_270, 300);
+    simulate_time(5);
+    test_send_lidar_data(1, -1, SENSOR_ROTATION_270, 2100);
+
+    expect(get_statistic(WILDLIFE_STATISTIC_DURATION, SENSOR_TYPE_LIDAR, 3) == 1, "Lidar detection not in the 4 to 7 second bucket.");
+    expect(get_statistic(WILDLIFE_STATISTIC_DURATION, SENSOR_TYPE_PIR, 3) == 0, "Lidar detection counted against PIRs.");
+
+    simulate_time(MINUTES(2));
+}
+
+static void test_case_sensor_daily_counts_roll_over(TestOutput& oracle)
+{
+    simulate_time(MINUTES(1));
+
+    // Lidar in bottom right sees two animals today.
+    test_send_lidar_data(1, -1, SENSOR_ROTATION_270, 300);
+    test_send_lidar_data(1, -1, SENSOR_ROTATION_270, 2100);
+    simulate_time(MINUTES(2));
+    test_send_lidar_data(1, -1, SENSOR_ROTATION_270, 300);
+    test_send_lidar_data(1, -1, SENSOR_ROTATION_270, 2100);
+
+    expect(get_sensor_daily(1, -1, SENSOR_ROTATION_270, 0) == 2, "Detections were not counted for today.");
+    expect(get_sensor_daily(-1, 0, SENSOR_ROTATION_180, 0) == 0, "Another sensor's detections were counted.");
+
+    // After midnight they move back to yesterday.
+    simulate_time(DAYS(1));
+    expect(get_sensor_daily(1, -1, SENSOR_ROTATION_270, 0) == 0, "Today was not cleared at midnight.");
+    expect(get_sensor_daily(1, -1, SENSOR_ROTATION_270, 1) == 2, "Yesterday's detections were lost.");
+
+    // A week later they have been forgotten.
+    simulate_time(DAYS(STATISTICS_DAYS_PER_WEEK));
+    for (uint8_t days_ago = 0; days_ago < STATISTICS_DAYS_PER_WEEK; days_ago++)
+    {
+        expect(get_sensor_daily(1, -1, SENSOR_ROTATION_270, days_ago) == 0, "Detections outlasted a week.");
+    }
+
+    uint16_t count;
+    uint16_t node_id = get_node_for_position(DEFAULT_GRID_ID, 1, -1)->node_id;
+    expect(!mm_wildlife_statistics_get_sensor_daily(DEFAULT_GRID_ID, node_id, SENSOR_ROTATION_0, STATISTICS_DAYS_PER_WEEK, &count), "Read a day from more than a week ago.");
+}
+
+static void test_case_export_matches_counters(TestOutput& oracle)
+{
+    simulate_time(MINUTES(1));
+
+    // A lidar detection yesterday and a PIR detection today.
+    test_send_lidar_data(1, -1, SENSOR_ROTATION_270, 300);
+    simulate_time(5);
+    test_send_lidar_data(1, -1, SENSOR_ROTATION_270, 2100);
+    simulate_time(DAYS(1));
+    test_send_pir_data(-1, 0, SENSOR_ROTATION_180, PIR_DETECTION_START);
+    test_send_pir_data(-1, 0, SENSOR_ROTATION_180, PIR_DETECTION_END);
+
+    uint16_t size = mm_wildlife_statistics_get_export_size();
+    std::vector<uint8_t> export_data(size);
+
+    // Read it in odd sized pieces, the way a transfer would.
+    for (uint16_t offset = 0; offset < size; offset += 7)
+    {
+        uint16_t piece = std::min<uint16_t>(7, size - offset);
+        expect(mm_wildlife_statistics_export(DEFAULT_GRID_ID, offset, &export_data[offset], piece), "Export piece out of range.");
+    }
+
+    uint8_t past_end;
+    expect(!mm_wildlife_statistics_export(DEFAULT_GRID_ID, size, &past_end, 1), "Exported past the end.");
+
+    auto get_export_count = [&](uint16_t position)
+    {
+        return (uint16_t)(export_data[position] | (export_data[position + 1] << 8));
+    };
+
+    uint16_t position = 0;
+
+    for (uint16_t region = 0; region < ACTIVITY_VARIABLES_NUM; ++region)
+    {
+        for (uint8_t hour = 0; hour < STATISTICS_HOURS_PER_DAY; ++hour, position += 2)
+        {
+            expect(get_export_count(position) == get_statistic(WILDLIFE_STATISTIC_REGION_HOURLY, region, hour), "Exported region count differs.");
+        }
+    }
+
+    for (uint16_t sensor_type = 0; sensor_type < SENSOR_TYPE_COUNT; ++sensor_type)
+    {
+        for (uint8_t bucket = 0; bucket < DURATION_HISTOGRAM_BUCKETS; ++bucket, position += 2)
+        {
+            expect(get_export_count(position) == get_statistic(WILDLIFE_STATISTIC_DURATION, sensor_type, bucket), "Exported duration count differs.");
+        }
+    }
+
+    uint16_t sensors_found = 0;
+
+    while (position < size)
+    {
+        uint16_t node_id = get_export_count(position);
+        sensor_rotation_t rotation = (sensor_rotation_t)export_data[position + 2];
+        position += 3;
+
+        for (uint8_t days_ago = 0; days_ago < STATISTICS_DAYS_PER_WEEK; ++days_ago, position += 2)
+        {
+            if (node_id == 0)
+            {
+                expect(get_export_count(position) == 0, "Exported counts for a missing sensor.");
+                continue;
+            }
+
+            uint16_t count;
+            expect(mm_wildlife_statistics_get_sensor_daily(DEFAULT_GRID_ID, node_id, rotation, days_ago, &count), "Exported sensor does not exist.");
+            expect(get_export_count(position) == count, "Exported daily count differs.");
+        }
+
+        sensors_found += (node_id != 0);
+    }
+
+    expect(sensors_found >= 2, "Detecting sensors are missing from the export.");
+    expect(get_sensor_daily(1, -1, SENSOR_ROTATION_270, 1) == 1, "Yesterday's lidar detection was lost.");
+
+    simulate_time(MINUTES(2));
+}
+
+// Sums the region counts for an hour of the day across the whole default grid.
+static uint32_t get_region_total(uint8_t hour)
+{
+    uint32_t total = 0;
+
+    for (uint16_t region = 0; region < ACTIVITY_VARIABLES_NUM; ++region)
+    {
+        total += get_statistic(WILDLIFE_STATISTIC_REGION_HOURLY, region, hour);
+    }
+
+    return total;
+}
+
+// Gets one counter from the default grid, throwing if it doesn't exist.
+static uint16_t get_statistic(wildlife_statistic_t statistic, uint16_t index, uint8_t bucket)
+{
+    uint16_t count;
+    expect(mm_wildlife_statistics_get(DEFAULT_GRID_ID, statistic, index, bucket, &count), "Statistic does not exist.");
+
+    return count;
+}
+
+// Gets a sensor's daily count from the default grid, throwing if it doesn't exist.
+static uint16_t get_sensor_daily(int8_t x, int8_t y, sensor_rotation_t total_rotation, uint8_t days_ago)
+{
+    // Sensors are known by their rotation on the node, same as test_send_lidar_data.
+    mm_node_position_t const * node = get_node_for_position(DEFAULT_GRID_ID, x, y);
+    sensor_rotation_t rotation = (sensor_rotation_t)((NODE_ROTATION_COUNT + total_rotation - node->node_rotation) % NODE_ROTATION_COUNT);
+
+    uint16_t count;
+    expect(mm_wildlife_statistics_get_sensor_daily(DEFAULT_GRID_ID, node->node_id, rotation, days_ago, &count), "Sensor statistic does not exist.");
+
+    return count;
+}
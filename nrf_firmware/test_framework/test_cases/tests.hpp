@@ -74,4 +74,28 @@ void test_one_animal_zig_zag(std::vector<TestCase>& tests);
 // Add the tests for sensors that are not working.
 void test_sensors_not_working(std::vector<TestCase>& tests);
 
+// Add the tests for how quickly the LEDs respond to detections.
+void test_detection_latency_add_tests(std::vector<TestCase>& tests);
+
+// Add the tests for how often the algorithm wakes up while idle.
+void test_idle_wakeups_add_tests(std::vector<TestCase>& tests);
+
+// Add the tests for the gateway's node position table.
+void test_position_table_add_tests(std::vector<TestCase>& tests);
+
+// Add the tests for a gateway running more than one sensor grid.
+void test_multiple_grids_add_tests(std::vector<TestCase>& tests);
+
+// Add the tests for algorithm config updates applied while the algorithm is running.
+void test_algorithm_config_update_add_tests(std::vector<TestCase>& tests);
+
+// Add the tests for predicting where tracked animals will reach the road.
+void test_trajectory_prediction_add_tests(std::vector<TestCase>& tests);
+
+// Add the tests for the long term wildlife statistics kept by the gateway.
+void test_wildlife_statistics_add_tests(std::vector<TestCase>& tests);
+
+// Add the tests for carrying algorithm state across a gateway reset.
+void test_warm_restart_add_tests(std::vector<TestCase>& tests);
+
 #endif /* TESTS_HPP */
\ No newline at end of file
@@ -27,11 +27,12 @@ notes:
 
 void TestOutput::initOracle(void)
 {
-    /* Fetch top 3 positions */
+    /* Fetch roadside positions */
     std::vector<mm_node_position_t const *> outputNodes;
-    outputNodes.push_back(get_node_for_position(-1, 1));
-    outputNodes.push_back(get_node_for_position(0, 1));
-    outputNodes.push_back(get_node_for_position(1, 1));
+    for (int8_t x = GRID_POSITION_MIN_X; x <= GRID_POSITION_MAX_X; ++x)
+    {
+        outputNodes.push_back(get_node_for_position(DEFAULT_GRID_ID, x, GRID_POSITION_LED_Y));
+    }
 
     /* Put an idle event onto the oracle for each */
     for (auto node : outputNodes)
@@ -61,7 +62,7 @@ void TestOutput::logLedUpdate
     logLedUpdate(
         LedUpdate{
             get_simulated_time_elapsed(),
-            get_node_for_position(x, y)->node_id,
+            get_node_for_position(DEFAULT_GRID_ID, x, y)->node_id,
             ledFunctionM,
             ledColourM
         }
@@ -73,7 +74,20 @@ void TestOutput::logLedUpdate(LedUpdate const & update)
     ledUpdatesM.push_back(update);
 }
 
-float TestOutput::getMatchScore(TestOutput const & result, TestOutput const & oracle)
+LedUpdate const * TestOutput::getLastLedUpdate(uint16_t targetNodeId) const
+{
+    for (auto it = ledUpdatesM.rbegin(); it != ledUpdatesM.rend(); ++it)
+    {
+        if (it->targetNodeIdM == targetNodeId)
+        {
+            return &(*it);
+        }
+    }
+
+    return NULL;
+}
+
+float TestOutput::getMatchScore(TestOutput const & result, TestOutput const & oracle, uint32_t endTime_s)
 {
     uint32_t max_correct_on_time = 0;
     uint32_t max_correct_off_time = 0;
@@ -90,8 +104,9 @@ float TestOutput::getMatchScore(TestOutput const & result, TestOutput const & or
     /* Run through the oracle output second by second */
     for(uint32_t t = 0; true; ++t)
     {
-        /* If there are no more led update events to process then the comparison is over. */
-        if (resultIt >= result.ledUpdatesM.size() && oracleIt >= oracle.ledUpdatesM.size())
+        /* If there are no more led update events to process and the test is over then so is the comparison.
+         * LED control doesn't repeat states, so the last outputs hold until the end of the test. */
+        if (resultIt >= result.ledUpdatesM.size() && oracleIt >= oracle.ledUpdatesM.size() && t > endTime_s)
         {
             break;
         }
@@ -187,4 +202,118 @@ float TestOutput::getMatchScore(TestOutput const & result, TestOutput const & or
     float score = std::pow(correct_on_f, ON_TIME_WEIGHT) * std::pow(correct_off_f, OFF_TIME_WEIGHT);
 
     return score;
+}
+
+float TestOutput::getEscalationLatency(TestOutput const & result, TestOutput const & oracle)
+{
+    uint32_t total_latency = 0;
+    uint32_t matched_updates = 0;
+
+    for (auto const & oracleUpdate : oracle.ledUpdatesM)
+    {
+        /* Only the time taken to turn an led on is of interest. */
+        if (oracleUpdate.ledFunctionM == LED_FUNCTION_LEDS_OFF)
+        {
+            continue;
+        }
+
+        LedUpdate const * current = NULL;
+        LedUpdate const * reached = NULL;
+
+        for (auto const & resultUpdate : result.ledUpdatesM)
+        {
+            if (resultUpdate.targetNodeIdM != oracleUpdate.targetNodeIdM)
+            {
+                continue;
+            }
+
+            if (resultUpdate.time_s <= oracleUpdate.time_s)
+            {
+                /* Track what the led is showing when the oracle expects the change. */
+                current = &resultUpdate;
+            }
+            else if (resultUpdate.ledFunctionM == oracleUpdate.ledFunctionM &&
+                     resultUpdate.ledColourM == oracleUpdate.ledColourM)
+            {
+                /* First time after the oracle update that the result catches up. */
+                reached = &resultUpdate;
+                break;
+            }
+        }
+
+        if (current != NULL &&
+            current->ledFunctionM == oracleUpdate.ledFunctionM &&
+            current->ledColourM == oracleUpdate.ledColourM)
+        {
+            /* Result was already showing the right output, no lag. */
+            matched_updates++;
+        }
+        else if (reached != NULL)
+        {
+            total_latency += reached->time_s - oracleUpdate.time_s;
+            matched_updates++;
+        }
+    }
+
+    if (!matched_updates)
+    {
+        return 0.0f;
+    }
+
+    return total_latency / (float)matched_updates;
+}
+
+float TestOutput::getEscalationLeadTime(TestOutput const & result, TestOutput const & oracle)
+{
+    uint32_t total_lead = 0;
+    uint32_t on_updates = 0;
+
+    for (auto const & oracleUpdate : oracle.ledUpdatesM)
+    {
+        /* Only the time taken to turn an led on is of interest. */
+        if (oracleUpdate.ledFunctionM == LED_FUNCTION_LEDS_OFF)
+        {
+            continue;
+        }
+
+        on_updates++;
+
+        /* Find when the result last started showing the oracle's output, if it still is. */
+        bool is_showing = false;
+        uint32_t showing_since_s = 0;
+
+        for (auto const & resultUpdate : result.ledUpdatesM)
+        {
+            if (resultUpdate.targetNodeIdM != oracleUpdate.targetNodeIdM)
+            {
+                continue;
+            }
+
+            if (resultUpdate.time_s > oracleUpdate.time_s)
+            {
+                break;
+            }
+
+            bool matches = resultUpdate.ledFunctionM == oracleUpdate.ledFunctionM &&
+                           resultUpdate.ledColourM == oracleUpdate.ledColourM;
+
+            if (matches && !is_showing)
+            {
+                showing_since_s = resultUpdate.time_s;
+            }
+            is_showing = matches;
+        }
+
+        if (is_showing)
+        {
+            total_lead += oracleUpdate.time_s - showing_since_s;
+        }
+    }
+
+    if (!on_updates)
+    {
+        return 0.0f;
+    }
+
+    return total_lead / (float)on_updates;
 }
\ No newline at end of file
@@ -15,6 +15,7 @@ notes:
 extern "C" {
 #include "mm_led_control.h"
 #include "mm_position_config.h"
+#include "mm_sensor_algorithm_config.h"
 }
 
 
@@ -54,9 +55,27 @@ public:
         );
 
     /**
-     * Calculate to what degree result matches oracle (0 to 1 score)
+     * Get the most recent led update for a node, or NULL if the node has never been updated.
      */
-    static float getMatchScore(TestOutput const & result, TestOutput const & oracle);
+    LedUpdate const * getLastLedUpdate(uint16_t targetNodeId) const;
+
+    /**
+     * Calculate to what degree result matches oracle (0 to 1 score), second by second
+     * up to endTime_s or the last update, whichever is later.
+     */
+    static float getMatchScore(TestOutput const & result, TestOutput const & oracle, uint32_t endTime_s);
+
+    /**
+     * Calculate the average number of seconds result lags behind oracle when an
+     * led is supposed to turn on. Oracle updates the result never reaches are not counted.
+     */
+    static float getEscalationLatency(TestOutput const & result, TestOutput const & oracle);
+
+    /**
+     * Calculate the average number of seconds result was already showing an led's
+     * output before oracle turns it on. Oracle updates result isn't showing count as 0.
+     */
+    static float getEscalationLeadTime(TestOutput const & result, TestOutput const & oracle);
 private:
 
     /**
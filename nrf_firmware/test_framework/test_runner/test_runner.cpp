@@ -13,6 +13,8 @@ notes:
 #include "test_runner.hpp"
 #include "test_output_logger.hpp"
 #include "mm_led_control.hpp"
+#include "mm_flash_storage.hpp"
+#include "mm_channel_period_control.hpp"
 
 extern "C" {
 #include "mm_sensor_algorithm_config.h"
@@ -21,7 +23,9 @@ extern "C" {
 #include "mm_monitoring_dispatch.h"
 #include "mm_position_config.h"
 #include "mm_led_control.h"
+#include "mm_channel_period_control.h"
 #include "mm_av_transmission.h"
+#include "mm_trajectory_tracker.h"
 }
 
 
@@ -30,6 +34,7 @@ extern "C" {
 **********************************************************/
 
 static mm_sensor_algorithm_config_t const * sensor_algorithm_config;
+static bool is_measuring_prediction_gain;
 
 /**********************************************************
                        DECLARATIONS
@@ -40,6 +45,12 @@ static mm_sensor_algorithm_config_t const * sensor_algorithm_config;
  */
 static float run_test_case(TestCase const & test);
 
+/**
+ * Run a particular test without trajectory predictions, and get how much lead time
+ * the LEDs have over the oracle without them.
+ */
+static float get_unpredicted_lead_time(TestCase const & test);
+
 /**
  * Prepare for test run by initializing all components and utilities.
  */
@@ -54,9 +65,10 @@ static void deinit_test_case(void);
                        DEFINITIONS
 **********************************************************/
 
-float test_runner_init(std::vector<TestCase> const & tests, mm_sensor_algorithm_config_t const * config)
+float test_runner_init(std::vector<TestCase> const & tests, mm_sensor_algorithm_config_t const * config, bool measure_prediction_gain)
 {
 	sensor_algorithm_config = config;
+    is_measuring_prediction_gain = measure_prediction_gain;
     float overall_score = 0;
 
 	for (int i = 0; i < tests.size(); i++)
@@ -69,6 +81,15 @@ float test_runner_init(std::vector<TestCase> const & tests, mm_sensor_algorithm_
 static float run_test_case(TestCase const & test)
 {
     float test_score = 0.0f;
+    float test_latency = 0.0f;
+    float test_lead_time = 0.0f;
+    float unpredicted_lead_time = 0.0f;
+
+    /* Doubles the run time, so the genetic algorithm's runs skip it. */
+    if (is_measuring_prediction_gain)
+    {
+        unpredicted_lead_time = get_unpredicted_lead_time(test);
+    }
 
     init_test_case(test.test_name);
 
@@ -78,7 +99,9 @@ static float run_test_case(TestCase const & test)
         oracle.initOracle();
         test.test(oracle);
         auto result = test_led_control_get_output();
-        test_score = TestOutput::getMatchScore(result, oracle);
+        test_score = TestOutput::getMatchScore(result, oracle, get_simulated_time_elapsed());
+        test_latency = TestOutput::getEscalationLatency(result, oracle);
+        test_lead_time = TestOutput::getEscalationLeadTime(result, oracle);
     }
     catch (const std::exception& ex) /* Catch everything, who knows what the test code could do! */
     {
@@ -88,17 +111,56 @@ static float run_test_case(TestCase const & test)
     deinit_test_case();
 
     std::cout << "Ran " << test.test_name << " with score of " << test_score << std::endl;
+    std::cout << "    average escalation latency of " << test_latency << "s" << std::endl;
+    std::cout << "    average escalation lead time of " << test_lead_time << "s";
+    if (is_measuring_prediction_gain)
+    {
+        std::cout << ", " << test_lead_time - unpredicted_lead_time << "s gained from trajectory prediction";
+    }
+    std::cout << std::endl;
+    std::cout << "    " << mm_sensor_algorithm_get_wakeup_count() << " timer wakeups over " << get_simulated_time_elapsed() << "s" << std::endl;
+    std::cout << "    " << test_channel_period_get_switch_count() << " channel period switches, "
+              << test_channel_period_get_low_power_fraction() * 100 << "% of the time at the low-power period" << std::endl;
+    std::cout << "    radio duty of " << test_channel_period_get_relative_radio_duty() * 100 << "% of a fixed low-latency period, "
+              << "average message latency of " << test_channel_period_get_average_latency_ms() << "ms" << std::endl;
 
     return test_score;
 }
 
+static float get_unpredicted_lead_time(TestCase const & test)
+{
+    float lead_time = 0.0f;
+
+    init_test_case(test.test_name);
+    mm_trajectory_tracker_set_predictions_enabled(false);
+
+    try
+    {
+        TestOutput oracle;
+        oracle.initOracle();
+        test.test(oracle);
+        lead_time = TestOutput::getEscalationLeadTime(test_led_control_get_output(), oracle);
+    }
+    catch (const std::exception&)
+    {
+        /* Failures are reported by the real run. */
+    }
+
+    mm_trajectory_tracker_set_predictions_enabled(true);
+    deinit_test_case();
+
+    return lead_time;
+}
+
 static void init_test_case(std::string const & test_name)
 {
     simulate_time_init();
     mm_position_config_init();
     mm_led_control_init();
+    mm_channel_period_control_init();
     mm_monitoring_dispatch_init();
     mm_sensor_transmission_init();
+    test_flash_storage_erase();
     mm_sensor_algorithm_init(sensor_algorithm_config);
     mm_av_transmission_init();
 
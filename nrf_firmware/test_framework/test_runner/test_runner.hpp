@@ -32,6 +32,10 @@ extern "C" {
                        DECLARATIONS
 **********************************************************/
 
-float test_runner_init(std::vector<TestCase> const & tests, mm_sensor_algorithm_config_t const * config);
+/**
+ * Run every test and get the average score. With measure_prediction_gain each test
+ * is run a second time without trajectory predictions, to report the lead time they add.
+ */
+float test_runner_init(std::vector<TestCase> const & tests, mm_sensor_algorithm_config_t const * config, bool measure_prediction_gain);
 
 #endif /* TEST_RUNNER_HPP */
\ No newline at end of file
@@ -0,0 +1,77 @@
+/**
+file: expect_utils.cpp
+brief: Checks shared by the test cases, each throws with a message when it fails
+notes:
+*/
+
+/**********************************************************
+                        INCLUDES
+**********************************************************/
+
+#include <stdexcept>
+#include <sstream>
+
+#include "expect_utils.hpp"
+#include "simulate_time.hpp"
+#include "mm_led_control.hpp"
+
+extern "C" {
+#include "mm_position_config.h"
+}
+
+/**********************************************************
+                       DEFINITIONS
+**********************************************************/
+
+void expect(bool check, char const * message)
+{
+    if (!check)
+    {
+        std::stringstream ss;
+        ss << message << " At " << get_simulated_time_elapsed() << "s.";
+        throw std::runtime_error(ss.str());
+    }
+}
+
+void expect_led_output(uint8_t grid_id, int8_t x, int8_t y, led_function_t led_function, led_colours_t led_colour)
+{
+    uint16_t node_id = get_node_for_position(grid_id, x, y)->node_id;
+    LedUpdate const * update = test_led_control_get_output().getLastLedUpdate(node_id);
+
+    bool matches = (update != NULL) && (update->ledFunctionM == led_function);
+    if (matches && led_function != LED_FUNCTION_LEDS_OFF)
+    {
+        matches = (update->ledColourM == led_colour);
+    }
+
+    if (!matches)
+    {
+        std::stringstream ss;
+        ss << "LED on node ID " << node_id << " in grid " << (int)grid_id << " is not showing function " << led_function
+           << " colour " << led_colour << " at " << get_simulated_time_elapsed() << "s.";
+        throw std::runtime_error(ss.str());
+    }
+}
+
+void expect_led_output(int8_t x, int8_t y, led_function_t led_function, led_colours_t led_colour)
+{
+    expect_led_output(DEFAULT_GRID_ID, x, y, led_function, led_colour);
+}
+
+mm_activity_variable_t get_max_activity_variable(void)
+{
+    mm_activity_variable_t max_av = *mm_av_access(DEFAULT_GRID_ID, 0, 0);
+
+    for (uint8_t x = 0; x < MAX_AV_SIZE_X; ++x)
+    {
+        for (uint8_t y = 0; y < MAX_AV_SIZE_Y; ++y)
+        {
+            if (*mm_av_access(DEFAULT_GRID_ID, x, y) > max_av)
+            {
+                max_av = *mm_av_access(DEFAULT_GRID_ID, x, y);
+            }
+        }
+    }
+
+    return max_av;
+}
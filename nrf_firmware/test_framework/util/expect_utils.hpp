@@ -0,0 +1,36 @@
+/**
+file: expect_utils.hpp
+brief: Checks shared by the test cases, each throws with a message when it fails
+notes:
+*/
+#ifndef EXPECT_UTILS_HPP
+#define EXPECT_UTILS_HPP
+
+/**********************************************************
+                        INCLUDES
+**********************************************************/
+
+#include <stdint.h>
+
+extern "C" {
+#include "mm_led_control.h"
+#include "mm_activity_variables.h"
+}
+
+/**********************************************************
+                       DECLARATIONS
+**********************************************************/
+
+/* Throws with a message if a check fails. */
+void expect(bool check, char const * message);
+
+/* Throws if the LED at (x, y) in a grid isn't currently showing the requested output. */
+void expect_led_output(uint8_t grid_id, int8_t x, int8_t y, led_function_t led_function, led_colours_t led_colour);
+
+/* Throws if the LED at (x, y) in the default grid isn't currently showing the requested output. */
+void expect_led_output(int8_t x, int8_t y, led_function_t led_function, led_colours_t led_colour);
+
+/* Gets the largest activity variable in the default grid. */
+mm_activity_variable_t get_max_activity_variable(void);
+
+#endif /* EXPECT_UTILS_HPP */